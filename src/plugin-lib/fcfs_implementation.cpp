@@ -44,6 +44,7 @@ bool FcfsImplementation::schedule(const std::vector<const SwmJob *> &jobs,
   if (events == nullptr || tts == nullptr) {
     throw std::runtime_error("FcfsImplementation::schedule(): \"events\" and \"tts\" cannot be equal to nullptr");
   }
+  TraceSpan span(events->trace(), "fcfs.schedule");
 
   // Sort jobs according to their priorities and gang id
   const std::vector<const SwmJob *> *jobs_ref = &jobs;
@@ -69,9 +70,25 @@ bool FcfsImplementation::schedule(const std::vector<const SwmJob *> &jobs,
   uint64_t gang_start_time = 0;
   tts->resize(jobs_ref->size());
   size_t tt_number = 0;
+
+  // Token is checked for every job, the clock is much slower, so it's checked for the first job
+  // and then once per 64 jobs. Interrupted schedule fails, but jobs placed so far are kept
+  // as the partial result, only the gang that is still being placed is dropped (its rest
+  // can't be aligned anymore)
+  const auto &token = events->cancellation_token();
+  const auto deadline = events->deadline();
+  const bool has_deadline = deadline != PluginEventsInterface::clock::time_point::max();
+  bool interrupted = false;
   for (size_t i = 0; i < jobs_ref->size(); i++) {
-    if (events->forced_to_interrupt()) {
-      return false;
+    if (token.cancelled() ||
+        (has_deadline && (i & 63) == 0 && PluginEventsInterface::clock::now() >= deadline)) {
+      if (!gang_id.empty() && (*jobs_ref)[i]->get_gang_id() == gang_id) {
+        tt_number -= gang_jobs.size();
+        gang_id.clear();
+      }
+      *error << "scheduling was interrupted, " << tt_number << " of " << jobs_ref->size() << " jobs are placed";
+      interrupted = true;
+      break;
     }
 
     const auto job = (*jobs_ref)[i];
@@ -146,7 +163,7 @@ bool FcfsImplementation::schedule(const std::vector<const SwmJob *> &jobs,
     align_jobs(&gang_jobs, &jobs_to_endtimes, gang_start_time);
   }
   tts->resize(tt_number);
-  return true;
+  return !interrupted;
 }
 
 void FcfsImplementation::close() {
@@ -32,6 +32,7 @@ class FcfsImplementation {
   void operator =(const FcfsImplementation &) = delete;
 
   bool init(const SchedulingInfoInterface *sched_info, std::stringstream *error = nullptr);
+  // Fails when it's cancelled or the deadline is over, "tts" has the jobs that were placed so far then
   bool schedule(const std::vector<const SwmJob *> &jobs,
                 PluginEventsInterface *events,
                 std::vector<SwmTimetable> *tts,
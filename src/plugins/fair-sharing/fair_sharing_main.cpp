@@ -31,8 +31,14 @@ bool swm_construct_timetable(void *,
 
   swm::FcfsImplementation fcfs;
   std::vector<swm::SwmTimetable> tts;
-  if (!fcfs.init(sched_info, error) ||
-      !fcfs.schedule(sched_info->jobs(), events, &tts, false, error)) {
+  if (!fcfs.init(sched_info, error)) {
+    return false;
+  }
+  if (!fcfs.schedule(sched_info->jobs(), events, &tts, false, error)) {
+    // Interrupted: the placed jobs are the intermediate result, not the constructed timetable
+    if (!tts.empty()) {
+      events->commit_intermediate_timetable(std::shared_ptr<swm::TimetableInfoInterface>(new TimetableInfo(&tts)));
+    }
     return false;
   }
 
@@ -15,9 +15,23 @@ CliArgs::CliArgs() {
   parser_->register_flag("-d", "--debug", &debug_flag_);
   parser_->register_flag("-i", "--input", &input_flag_, &input_value_);
   parser_->register_flag("-p", "--plugins", &plugins_flag_, &plugins_value_);
+  parser_->register_flag("-s", "--socket", &socket_flag_, &socket_value_);
+  parser_->register_flag(std::string(), "--client-queue", &client_queue_flag_, &client_queue_value_);
+  parser_->register_flag(std::string(), "--client-stall", &client_stall_flag_, &client_stall_value_);
+  parser_->register_flag(std::string(), "--shm", &shm_flag_, &shm_value_);
+  parser_->register_flag(std::string(), "--shm-size", &shm_size_flag_, &shm_size_value_);
   parser_->register_flag(std::string(), "--in-queue", &in_queue_flag_, &in_queue_value_);
   parser_->register_flag(std::string(), "--out-queue", &out_queue_flag_, &out_queue_value_);
   parser_->register_flag(std::string(), "--timeout", &timeout_flag_, &timeout_value_);
+  parser_->register_flag(std::string(), "--compress", &compress_flag_, &compress_value_);
+  parser_->register_flag(std::string(), "--coalesce", &coalesce_flag_);
+  parser_->register_flag(std::string(), "--memoize", &memoize_flag_, &memoize_value_);
+  parser_->register_flag(std::string(), "--reply-metrics", &reply_metrics_flag_);
+  parser_->register_flag(std::string(), "--record", &record_flag_, &record_value_);
+  parser_->register_flag(std::string(), "--record-slow", &record_slow_flag_, &record_slow_value_);
+  parser_->register_flag(std::string(), "--replay", &replay_flag_, &replay_value_);
+  parser_->register_flag(std::string(), "--replay-speed", &replay_speed_flag_, &replay_speed_value_);
+  parser_->register_flag(std::string(), "--trace", &trace_flag_, &trace_value_);
 }
 
 bool CliArgs::try_parse(const std::string &val, size_t *pval) {
@@ -61,6 +75,46 @@ bool CliArgs::init(int argc, const char * const argv[], std::stringstream *error
     return false;
   }
   
+  if (socket_flag_ && input_flag_) {
+    *errors << "flags \"-s\" and \"-i\" cannot be used together";
+    return false;
+  }
+
+  if ((client_queue_flag_ || client_stall_flag_) && !socket_flag_) {
+    *errors << "flags \"--client-queue\" and \"--client-stall\" require \"-s\"";
+    return false;
+  }
+
+  if (shm_flag_ && (socket_flag_ || input_flag_)) {
+    *errors << "flag \"--shm\" cannot be used with \"-s\" and \"-i\"";
+    return false;
+  }
+
+  if (shm_size_flag_ && !shm_flag_) {
+    *errors << "flag \"--shm-size\" requires \"--shm\"";
+    return false;
+  }
+
+  if (replay_flag_ && !util::file_exist(replay_value_)) {
+    *errors << "recording defined by flag \"--replay\" not exists";
+    return false;
+  }
+
+  if (replay_flag_ && (input_flag_ || socket_flag_ || shm_flag_ || record_flag_)) {
+    *errors << "flag \"--replay\" cannot be used with \"-i\", \"-s\", \"--shm\" and \"--record\"";
+    return false;
+  }
+
+  if (record_slow_flag_ && !record_flag_) {
+    *errors << "flag \"--record-slow\" requires \"--record\"";
+    return false;
+  }
+
+  if (replay_speed_flag_ && !replay_flag_) {
+    *errors << "flag \"--replay-speed\" requires \"--replay\"";
+    return false;
+  }
+
   if (plugins_flag_ && !util::directory_exist(plugins_value_)) {
     *errors << "plug-in directory defined by flag \"-p\" not exists";
     return false;
@@ -85,6 +139,48 @@ bool CliArgs::init(int argc, const char * const argv[], std::stringstream *error
     return false;
   }
 
+  if (compress_flag_ && !try_parse(compress_value_, &compress_pvalue_)) {
+    *errors << "value \"" << compress_value_
+            << "\" defined by flag \"--compress\" cannot be casted to size_t";
+    return false;
+  }
+
+  if (memoize_flag_ && (!try_parse(memoize_value_, &memoize_pvalue_) || memoize_pvalue_ == 0)) {
+    *errors << "value \"" << memoize_value_
+            << "\" defined by flag \"--memoize\" cannot be casted to positive size_t";
+    return false;
+  }
+
+  if (client_queue_flag_ && (!try_parse(client_queue_value_, &client_queue_pvalue_) || client_queue_pvalue_ == 0)) {
+    *errors << "value \"" << client_queue_value_
+            << "\" defined by flag \"--client-queue\" cannot be casted to positive size_t";
+    return false;
+  }
+
+  if (client_stall_flag_ && (!try_parse(client_stall_value_, &client_stall_pvalue_) || client_stall_pvalue_ <= 0.0)) {
+    *errors << "value \"" << client_stall_value_
+            << "\" defined by flag \"--client-stall\" cannot be casted to positive double";
+    return false;
+  }
+
+  if (shm_size_flag_ && (!try_parse(shm_size_value_, &shm_size_pvalue_) || shm_size_pvalue_ == 0)) {
+    *errors << "value \"" << shm_size_value_
+            << "\" defined by flag \"--shm-size\" cannot be casted to positive size_t";
+    return false;
+  }
+
+  if (record_slow_flag_ && (!try_parse(record_slow_value_, &record_slow_pvalue_) || record_slow_pvalue_ <= 0.0)) {
+    *errors << "value \"" << record_slow_value_
+            << "\" defined by flag \"--record-slow\" cannot be casted to positive double";
+    return false;
+  }
+
+  if (replay_speed_flag_ && (!try_parse(replay_speed_value_, &replay_speed_pvalue_) || replay_speed_pvalue_ < 0.0)) {
+    *errors << "value \"" << replay_speed_value_
+            << "\" defined by flag \"--replay-speed\" cannot be casted to non-negative double";
+    return false;
+  }
+
   return true;
 }
 
@@ -98,9 +194,16 @@ void CliArgs::format_help_message(std::ostream *stream) {
   *stream << "Usage:" << std::endl;
   *stream << std::endl;
   *stream << "swm-sched {-h|--help}" << std::endl;
-  *stream << "swm-sched [{-d|--debug}] [{-p|--plugins} <PLUGINS>] [{-i|--input} <INPUT>]" << std::endl;
+  *stream << "swm-sched [{-d|--debug}] [{-p|--plugins} <PLUGINS>]" << std::endl;
+  *stream << "          [{-i|--input} <INPUT> |" << std::endl;
+  *stream << "           {-s|--socket} <SOCKET> [--client-queue <SIZE>] [--client-stall <SECONDS>] |" << std::endl;
+  *stream << "           --shm <HANDSHAKE> [--shm-size <BYTES>]]" << std::endl;
   *stream << "          [--in_queue <IN_QUEUE_SIZE>] [--out_queue <IN_QUEUE_SIZE>]" << std::endl;
-  *stream << "          [--timeout <TIMEOUT>]" << std::endl;
+  *stream << "          [--timeout <TIMEOUT>] [--compress <THRESHOLD>]" << std::endl;
+  *stream << "          [--coalesce] [--memoize <CAPACITY>] [--reply-metrics]" << std::endl;
+  *stream << "          [--record <RECORDING> [--record-slow <SECONDS>]] [--trace <TRACE>]" << std::endl;
+  *stream << "swm-sched [{-p|--plugins} <PLUGINS>] --replay <RECORDING> [--replay-speed <FACTOR>]" << std::endl;
+  *stream << "          [--trace <TRACE>]" << std::endl;
   *stream << std::endl;
   *stream << "where" << std::endl;
   *stream << "     -h, --help:" << std::endl;
@@ -113,6 +216,23 @@ void CliArgs::format_help_message(std::ostream *stream) {
   *stream << "     -i, --input:" << std::endl;
   *stream << "          forces to read commands from file with name <INPUT> instead of" << std::endl;
   *stream << "          standard input" << std::endl;
+  *stream << "     -s, --socket:" << std::endl;
+  *stream << "          serves clients connected to Unix domain socket <SOCKET> instead of" << std::endl;
+  *stream << "          standard input and output. Plugins, thread pools and caches are" << std::endl;
+  *stream << "          shared by all the clients" << std::endl;
+  *stream << "     --client-queue:" << std::endl;
+  *stream << "          specifies size of the response queue of every client, the ones" << std::endl;
+  *stream << "          beyond it are kept until the client reads. In pcs., the default" << std::endl;
+  *stream << "          value is 64" << std::endl;
+  *stream << "     --client-stall:" << std::endl;
+  *stream << "          client that reads none of its responses for <SECONDS> is" << std::endl;
+  *stream << "          disconnected. The default value is 10.0" << std::endl;
+  *stream << "     --shm:" << std::endl;
+  *stream << "          waits for a co-located client on Unix domain socket <HANDSHAKE>," << std::endl;
+  *stream << "          passes it two shared memory rings (commands and responses) and" << std::endl;
+  *stream << "          serves it through them instead of standard input and output" << std::endl;
+  *stream << "     --shm-size:" << std::endl;
+  *stream << "          capacity of each ring. In bytes, the default value is 16777216" << std::endl;
   *stream << "     --in-queue:" << std::endl;
   *stream << "          specifies size of the input command queue. If it is exceeded new" << std::endl;
   *stream << "          commands will not be read from input. In pcs., the default" << std::endl;
@@ -124,6 +244,37 @@ void CliArgs::format_help_message(std::ostream *stream) {
   *stream << "     --timeout:" << std::endl;
   *stream << "          sets timeout for SWM_COMMAND_INTERRUPT, SWM_COMMAND_EXCHANGE and" << std::endl;
   *stream << "          SWM_COMMAND_COMMAND. In seconds, the default value is 10.0" << std::endl;
+  *stream << "     --compress:" << std::endl;
+  *stream << "          responses of at least <THRESHOLD> bytes are sent as compressed" << std::endl;
+  *stream << "          erlang terms. In bytes, the default value 0 disables compression." << std::endl;
+  *stream << "     --coalesce:" << std::endl;
+  *stream << "          newer schedule request of the same client and grid (or clusters)" << std::endl;
+  *stream << "          replaces the queued and running ones, they are answered with" << std::endl;
+  *stream << "          SWM_RESULT_SUPERSEDED. Disabled by default" << std::endl;
+  *stream << "     --memoize:" << std::endl;
+  *stream << "          keeps results of the last <CAPACITY> inputs and answers identical" << std::endl;
+  *stream << "          schedule requests (same input, schedulers and chain options)" << std::endl;
+  *stream << "          with them for 60 seconds. Disabled by default" << std::endl;
+  *stream << "     --reply-metrics:" << std::endl;
+  *stream << "          answers SWM_COMMAND_METRICS with the service metrics (counters" << std::endl;
+  *stream << "          and latency percentiles) in a scheduler_result. Disabled by" << std::endl;
+  *stream << "          default, the command has no answer then" << std::endl;
+  *stream << "     --record:" << std::endl;
+  *stream << "          writes every received command with its arrival time to file" << std::endl;
+  *stream << "          <RECORDING>, so the stream can be replayed offline" << std::endl;
+  *stream << "     --record-slow:" << std::endl;
+  *stream << "          keeps only the requests answered slower than <SECONDS> (and the" << std::endl;
+  *stream << "          ones left without answers) in the recording" << std::endl;
+  *stream << "     --replay:" << std::endl;
+  *stream << "          feeds commands of <RECORDING> to the scheduler instead of reading" << std::endl;
+  *stream << "          standard input, prints latency of every request and exits" << std::endl;
+  *stream << "     --replay-speed:" << std::endl;
+  *stream << "          pacing of the replay: 1 keeps the recorded intervals, 2 halves" << std::endl;
+  *stream << "          them, 0 sends commands without pauses. The default value is 1.0" << std::endl;
+  *stream << "     --trace:" << std::endl;
+  *stream << "          records spans of receiving, processing, scheduling and sending" << std::endl;
+  *stream << "          and writes them to file <TRACE> at exit and on SIGUSR1, in Chrome" << std::endl;
+  *stream << "          trace format (open in chrome://tracing or ui.perfetto.dev)" << std::endl;
 }
 
 } // swm
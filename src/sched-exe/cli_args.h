@@ -30,6 +30,56 @@ class CliArgs {
     return plugins_flag_;
   }
 
+  bool has_socket_flag(std::string *value = nullptr) const {
+    if (value != nullptr) { *value = socket_value_; }
+    return socket_flag_;
+  }
+
+  bool has_client_queue_flag(size_t *value = nullptr) const {
+    if (value != nullptr) { *value = client_queue_pvalue_; }
+    return client_queue_flag_;
+  }
+
+  bool has_client_stall_flag(double *value = nullptr) const {
+    if (value != nullptr) { *value = client_stall_pvalue_; }
+    return client_stall_flag_;
+  }
+
+  bool has_shm_flag(std::string *value = nullptr) const {
+    if (value != nullptr) { *value = shm_value_; }
+    return shm_flag_;
+  }
+
+  bool has_shm_size_flag(size_t *value = nullptr) const {
+    if (value != nullptr) { *value = shm_size_pvalue_; }
+    return shm_size_flag_;
+  }
+
+  bool has_record_flag(std::string *value = nullptr) const {
+    if (value != nullptr) { *value = record_value_; }
+    return record_flag_;
+  }
+
+  bool has_record_slow_flag(double *value = nullptr) const {
+    if (value != nullptr) { *value = record_slow_pvalue_; }
+    return record_slow_flag_;
+  }
+
+  bool has_replay_flag(std::string *value = nullptr) const {
+    if (value != nullptr) { *value = replay_value_; }
+    return replay_flag_;
+  }
+
+  bool has_replay_speed_flag(double *value = nullptr) const {
+    if (value != nullptr) { *value = replay_speed_pvalue_; }
+    return replay_speed_flag_;
+  }
+
+  bool has_trace_flag(std::string *value = nullptr) const {
+    if (value != nullptr) { *value = trace_value_; }
+    return trace_flag_;
+  }
+
   bool has_in_queue_flag(size_t *value = nullptr) const {
     if (value != nullptr) { *value = in_queue_pvalue_; }
     return in_queue_flag_;
@@ -45,6 +95,20 @@ class CliArgs {
     return timeout_flag_;
   }
 
+  bool has_coalesce_flag() const { return coalesce_flag_; }
+
+  bool has_reply_metrics_flag() const { return reply_metrics_flag_; }
+
+  bool has_memoize_flag(size_t *value = nullptr) const {
+    if (value != nullptr) { *value = memoize_pvalue_; }
+    return memoize_flag_;
+  }
+
+  bool has_compress_flag(size_t *value = nullptr) const {
+    if (value != nullptr) { *value = compress_pvalue_; }
+    return compress_flag_;
+  }
+
   static void format_help_message(std::ostream *stream);
  
  private:
@@ -56,9 +120,23 @@ class CliArgs {
   bool debug_flag_;
   bool input_flag_; std::string input_value_;
   bool plugins_flag_; std::string plugins_value_;
+  bool socket_flag_; std::string socket_value_;
+  bool client_queue_flag_; std::string client_queue_value_; size_t client_queue_pvalue_;
+  bool client_stall_flag_; std::string client_stall_value_; double client_stall_pvalue_;
+  bool shm_flag_; std::string shm_value_;
+  bool shm_size_flag_; std::string shm_size_value_; size_t shm_size_pvalue_;
   bool in_queue_flag_; std::string in_queue_value_; size_t in_queue_pvalue_;
   bool out_queue_flag_; std::string out_queue_value_; size_t out_queue_pvalue_;
   bool timeout_flag_; std::string timeout_value_; double timeout_pvalue_;
+  bool compress_flag_; std::string compress_value_; size_t compress_pvalue_;
+  bool coalesce_flag_;
+  bool reply_metrics_flag_;
+  bool memoize_flag_; std::string memoize_value_; size_t memoize_pvalue_;
+  bool record_flag_; std::string record_value_;
+  bool record_slow_flag_; std::string record_slow_value_; double record_slow_pvalue_;
+  bool replay_flag_; std::string replay_value_;
+  bool replay_speed_flag_; std::string replay_speed_value_; double replay_speed_pvalue_;
+  bool trace_flag_; std::string trace_value_;
 };
 
 } // swm
@@ -1,12 +1,57 @@
 
 #include <fstream>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <signal.h>
 
 #include "hw/scanner.h"
 #include "alg/algorithm_factory.h"
 #include "ctrl/service.h"
+#include "ctrl/command_replayer.h"
 #include "cli_args.h"
 
+// Thread that handles the blocked signals, it's stopped and joined before the service is destroyed
+class SignalWaiter {
+ public:
+  SignalWaiter(swm::Service *service, const sigset_t &signals)
+      : signals_(signals), done_(false) {
+    // Only these are ever waited for, SIGINT comes along with SIGTERM
+    if (!sigismember(&signals_, SIGUSR1) && !sigismember(&signals_, SIGTERM)) {
+      return;
+    }
+    pthread_sigmask(SIG_BLOCK, &signals_, nullptr);
+    thread_ = std::thread([this, service]() -> void {
+      int signal = 0;
+      while (sigwait(&signals_, &signal) == 0 && !done_) {
+        if (signal == SIGUSR1) {
+          std::stringstream errors;
+          if (!service->dump_trace(&errors)) {
+            std::cerr << "Failed to dump the trace: " << errors.str() << std::endl;
+          }
+        }
+        else {
+          service->stop();
+        }
+      }
+    });
+  }
+  SignalWaiter(const SignalWaiter &) = delete;
+  ~SignalWaiter() {
+    if (thread_.joinable()) {
+      done_ = true;
+      pthread_kill(thread_.native_handle(), sigismember(&signals_, SIGUSR1) ? SIGUSR1 : SIGTERM);
+      thread_.join();
+    }
+  }
+  void operator =(const SignalWaiter &) = delete;
+
+ private:
+  const sigset_t signals_;
+  std::atomic<bool> done_;
+  std::thread thread_;
+};
+
 int main(int argc, char* const argv[]) {
   size_t ivalue;
   double dvalue;
@@ -59,7 +104,66 @@ int main(int argc, char* const argv[]) {
     if (args.has_timeout_flag(&dvalue)) {
       service.set_timeout(dvalue);
     }
+    if (args.has_compress_flag(&ivalue)) {
+      service.set_compression_threshold(ivalue);
+    }
+    if (args.has_coalesce_flag()) {
+      service.set_coalescing(true);
+    }
+    if (args.has_reply_metrics_flag()) {
+      service.set_metrics_replies(true);
+    }
+    if (args.has_memoize_flag(&ivalue)) {
+      service.set_memoization(ivalue, service.get_memoization_ttl());
+    }
     
+    if (args.has_record_flag(&svalue)) {
+      service.set_recording(svalue, args.has_record_slow_flag(&dvalue) ? dvalue : 0.0);
+    }
+
+    // SIGUSR1 dumps the spans collected so far, SIGTERM and SIGINT stop the server gracefully.
+    // They're blocked before the service starts its threads, so only the waiter receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    if (args.has_trace_flag(&svalue)) {
+      service.set_tracing(svalue);
+      sigaddset(&signals, SIGUSR1);
+    }
+    if (args.has_socket_flag(&svalue)) {
+      service.set_socket_path(svalue);
+      if (args.has_client_queue_flag(&ivalue)) {
+        service.set_client_queue_size(ivalue);
+      }
+      if (args.has_client_stall_flag(&dvalue)) {
+        service.set_client_stall_timeout(dvalue);
+      }
+      sigaddset(&signals, SIGTERM);
+      sigaddset(&signals, SIGINT);
+    }
+    if (args.has_shm_flag(&svalue)) {
+      service.set_shm(svalue, args.has_shm_size_flag(&ivalue) ? ivalue : service.get_shm_capacity());
+      sigaddset(&signals, SIGTERM);
+      sigaddset(&signals, SIGINT);
+    }
+    SignalWaiter waiter(&service, signals);
+
+    // Replay takes the transport of the service and reports to standard output
+    if (args.has_replay_flag(&svalue)) {
+      std::vector<swm::util::CommandRecorder::Entry> entries;
+      std::vector<swm::util::CommandReplayer::Result> results;
+      swm::util::CommandReplayer replayer;
+      if (args.has_replay_speed_flag(&dvalue)) {
+        replayer.set_speed(dvalue);
+      }
+      if (!swm::util::CommandRecorder::load(svalue, &entries, &errors) ||
+          !replayer.run(&service, entries, &results, &errors)) {
+        std::cerr << "Failed to replay the recording: " << errors.str() << std::endl;
+        return -4;
+      }
+      swm::util::CommandReplayer::print_report(results, &std::cout);
+      return 0;
+    }
+
     std::ifstream input;
     if (args.has_input_flag(&svalue)) {
       input.open(svalue.c_str());
@@ -71,8 +175,7 @@ int main(int argc, char* const argv[]) {
     }
 
     // Done! Starting service, current thread will be blocked
-    service.main_loop();
-    return 0;
+    return service.main_loop() ? 0 : -4;
   }
   catch (std::exception &err) {
     std::cerr << "Exception thrown: " << err.what() << std::endl;
@@ -38,6 +38,7 @@ bool Algorithm::create_timetable(const SchedulingInfoInterface *info,
     error = &error_;
   }
 
+  util::LatencyHistogram::Scope latency(latency_.get());
   bool succeeded = binding_->construct_timetable(ctx_, info, events, tt, error);
   if (succeeded) {
     if (tt->get() == nullptr) {
@@ -64,6 +65,7 @@ bool Algorithm::improve_timetable(const TimetableInfoInterface *old_tt,
     throw std::runtime_error(ss.str());
   }
 
+  util::LatencyHistogram::Scope latency(latency_.get());
   return binding_->improve_timetable(ctx_, old_tt, events, new_tt, error);
 }
 
@@ -5,6 +5,8 @@
 #include "hw/compute_unit.h"
 #include "lib_binding.h"
 #include "algorithm_metrics.h"
+#include "auxl/latency_histogram.h"
+#include "auxl/metrics.h"
 
 namespace swm {
 
@@ -29,6 +31,9 @@ class Algorithm {
   const AlgorithmMetrics &algorithm_metrics() const { return algorithm_metrics_; }
   const MetricsInterface &plugin_metrics() const { return plugin_metrics_; }
   const std::string &plugin_location() const { return binding_->lib_location(); }
+  // Every creation and improvement of timetable is recorded there, nullptr disables it. Owner of
+  // the histogram is shared (e.g. by aliasing the service metrics), so it outlives the algorithm
+  void set_latency_histogram(const std::shared_ptr<util::LatencyHistogram> &histogram) { latency_ = histogram; }
 
   ~Algorithm();
 
@@ -44,6 +49,7 @@ class Algorithm {
   std::shared_ptr<util::LibBinding> binding_;
   AlgorithmMetrics algorithm_metrics_;
   util::Metrics plugin_metrics_;
+  std::shared_ptr<util::LatencyHistogram> latency_;
    
   friend class AlgorithmFactory;
 };
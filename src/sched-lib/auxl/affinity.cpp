@@ -0,0 +1,74 @@
+#include "affinity.h"
+
+#if !defined(WIN32)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace swm {
+namespace util {
+
+#if !defined(WIN32)
+// Values of <numaif.h>, libnuma is not required for two syscalls
+static const int MPOL_DEFAULT_MODE = 0;
+static const int MPOL_PREFERRED_MODE = 1;
+#endif
+
+bool bind_current_thread(const std::vector<size_t> &cpus, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  if (cpus.empty()) {
+    return true;
+  }
+#if defined(WIN32)
+  *errors << "thread affinity is not supported";
+  return false;
+#else
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const size_t cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      *errors << "CPU #" << cpu << " is out of the supported range";
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+
+  const int res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (res != 0) {
+    *errors << "failed to set thread affinity: " << strerror(res);
+    return false;
+  }
+  return true;
+#endif
+}
+
+PreferredNodeScope::PreferredNodeScope(int node) : applied_(false) {
+#if !defined(WIN32) && defined(SYS_set_mempolicy)
+  unsigned long mask = 0;
+  if (node >= 0 && (size_t)node < sizeof(mask) * 8) {
+    mask = 1UL << node;
+    // The kernel expects the count of bits plus one
+    applied_ = syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8 + 1) == 0;
+  }
+#else
+  (void)node;
+#endif
+}
+
+PreferredNodeScope::~PreferredNodeScope() {
+#if !defined(WIN32) && defined(SYS_set_mempolicy)
+  if (applied_) {
+    syscall(SYS_set_mempolicy, MPOL_DEFAULT_MODE, nullptr, 0);
+  }
+#endif
+}
+
+} // util
+} // swm
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Restricts the current thread to the logical CPUs, empty list removes nothing.
+// Always fails on platforms without thread affinity
+bool bind_current_thread(const std::vector<size_t> &cpus, std::stringstream *errors);
+
+// Memory allocated by the current thread prefers the NUMA node while the object exists
+// (the kernel falls back to other nodes if it's exhausted). Does nothing without NUMA support
+class PreferredNodeScope {
+ public:
+  explicit PreferredNodeScope(int node);
+  PreferredNodeScope(const PreferredNodeScope &) = delete;
+  ~PreferredNodeScope();
+  void operator =(const PreferredNodeScope &) = delete;
+
+  bool applied() const { return applied_; }
+
+ private:
+  bool applied_;
+};
+
+} // util
+} // swm
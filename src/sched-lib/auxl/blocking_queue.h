@@ -0,0 +1,256 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Thread-safe fixed-size multi-producer/multi-consumer queue.
+// Elements are passed through lock-free ring of sequenced cells (D. Vyukov's scheme),
+// the mutex and condition variables are touched only when somebody has to sleep.
+// Sequences are doubled (even - free for position, odd - filled) to support ring of one cell.
+// After close() new elements are rejected, but the stored ones still can be popped.
+// wake_consumer() lets a thread waiting for elements react to events from other sources.
+template <class T>
+class BlockingQueue {
+ public:
+  explicit BlockingQueue(size_t max_size)
+      : capacity_(max_size), cells_(nullptr), enqueue_pos_(0), dequeue_pos_(0),
+        closed_(false), waiting_producers_(0), waiting_consumers_(0), wakeup_(false) {
+    if (max_size == 0) {
+      throw std::runtime_error(
+        "BlockingQueue::BlockingQueue(): \"max_size\" must be greater than 0");
+    }
+    cells_ = new Cell[capacity_];
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+  BlockingQueue(const BlockingQueue &) = delete;
+  ~BlockingQueue() { delete[] cells_; }
+  void operator =(const BlockingQueue &) = delete;
+
+  size_t size() const { return capacity_; }
+
+  // Exact only if there are no concurrent operations
+  size_t element_count() const {
+    const size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    const size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail > head ? std::min(tail - head, capacity_) : 0;
+  }
+
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Rejects new elements and wakes up all waiting threads
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_.store(true, std::memory_order_release);
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  // Forces one blocked (or the next blocking) pop to return false without an element
+  void wake_consumer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_ = true;
+    not_empty_.notify_all();
+  }
+
+  bool try_push(const T &value) {
+    if (closed()) {
+      return false;
+    }
+    if (!try_enqueue(value)) {
+      return false;
+    }
+    notify(waiting_consumers_, not_empty_);
+    return true;
+  }
+
+  // Blocks caller while the queue is full, returns false if queue was closed
+  bool push(const T &value) {
+    if (try_push(value)) {
+      return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    Waiter waiter(&waiting_producers_);
+    while (true) {
+      if (closed()) {
+        return false;
+      }
+      if (try_enqueue(value)) {
+        not_empty_.notify_one();
+        return true;
+      }
+      not_full_.wait(lock);
+    }
+  }
+
+  bool try_pop(T *value) {
+    if (value == nullptr) {
+      throw std::runtime_error("BlockingQueue::try_pop(): \"value\" cannot be equal to nullptr");
+    }
+    if (!try_dequeue(value)) {
+      return false;
+    }
+    notify(waiting_producers_, not_full_);
+    return true;
+  }
+
+  // Blocks caller while the queue is empty, returns false if it was closed and drained or woken up
+  bool pop(T *value) {
+    if (try_pop(value)) {
+      return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    Waiter waiter(&waiting_consumers_);
+    while (!try_pop_locked(value)) {
+      if (closed()) {
+        return try_pop_locked(value);
+      }
+      if (woken_up()) {
+        return false;
+      }
+      not_empty_.wait(lock);
+    }
+    return true;
+  }
+
+  T pop() {
+    T value;
+    if (!pop(&value)) {
+      throw std::runtime_error("BlockingQueue::pop(): queue was closed or consumer was woken up");
+    }
+    return value;
+  }
+
+  // Returns false if nothing was popped during "timeout", queue was closed and drained or woken up
+  template <class Rep, class Period>
+  bool pop_for(T *value, const std::chrono::duration<Rep, Period> &timeout) {
+    if (try_pop(value)) {
+      return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    Waiter waiter(&waiting_consumers_);
+    while (!try_pop_locked(value)) {
+      if (closed()) {
+        return try_pop_locked(value);
+      }
+      if (woken_up()) {
+        return false;
+      }
+      if (not_empty_.wait_until(lock, deadline) == std::cv_status::timeout) {
+        return try_pop_locked(value);
+      }
+    }
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Registers sleeping thread, so the opposite side knows it must take the mutex to notify
+  class Waiter {
+   public:
+    explicit Waiter(std::atomic<size_t> *counter) : counter_(counter) {
+      counter_->fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    Waiter(const Waiter &) = delete;
+    ~Waiter() { counter_->fetch_sub(1, std::memory_order_relaxed); }
+    void operator =(const Waiter &) = delete;
+
+   private:
+    std::atomic<size_t> *counter_;
+  };
+
+  // Sleeping thread registers itself under the mutex, so it's safe to notify without checks
+  bool try_pop_locked(T *value) {
+    if (!try_dequeue(value)) {
+      return false;
+    }
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Must be called under the mutex, consumes the wake up request
+  bool woken_up() {
+    const bool res = wakeup_;
+    wakeup_ = false;
+    return res;
+  }
+
+  bool try_enqueue(const T &value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[pos % capacity_];
+      const size_t seq = cell.sequence.load(std::memory_order_acquire);
+      if (seq == 2 * pos) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(2 * pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (seq < 2 * pos) {
+        return false;   // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_dequeue(T *value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[pos % capacity_];
+      const size_t seq = cell.sequence.load(std::memory_order_acquire);
+      if (seq == 2 * pos + 1) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *value = std::move(cell.value);
+          cell.value = T();
+          cell.sequence.store(2 * (pos + capacity_), std::memory_order_release);
+          return true;
+        }
+      } else if (seq < 2 * pos + 1) {
+        return false;   // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Slow path: the mutex is taken only if the opposite side is (going to be) sleeping
+  void notify(const std::atomic<size_t> &waiting, std::condition_variable &cv) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv.notify_one();
+    }
+  }
+
+  const size_t capacity_;
+  Cell *cells_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+  alignas(64) std::atomic<bool> closed_;
+  std::atomic<size_t> waiting_producers_;
+  std::atomic<size_t> waiting_consumers_;
+  bool wakeup_;                                   // guarded by the mutex
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+} // util
+} // swm
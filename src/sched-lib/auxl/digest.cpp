@@ -0,0 +1,57 @@
+#include "digest.h"
+
+#include <string.h>
+
+namespace swm {
+namespace util {
+
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+static const uint64_t MIX_SEED = 0x9e3779b97f4a7c15ULL;
+static const uint64_t MIX_MULTIPLIER = 0xff51afd7ed558ccdULL;
+
+Digest::Digest() : fnv_(FNV_OFFSET_BASIS), mix_(MIX_SEED) {
+}
+
+Digest &Digest::update(const void *data, size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    fnv_ = (fnv_ ^ bytes[i]) * FNV_PRIME;
+    mix_ = (mix_ ^ bytes[i]) * MIX_MULTIPLIER;
+    mix_ = (mix_ << 31) | (mix_ >> 33);
+  }
+  return *this;
+}
+
+Digest &Digest::update(const std::string &str) {
+  update((uint64_t)str.size());
+  return update(str.data(), str.size());
+}
+
+Digest &Digest::update(uint64_t value) {
+  unsigned char bytes[sizeof(value)];
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    bytes[i] = (unsigned char)(value >> (8 * i));
+  }
+  return update(bytes, sizeof(bytes));
+}
+
+Digest &Digest::update(double value) {
+  uint64_t bits = 0;
+  static_assert(sizeof(bits) == sizeof(value), "double must be 64-bit");
+  memcpy(&bits, &value, sizeof(bits));
+  return update(bits);
+}
+
+std::string Digest::hex() const {
+  static const char digits[] = "0123456789abcdef";
+  std::string res(32, '0');
+  for (size_t i = 0; i < 16; ++i) {
+    res[15 - i] = digits[(fnv_ >> (4 * i)) & 0xf];
+    res[31 - i] = digits[(mix_ >> (4 * i)) & 0xf];
+  }
+  return res;
+}
+
+} // util
+} // swm
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Non-cryptographic 128-bit digest of byte sequences: FNV-1a and a multiply-rotate hash
+// computed side by side. Good enough as a key of caches, must not be used for security
+class Digest {
+ public:
+  Digest();
+
+  Digest &update(const void *data, size_t size);
+  // Length goes first, so "ab" + "c" and "a" + "bc" give different digests
+  Digest &update(const std::string &str);
+  Digest &update(uint64_t value);
+  Digest &update(double value);
+
+  // 32 hex digits
+  std::string hex() const;
+
+ private:
+  uint64_t fnv_;
+  uint64_t mix_;
+};
+
+} // util
+} // swm
@@ -0,0 +1,161 @@
+#include "executor.h"
+
+#include <iostream>
+
+#include "affinity.h"
+
+namespace swm {
+namespace util {
+
+Executor::Executor(size_t threads, const std::vector<std::vector<size_t> > &affinity)
+    : affinity_(affinity), stopping_(false), queued_(0), shared_queued_(0), sleeping_(0), busy_(0), executed_(0),
+      stolen_(0) {
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_[i]->thread = std::thread([obj = this, i]() -> void { obj->worker_loop(i); });
+  }
+}
+
+Executor::~Executor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    has_tasks_.notify_all();
+  }
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+void Executor::submit(const Task &task) {
+  if (!task) {
+    throw std::runtime_error("Executor::submit(): \"task\" cannot be empty");
+  }
+
+  if (inline_mode()) {
+    execute(task);
+    return;
+  }
+
+  queued_.fetch_add(1, std::memory_order_seq_cst);
+  const size_t index = current_worker();
+  if (index < workers_.size()) {
+    // Only the own deque is locked, the executor is alive while its worker runs
+    Worker *worker = workers_[index].get();
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->tasks.push_back(task);
+    }
+
+    // Sleeping worker registers itself before it checks the counter, so one of them sees the other
+    if (sleeping_.load(std::memory_order_seq_cst) != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      has_tasks_.notify_one();
+    }
+  }
+  else {
+    // Notifying under the same lock: the task can complete the owner of executor,
+    // so executor must not be touched after the task is visible to workers
+    std::lock_guard<std::mutex> lock(mutex_);
+    shared_tasks_.push_back(task);
+    shared_queued_.fetch_add(1, std::memory_order_release);
+    has_tasks_.notify_one();
+  }
+}
+
+size_t Executor::current_worker() const {
+  // Threads are assigned before the first task, so workers can read them without the lock
+  const std::thread::id id = std::this_thread::get_id();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i]->thread.get_id() == id) {
+      return i;
+    }
+  }
+  return workers_.size();
+}
+
+bool Executor::take_task(size_t index, Task *task) {
+  // The newest own task, its data are most likely in cache
+  {
+    Worker *worker = workers_[index].get();
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (!worker->tasks.empty()) {
+      *task = std::move(worker->tasks.back());
+      worker->tasks.pop_back();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  // Task from the outside, the lock is taken only if there is one
+  if (shared_queued_.load(std::memory_order_acquire) != 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!shared_tasks_.empty()) {
+      *task = std::move(shared_tasks_.front());
+      shared_tasks_.pop_front();
+      shared_queued_.fetch_sub(1, std::memory_order_relaxed);
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  // The oldest task of some other worker
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker *victim = workers_[(index + i) % workers_.size()].get();
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->tasks.empty()) {
+      *task = std::move(victim->tasks.front());
+      victim->tasks.pop_front();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      stolen_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Executor::execute(const Task &task) {
+  busy_.fetch_add(1, std::memory_order_relaxed);
+  try { task(); }
+  catch (std::exception &ex) {
+    std::cerr << "Exception from Executor::execute(): " << ex.what() << std::endl;
+  }
+  busy_.fetch_sub(1, std::memory_order_relaxed);
+  executed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Executor::worker_loop(size_t index) {
+  // Unbound worker is still useful, so it's not a reason to stop
+  std::stringstream errors;
+  if (!affinity_.empty() && !bind_current_thread(affinity_[index % affinity_.size()], &errors)) {
+    std::cerr << "Executor::worker_loop(): worker #" << index << " is not bound, " << errors.str() << std::endl;
+  }
+
+  Task task;
+  while (true) {
+    if (take_task(index, &task)) {
+      execute(task);
+      task = nullptr;
+      continue;
+    }
+
+    // The counter can be positive while the task is being placed, so it's just a short retry
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    has_tasks_.wait(lock, [this]() -> bool {
+      return stopping_ || queued_.load(std::memory_order_seq_cst) != 0;
+    });
+    sleeping_.fetch_sub(1, std::memory_order_relaxed);
+    if (stopping_ && queued_.load(std::memory_order_seq_cst) == 0) {
+      break;
+    }
+  }
+}
+
+} // util
+} // swm
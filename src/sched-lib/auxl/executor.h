@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Fixed-size work-stealing thread pool.
+// Each worker owns a deque: tasks submitted by a worker go to its own deque and are taken
+// in LIFO order, idle workers steal from the opposite end. Tasks from other threads are
+// placed into the shared queue. Workers' own submissions don't take the shared lock unless
+// some worker sleeps. Executor without threads runs tasks right in submit().
+// Destructor executes all enqueued tasks before stopping workers.
+// Workers can be bound to CPUs: the i-th one gets "affinity[i % affinity.size()]" list.
+class Executor {
+ public:
+  typedef std::function<void()> Task;
+
+  explicit Executor(size_t threads,
+                    const std::vector<std::vector<size_t> > &affinity = std::vector<std::vector<size_t> >());
+  Executor(const Executor &) = delete;
+  ~Executor();
+  void operator =(const Executor &) = delete;
+
+  void submit(const Task &task);
+
+  bool inline_mode() const { return workers_.empty(); }
+  size_t threads() const { return workers_.size(); }
+  size_t busy_threads() const { return busy_.load(std::memory_order_relaxed); }
+  size_t queued_tasks() const { return queued_.load(std::memory_order_relaxed); }
+  size_t executed_tasks() const { return executed_.load(std::memory_order_relaxed); }
+  size_t stolen_tasks() const { return stolen_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  size_t current_worker() const;             // index of the calling worker or threads() for others
+  bool take_task(size_t index, Task *task);
+  void execute(const Task &task);
+  void worker_loop(size_t index);
+
+  std::vector<std::unique_ptr<Worker> > workers_;
+  std::vector<std::vector<size_t> > affinity_;
+  std::deque<Task> shared_tasks_;             // guarded by the mutex
+  bool stopping_;                             // guarded by the mutex
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+
+  std::atomic<size_t> queued_;                // incremented before the task is placed
+  std::atomic<size_t> shared_queued_;         // size of the shared queue, to skip its lock
+  std::atomic<size_t> sleeping_;              // workers waiting for tasks
+  std::atomic<size_t> busy_;
+  std::atomic<size_t> executed_;
+  std::atomic<size_t> stolen_;
+};
+
+} // util
+} // swm
@@ -3,6 +3,8 @@
 
 #include <sys/stat.h>
 
+#include <fstream>
+
 #ifdef WIN32
 #include <Windows.h>
 #else
@@ -66,5 +68,27 @@ std::string file_full_path(const std::string &filename) {
   return res;
 }
 
+bool read_file(const std::string &filename, std::string *content) {
+  std::ifstream fstr(filename, std::ios::in | std::ios::binary);
+  if (!fstr.is_open()) {
+    return false;
+  }
+  std::stringstream sstr;
+  sstr << fstr.rdbuf();
+  *content = sstr.str();
+  return true;
+}
+
+bool read_first_line(const std::string &filename, std::string *line) {
+  std::ifstream fstr(filename);
+  if (!fstr.is_open() || !std::getline(fstr, *line)) {
+    return false;
+  }
+  while (!line->empty() && isspace((unsigned char)line->back())) {
+    line->pop_back();
+  }
+  return true;
+}
+
 } // util
 } // swm
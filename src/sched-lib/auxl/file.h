@@ -9,5 +9,10 @@ namespace util {
 bool file_exist(const std::string &filename);
 std::string file_full_path(const std::string &filename);
 
+// The whole content by one read, e.g. of procfs file. False if the file cannot be opened
+bool read_file(const std::string &filename, std::string *content);
+// The first line without trailing whitespaces, e.g. of sysfs attribute
+bool read_first_line(const std::string &filename, std::string *line);
+
 } // util
 } // swm
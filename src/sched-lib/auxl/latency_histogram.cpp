@@ -0,0 +1,97 @@
+#include "latency_histogram.h"
+
+#include <cmath>
+
+namespace swm {
+namespace util {
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(clock::duration duration) {
+  const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  record_micros(micros > 0 ? (uint64_t)micros : 0);
+}
+
+void LatencyHistogram::record(double seconds) {
+  record_micros(seconds > 0.0 ? (uint64_t)std::llround(std::min(seconds * 1e6, 1e15)) : 0);
+}
+
+void LatencyHistogram::reset() {
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t res = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    res += counts_[i].load(std::memory_order_relaxed);
+  }
+  return res;
+}
+
+double LatencyHistogram::max() const {
+  return (double)max_.load(std::memory_order_relaxed) * 1e-6;
+}
+
+double LatencyHistogram::percentile(double quantile) const {
+  if (quantile < 0.0 || quantile > 1.0) {
+    throw std::runtime_error("LatencyHistogram::percentile(): \"quantile\" must be in [0.0, 1.0]");
+  }
+
+  // Counts are copied first, so the rank matches them while other threads record
+  std::vector<uint64_t> counts(BUCKETS);
+  uint64_t total = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0.0;
+  }
+
+  const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(quantile * (double)total));
+  const uint64_t max = max_.load(std::memory_order_relaxed);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return (double)std::min(bucket_top(i), max) * 1e-6;
+    }
+  }
+  return (double)max * 1e-6;
+}
+
+// Bucket is (shift, sub) where "sub" is the value shifted into [32, 64), or the value itself below 64
+size_t LatencyHistogram::bucket(uint64_t micros) {
+  size_t shift = 0;
+  while ((micros >> shift) >= SUB_BUCKETS) {
+    ++shift;
+  }
+  if (shift > MAX_SHIFT) {
+    return BUCKETS - 1;
+  }
+  return shift * (SUB_BUCKETS / 2) + (size_t)(micros >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_top(size_t index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+  const size_t shift = index / (SUB_BUCKETS / 2) - 1;
+  const uint64_t sub = index % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record_micros(uint64_t micros) {
+  counts_[bucket(micros)].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (micros > max && !max_.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+  }
+}
+
+} // util
+} // swm
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// HDR-style histogram of durations: microseconds are counted in log-linear buckets, 32 buckets
+// per power of two, so percentiles are exact below 64 us and within 3.2% above.
+// Any thread records without locks, durations over 2^40 us (~12 days) fall into the last bucket
+class LatencyHistogram {
+ public:
+  typedef std::chrono::steady_clock clock;
+
+  // Records time from construction to destruction, if the histogram is given
+  class Scope {
+   public:
+    explicit Scope(LatencyHistogram *histogram) : histogram_(histogram), start_(clock::now()) { }
+    Scope(const Scope &) = delete;
+    ~Scope() { if (histogram_ != nullptr) { histogram_->record(clock::now() - start_); } }
+    void operator =(const Scope &) = delete;
+
+   private:
+    LatencyHistogram *histogram_;
+    clock::time_point start_;
+  };
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  void operator =(const LatencyHistogram &) = delete;
+
+  void record(clock::duration duration);
+  void record(double seconds);
+  void reset();
+
+  uint64_t count() const;
+  double max() const;                                 // seconds
+  // Seconds within which "quantile" (from 0.0 to 1.0) of durations fit, 0.0 if nothing is recorded
+  double percentile(double quantile) const;
+
+ private:
+  static const size_t SUB_BUCKETS = 64;
+  static const size_t MAX_SHIFT = 34;
+  static const size_t BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS / 2;
+
+  static size_t bucket(uint64_t micros);
+  static uint64_t bucket_top(size_t index);
+  void record_micros(uint64_t micros);
+
+  std::atomic<uint64_t> counts_[BUCKETS];
+  std::atomic<uint64_t> max_;                         // microseconds
+};
+
+} // util
+} // swm
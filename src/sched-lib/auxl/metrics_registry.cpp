@@ -0,0 +1,357 @@
+#include "metrics_registry.h"
+
+#include <cstring>
+
+namespace swm {
+namespace util {
+
+static uint64_t double_to_bits(double value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double bits_to_double(uint64_t bits) {
+  double value = 0.0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Integers are summed as two's complement, so shards can keep negative increments
+static uint64_t add_bits(uint64_t bits, uint64_t increment, bool is_double) {
+  return is_double ? double_to_bits(bits_to_double(bits) + bits_to_double(increment)) : bits + increment;
+}
+
+static uint64_t sub_bits(uint64_t bits, uint64_t decrement, bool is_double) {
+  return is_double ? double_to_bits(bits_to_double(bits) - bits_to_double(decrement)) : bits - decrement;
+}
+
+//------------------------------
+//--- MetricsRegistry::Shard ---
+//------------------------------
+
+// Values written by one thread, sequence is odd while an update is in progress.
+// Values follow the shard in the same aligned allocation
+struct MetricsRegistry::Shard {
+  alignas(64) std::atomic<uint64_t> sequence;
+  size_t depth;                                     // nested updates, owner thread only
+  const std::thread::id owner;
+  Shard *next;
+
+  static Shard *create(std::thread::id owner, size_t capacity) {
+    void *memory = ::operator new(sizeof(Shard) + capacity * sizeof(std::atomic<uint64_t>),
+                                  std::align_val_t(alignof(Shard)));
+    Shard *shard = new (memory) Shard(owner);
+    for (size_t i = 0; i < capacity; ++i) {
+      new (&shard->values()[i]) std::atomic<uint64_t>(0);
+    }
+    return shard;
+  }
+
+  static void destroy(Shard *shard) {
+    shard->~Shard();
+    ::operator delete(shard, std::align_val_t(alignof(Shard)));
+  }
+
+  std::atomic<uint64_t> *values() { return reinterpret_cast<std::atomic<uint64_t> *>(this + 1); }
+  const std::atomic<uint64_t> *values() const { return reinterpret_cast<const std::atomic<uint64_t> *>(this + 1); }
+
+  // Copies values seen between two equal even sequences
+  void read(size_t count, uint64_t *res) const {
+    for (size_t attempt = 0; ; ++attempt) {
+      const uint64_t before = sequence.load(std::memory_order_acquire);
+      if ((before & 1) == 0) {
+        for (size_t i = 0; i < count; ++i) {
+          res[i] = values()[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+          return;
+        }
+      }
+      if (attempt >= 16) {
+        std::this_thread::yield();                  // writer is preempted in the middle of update
+      }
+    }
+  }
+
+ private:
+  explicit Shard(std::thread::id id) : sequence(0), depth(0), owner(id), next(nullptr) { }
+};
+
+//---------------------------------
+//--- MetricsRegistry::Snapshot ---
+//---------------------------------
+
+// Names and positions of values, shared by all snapshots taken between registrations
+struct MetricsRegistry::Layout {
+  std::vector<std::pair<uint32_t, std::string> > int_indices;
+  std::vector<std::pair<uint32_t, std::string> > double_indices;
+  std::unordered_map<uint32_t, size_t> int_positions;
+  std::unordered_map<uint32_t, size_t> double_positions;
+};
+
+// Values frozen at the moment of snapshot, copies share the same data
+class MetricsRegistry::Snapshot : public MetricsInterface {
+ public:
+  Snapshot(const std::shared_ptr<const Layout> &layout, const std::shared_ptr<const std::vector<uint64_t> > &values)
+      : layout_(layout), values_(values) { }
+
+  virtual void register_int_value(uint32_t, const std::string &) override { read_only("register_int_value"); }
+  virtual std::vector<std::pair<uint32_t, std::string> > int_value_indices() const override {
+    return layout_->int_indices;
+  }
+  virtual int32_t int_value(uint32_t id) const override {
+    return (int32_t)(int64_t)value(layout_->int_positions, id, "int_value");
+  }
+  virtual int32_t update_int_value(uint32_t, int32_t) override { read_only("update_int_value"); return 0; }
+  virtual void reset_int_value(uint32_t) override { read_only("reset_int_value"); }
+
+  virtual void register_double_value(uint32_t, const std::string &) override { read_only("register_double_value"); }
+  virtual std::vector<std::pair<uint32_t, std::string> > double_value_indices() const override {
+    return layout_->double_indices;
+  }
+  virtual double double_value(uint32_t id) const override {
+    return bits_to_double(value(layout_->double_positions, id, "double_value"));
+  }
+  virtual double update_double_value(uint32_t, double) override { read_only("update_double_value"); return 0.0; }
+  virtual void reset_double_value(uint32_t) override { read_only("reset_double_value"); }
+
+  virtual std::shared_ptr<MetricsInterface> clone() const override {
+    return std::shared_ptr<MetricsInterface>(new Snapshot(layout_, values_));
+  }
+
+ private:
+  uint64_t value(const std::unordered_map<uint32_t, size_t> &positions, uint32_t id, const char *method) const {
+    auto iter = positions.find(id);
+    if (iter == positions.end()) {
+      throw std::runtime_error(std::string("MetricsRegistry::Snapshot::") + method + "(): value not registered");
+    }
+    return (*values_)[iter->second];
+  }
+
+  static void read_only(const char *method) {
+    throw std::runtime_error(std::string("MetricsRegistry::Snapshot::") + method + "(): snapshot is read-only");
+  }
+
+  std::shared_ptr<const Layout> layout_;
+  std::shared_ptr<const std::vector<uint64_t> > values_;
+};
+
+//-------------------------------
+//--- MetricsRegistry::Update ---
+//-------------------------------
+
+MetricsRegistry::Update::Update(Shard *shard) : shard_(shard) {
+  if (shard_->depth++ == 0) {
+    const uint64_t sequence = shard_->sequence.load(std::memory_order_relaxed);
+    shard_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+}
+
+MetricsRegistry::Update::~Update() {
+  if (shard_ != nullptr && --shard_->depth == 0) {
+    const uint64_t sequence = shard_->sequence.load(std::memory_order_relaxed);
+    shard_->sequence.store(sequence + 1, std::memory_order_release);
+  }
+}
+
+MetricsRegistry::Update &MetricsRegistry::Update::add_int(Handle handle, int64_t increment) {
+  auto &value = shard_->values()[handle];
+  value.store(value.load(std::memory_order_relaxed) + (uint64_t)increment, std::memory_order_relaxed);
+  return *this;
+}
+
+MetricsRegistry::Update &MetricsRegistry::Update::add_double(Handle handle, double increment) {
+  auto &value = shard_->values()[handle];
+  value.store(add_bits(value.load(std::memory_order_relaxed), double_to_bits(increment), true),
+              std::memory_order_relaxed);
+  return *this;
+}
+
+//-----------------------
+//--- MetricsRegistry ---
+//-----------------------
+
+MetricsRegistry::MetricsRegistry(size_t capacity)
+    : capacity_(capacity), bases_(new std::atomic<uint64_t>[capacity]), layout_(new Layout()), shards_(nullptr),
+      lookup_(new std::atomic<Shard *>[LOOKUP_SIZE]) {
+  for (size_t i = 0; i < capacity_; ++i) {
+    bases_[i].store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < LOOKUP_SIZE; ++i) {
+    lookup_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+MetricsRegistry::~MetricsRegistry() {
+  Shard *shard = shards_.load();
+  while (shard != nullptr) {
+    Shard *next = shard->next;
+    Shard::destroy(shard);
+    shard = next;
+  }
+}
+
+MetricsRegistry::Handle MetricsRegistry::int_handle(uint32_t id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return find(id, false);
+}
+
+MetricsRegistry::Handle MetricsRegistry::double_handle(uint32_t id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return find(id, true);
+}
+
+MetricsRegistry::Update MetricsRegistry::update() {
+  return Update(own_shard());
+}
+
+int64_t MetricsRegistry::int_sum(Handle handle) const {
+  return (int64_t)sub_bits(sum(handle, false), bases_[handle].load(std::memory_order_relaxed), false);
+}
+
+double MetricsRegistry::double_sum(Handle handle) const {
+  return bits_to_double(sub_bits(sum(handle, true), bases_[handle].load(std::memory_order_relaxed), true));
+}
+
+std::shared_ptr<MetricsInterface> MetricsRegistry::snapshot() const {
+  std::shared_ptr<std::vector<uint64_t> > values(new std::vector<uint64_t>());
+  std::lock_guard<std::mutex> lock(mutex_);
+  read(values.get());
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    (*values)[i] = sub_bits((*values)[i], bases_[i].load(std::memory_order_relaxed), slots_[i].is_double);
+  }
+  return std::shared_ptr<MetricsInterface>(new Snapshot(layout_, values));
+}
+
+void MetricsRegistry::register_int_value(uint32_t id, const std::string &name) {
+  register_value(id, name, false);
+}
+
+std::vector<std::pair<uint32_t, std::string> > MetricsRegistry::int_value_indices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return layout_->int_indices;
+}
+
+int32_t MetricsRegistry::int_value(uint32_t id) const {
+  return (int32_t)int_sum(int_handle(id));
+}
+
+int32_t MetricsRegistry::update_int_value(uint32_t id, int32_t increment) {
+  const Handle handle = int_handle(id);
+  update().add_int(handle, increment);
+  return (int32_t)int_sum(handle);
+}
+
+void MetricsRegistry::reset_int_value(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Handle handle = find(id, false);
+  bases_[handle].store(sum(handle, false), std::memory_order_relaxed);
+}
+
+void MetricsRegistry::register_double_value(uint32_t id, const std::string &name) {
+  register_value(id, name, true);
+}
+
+std::vector<std::pair<uint32_t, std::string> > MetricsRegistry::double_value_indices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return layout_->double_indices;
+}
+
+double MetricsRegistry::double_value(uint32_t id) const {
+  return double_sum(double_handle(id));
+}
+
+double MetricsRegistry::update_double_value(uint32_t id, double increment) {
+  const Handle handle = double_handle(id);
+  update().add_double(handle, increment);
+  return double_sum(handle);
+}
+
+void MetricsRegistry::reset_double_value(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Handle handle = find(id, true);
+  bases_[handle].store(sum(handle, true), std::memory_order_relaxed);
+}
+
+MetricsRegistry::Handle MetricsRegistry::register_value(uint32_t id, const std::string &name, bool is_double) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &slot : slots_) {
+    if (slot.id == id && slot.is_double == is_double) {
+      throw std::runtime_error("MetricsRegistry::register_value(): value already registered");
+    }
+  }
+  if (slots_.size() >= capacity_) {
+    throw std::runtime_error("MetricsRegistry::register_value(): registry is full");
+  }
+  slots_.push_back(Slot { id, name, is_double });
+
+  // Snapshots taken before keep the old layout
+  std::shared_ptr<Layout> layout(new Layout(*layout_));
+  auto &indices = is_double ? layout->double_indices : layout->int_indices;
+  auto &positions = is_double ? layout->double_positions : layout->int_positions;
+  indices.push_back(std::make_pair(id, name));
+  positions[id] = slots_.size() - 1;
+  layout_ = layout;
+  return slots_.size() - 1;
+}
+
+MetricsRegistry::Handle MetricsRegistry::find(uint32_t id, bool is_double) const {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].id == id && slots_[i].is_double == is_double) {
+      return i;
+    }
+  }
+  throw std::runtime_error("MetricsRegistry::find(): value not registered");
+}
+
+// Shard is found by the id of the thread: in the lookup table at once, in the list after a collision.
+// Ids are unique among the threads alive, so every shard has a single writer
+MetricsRegistry::Shard *MetricsRegistry::own_shard() const {
+  const std::thread::id self = std::this_thread::get_id();
+  std::atomic<Shard *> &cached = lookup_[std::hash<std::thread::id>()(self) & (LOOKUP_SIZE - 1)];
+  Shard *shard = cached.load(std::memory_order_acquire);
+  if (shard != nullptr && shard->owner == self) {
+    return shard;
+  }
+
+  for (shard = shards_.load(std::memory_order_acquire); shard != nullptr; shard = shard->next) {
+    if (shard->owner == self) {
+      break;
+    }
+  }
+  if (shard == nullptr) {
+    shard = Shard::create(self, capacity_);
+    shard->next = shards_.load(std::memory_order_relaxed);
+    while (!shards_.compare_exchange_weak(shard->next, shard, std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+  cached.store(shard, std::memory_order_release);
+  return shard;
+}
+
+uint64_t MetricsRegistry::sum(Handle handle, bool is_double) const {
+  uint64_t res = is_double ? double_to_bits(0.0) : 0;
+  for (Shard *shard = shards_.load(std::memory_order_acquire); shard != nullptr; shard = shard->next) {
+    res = add_bits(res, shard->values()[handle].load(std::memory_order_relaxed), is_double);
+  }
+  return res;
+}
+
+void MetricsRegistry::read(std::vector<uint64_t> *sums) const {
+  const size_t count = slots_.size();
+  sums->assign(count, 0);
+  std::vector<uint64_t> values(count);
+  for (Shard *shard = shards_.load(std::memory_order_acquire); shard != nullptr; shard = shard->next) {
+    shard->read(count, values.data());
+    for (size_t i = 0; i < count; ++i) {
+      (*sums)[i] = add_bits((*sums)[i], values[i], slots_[i].is_double);
+    }
+  }
+}
+
+} // util
+} // swm
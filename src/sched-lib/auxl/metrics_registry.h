@@ -0,0 +1,99 @@
+#pragma once
+
+#include <thread>
+
+#include "defs.h"
+#include "ifaces/metrics_interface.h"
+
+namespace swm {
+namespace util {
+
+// Metrics for hot paths: values are registered up front and updated by handles. Every thread
+// writes its own shard (no locks, no shared cache lines), readers sum the shards up. Shard of
+// a finished thread is taken over by the next thread with the same id, so there are about as many
+// shards as threads alive. A registry per thread pool or service is expected, not per object.
+// Shard is guarded by the seqlock of its thread, so snapshot() sees all values of an update()
+// or none of them and never blocks writers. Event handlers are not supported.
+// Registration, reads by identifiers and reset are not meant for hot paths, they take the mutex
+class MetricsRegistry : public MetricsInterface {
+  struct Shard;
+
+ public:
+  typedef size_t Handle;
+
+  // Values changed together by one thread, handles must come from the same registry
+  class Update {
+   public:
+    Update(const Update &) = delete;
+    Update(Update &&other) : shard_(other.shard_) { other.shard_ = nullptr; }
+    ~Update();
+    void operator =(const Update &) = delete;
+
+    Update &add_int(Handle handle, int64_t increment);
+    Update &add_double(Handle handle, double increment);
+
+   private:
+    explicit Update(Shard *shard);
+
+    Shard *shard_;
+
+   friend class MetricsRegistry;
+  };
+
+  explicit MetricsRegistry(size_t capacity = 32);
+  MetricsRegistry(const MetricsRegistry &) = delete;
+  virtual ~MetricsRegistry();
+  void operator =(const MetricsRegistry &) = delete;
+
+  Handle int_handle(uint32_t id) const;
+  Handle double_handle(uint32_t id) const;
+  Update update();
+  int64_t int_sum(Handle handle) const;
+  double double_sum(Handle handle) const;
+
+  // Immutable copy of all values, updates of the copy throw
+  std::shared_ptr<MetricsInterface> snapshot() const;
+
+  virtual void register_int_value(uint32_t id, const std::string &name) override;
+  virtual std::vector<std::pair<uint32_t, std::string> > int_value_indices() const override;
+  virtual int32_t int_value(uint32_t id) const override;
+  virtual int32_t update_int_value(uint32_t id, int32_t increment) override;
+  virtual void reset_int_value(uint32_t id) override;
+
+  virtual void register_double_value(uint32_t id, const std::string &name) override;
+  virtual std::vector<std::pair<uint32_t, std::string> > double_value_indices() const override;
+  virtual double double_value(uint32_t id) const override;
+  virtual double update_double_value(uint32_t id, double increment) override;
+  virtual void reset_double_value(uint32_t id) override;
+
+  virtual std::shared_ptr<MetricsInterface> clone() const override { return snapshot(); }
+
+ private:
+  struct Slot {
+    uint32_t id;
+    std::string name;
+    bool is_double;
+  };
+  struct Layout;
+  class Snapshot;
+
+  Handle register_value(uint32_t id, const std::string &name, bool is_double);
+  Handle find(uint32_t id, bool is_double) const;   // mutex must be locked
+  Shard *own_shard() const;
+  uint64_t sum(Handle handle, bool is_double) const;
+  void read(std::vector<uint64_t> *sums) const;     // all values at once, mutex must be locked
+
+  static constexpr size_t LOOKUP_SIZE = 64;             // power of two
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::vector<Slot> slots_;                         // guarded by mutex
+  std::unique_ptr<std::atomic<uint64_t>[]> bases_; // sums at the last reset
+  std::shared_ptr<const Layout> layout_;            // guarded by mutex
+  mutable std::atomic<Shard *> shards_;             // list of threads' shards, never shrinks
+  // Shards by hash of their threads' ids, collisions are resolved by the list
+  mutable std::unique_ptr<std::atomic<Shard *>[]> lookup_;
+};
+
+} // util
+} // swm
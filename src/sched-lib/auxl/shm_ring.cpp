@@ -0,0 +1,493 @@
+#include "shm_ring.h"
+
+#include <limits>
+
+#if !defined(WIN32)
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace swm {
+namespace util {
+
+// Positions are counted in bytes from the creation of the ring and never go back, producer's and
+// consumer's ones are kept on separate cache lines
+struct ShmRing::Header {
+  std::atomic<uint64_t> head;         // end of committed frames
+  char head_padding[56];
+  std::atomic<uint64_t> tail;         // start of the frames that are not released yet
+  char tail_padding[56];
+  std::atomic<uint32_t> closed;
+  std::atomic<uint32_t> data_sleepers;     // consumers that are going to sleep on eventfd
+  std::atomic<uint32_t> space_sleepers;    // producers that are going to sleep on eventfd
+};
+
+struct ShmRing::FrameHeader {
+  uint32_t size;
+  uint32_t padding;                   // not 0 if the rest of the region is skipped
+};
+
+size_t ShmRing::header_size() {
+  return (sizeof(Header) + 63) / 64 * 64;
+}
+
+static inline uint64_t align_frame(size_t size) {
+  return ((uint64_t)size + 7) / 8 * 8;
+}
+
+static inline std::chrono::steady_clock::time_point deadline_after(double timeout) {
+  if (timeout < 0.0) {
+    return std::chrono::steady_clock::time_point::max();
+  }
+  return std::chrono::steady_clock::now() +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+}
+
+ShmRing::ShmRing()
+    : region_(nullptr), region_size_(0), header_(nullptr), data_(nullptr), capacity_(0),
+      memory_fd_(-1), data_fd_(-1), space_fd_(-1), reserved_(0), interrupted_(false), read_(0) { }
+
+ShmRing::~ShmRing() {
+#if !defined(WIN32)
+  if (region_ != nullptr) {
+    munmap(region_, region_size_);
+  }
+  if (memory_fd_ != -1) {
+    ::close(memory_fd_);
+  }
+  if (data_fd_ != -1) {
+    ::close(data_fd_);
+  }
+  if (space_fd_ != -1) {
+    ::close(space_fd_);
+  }
+#endif
+}
+
+bool ShmRing::create(size_t capacity, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  if (region_ != nullptr) {
+    throw std::runtime_error("ShmRing::create(): ring was already created");
+  }
+
+#if defined(WIN32)
+  (void)capacity;
+  *errors << "shared memory rings are not supported on this platform";
+  return false;
+#else
+  capacity = (size_t)align_frame(capacity);
+  if (capacity < 2 * sizeof(FrameHeader)) {
+    *errors << "ring capacity " << capacity << " is too small";
+    return false;
+  }
+
+  const size_t prefix = header_size();
+  const int memory_fd = memfd_create("swm-sched-ring", MFD_CLOEXEC);
+  if (memory_fd == -1) {
+    *errors << "cannot create shared memory: " << strerror(errno);
+    return false;
+  }
+  if (ftruncate(memory_fd, (off_t)(prefix + capacity)) != 0) {
+    *errors << "cannot allocate " << prefix + capacity << " bytes of shared memory: " << strerror(errno);
+    ::close(memory_fd);
+    return false;
+  }
+  const int data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  const int space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (data_fd == -1 || space_fd == -1 || !map(memory_fd, prefix + capacity, errors)) {
+    if (data_fd == -1 || space_fd == -1) {
+      *errors << "cannot create eventfd: " << strerror(errno);
+    }
+    if (data_fd != -1) { ::close(data_fd); }
+    if (space_fd != -1) { ::close(space_fd); }
+    ::close(memory_fd);
+    return false;
+  }
+
+  header_ = new (region_) Header();
+  header_->head.store(0);
+  header_->tail.store(0);
+  header_->closed.store(0);
+  header_->data_sleepers.store(0);
+  header_->space_sleepers.store(0);
+  data_fd_ = data_fd;
+  space_fd_ = space_fd;
+  return true;
+#endif
+}
+
+// Descriptors go as SCM_RIGHTS with a single byte of data, the size of the ring is the size of the memfd
+bool ShmRing::share(int socket, std::stringstream *errors) const {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  check_created("share");
+
+#if defined(WIN32)
+  (void)socket;
+  *errors << "shared memory rings are not supported on this platform";
+  return false;
+#else
+  const int fds[3] = { memory_fd_, data_fd_, space_fd_ };
+  char byte = 'R';
+  iovec iov { &byte, 1 };
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  ssize_t res = 0;
+  do {
+    res = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while (res < 0 && errno == EINTR);
+  if (res != 1) {
+    *errors << "cannot pass the ring: " << (res < 0 ? strerror(errno) : "connection is closed");
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool ShmRing::attach(int socket, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  if (region_ != nullptr) {
+    throw std::runtime_error("ShmRing::attach(): ring was already created");
+  }
+
+#if defined(WIN32)
+  (void)socket;
+  *errors << "shared memory rings are not supported on this platform";
+  return false;
+#else
+  int fds[3] = { -1, -1, -1 };
+  char byte = 0;
+  iovec iov { &byte, 1 };
+  char control[CMSG_SPACE(sizeof(fds))];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t res = 0;
+  do {
+    res = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+  } while (res < 0 && errno == EINTR);
+  if (res != 1) {
+    *errors << "cannot receive the ring: " << (res < 0 ? strerror(errno) : "connection is closed");
+    return false;
+  }
+  const cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(fds, CMSG_DATA(cmsg), std::min(sizeof(fds), (size_t)(cmsg->cmsg_len - CMSG_LEN(0))));
+  }
+  auto close_all = [&fds]() -> void {
+    for (int fd : fds) {
+      if (fd != -1) { ::close(fd); }
+    }
+  };
+  if (byte != 'R' || fds[0] == -1 || fds[1] == -1 || fds[2] == -1 || (msg.msg_flags & MSG_CTRUNC) != 0) {
+    *errors << "wrong ring handshake";
+    close_all();
+    return false;
+  }
+
+  const size_t prefix = header_size();
+  struct stat st;
+  if (fstat(fds[0], &st) != 0 || (size_t)st.st_size < prefix + 2 * sizeof(FrameHeader) ||
+      ((size_t)st.st_size - prefix) % 8 != 0) {
+    *errors << "wrong shared memory of the ring";
+    close_all();
+    return false;
+  }
+  if (!map(fds[0], (size_t)st.st_size, errors)) {
+    close_all();
+    return false;
+  }
+  header_ = (Header *)region_;
+  data_fd_ = fds[1];
+  space_fd_ = fds[2];
+  return true;
+#endif
+}
+
+bool ShmRing::map(int memory_fd, size_t size, std::stringstream *errors) {
+#if defined(WIN32)
+  (void)memory_fd;
+  (void)size;
+  *errors << "shared memory rings are not supported on this platform";
+  return false;
+#else
+  void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  if (region == MAP_FAILED) {
+    *errors << "cannot map " << size << " bytes of shared memory: " << strerror(errno);
+    return false;
+  }
+  const size_t prefix = header_size();
+  region_ = region;
+  region_size_ = size;
+  data_ = (char *)region + prefix;
+  capacity_ = size - prefix;
+  memory_fd_ = memory_fd;
+  return true;
+#endif
+}
+
+size_t ShmRing::max_frame_size() const {
+  const size_t limit = capacity_ > sizeof(FrameHeader) ? capacity_ - sizeof(FrameHeader) : 0;
+  return std::min(limit, (size_t)std::numeric_limits<uint32_t>::max());
+}
+
+char *ShmRing::reserve(size_t size, double timeout) {
+  check_created("reserve");
+  if (size > max_frame_size()) {
+    return nullptr;
+  }
+
+  // Frame that doesn't fit into the end of the region starts from the beginning, the skipped end
+  // is committed at once, so the consumer can release it while the frame waits for room
+  const auto deadline = deadline_after(timeout);
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  const uint64_t need = sizeof(FrameHeader) + align_frame(size);
+  if (head % capacity_ + need > capacity_) {
+    const uint64_t skip = capacity_ - head % capacity_;
+    if (!wait_space(head + skip, deadline)) {
+      return nullptr;
+    }
+    FrameHeader *padding = frame_at(head);
+    padding->size = 0;
+    padding->padding = 1;
+    head += skip;
+    header_->head.store(head, std::memory_order_release);
+    notify(data_fd_, header_->data_sleepers);
+  }
+  if (!wait_space(head + need, deadline)) {
+    return nullptr;
+  }
+
+  FrameHeader *frame = frame_at(head);
+  frame->size = (uint32_t)size;
+  frame->padding = 0;
+  reserved_ = head + need;
+  return (char *)(frame + 1);
+}
+
+void ShmRing::commit() {
+  check_created("commit");
+  if (reserved_ == header_->head.load(std::memory_order_relaxed)) {
+    throw std::runtime_error("ShmRing::commit(): no frame was reserved");
+  }
+  header_->head.store(reserved_, std::memory_order_release);
+  notify(data_fd_, header_->data_sleepers);
+}
+
+bool ShmRing::acquire(Frame *frame, double timeout, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  if (frame == nullptr) {
+    throw std::runtime_error("ShmRing::acquire(): \"frame\" cannot be nullptr");
+  }
+  check_created("acquire");
+
+  const auto deadline = deadline_after(timeout);
+  while (true) {
+    // Producer commits everything before it closes the ring
+    const bool was_closed = closed();
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    {
+      std::lock_guard<std::mutex> lock(consumer_mutex_);
+      while (read_ != head) {
+        if (!check_frame(head, errors)) {
+          return false;
+        }
+        const FrameHeader *header = frame_at(read_);
+        const uint64_t begin = read_;
+        if (header->padding != 0) {
+          read_ += capacity_ - read_ % capacity_;
+          released_[begin] = read_;
+          advance_tail();
+          continue;
+        }
+        read_ += sizeof(FrameHeader) + align_frame(header->size);
+        *frame = Frame { (char *)(header + 1), header->size, begin, read_ };
+        return true;
+      }
+    }
+    if (was_closed || interrupted_ || std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    wait(data_fd_, header_->data_sleepers, deadline, [this, head]() -> bool {
+      return closed() || interrupted_ || header_->head.load(std::memory_order_acquire) != head;
+    });
+  }
+}
+
+void ShmRing::release(const Frame &frame) {
+  check_created("release");
+  std::lock_guard<std::mutex> lock(consumer_mutex_);
+  released_[frame.begin] = frame.end;
+  advance_tail();
+}
+
+void ShmRing::close() {
+  check_created("close");
+  header_->closed.store(1, std::memory_order_release);
+  signal(data_fd_);
+  signal(space_fd_);
+}
+
+bool ShmRing::closed() const {
+  return header_ != nullptr && header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool ShmRing::corrupted() {
+  std::lock_guard<std::mutex> lock(consumer_mutex_);
+  return !corruption_.empty();
+}
+
+bool ShmRing::finished() {
+  if (!closed()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(consumer_mutex_);
+  return read_ == header_->head.load(std::memory_order_acquire);
+}
+
+void ShmRing::interrupt() {
+  check_created("interrupt");
+  interrupted_ = true;
+  signal(data_fd_);
+  signal(space_fd_);
+}
+
+void ShmRing::check_created(const char *method) const {
+  if (region_ == nullptr) {
+    throw std::runtime_error(std::string("ShmRing::") + method + "(): ring must be created first");
+  }
+}
+
+ShmRing::FrameHeader *ShmRing::frame_at(uint64_t position) const {
+  return (FrameHeader *)(data_ + position % capacity_);
+}
+
+bool ShmRing::wait_space(uint64_t end, std::chrono::steady_clock::time_point deadline) const {
+  while (end - header_->tail.load(std::memory_order_acquire) > capacity_) {
+    if (closed() || interrupted_ || std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    wait(space_fd_, header_->space_sleepers, deadline, [this, end]() -> bool {
+      return closed() || interrupted_ || end - header_->tail.load(std::memory_order_acquire) <= capacity_;
+    });
+  }
+  return !closed() && !interrupted_;
+}
+
+// Head and frame headers are written by the other process, the frame at "read_" must lie within
+// the committed bytes and must not cross the end of the region
+bool ShmRing::check_frame(uint64_t head, std::stringstream *errors) {
+  if (corruption_.empty()) {
+    const FrameHeader *header = frame_at(read_);
+    const uint64_t offset = read_ % capacity_;
+    const uint64_t size = header->padding != 0 ? capacity_ - offset : sizeof(FrameHeader) + align_frame(header->size);
+    std::stringstream reason;
+    if (head - read_ > capacity_) {
+      reason << "committed bytes (" << head - read_ << ") exceed the capacity at " << read_;
+    }
+    else if (size > head - read_ || offset + size > capacity_) {
+      reason << "frame of " << size << " bytes exceeds the committed bytes or the region at " << read_;
+    }
+    corruption_ = reason.str();
+  }
+  if (!corruption_.empty()) {
+    *errors << "corrupted ring: " << corruption_;
+    return false;
+  }
+  return true;
+}
+
+void ShmRing::advance_tail() {
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  const uint64_t old_tail = tail;
+  for (auto it = released_.begin(); it != released_.end() && it->first == tail; it = released_.erase(it)) {
+    tail = it->second;
+  }
+  if (tail != old_tail) {
+    header_->tail.store(tail, std::memory_order_release);
+    notify(space_fd_, header_->space_sleepers);
+  }
+}
+
+void ShmRing::signal(int fd) const {
+#if defined(WIN32)
+  (void)fd;
+#else
+  const uint64_t one = 1;
+  ssize_t res = 0;
+  do {
+    res = ::write(fd, &one, sizeof(one));
+  } while (res < 0 && errno == EINTR);
+#endif
+}
+
+// Streaming side doesn't make system calls while the other one is busy: eventfd is signalled only
+// if somebody has announced the sleep. Announcement and the position are ordered by the fences
+void ShmRing::notify(int fd, const std::atomic<uint32_t> &sleepers) const {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers.load(std::memory_order_relaxed) != 0) {
+    signal(fd);
+  }
+}
+
+// Counter of eventfd keeps the signals that come before poll(), so they are not lost
+void ShmRing::wait(int fd, std::atomic<uint32_t> &sleepers, std::chrono::steady_clock::time_point deadline,
+                   const std::function<bool()> &ready) const {
+  sleepers.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!ready()) {
+#if defined(WIN32)
+    (void)fd;
+    (void)deadline;
+#else
+    int timeout = -1;
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      timeout = (int)std::min<int64_t>(std::max<int64_t>(1, (int64_t)left.count()), std::numeric_limits<int>::max());
+    }
+    pollfd pfd { fd, POLLIN, 0 };
+    if (::poll(&pfd, 1, timeout) > 0) {
+      uint64_t counter = 0;
+      ssize_t res = ::read(fd, &counter, sizeof(counter));
+      (void)res;
+    }
+#endif
+  }
+  sleepers.fetch_sub(1);
+}
+
+} // util
+} // swm
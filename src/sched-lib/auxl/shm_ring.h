@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Ring of frames in memory shared with a co-located process, not supported on Windows. Memory is
+// a memfd, so nothing is left behind by a crashed process; the other process gets it along with
+// eventfd notifications over a Unix socket, see share() and attach().
+// Producer reserves a frame, fills it in place and commits it; consumer reads the frame in place
+// and releases it. Frames never wrap: the end of the region is skipped if the next frame doesn't fit.
+// One thread produces, consumer's frames can be released in any order by several threads
+class ShmRing {
+ public:
+  // Frame seen by consumer, "data" stays valid until the frame is released
+  struct Frame {
+    char *data;
+    size_t size;
+    uint64_t begin;                   // bounds in the stream of bytes passed through the ring
+    uint64_t end;
+  };
+
+  ShmRing();
+  ShmRing(const ShmRing &) = delete;
+  ~ShmRing();
+  void operator =(const ShmRing &) = delete;
+
+  bool create(size_t capacity, std::stringstream *errors = nullptr);
+  // Handshake: descriptors of the created ring are passed over the connected Unix socket,
+  // the ring attached on the other end is the same one
+  bool share(int socket, std::stringstream *errors = nullptr) const;
+  bool attach(int socket, std::stringstream *errors = nullptr);
+  size_t capacity() const { return capacity_; }
+  size_t max_frame_size() const;
+
+  // Negative timeouts wait until the call can complete, the ring is closed or interrupted.
+  // Producer: nullptr if the ring is closed, the frame can never fit or there is no room in "timeout"
+  char *reserve(size_t size, double timeout);
+  void commit();
+
+  // Consumer: false if there is no committed frame in "timeout", the ring is finished or corrupted
+  // (the other process published a frame that exceeds the committed bytes or the region)
+  bool acquire(Frame *frame, double timeout, std::stringstream *errors = nullptr);
+  void release(const Frame &frame);
+  // Nothing can be acquired anymore, see acquire()
+  bool corrupted();
+
+  // Producer has nothing to send anymore, consumer still gets committed frames
+  void close();
+  bool closed() const;
+  // Closed and all committed frames are acquired
+  bool finished();
+  // Wakes up the calls of this process and fails the later ones, the other process is not affected
+  void interrupt();
+
+ private:
+  struct Header;
+  struct FrameHeader;
+
+  static size_t header_size();       // cache lines taken by the header
+  bool map(int memory_fd, size_t size, std::stringstream *errors);
+  void check_created(const char *method) const;
+  FrameHeader *frame_at(uint64_t position) const;
+  bool wait_space(uint64_t end, std::chrono::steady_clock::time_point deadline) const;   // producer
+  void advance_tail();                // consumer's mutex must be locked
+  bool check_frame(uint64_t head, std::stringstream *errors);   // consumer's mutex must be locked
+  void signal(int fd) const;
+  void notify(int fd, const std::atomic<uint32_t> &sleepers) const;
+  void wait(int fd, std::atomic<uint32_t> &sleepers, std::chrono::steady_clock::time_point deadline,
+            const std::function<bool()> &ready) const;
+
+  void *region_;
+  size_t region_size_;
+  Header *header_;
+  char *data_;
+  size_t capacity_;
+  int memory_fd_;
+  int data_fd_;                       // signalled on commit and close if the consumer sleeps
+  int space_fd_;                      // signalled on release and close if the producer sleeps
+  uint64_t reserved_;                 // end of the reserved frame, producer only
+  std::atomic<bool> interrupted_;
+
+  std::mutex consumer_mutex_;
+  uint64_t read_;                     // next frame to acquire, guarded by consumer's mutex
+  std::map<uint64_t, uint64_t> released_;   // released frames ahead of the tail, guarded by consumer's mutex
+  std::string corruption_;            // why the stream cannot be read, guarded by consumer's mutex
+};
+
+} // util
+} // swm
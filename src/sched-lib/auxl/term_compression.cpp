@@ -0,0 +1,117 @@
+#include "term_compression.h"
+
+#include <zlib.h>
+
+namespace swm {
+namespace util {
+
+bool is_compressed_term(const char *data, size_t size) {
+  return data != nullptr && size >= ETF_COMPRESSED_HEADER_SIZE &&
+         static_cast<uint8_t>(data[0]) == ETF_VERSION_TAG && static_cast<uint8_t>(data[1]) == ETF_COMPRESSED_TAG;
+}
+
+bool compress_term(const char *data, size_t size, int level,
+                   std::unique_ptr<char[]> *res, size_t *res_size,
+                   std::stringstream *errors) {
+  if (data == nullptr || res == nullptr || res_size == nullptr) {
+    throw std::runtime_error(
+      "compress_term(): \"data\", \"res\" and \"res_size\" cannot be equal to nullptr");
+  }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  if (size < 2 || static_cast<uint8_t>(data[0]) != ETF_VERSION_TAG) {
+    *errors << "source data is not a versioned erlang term";
+    return false;
+  }
+  if (is_compressed_term(data, size)) {
+    *errors << "source term is already compressed";
+    return false;
+  }
+
+  const size_t term_size = size - 1;
+  if (term_size > UINT32_MAX) {
+    *errors << "term of " << term_size << " bytes is too large to be compressed";
+    return false;
+  }
+
+  // Nothing to win if zlib cannot fit the data in the source size (or even the header doesn't fit)
+  if (size <= ETF_COMPRESSED_HEADER_SIZE) {
+    return false;
+  }
+  uLongf zsize = static_cast<uLongf>(size - ETF_COMPRESSED_HEADER_SIZE);
+  std::unique_ptr<char[]> buf(new char[size]);
+  const int rc = compress2(reinterpret_cast<Bytef *>(buf.get() + ETF_COMPRESSED_HEADER_SIZE), &zsize,
+                           reinterpret_cast<const Bytef *>(data + 1), static_cast<uLong>(term_size), level);
+  if (rc == Z_BUF_ERROR) {
+    return false;
+  }
+  if (rc != Z_OK) {
+    *errors << "zlib failed to compress term (code " << rc << ")";
+    return false;
+  }
+
+  buf[0] = static_cast<char>(ETF_VERSION_TAG);
+  buf[1] = static_cast<char>(ETF_COMPRESSED_TAG);
+  buf[2] = static_cast<char>((term_size >> 24) & 0xFF);
+  buf[3] = static_cast<char>((term_size >> 16) & 0xFF);
+  buf[4] = static_cast<char>((term_size >> 8) & 0xFF);
+  buf[5] = static_cast<char>(term_size & 0xFF);
+
+  *res = std::move(buf);
+  *res_size = ETF_COMPRESSED_HEADER_SIZE + zsize;
+  return true;
+}
+
+bool decompress_term(const char *data, size_t size,
+                     std::unique_ptr<char[]> *res, size_t *res_size,
+                     std::stringstream *errors) {
+  if (data == nullptr || res == nullptr || res_size == nullptr) {
+    throw std::runtime_error(
+      "decompress_term(): \"data\", \"res\" and \"res_size\" cannot be equal to nullptr");
+  }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  if (!is_compressed_term(data, size)) {
+    *errors << "source data is not a compressed erlang term";
+    return false;
+  }
+
+  const auto bytes = reinterpret_cast<const uint8_t *>(data);
+  const size_t term_size = (static_cast<size_t>(bytes[2]) << 24) | (static_cast<size_t>(bytes[3]) << 16) |
+                           (static_cast<size_t>(bytes[4]) << 8) | static_cast<size_t>(bytes[5]);
+
+  // Declared size comes from the peer, it's not trusted to allocate more than zlib can inflate
+  const size_t zsize = size - ETF_COMPRESSED_HEADER_SIZE;
+  if (term_size == 0 || term_size > zsize * ETF_MAX_INFLATE_RATIO) {
+    *errors << "declared term size " << term_size << " doesn't match " << zsize << " bytes of compressed data";
+    return false;
+  }
+
+  std::unique_ptr<char[]> buf(new char[term_size + 1]);
+  buf[0] = static_cast<char>(ETF_VERSION_TAG);
+  uLongf out_size = static_cast<uLongf>(term_size);
+  const int rc = uncompress(reinterpret_cast<Bytef *>(buf.get() + 1), &out_size,
+                            reinterpret_cast<const Bytef *>(data + ETF_COMPRESSED_HEADER_SIZE),
+                            static_cast<uLong>(zsize));
+  if (rc != Z_OK) {
+    *errors << "zlib failed to inflate term (code " << rc << ")";
+    return false;
+  }
+  if (out_size != term_size) {
+    *errors << "inflated term size " << out_size << " differs from declared " << term_size;
+    return false;
+  }
+
+  *res = std::move(buf);
+  *res_size = term_size + 1;
+  return true;
+}
+
+} // util
+} // swm
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Compressed Erlang external term format, the same as produced by
+// term_to_binary(Term, [compressed]) and accepted by binary_to_term/1:
+//   <<131, 80, UncompressedSize:32/big, ZlibData/binary>>
+// where UncompressedSize is the size of the term without leading version byte.
+const uint8_t ETF_VERSION_TAG = 131;
+const uint8_t ETF_COMPRESSED_TAG = 80;
+const size_t ETF_COMPRESSED_HEADER_SIZE = 6;
+// Deflate can't pack more than 1032 bytes into one, larger declared sizes are corrupted headers
+const size_t ETF_MAX_INFLATE_RATIO = 1032;
+
+bool is_compressed_term(const char *data, size_t size);
+
+// Compresses versioned term "data", result is put to "res" only if it is shorter than the source
+bool compress_term(const char *data, size_t size, int level,
+                   std::unique_ptr<char[]> *res, size_t *res_size,
+                   std::stringstream *errors = nullptr);
+
+// Inflates compressed term back to the ordinary versioned one
+bool decompress_term(const char *data, size_t size,
+                     std::unique_ptr<char[]> *res, size_t *res_size,
+                     std::stringstream *errors = nullptr);
+
+} // util
+} // swm
@@ -13,7 +13,7 @@ void TimeCounter::get_times(double *astronomical, double *idling, double *workin
   double working_add = 0.0;
   bool is_idling = true;
   for (const auto &it : thread_tps_) {
-    if (it.second.first) {
+    if (it.second.first != 0) {
       working_add += to_seconds(now, it.second.second);
       is_idling = false;
     }
@@ -40,7 +40,7 @@ void TimeCounter::reset() {
   }
 
   for (auto &it : thread_tps_) {
-    if (it.second.first) {
+    if (it.second.first != 0) {
       locker_.clear();
       throw std::runtime_error("TimeCounter::reset(): some threads have not finished counting");
     }
@@ -61,22 +61,22 @@ void TimeCounter::turn_on() {
   bool i_am_the_first = true;
   bool found_my_record = false;
   for (auto &it : thread_tps_) {
-    i_am_the_first = i_am_the_first && !it.second.first;
+    i_am_the_first = i_am_the_first && it.second.first == 0;
 
     if (it.first == std::this_thread::get_id()) {
-      if (it.second.first) {
+      // Nested counting (e.g. chain performed inline by processor) is measured once
+      if (it.second.first++ != 0) {
         locker_.clear();
-        throw std::runtime_error("TimeCounter::turn_on(): counter was not turned off");
+        return;
       }
 
-      it.second.first = true;
       it.second.second = my_clock::now();
       found_my_record = true;
     }
   }
 
   if (!found_my_record) {
-    thread_tps_[std::this_thread::get_id()] = std::make_pair(true, my_clock::now());
+    thread_tps_[std::this_thread::get_id()] = std::make_pair((size_t)1, my_clock::now());
   }
 
   if (i_am_the_first) {
@@ -96,17 +96,18 @@ void TimeCounter::turn_off() {
   for (auto &it : thread_tps_)
   {
     if (it.first == std::this_thread::get_id()) {
-      if (!it.second.first) {
+      if (it.second.first == 0) {
         locker_.clear();
         throw std::runtime_error("TimeCounter::turn_off(): timer was not turned on");
       }
 
-      it.second.first = false;
-      working_time_ += to_seconds(my_clock::now(), it.second.second);
+      if (--it.second.first == 0) {
+        working_time_ += to_seconds(my_clock::now(), it.second.second);
+      }
       found_my_record = true;
     }
 
-    i_am_the_last = i_am_the_last && !it.second.first;
+    i_am_the_last = i_am_the_last && it.second.first == 0;
   }
 
   if (!found_my_record) {
@@ -48,7 +48,7 @@ class TimeCounter {
   }
 
   std::atomic_flag locker_;
-  std::unordered_map<std::thread::id, std::pair<bool, my_time_point> > thread_tps_;
+  std::unordered_map<std::thread::id, std::pair<size_t, my_time_point> > thread_tps_; // nesting depth
   my_time_point start_tp_;
   my_time_point last_working_tp_;
   double working_time_;
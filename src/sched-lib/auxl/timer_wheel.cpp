@@ -0,0 +1,185 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace swm {
+namespace util {
+
+TimerWheel::TimerWheel(std::chrono::microseconds tick)
+    : tick_(tick), start_(clock::now()), current_tick_(0), last_id_(0), firing_id_(0),
+      stopping_(false) {
+  if (tick_.count() <= 0) {
+    throw std::runtime_error("TimerWheel::TimerWheel(): \"tick\" must be positive");
+  }
+  worker_ = std::thread([obj = this]() -> void { obj->worker_loop(); });
+}
+
+TimerWheel::~TimerWheel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    changed_.notify_all();
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+TimerWheel::TimerId TimerWheel::schedule(double seconds, const Callback &clb) {
+  if (!clb) {
+    throw std::runtime_error("TimerWheel::schedule(): \"clb\" cannot be empty");
+  }
+
+  const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::duration<double>(std::max(seconds, 0.0)));
+  const auto deadline = clock::now() + delay;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (active_.empty()) {
+    // Slots contain only cancelled timers, so the wheel can be moved forward without processing
+    for (size_t level = 0; level < LEVELS; ++level) {
+      for (size_t slot = 0; slot < SLOTS; ++slot) {
+        slots_[level][slot].clear();
+      }
+    }
+    current_tick_ = std::max(current_tick_, to_ticks(clock::now()));
+  }
+
+  // Timer never fires before its deadline, so rounding up
+  const uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                  deadline - start_).count();
+  const uint64_t tick = (uint64_t)tick_.count();
+  const uint64_t expires = std::max((us + tick - 1) / tick, current_tick_ + 1);
+
+  const TimerId id = ++last_id_;
+  active_.insert(id);
+  insert(Timer { id, expires, clb });
+  changed_.notify_one();
+  return id;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (active_.erase(id) != 0) {
+    return true;
+  }
+  if (std::this_thread::get_id() != worker_.get_id()) {
+    fired_.wait(lock, [this, id]() -> bool { return firing_id_ != id; });
+  }
+  return false;
+}
+
+size_t TimerWheel::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_.size();
+}
+
+uint64_t TimerWheel::to_ticks(const clock::time_point &tp) const {
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(tp - start_).count();
+  return us > 0 ? (uint64_t)us / (uint64_t)tick_.count() : 0;
+}
+
+void TimerWheel::insert(Timer &&timer) {
+  // Level is chosen by distance from the current tick, the slot - by absolute expiration tick
+  const uint64_t expires = std::max(timer.expires, current_tick_);
+  const uint64_t delta = expires - current_tick_;
+  size_t level = 0;
+  while (level + 1 < LEVELS && delta >= ((uint64_t)1 << (SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+
+  // Too distant timers are parked at the last level and re-inserted when it comes up
+  uint64_t pos = expires;
+  if (level + 1 == LEVELS) {
+    pos = std::min(pos, current_tick_ + ((uint64_t)1 << (SLOT_BITS * LEVELS)) - 1);
+  }
+  slots_[level][(pos >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(std::move(timer));
+}
+
+void TimerWheel::cascade(size_t level) {
+  std::list<Timer> timers;
+  timers.swap(slots_[level][(current_tick_ >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+  for (auto &timer : timers) {
+    if (active_.count(timer.id) != 0) {
+      insert(std::move(timer));
+    }
+  }
+}
+
+void TimerWheel::advance(std::vector<Timer> *expired) {
+  ++current_tick_;
+
+  // Coarse levels first: their timers can fall into the finer slots of the current tick
+  for (size_t level = LEVELS - 1; level > 0; --level) {
+    const uint64_t mask = ((uint64_t)1 << (SLOT_BITS * level)) - 1;
+    if ((current_tick_ & mask) == 0) {
+      cascade(level);
+    }
+  }
+
+  std::list<Timer> timers;
+  timers.swap(slots_[0][current_tick_ & (SLOTS - 1)]);
+  for (auto &timer : timers) {
+    if (active_.count(timer.id) == 0) {
+      continue;
+    }
+    if (timer.expires <= current_tick_) {
+      expired->push_back(std::move(timer));
+    }
+    else {
+      insert(std::move(timer));
+    }
+  }
+}
+
+uint64_t TimerWheel::next_wakeup() const {
+  for (uint64_t tick = current_tick_ + 1; tick <= current_tick_ + SLOTS; ++tick) {
+    if ((tick & (SLOTS - 1)) == 0 || !slots_[0][tick & (SLOTS - 1)].empty()) {
+      return tick;
+    }
+  }
+  return current_tick_ + SLOTS;
+}
+
+void TimerWheel::worker_loop() {
+  std::vector<Timer> expired;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (active_.empty()) {
+      changed_.wait(lock);
+      continue;
+    }
+
+    const uint64_t now = to_ticks(clock::now());
+    while (current_tick_ < now) {
+      advance(&expired);
+    }
+
+    // Timer could be cancelled while others were being called
+    for (auto &timer : expired) {
+      if (active_.erase(timer.id) == 0) {
+        continue;
+      }
+      firing_id_ = timer.id;
+      lock.unlock();
+      try { timer.clb(); }
+      catch (std::exception &ex) {
+        std::cerr << "Exception from TimerWheel::worker_loop(): " << ex.what() << std::endl;
+      }
+      lock.lock();
+      firing_id_ = 0;
+      fired_.notify_all();
+    }
+    if (!expired.empty()) {
+      expired.clear();
+      continue;
+    }
+
+    const auto wakeup = start_ + std::chrono::microseconds(tick_.count() * (int64_t)next_wakeup());
+    changed_.wait_until(lock, wakeup);
+  }
+}
+
+} // util
+} // swm
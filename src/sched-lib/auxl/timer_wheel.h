@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <unordered_set>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Hierarchical timer wheel with personal thread that fires deadline callbacks.
+// Four levels of 64 slots: the first one covers 64 ticks, every next one is 64 times coarser,
+// timers are moved to the finer level when their slot comes up. The thread sleeps until the
+// next non-empty slot of the first level (or the next cascade), and sleeps without timeout
+// if there are no timers at all. Callbacks are called by the wheel's thread without locks,
+// so they must be short (e.g. pass the work to executor).
+class TimerWheel {
+ public:
+  typedef uint64_t TimerId;
+  typedef std::function<void()> Callback;
+  typedef std::chrono::steady_clock clock;
+
+  explicit TimerWheel(std::chrono::microseconds tick = std::chrono::milliseconds(1));
+  TimerWheel(const TimerWheel &) = delete;
+  ~TimerWheel();                          // pending timers are dropped without calls
+  void operator =(const TimerWheel &) = delete;
+
+  // Returns non-zero identifier of the timer
+  TimerId schedule(double seconds, const Callback &clb);
+
+  // Returns false if the timer has already fired. If its callback is being called right now,
+  // waits for the completion (unless called from the callback itself)
+  bool cancel(TimerId id);
+
+  size_t pending() const;
+  std::chrono::microseconds tick() const { return tick_; }
+
+ private:
+  static const size_t LEVELS = 4;
+  static const size_t SLOT_BITS = 6;
+  static const size_t SLOTS = (size_t)1 << SLOT_BITS;
+
+  struct Timer {
+    TimerId id;
+    uint64_t expires;                     // tick number
+    Callback clb;
+  };
+
+  uint64_t to_ticks(const clock::time_point &tp) const;
+  void insert(Timer &&timer);
+  void cascade(size_t level);
+  void advance(std::vector<Timer> *expired);
+  uint64_t next_wakeup() const;
+  void worker_loop();
+
+  const std::chrono::microseconds tick_;
+  const clock::time_point start_;
+  std::list<Timer> slots_[LEVELS][SLOTS];
+  std::unordered_set<TimerId> active_;    // cancelled timers are removed lazily from slots
+  uint64_t current_tick_;                 // the last processed tick
+  TimerId last_id_;
+  TimerId firing_id_;                     // callback is being called right now
+  bool stopping_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::condition_variable fired_;
+  std::thread worker_;
+};
+
+} // util
+} // swm
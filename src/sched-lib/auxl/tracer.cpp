@@ -0,0 +1,183 @@
+#include "tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace swm {
+namespace util {
+
+//--------------------
+//--- Tracer::Ring ---
+//--------------------
+
+// Span in the ring, position is the index of the span plus one and zero while it's being written
+struct Tracer::Slot {
+  std::atomic<uint64_t> position;
+  std::atomic<const char *> name;
+  std::atomic<int64_t> begin;
+  std::atomic<int64_t> end;
+};
+
+// Spans of one thread, only the owner writes them. A new thread with the id of a finished one
+// continues its ring, so short-lived threads don't grow the list
+struct Tracer::Ring {
+  alignas(64) std::atomic<uint64_t> written;
+  const std::thread::id owner;
+  uint32_t thread;
+  std::unique_ptr<Slot[]> slots;
+  Ring *next;
+
+  Ring(size_t capacity, std::thread::id self, uint32_t id)
+      : written(0), owner(self), thread(id), slots(new Slot[capacity]), next(nullptr) {
+    for (size_t i = 0; i < capacity; ++i) {
+      slots[i].position.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+//--------------
+//--- Tracer ---
+//--------------
+
+Tracer::Tracer(size_t capacity)
+    : capacity_(capacity), origin_(clock::now()), threads_(0), rings_(nullptr),
+      lookup_(new std::atomic<Ring *>[LOOKUP_SIZE]) {
+  if (capacity_ == 0) {
+    throw std::runtime_error("Tracer::Tracer(): \"capacity\" must be greater than zero");
+  }
+  for (size_t i = 0; i < LOOKUP_SIZE; ++i) {
+    lookup_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+Tracer::~Tracer() {
+  Ring *ring = rings_.load();
+  while (ring != nullptr) {
+    Ring *next = ring->next;
+    delete ring;
+    ring = next;
+  }
+}
+
+void Tracer::add_span(const char *name, clock::time_point begin, clock::time_point end) {
+  Ring *ring = own_ring();
+  const uint64_t index = ring->written.load(std::memory_order_relaxed);
+  Slot &slot = ring->slots[index % capacity_];
+
+  // Seqlock of the slot: readers see either the whole span or a changed position
+  slot.position.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin_).count(),
+                   std::memory_order_relaxed);
+  slot.end.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - origin_).count(),
+                 std::memory_order_relaxed);
+  slot.position.store(index + 1, std::memory_order_release);
+  ring->written.store(index + 1, std::memory_order_release);
+}
+
+size_t Tracer::spans_count() const {
+  std::vector<Span> spans;
+  collect(&spans);
+  return spans.size();
+}
+
+void Tracer::write_json(std::ostream *out) const {
+  std::vector<Span> spans;
+  collect(&spans);
+  std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) -> bool {
+    return a.thread != b.thread ? a.thread < b.thread : a.begin < b.begin;
+  });
+
+  // Complete events ("X") with microseconds, names are escaped in case they aren't plain literals
+  const auto flags = out->flags();
+  const auto precision = out->precision();
+  *out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < spans.size(); ++i) {
+    *out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"";
+    for (const char *c = spans[i].name; *c != '\0'; ++c) {
+      if (*c == '"' || *c == '\\') {
+        *out << '\\' << *c;
+      }
+      else if ((unsigned char)*c >= 0x20) {
+        *out << *c;
+      }
+    }
+    *out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << spans[i].thread
+         << ",\"ts\":" << (double)spans[i].begin / 1000.0
+         << ",\"dur\":" << (double)(spans[i].end - spans[i].begin) / 1000.0 << "}";
+  }
+  *out << "\n]}\n";
+  out->flags(flags);
+  out->precision(precision);
+}
+
+bool Tracer::dump(const std::string &path, std::stringstream *errors) const {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  std::ofstream output(path, std::ios::trunc);
+  if (!output.good()) {
+    *errors << "cannot create trace \"" << path << "\"";
+    return false;
+  }
+  write_json(&output);
+  output.flush();
+  if (!output.good()) {
+    *errors << "cannot write trace \"" << path << "\"";
+    return false;
+  }
+  return true;
+}
+
+Tracer::Ring *Tracer::own_ring() {
+  const std::thread::id self = std::this_thread::get_id();
+  std::atomic<Ring *> &cached = lookup_[std::hash<std::thread::id>()(self) & (LOOKUP_SIZE - 1)];
+  Ring *ring = cached.load(std::memory_order_acquire);
+  if (ring != nullptr && ring->owner == self) {
+    return ring;
+  }
+
+  for (ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+    if (ring->owner == self) {
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    ring = new Ring(capacity_, self, threads_.fetch_add(1) + 1);
+    ring->next = rings_.load(std::memory_order_relaxed);
+    while (!rings_.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+  cached.store(ring, std::memory_order_release);
+  return ring;
+}
+
+void Tracer::collect(std::vector<Span> *spans) const {
+  spans->clear();
+  for (Ring *ring = rings_.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+    const uint64_t written = ring->written.load(std::memory_order_acquire);
+    const uint64_t first = written > capacity_ ? written - capacity_ : 0;
+    for (uint64_t index = first; index < written; ++index) {
+      const Slot &slot = ring->slots[index % capacity_];
+      if (slot.position.load(std::memory_order_acquire) != index + 1) {
+        continue;
+      }
+      Span span;
+      span.name = slot.name.load(std::memory_order_relaxed);
+      span.begin = slot.begin.load(std::memory_order_relaxed);
+      span.end = slot.end.load(std::memory_order_relaxed);
+      span.thread = ring->thread;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.position.load(std::memory_order_relaxed) == index + 1) {
+        spans->push_back(span);
+      }
+    }
+  }
+}
+
+} // util
+} // swm
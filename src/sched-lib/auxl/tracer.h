@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <thread>
+
+#include "defs.h"
+#include "ifaces/trace_interface.h"
+
+namespace swm {
+namespace util {
+
+// Timeline of spans for offline profiling. Every thread writes its own ring of fixed capacity
+// (no locks, no shared cache lines), the oldest spans of the thread are overwritten when it's full.
+// Readers copy the rings without stopping writers, spans overwritten during the copy are skipped.
+// Components get the tracer explicitly and don't trace without it
+class Tracer : public TraceInterface {
+  struct Slot;
+  struct Ring;
+
+ public:
+  explicit Tracer(size_t capacity = 1 << 14);     // spans per thread
+  Tracer(const Tracer &) = delete;
+  virtual ~Tracer();
+  void operator =(const Tracer &) = delete;
+
+  virtual void add_span(const char *name, clock::time_point begin, clock::time_point end) override;
+
+  size_t spans_count() const;                     // kept by all threads right now
+  // Chrome trace event format (chrome://tracing, ui.perfetto.dev), times are counted from creation
+  void write_json(std::ostream *out) const;
+  bool dump(const std::string &path, std::stringstream *errors = nullptr) const;
+
+ private:
+  struct Span {
+    const char *name;
+    int64_t begin;                                // nanoseconds since creation
+    int64_t end;
+    uint32_t thread;
+  };
+
+  Ring *own_ring();
+  void collect(std::vector<Span> *spans) const;
+
+  static constexpr size_t LOOKUP_SIZE = 64;       // power of two
+
+  const size_t capacity_;
+  const clock::time_point origin_;
+  std::atomic<uint32_t> threads_;
+  std::atomic<Ring *> rings_;                     // list of threads' rings, never shrinks
+  // Rings by hash of the thread id, a miss falls back to the list
+  std::unique_ptr<std::atomic<Ring *>[]> lookup_;
+};
+
+} // util
+} // swm
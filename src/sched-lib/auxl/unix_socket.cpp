@@ -0,0 +1,271 @@
+#include "unix_socket.h"
+
+#if !defined(WIN32)
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace swm {
+namespace util {
+
+SocketStreamBuf::SocketStreamBuf(int fd, size_t buffer_size) : fd_(fd), input_(buffer_size) {
+  setg(input_.data(), input_.data(), input_.data());
+}
+
+SocketStreamBuf::int_type SocketStreamBuf::underflow() {
+#if defined(WIN32)
+  return traits_type::eof();
+#else
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  ssize_t got = 0;
+  do {
+    got = ::recv(fd_, input_.data(), input_.size(), 0);
+  } while (got < 0 && errno == EINTR);
+  if (got <= 0) {
+    return traits_type::eof();
+  }
+  setg(input_.data(), input_.data(), input_.data() + got);
+  return traits_type::to_int_type(*gptr());
+#endif
+}
+
+SocketStreamBuf::int_type SocketStreamBuf::overflow(int_type ch) {
+  if (traits_type::eq_int_type(ch, traits_type::eof())) {
+    return traits_type::not_eof(ch);
+  }
+  const char c = traits_type::to_char_type(ch);
+  return write_all(&c, 1) ? ch : traits_type::eof();
+}
+
+std::streamsize SocketStreamBuf::xsputn(const char *data, std::streamsize size) {
+  return write_all(data, (size_t)size) ? size : 0;
+}
+
+bool SocketStreamBuf::write_all(const char *data, size_t size) {
+#if defined(WIN32)
+  (void)data;
+  return size == 0;
+#else
+  // Peer that has gone away must not kill the process by SIGPIPE
+  while (size > 0) {
+    const ssize_t sent = ::send(fd_, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    size -= (size_t)sent;
+  }
+  return true;
+#endif
+}
+
+UnixSocketListener::~UnixSocketListener() {
+  close();
+#if !defined(WIN32)
+  if (wakeup_fd_ != -1) {
+    ::close(wakeup_fd_);
+  }
+#endif
+}
+
+#if defined(WIN32)
+
+bool UnixSocketListener::listen(const std::string &, std::stringstream *errors) {
+  if (errors != nullptr) {
+    *errors << "Unix domain sockets are not supported on this platform";
+  }
+  return false;
+}
+
+int UnixSocketListener::accept(double) {
+  return -1;
+}
+
+void UnixSocketListener::wake() {
+}
+
+void UnixSocketListener::close() {
+}
+
+int UnixSocketListener::connect(const std::string &, std::stringstream *errors) {
+  if (errors != nullptr) {
+    *errors << "Unix domain sockets are not supported on this platform";
+  }
+  return -1;
+}
+
+void UnixSocketListener::shutdown(int) {
+}
+
+void UnixSocketListener::disconnect(int) {
+}
+
+void UnixSocketListener::close(int) {
+}
+
+#else
+
+static bool make_address(const std::string &path, sockaddr_un *addr, std::stringstream *errors) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+    *errors << "socket path \"" << path << "\" must have from 1 to "
+            << sizeof(addr->sun_path) - 1 << " characters";
+    return false;
+  }
+  memcpy(addr->sun_path, path.c_str(), path.size());
+  return true;
+}
+
+bool UnixSocketListener::listen(const std::string &path, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  if (fd_ != -1) {
+    throw std::runtime_error("UnixSocketListener::listen(): socket is already listening");
+  }
+
+  sockaddr_un addr;
+  if (!make_address(path, &addr, errors)) {
+    return false;
+  }
+  if (wakeup_fd_ == -1 && (wakeup_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+    *errors << "cannot create eventfd: " << strerror(errno);
+    return false;
+  }
+
+  // Socket nobody accepts on is stale, other files are not ours to remove
+  struct stat st;
+  if (::lstat(path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      *errors << "cannot listen on \"" << path << "\": file exists and it's not a socket";
+      return false;
+    }
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1) {
+      *errors << "cannot create socket: " << strerror(errno);
+      return false;
+    }
+    const bool connected = ::connect(probe, (const sockaddr *)&addr, sizeof(addr)) == 0;
+    const int error = connected ? 0 : errno;
+    ::close(probe);
+    if (connected) {
+      *errors << "cannot listen on \"" << path << "\": socket is in use by another process";
+      return false;
+    }
+    if (error != ECONNREFUSED && error != ENOENT) {
+      *errors << "cannot check socket \"" << path << "\": " << strerror(error);
+      return false;
+    }
+    ::unlink(path.c_str());
+  }
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    *errors << "cannot create socket: " << strerror(errno);
+    return false;
+  }
+  if (::bind(fd, (const sockaddr *)&addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+    *errors << "cannot listen on \"" << path << "\": " << strerror(errno);
+    ::close(fd);
+    return false;
+  }
+
+  fd_ = fd;
+  path_ = path;
+  return true;
+}
+
+int UnixSocketListener::accept(double timeout) {
+  if (fd_ == -1) {
+    return -1;
+  }
+  pollfd pfds[2] = { { fd_, POLLIN, 0 }, { wakeup_fd_, POLLIN, 0 } };
+  const int ms = timeout < 0.0 ? -1 : static_cast<int>(timeout * 1000.0);
+  if (::poll(pfds, 2, ms) <= 0) {
+    return -1;
+  }
+  if ((pfds[1].revents & POLLIN) != 0) {
+    uint64_t counter = 0;
+    ssize_t res = ::read(wakeup_fd_, &counter, sizeof(counter));
+    (void)res;
+    return -1;
+  }
+  if ((pfds[0].revents & POLLIN) == 0) {
+    return -1;
+  }
+  return ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+}
+
+void UnixSocketListener::wake() {
+  if (wakeup_fd_ == -1) {
+    return;
+  }
+  const uint64_t one = 1;
+  ssize_t res = 0;
+  do {
+    res = ::write(wakeup_fd_, &one, sizeof(one));
+  } while (res < 0 && errno == EINTR);
+}
+
+void UnixSocketListener::close() {
+  if (fd_ == -1) {
+    return;
+  }
+  ::close(fd_);
+  ::unlink(path_.c_str());
+  fd_ = -1;
+  path_.clear();
+}
+
+int UnixSocketListener::connect(const std::string &path, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  sockaddr_un addr;
+  if (!make_address(path, &addr, errors)) {
+    return -1;
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    *errors << "cannot create socket: " << strerror(errno);
+    return -1;
+  }
+  if (::connect(fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+    *errors << "cannot connect to \"" << path << "\": " << strerror(errno);
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void UnixSocketListener::shutdown(int fd) {
+  ::shutdown(fd, SHUT_RD);
+}
+
+void UnixSocketListener::disconnect(int fd) {
+  ::shutdown(fd, SHUT_RDWR);
+}
+
+void UnixSocketListener::close(int fd) {
+  ::close(fd);
+}
+
+#endif
+
+} // util
+} // swm
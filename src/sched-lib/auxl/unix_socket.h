@@ -0,0 +1,62 @@
+#pragma once
+
+#include <streambuf>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Stream buffer over a connected socket, so the socket can be used as std::istream and
+// std::ostream at once. Input is buffered, output is written through. Doesn't own the socket
+class SocketStreamBuf : public std::streambuf {
+ public:
+  explicit SocketStreamBuf(int fd, size_t buffer_size = 64 * 1024);
+  SocketStreamBuf(const SocketStreamBuf &) = delete;
+  void operator =(const SocketStreamBuf &) = delete;
+
+ protected:
+  virtual int_type underflow() override;
+  virtual int_type overflow(int_type ch) override;
+  virtual std::streamsize xsputn(const char *data, std::streamsize size) override;
+
+ private:
+  bool write_all(const char *data, size_t size);
+
+  int fd_;
+  std::vector<char> input_;
+};
+
+// Listening Unix domain socket (not supported on Windows), its file is removed by close()
+class UnixSocketListener {
+ public:
+  UnixSocketListener() : fd_(-1), wakeup_fd_(-1) { }
+  UnixSocketListener(const UnixSocketListener &) = delete;
+  ~UnixSocketListener();
+  void operator =(const UnixSocketListener &) = delete;
+
+  // Stale socket file left by a killed process is replaced, the one that is still accepting
+  // connections and files of other kinds are left as they are
+  bool listen(const std::string &path, std::stringstream *errors = nullptr);
+  // Connected socket, -1 if nobody has come in "timeout" seconds (negative one waits forever),
+  // the listener was woken up or it's closed
+  int accept(double timeout);
+  // Makes the current (or the next) accept() return, thread-safe until the object is destroyed
+  void wake();
+  void close();
+
+  static int connect(const std::string &path, std::stringstream *errors = nullptr);
+  // Stops reading: the threads blocked on the socket see the end of stream, writing still works
+  static void shutdown(int fd);
+  // Stops reading and writing: blocked writes fail, the peer sees the end of stream
+  static void disconnect(int fd);
+  static void close(int fd);
+
+ private:
+  int fd_;
+  int wakeup_fd_;                     // eventfd, lives as long as the object
+  std::string path_;
+};
+
+} // util
+} // swm
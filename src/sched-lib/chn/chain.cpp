@@ -1,27 +1,102 @@
 
 #include "chain.h"
 
+#include <iostream>
+
 namespace swm {
 
-Chain::~Chain() {
-  // Use async operations to stop worker
-  if (status_ == WORKING) {
-    while (!ready_for_async_operation()) {
-      std::this_thread::yield();
+// Events of the single algorithm performed concurrently with others (portfolio member or pipeline
+// stage): it stops when the chain is interrupted, the whole group is stopped, the budget is over
+// or the stage must restart. Injected timetable doesn't stop it, the chain takes it at the end
+class Chain::MemberEvents : public PluginEventsInterface {
+ public:
+  // The own token is a child of the group's one, it's cancelled to restart the stage
+  MemberEvents(Chain *chain, CancellationToken *group, const clock::time_point &deadline)
+      : token(group), chain_(chain), group_(group), deadline_(deadline), calls_(0) { }
+
+  virtual bool forced_to_interrupt() const override {
+    if (token.cancelled()) {
+      return true;
     }
 
-    try { interrupt_async(); }
-    catch (std::exception &ex) {
-      std::cerr << "Internal error at Chain::~Chain(): failed to stop worker (\""
-                << ex.what() << "\")";
+    // Clock is much slower than loads, so it's checked once per 64 calls
+    if (deadline_ != clock::time_point::max() && (++calls_ & 63) == 0 && clock::now() >= deadline_) {
+      group_->cancel();
+      return true;
+    }
+    return false;
+  }
+
+  virtual const CancellationToken &cancellation_token() const override { return token; }
+  virtual clock::time_point deadline() const override { return deadline_; }
+  virtual TraceInterface *trace() const override { return chain_->tracer(); }
+
+  virtual void commit_intermediate_timetable(
+      const std::shared_ptr<TimetableInfoInterface> &tt) override {
+    chain_->commit_intermediate_timetable(tt);
+    if (commit_clb_) {
+      commit_clb_(tt);
+    }
+  }
+
+  void set_commit_callback(
+      const std::function<void(const std::shared_ptr<TimetableInfoInterface> &)> &clb) {
+    commit_clb_ = clb;
+  }
+
+  CancellationToken token;
+
+ private:
+  Chain *chain_;
+  CancellationToken *group_;
+  clock::time_point deadline_;
+  std::function<void(const std::shared_ptr<TimetableInfoInterface> &)> commit_clb_;
+  mutable size_t calls_;
+};
+
+// Shared with tasks of the executor: they can be started after the chain has performed everything
+struct Chain::ConcurrentTasks {
+  std::function<void(size_t)> task;
+  std::vector<std::unique_ptr<std::atomic<bool> > > claimed;
+  size_t done;
+  std::mutex mutex;
+  std::condition_variable done_cv;
+
+  // Task is performed only by the thread that has claimed it
+  void perform(size_t i) {
+    if (claimed[i]->exchange(true)) {
       return;
     }
+    task(i);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++done;
+    done_cv.notify_all();
+  }
+};
 
-    while (status_ != FINISHED && status_ != INTERRUPTED) {
-      std::this_thread::yield();
+Chain::~Chain() {
+  // Use async operations to stop worker
+  if (status() == WORKING) {
+    {
+      std::unique_lock<std::mutex> lock(done_mutex_);
+      done_cv_.wait(lock, [this]() -> bool { return done_ || ready_for_async_operation(); });
+    }
+
+    // Otherwise the worker will stop by itself, waiting for it anyway
+    if (!stopped()) {
+      try { interrupt_async(); }
+      catch (std::exception &ex) {
+        std::cerr << "Internal error at Chain::~Chain(): failed to stop worker (\""
+                  << ex.what() << "\")";
+      }
     }
   }
 
+  if (status() != NOT_STARTED) {
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_cv_.wait(lock, [this]() -> bool { return done_; });
+  }
   if (worker_.joinable()) {
     worker_.join();
   }
@@ -29,7 +104,8 @@ Chain::~Chain() {
 
 void Chain::init(const std::shared_ptr<SchedulingInfoInterface> &info,
                  const std::vector<std::shared_ptr<Algorithm> > &algorithms,
-                 std::shared_ptr<util::TimeCounter> timer) {
+                 std::shared_ptr<util::TimeCounter> timer,
+                 util::Executor *executor) {
   if (info.get() == nullptr || algorithms.empty()) {
     throw std::runtime_error("Chain::init(): \"info\" and \"algorithms\" cannot be empty");
   }
@@ -37,9 +113,14 @@ void Chain::init(const std::shared_ptr<SchedulingInfoInterface> &info,
     throw std::runtime_error("Chain::init(): object was already initialized");
   }
 
-  status_ = WORKING;
-  async_op_ = NONE;
+  status_.store(WORKING, std::memory_order_release);
+  async_op_.store(NONE, std::memory_order_release);
+  if (budget_ > 0.0) {
+    deadline_ = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget_));
+  }
   info_ = info;
+  input_ = info;
+  executor_ = executor;
   algorithms_ = algorithms;
 
   algorithms_ptrs_.resize(algorithms_.size());
@@ -47,126 +128,224 @@ void Chain::init(const std::shared_ptr<SchedulingInfoInterface> &info,
     algorithms_ptrs_[i] = algorithms_[i].get();
   }
 
-  locker_.clear();
-  worker_ = std::thread([obj = this, timer]() -> void { obj->worker_loop(timer); });
+  // Members of the group need threads of their own, they are created once for the whole run
+  if (executor == nullptr && mode_ != SEQUENTIAL && algorithms_.size() > 1) {
+    own_executor_.reset(new util::Executor(algorithms_.size() - 1));
+  }
+
+  if (executor != nullptr) {
+    executor->submit([obj = this, timer]() -> void { obj->run(timer); });
+  }
+  else {
+    worker_ = std::thread([obj = this, timer]() -> void { obj->run(timer); });
+  }
+}
+
+void Chain::set_mode(ModeType mode, const TimetableObjective &objective, double budget) {
+  if (status() != NOT_STARTED) {
+    throw std::runtime_error("Chain::set_mode(): object was already initialized");
+  }
+  if (budget < 0.0) {
+    throw std::runtime_error("Chain::set_mode(): \"budget\" cannot be negative");
+  }
+
+  mode_ = mode;
+  objective_ = objective;
+  budget_ = budget;
+}
+
+void Chain::set_input_copy(const InputCopy &copy) {
+  if (status() != NOT_STARTED) {
+    throw std::runtime_error("Chain::set_input_copy(): object was already initialized");
+  }
+  input_copy_ = copy;
+}
+
+const std::shared_ptr<SchedulingInfoInterface> &Chain::scheduling_info() const {
+  if (status() == NOT_STARTED) {
+    throw std::runtime_error("Chain::scheduling_info(): object must be initialized first");
+  }
+  return info_;
 }
 
 const ChainMetrics &Chain::metrics() const {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error("Chain::metrics(): object must be initialized first");
   }
   return metrics_;
 }
 
 const std::vector<const Algorithm *> &Chain::algorithms() const {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error("Chain::algorithms(): object must be initialized first");
   }
   return algorithms_ptrs_;
 }
 
 std::shared_ptr<TimetableInfoInterface> Chain::intermediate_timetable() const {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error("Chain::intermediate_timetable(): object must be initialized first");
   }
-
-  // std::shared_ptr<> is not atomic in gcc. So, we need to use locker
-  std::shared_ptr<TimetableInfoInterface> res;
-  lock();
-  res = intermediate_tt_;
-  unlock();
-  return res;
+  return std::atomic_load(&intermediate_tt_);
 }
 
 std::shared_ptr<TimetableInfoInterface> Chain::actual_timetable() const {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error("Chain::actual_timetable(): object must be initialized first");
   }
+  return std::atomic_load(&actual_tt_);
+}
 
-  // std::shared_ptr<> is not atomic in gcc, so, need to use locker
-  std::shared_ptr<TimetableInfoInterface> res;
-  lock();
-  res = actual_tt_;
-  unlock();
-  return res;
+std::shared_ptr<TimetableInfoInterface> Chain::latest_timetable() const {
+  if (status() == NOT_STARTED) {
+    throw std::runtime_error("Chain::latest_timetable(): object must be initialized first");
+  }
+  auto tt = std::atomic_load(&actual_tt_);
+  return tt.get() != nullptr ? tt : std::atomic_load(&intermediate_tt_);
 }
 
 bool Chain::ready_for_async_operation() const {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error(
       "Chain::ready_for_async_operation(): object must be initialized first");
   }
-
-  bool res = false;
-  lock();
-  res = async_op_ == NONE;
-  unlock();
-  return res;
+  return async_op_.load(std::memory_order_acquire) == NONE;
 }
 
 void Chain::interrupt_async() {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error(
       "Chain::interrupt_async(): object must be initialized first");
   }
 
-  lock();
-  if (async_op_ != NONE) {
-    unlock();
+  AsyncOperationType expected = NONE;
+  if (!async_op_.compare_exchange_strong(expected, PLACING, std::memory_order_acq_rel)) {
     throw std::runtime_error("Chain::interrupt_async(): chain is not ready for async operation");
   }
-  if (!stopped()) {
-    async_op_ = INTERRUPT;
+  if (stopped()) {
+    async_op_.store(NONE, std::memory_order_release);
+    notify_placed();
+    return;
   }
-  unlock();
+  interrupt_token_.cancel();
+  async_op_.store(INTERRUPT, std::memory_order_release);
+  notify_placed();
 }
 
 void Chain::inject_timetable_async(const std::shared_ptr<TimetableInfoInterface> &tt) {
-  if (status_ == NOT_STARTED) {
+  if (status() == NOT_STARTED) {
     throw std::runtime_error(
       "Chain::inject_timetable_async(): object must be initialized first");
   }
 
-  lock();
-  if (async_op_ != NONE) {
-    unlock();
+  // Timetable is stored before the operation becomes visible to worker
+  AsyncOperationType expected = NONE;
+  if (!async_op_.compare_exchange_strong(expected, PLACING, std::memory_order_acq_rel)) {
     throw std::runtime_error(
       "Chain::inject_timetable_async(): chain is not ready for async operation");
   }
 
   if (!stopped()) {
-    async_op_ = INJECT_TT;
-    injected_tt_ = tt;
+    std::atomic_store(&injected_tt_, tt);
+    cancel_token_.cancel();
+    async_op_.store(INJECT_TT, std::memory_order_release);
+    notify_placed();
   }
   else {
-    actual_tt_ = tt;
+    std::atomic_store(&actual_tt_, tt);
+    async_op_.store(NONE, std::memory_order_release);
+    notify_placed();
   }
-  unlock();
 }
 
+void Chain::set_stop_callback(const std::function<void()> &clb) {
+  // Callback is called under the mutex, so the owner can safely reset it before destruction
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  stop_clb_ = clb;
+  if (stop_notified_ && stop_clb_) {
+    stop_clb_();
+  }
+}
+
+void Chain::set_ready_callback(const std::function<void()> &clb) {
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  ready_clb_ = clb;
+}
 
 bool Chain::forced_to_interrupt() const {
-  bool res = false;
-  lock();
-  res = async_op_ == INTERRUPT || async_op_ == INJECT_TT;
-  unlock();
-  return res;
+  // Called by algorithms in their hot loops: clock is much slower than loads, so it's checked
+  // once per 64 calls. The operation itself is read by the worker loop after the algorithm returns
+  if (cancel_token_.cancelled()) {
+    return true;
+  }
+  return deadline_ != clock::time_point::max() &&
+         (deadline_checks_.fetch_add(1, std::memory_order_relaxed) & 63) == 0 && clock::now() >= deadline_;
 }
 
-void Chain::commit_intermediate_timetable(const std::shared_ptr<TimetableInfoInterface> &tt) {
-  lock();
-  intermediate_tt_ = tt;
-  unlock();
+Chain::AsyncOperationType Chain::placed_async_op() const {
+  // Token is cancelled a moment before the operation is published
+  AsyncOperationType op = async_op_.load(std::memory_order_acquire);
+  if (op == PLACING) {
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_cv_.wait(lock, [this, &op]() -> bool {
+      return (op = async_op_.load(std::memory_order_acquire)) != PLACING;
+    });
+  }
+  return op;
 }
 
-void Chain::lock() const {
-  while (locker_.test_and_set()) {
-    std::this_thread::yield();
+void Chain::notify_placed() const {
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  done_cv_.notify_all();
+}
+
+void Chain::notify_ready() {
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  done_cv_.notify_all();
+  if (ready_clb_) {
+    try { ready_clb_(); }
+    catch (std::exception &ex) {
+      std::cerr << "Exception from Chain::notify_ready(): " << ex.what() << std::endl;
+    }
   }
 }
 
-void Chain::unlock() const {
-  locker_.clear();
+void Chain::commit_intermediate_timetable(const std::shared_ptr<TimetableInfoInterface> &tt) {
+  std::atomic_store(&intermediate_tt_, tt);
+}
+
+void Chain::run(const std::shared_ptr<util::TimeCounter> &timer) {
+  try {
+    TraceSpan span(trace(), "chain.run");
+    if (input_copy_) {
+      TraceSpan copy_span(trace(), "chain.copy_input");
+      input_ = input_copy_(info_);
+    }
+    if (mode_ == PORTFOLIO) {
+      portfolio_loop(timer);
+    }
+    else if (mode_ == PIPELINE) {
+      pipeline_loop(timer);
+    }
+    else {
+      worker_loop(timer);
+    }
+  }
+  catch (std::exception &ex) {
+    std::cerr << "Exception from Chain::run(): " << ex.what() << std::endl;
+    status_.store(INTERRUPTED, std::memory_order_release);
+  }
+
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  stop_notified_ = true;
+  if (stop_clb_) {
+    try { stop_clb_(); }
+    catch (std::exception &ex) {
+      std::cerr << "Exception from Chain::run(): " << ex.what() << std::endl;
+    }
+  }
+  done_ = true;
+  done_cv_.notify_all();
 }
 
 void Chain::worker_loop(const std::shared_ptr<util::TimeCounter> &timer) {
@@ -175,7 +354,7 @@ void Chain::worker_loop(const std::shared_ptr<util::TimeCounter> &timer) {
   }
   
   util::TimeCounter::Lock time_lock(timer);
-  status_ = WORKING;
+  status_.store(WORKING, std::memory_order_release);
   std::stringstream errors;
   const int BUFFER_NUMBER = 2;      // buffers for ping-pong scheme, must be equal to 2
   size_t tt_cur = 0;
@@ -185,51 +364,298 @@ void Chain::worker_loop(const std::shared_ptr<util::TimeCounter> &timer) {
   bool succeeded = false;
   bool injected = false;
   for (size_t i = 0; i < algorithms_.size(); i += succeeded ? 1 : 0) {
-    succeeded = (i == 0 && !injected)
-            ? algorithms_[0]->create_timetable(info_.get(), this,
-                                               &tt[(tt_cur + 1) % BUFFER_NUMBER], &errors)
-            : algorithms_[i]->improve_timetable(tt[tt_cur].get(), this,
-                                                &tt[(tt_cur + 1) % BUFFER_NUMBER], &errors);
-    
-    lock();
-    if (!succeeded && async_op_ == NONE) { // wasn't interrupted by async op?
+    {
+      const bool create = i == 0 && !injected;
+      TraceSpan span(trace(), create ? "chain.create_timetable" : "chain.improve_timetable");
+      succeeded = create
+              ? algorithms_[0]->create_timetable(input_.get(), this,
+                                                 &tt[(tt_cur + 1) % BUFFER_NUMBER], &errors)
+              : algorithms_[i]->improve_timetable(tt[tt_cur].get(), this,
+                                                  &tt[(tt_cur + 1) % BUFFER_NUMBER], &errors);
+    }
+
+    const AsyncOperationType op = placed_async_op();
+    const bool budget_over = op == NONE && clock::now() >= deadline_;
+    if (!succeeded && op != INTERRUPT && op != INJECT_TT && !budget_over) { // wasn't interrupted?
       std::cerr << "Failed to " << (i == 0 ? "construct" : "improve") << " timetable: "
                 << errors.str() << std::endl;
-      async_op_ = NONE;         // ignoring current operation
-      status_ = INTERRUPTED;
-      unlock();
+      std::atomic_store(&intermediate_tt_, std::shared_ptr<TimetableInfoInterface>());
+      status_.store(INTERRUPTED, std::memory_order_release);
       return;
     }
 
-    // Store timetable as actual and clear intermidiate version
+    // Store timetable as actual and clear intermidiate version. Intermediate version of
+    // the interrupted algorithm is kept: it's the latest result if there is no actual one
     if (succeeded) {
-      actual_tt_ = tt[(tt_cur + 1) % BUFFER_NUMBER];
+      std::atomic_store(&actual_tt_, tt[(tt_cur + 1) % BUFFER_NUMBER]);
+    }
+    if (succeeded || op == INJECT_TT) {
+      std::atomic_store(&intermediate_tt_, std::shared_ptr<TimetableInfoInterface>());
     }
-    intermediate_tt_.reset();
 
-    // Check for async operation
-    if (async_op_ == INTERRUPT) {
-      async_op_ = NONE;
-      status_ = INTERRUPTED;
-      unlock();
+    // Check for async operation. Status is changed first: the chain must not look ready
+    // for the next operation while it's still working
+    if (op == INTERRUPT) {
+      status_.store(INTERRUPTED, std::memory_order_release);
+      async_op_.store(NONE, std::memory_order_release);
       return;
     }
-    if (async_op_ == INJECT_TT) {
-      async_op_ = NONE;
-      status_ = WORKING;
-
-      actual_tt_ = injected_tt_;
-      tt[(tt_cur + 1) % BUFFER_NUMBER] = injected_tt_;
+    if (budget_over) {
+      const bool has_tt = std::atomic_load(&actual_tt_).get() != nullptr;
+      status_.store(has_tt ? FINISHED : INTERRUPTED, std::memory_order_release);
+      return;
+    }
+    if (op == INJECT_TT) {
+      auto injected_tt = std::atomic_load(&injected_tt_);
+      std::atomic_store(&actual_tt_, injected_tt);
+      std::atomic_store(&injected_tt_, std::shared_ptr<TimetableInfoInterface>());
+      tt[(tt_cur + 1) % BUFFER_NUMBER] = injected_tt;
       injected = true;
+      cancel_token_.reset();
+      async_op_.store(NONE, std::memory_order_release);
+      notify_ready();
     }
-    unlock();
 
     // Switch buffers with actual and obsolete timetables
     tt_cur = (tt_cur + 1) % BUFFER_NUMBER;
   }
 
   // Done! Just need to update status
-  status_ = FINISHED;
+  status_.store(FINISHED, std::memory_order_release);
+}
+
+void Chain::run_concurrently(size_t count,
+                             const std::function<void(size_t)> &task,
+                             const clock::time_point *deadline,
+                             CancellationToken *stop) {
+  std::shared_ptr<ConcurrentTasks> tasks(new ConcurrentTasks());
+  tasks->task = task;
+  tasks->done = 0;
+  for (size_t i = 0; i < count; ++i) {
+    tasks->claimed.emplace_back(new std::atomic<bool>(false));
+  }
+
+  // Tasks are offered to other threads, the rest of them is performed here in order: so we never
+  // wait for tasks that can't be started because all threads of executor are busy
+  util::Executor *executor = executor_ != nullptr ? executor_ : own_executor_.get();
+  for (size_t i = 1; i < count && executor != nullptr && !executor->inline_mode(); ++i) {
+    executor->submit([tasks, i]() -> void { tasks->perform(i); });
+  }
+  for (size_t i = 0; i < count; ++i) {
+    tasks->perform(i);
+  }
+
+  // Algorithms that don't check events too often are stopped at least by the deadline
+  std::unique_lock<std::mutex> lock(tasks->mutex);
+  auto all_done = [&tasks, count]() -> bool { return tasks->done == count; };
+  if (deadline != nullptr) {
+    tasks->done_cv.wait_until(lock, *deadline, all_done);
+    stop->cancel();
+  }
+  tasks->done_cv.wait(lock, all_done);
+}
+
+void Chain::portfolio_loop(const std::shared_ptr<util::TimeCounter> &timer) {
+  util::TimeCounter::Lock time_lock(timer);
+  status_.store(WORKING, std::memory_order_release);
+
+  const size_t count = algorithms_.size();
+  CancellationToken stop(&interrupt_token_);
+  std::vector<std::unique_ptr<MemberEvents> > events;
+  std::vector<std::shared_ptr<TimetableInfoInterface> > tts(count);
+  std::vector<char> succeeded(count, 0);
+  std::vector<std::stringstream> errors(count);
+  for (size_t i = 0; i < count; ++i) {
+    events.emplace_back(new MemberEvents(this, &stop, deadline_));
+  }
+
+  run_concurrently(count, [&](size_t i) -> void {
+    TraceSpan span(trace(), "chain.create_timetable");
+    succeeded[i] = algorithms_[i]->create_timetable(input_.get(), events[i].get(), &tts[i], &errors[i]);
+  }, budget_ > 0.0 ? &deadline_ : nullptr, &stop);
+
+  // Choosing the best of completed timetables
+  std::vector<std::shared_ptr<TimetableInfoInterface> > candidates;
+  for (size_t i = 0; i < count; ++i) {
+    if (succeeded[i]) {
+      candidates.push_back(tts[i]);
+    }
+  }
+  if (candidates.empty() && !stop.cancelled()) {
+    for (size_t i = 0; i < count; ++i) {
+      std::cerr << "Failed to construct timetable: " << errors[i].str() << std::endl;
+    }
+  }
+  complete_concurrent(candidates);
+}
+
+void Chain::pipeline_loop(const std::shared_ptr<util::TimeCounter> &timer) {
+  util::TimeCounter::Lock time_lock(timer);
+  status_.store(WORKING, std::memory_order_release);
+
+  // Input of stage i is the latest timetable published by stage i - 1: intermediate ones
+  // and the final one, the result of the previous stage for its final input
+  struct Input {
+    std::shared_ptr<TimetableInfoInterface> tt;
+    size_t version;
+    bool final;
+  };
+  const size_t count = algorithms_.size();
+  CancellationToken stop(&interrupt_token_);
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<Input> inputs(count + 1, Input { nullptr, 0, false });
+  std::vector<std::shared_ptr<TimetableInfoInterface> > finals;     // results of stages' final inputs
+  std::vector<std::unique_ptr<MemberEvents> > events;
+  bool failed = false;
+
+  // Newer intermediate input is taken when the stage completes, but the final one restarts it
+  auto publish = [&](size_t stage, const std::shared_ptr<TimetableInfoInterface> &tt, bool final) -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (inputs[stage].final) {
+      return;
+    }
+    inputs[stage].tt = tt;
+    inputs[stage].final = final;
+    ++inputs[stage].version;
+    if (final && stage < count) {
+      events[stage]->token.cancel();
+    }
+    changed.notify_all();
+  };
+  for (size_t i = 0; i < count; ++i) {
+    events.emplace_back(new MemberEvents(this, &stop, deadline_));
+    events.back()->set_commit_callback([&publish, i](const std::shared_ptr<TimetableInfoInterface> &tt) -> void {
+      publish(i + 1, tt, false);
+    });
+  }
+
+  // Stages waiting for input must be woken, when some of them was interrupted or has failed
+  auto stop_all = [&](bool failure) -> void {
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = failed || failure;
+    stop.cancel();
+    changed.notify_all();
+  };
+  auto fail = [&](size_t stage, const std::stringstream &errors) -> void {
+    std::cerr << "Failed to " << (stage == 0 ? "construct" : "improve") << " timetable: "
+              << errors.str() << std::endl;
+    stop_all(true);
+  };
+
+  run_concurrently(count, [&](size_t i) -> void {
+    std::stringstream errors;
+    std::shared_ptr<TimetableInfoInterface> tt;
+    if (i == 0) {
+      bool created = false;
+      {
+        TraceSpan span(trace(), "chain.create_timetable");
+        created = algorithms_[0]->create_timetable(input_.get(), events[0].get(), &tt, &errors);
+      }
+      // Timetable completed after the stop can be truncated by the algorithm, it's intermediate only
+      if (created && !stop.cancelled()) {
+        std::atomic_store(&actual_tt_, tt);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          finals.push_back(tt);
+        }
+        publish(1, tt, true);
+      }
+      else if (created) {
+        commit_intermediate_timetable(tt);
+        stop_all(false);
+      }
+      else if (!stop.cancelled()) {
+        fail(0, errors);
+      }
+      else {
+        stop_all(false);
+      }
+      return;
+    }
+
+    size_t processed = 0;
+    while (true) {
+      Input input;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() -> bool {
+          return stop.cancelled() || inputs[i].version != processed;
+        });
+        if (stop.cancelled()) {
+          return;
+        }
+        input = inputs[i];
+        events[i]->token.reset();
+      }
+
+      tt.reset();
+      errors.str("");
+      bool succeeded = false;
+      if (input.tt.get() != nullptr) {
+        TraceSpan span(trace(), "chain.improve_timetable");
+        succeeded = algorithms_[i]->improve_timetable(input.tt.get(), events[i].get(), &tt, &errors);
+      }
+      // Improvement of the final input that has come after the stop still competes with the others
+      if (succeeded && input.final) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finals.push_back(tt);
+      }
+      if (stop.cancelled()) {
+        stop_all(false);
+        return;
+      }
+      processed = input.version;
+
+      // Intermediate input can be incomplete, so only failure on the final one is fatal
+      if (succeeded) {
+        if (input.final) {
+          std::atomic_store(&actual_tt_, tt);
+        }
+        publish(i + 1, tt, input.final);
+      }
+      else if (input.final) {
+        fail(i, errors);
+        return;
+      }
+      if (input.final) {
+        return;
+      }
+    }
+  }, budget_ > 0.0 ? &deadline_ : nullptr, &stop);
+
+  // Completed pipeline or the budget is over: final results of all stages (late ones too) compete
+  // by the objective, a later stage is not necessarily better
+  std::vector<std::shared_ptr<TimetableInfoInterface> > candidates;
+  if (!failed && (inputs[count].final || clock::now() >= deadline_)) {
+    candidates = finals;
+  }
+  complete_concurrent(candidates);
+}
+
+void Chain::complete_concurrent(const std::vector<std::shared_ptr<TimetableInfoInterface> > &candidates) {
+  // Injected timetable is one more candidate
+  AsyncOperationType op = async_op_.load(std::memory_order_acquire);
+  std::shared_ptr<TimetableInfoInterface> best;
+  if (op == INJECT_TT) {
+    best = std::atomic_load(&injected_tt_);
+  }
+  for (const auto &tt : candidates) {
+    if (objective_.better(input_.get(), tt.get(), best.get())) {
+      best = tt;
+    }
+  }
+
+  // Interrupted chain keeps the intermediate timetable committed by its members, it's the result then
+  std::atomic_store(&injected_tt_, std::shared_ptr<TimetableInfoInterface>());
+  if (best.get() != nullptr) {
+    std::atomic_store(&actual_tt_, best);
+    std::atomic_store(&intermediate_tt_, std::shared_ptr<TimetableInfoInterface>());
+  }
+  status_.store(best.get() != nullptr ? FINISHED : INTERRUPTED, std::memory_order_release);
+  if (op == INTERRUPT || op == INJECT_TT) {
+    async_op_.compare_exchange_strong(op, NONE, std::memory_order_acq_rel);
+  }
 }
 
 } // swm
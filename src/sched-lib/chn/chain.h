@@ -1,9 +1,13 @@
 
 #pragma once
 
+#include <condition_variable>
+
 #include "defs.h"
+#include "auxl/executor.h"
 #include "auxl/time_counter.h"
 #include "chain_metrics.h"
+#include "timetable_objective.h"
 #include "alg/algorithm.h"
 #include "ifaces/metrics_interface.h"
 #include "ifaces/timetable_info_interface.h"
@@ -11,9 +15,9 @@
 
 namespace swm {
 
-// Groups set of algorithms into chain. Spawns personal worker thread, provides thread-safe
-// async methods for basic management from single master thread. More complex functionality
-// implemented via ChainController.
+// Groups set of algorithms into chain. Works as a task of the given executor (or spawns
+// personal worker thread), provides thread-safe async methods for basic management from single
+// master thread. More complex functionality implemented via ChainController.
 class Chain : private PluginEventsInterface {
  public:
   enum StatusType {
@@ -22,54 +26,134 @@ class Chain : private PluginEventsInterface {
     INTERRUPTED   = 2,      // tt construction process interrupted by someone or due to errors
     FINISHED      = 3       // tt constructed without errors and can be used
   };
+  enum ModeType {
+    SEQUENTIAL    = 0,      // the first algorithm constructs tt, each next one improves it
+    PORTFOLIO     = 1,      // all algorithms construct tt concurrently, the best tt is taken
+    PIPELINE      = 2       // algorithms work concurrently, each next one improves the latest tt
+                            // published by the previous one (intermediate or final)
+  };
   
-  Chain() : status_(NOT_STARTED), async_op_(NONE) { }
+  Chain() : status_(NOT_STARTED), async_op_(NONE), cancel_token_(&interrupt_token_),
+            deadline_(clock::time_point::max()), deadline_checks_(0), stop_notified_(false), done_(false),
+            mode_(SEQUENTIAL), budget_(0.0), executor_(nullptr), tracer_(nullptr) { }
   void operator =(const Chain &) = delete;
   ~Chain();
 
   void init(const std::shared_ptr<SchedulingInfoInterface> &info,
             const std::vector<std::shared_ptr<Algorithm> > &algorithms,
-            std::shared_ptr<util::TimeCounter> timer = nullptr);
+            std::shared_ptr<util::TimeCounter> timer = nullptr,
+            util::Executor *executor = nullptr);
+  // Must be called before init(). Algorithms are given "budget" seconds since init() (zero means
+  // unlimited), they see the deadline and are forced to stop after it. Sequential chain and
+  // pipeline return the latest actual tt then, portfolio - the best of completed ones.
+  // Objective also decides whether injected tt is better than the result of portfolio or pipeline
+  void set_mode(ModeType mode,
+                const TimetableObjective &objective = TimetableObjective(),
+                double budget = 0.0);
+  ModeType mode() const { return mode_; }
+  // Must be called before init(). The worker gives algorithms the result of "copy" instead of the
+  // input, so the copy is allocated by a thread of the executor (e.g. in memory of its NUMA node);
+  // scheduling_info() is still the original input
+  typedef std::function<std::shared_ptr<SchedulingInfoInterface>(
+    const std::shared_ptr<SchedulingInfoInterface> &)> InputCopy;
+  void set_input_copy(const InputCopy &copy);
+  // Must be called before init(). The chain and its algorithms record spans there (nullptr disables it)
+  void set_tracer(TraceInterface *tracer) { tracer_ = tracer; }
+  TraceInterface *tracer() const { return tracer_; }
+  const TimetableObjective &objective() const { return objective_; }
+
+  const std::shared_ptr<SchedulingInfoInterface> &scheduling_info() const;
   const ChainMetrics &metrics() const;
   const std::vector<const Algorithm *> &algorithms() const;
   std::shared_ptr<TimetableInfoInterface> intermediate_timetable() const;
   std::shared_ptr<TimetableInfoInterface> actual_timetable() const;
+  // Actual timetable or, if there is no one yet, intermediate version of the current algorithm
+  std::shared_ptr<TimetableInfoInterface> latest_timetable() const;
 
-  StatusType status() const { return status_; }
-  bool stopped() const { return status_ != WORKING; }
+  StatusType status() const { return status_.load(std::memory_order_acquire); }
+  bool stopped() const { return status() != WORKING; }
   bool ready_for_async_operation() const;
   void interrupt_async();
   void inject_timetable_async(const std::shared_ptr<TimetableInfoInterface> &tt);
 
+  // Callback is invoked once, right after the chain has stopped (or immediately if it already has)
+  void set_stop_callback(const std::function<void()> &clb);
+  // Callback is invoked by the worker each time it has taken an injection and is ready for the next
+  // async operation (stop is reported by the stop callback only)
+  void set_ready_callback(const std::function<void()> &clb);
+
  protected:
   virtual bool forced_to_interrupt() const  override;
   virtual void commit_intermediate_timetable(
     const std::shared_ptr<TimetableInfoInterface> &tt) override;
+  virtual const CancellationToken &cancellation_token() const override { return cancel_token_; }
+  virtual clock::time_point deadline() const override { return deadline_; }
+  virtual TraceInterface *trace() const override { return tracer_; }
  
  private:
   enum AsyncOperationType {
     NONE      = 0,        // nothing to do
     INTERRUPT = 1,        // chain must be interrupted asap
-    INJECT_TT = 2         // new tt "injected_tt_" must be injected asap
+    INJECT_TT = 2,        // new tt "injected_tt_" must be injected asap
+    PLACING   = 3         // operation is being placed by the master thread, not visible to worker
   };
 
-  void lock() const;
-  void unlock() const;
+  class MemberEvents;
+  struct ConcurrentTasks;
+
+  void run(const std::shared_ptr<util::TimeCounter> &timer);
   void worker_loop(const std::shared_ptr<util::TimeCounter> &timer);
+  void portfolio_loop(const std::shared_ptr<util::TimeCounter> &timer);
+  void pipeline_loop(const std::shared_ptr<util::TimeCounter> &timer);
+  void run_concurrently(size_t count,
+                        const std::function<void(size_t)> &task,
+                        const clock::time_point *deadline,
+                        CancellationToken *stop);
+  AsyncOperationType placed_async_op() const;
+  void notify_placed() const;
+  void notify_ready();
+  void complete_concurrent(const std::vector<std::shared_ptr<TimetableInfoInterface> > &candidates);
+
+  std::thread worker_;                      // only if executor was not specified
 
-  mutable std::atomic_flag locker_;
-  std::thread worker_;
+  // Status and operation are published with release semantics, so the data written before
+  // (timetables) are visible to the thread that has seen the new value
+  std::atomic<StatusType> status_;
+  std::atomic<AsyncOperationType> async_op_;
 
-  volatile StatusType status_;
-  volatile AsyncOperationType async_op_;
+  // Cancelled before the operation is published, so the worker that has seen the token waits for
+  // the operation. Groups of concurrent algorithms are children of the interrupt token: injected
+  // tt doesn't stop them
+  CancellationToken interrupt_token_;
+  CancellationToken cancel_token_;          // also cancelled by injection, reset when it's taken
+  clock::time_point deadline_;
+  mutable std::atomic<size_t> deadline_checks_;   // shared by the threads calling forced_to_interrupt()
   ChainMetrics metrics_;
   std::shared_ptr<SchedulingInfoInterface> info_;
+  std::shared_ptr<SchedulingInfoInterface> input_;    // read by algorithms, worker only after init()
+  InputCopy input_copy_;
   std::vector<std::shared_ptr<Algorithm> > algorithms_;
   std::vector<const Algorithm *> algorithms_ptrs_;
   
+  // Accessed only via std::atomic_load()/std::atomic_store(): readers take the published
+  // snapshot, writers replace it as a whole
   std::shared_ptr<TimetableInfoInterface> injected_tt_;
   std::shared_ptr<TimetableInfoInterface> intermediate_tt_;
   std::shared_ptr<TimetableInfoInterface> actual_tt_;
+
+  mutable std::mutex done_mutex_;
+  mutable std::condition_variable done_cv_;       // also notified when async operation is placed or taken
+  std::function<void()> stop_clb_;
+  std::function<void()> ready_clb_;
+  bool stop_notified_;
+  bool done_;                               // "run" won't touch the object anymore
+
+  ModeType mode_;
+  TimetableObjective objective_;
+  double budget_;
+  util::Executor *executor_;                // runs portfolio members, if specified
+  std::unique_ptr<util::Executor> own_executor_;    // runs them otherwise
+  TraceInterface *tracer_;
 };
 
 } // swm
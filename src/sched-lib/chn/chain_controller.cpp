@@ -1,21 +1,62 @@
 
 #include "chain_controller.h"
 
+#include <algorithm>
+#include <iostream>
+
 namespace swm {
 namespace util {
 
+// Timer of the pending interruption: it's completed either by the chain's stop or by the deadline
+struct ChainController::InterruptRequest {
+  finish_callback clb;
+  done_callback done;
+  std::shared_ptr<TimeCounter> timer;
+  TimerWheel::clock::time_point deadline;
+  TimerWheel::TimerId timer_id;
+  std::atomic<bool> completed;
+};
+
+// Exchange request waiting for the counterpart, owned by whoever takes it from "exchange_offer_"
+struct ChainController::ExchangeOffer {
+  ChainController *owner;
+  const ChainController *target;
+  exchange_callback clb;
+  done_callback done;
+  std::shared_ptr<TimeCounter> timer;
+  TimerWheel::clock::time_point deadline;
+  TimerWheel::TimerId timer_id;
+};
+
 ChainController::~ChainController() {
-  stopped_ = true;
-  if (worker_.joinable()) {
-    worker_.join();
+  if (chain_.get() == nullptr) {
+    return;
+  }
+
+  // Skipping the rest of commands, waiting for the finish callback (pending command is
+  // completed by its deadline at the latest)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  schedule_drain();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_cv_.wait(lock, [this]() -> bool { return finished_ && !draining_; });
   }
+
+  // Waits for the callbacks if they are being called right now
+  chain_->set_ready_callback(nullptr);
+  chain_->set_stop_callback(nullptr);
 }
 
 void ChainController::init(const std::shared_ptr<Chain> &chain,
                            const swm::MetricsInterface *service_metrics,
                            const finish_callback &clb,
                            double timeout,
-                           std::shared_ptr<TimeCounter> timer) {
+                           std::shared_ptr<TimeCounter> timer,
+                           Executor *executor,
+                           TimerWheel *timers) {
   if (chain.get() == nullptr || service_metrics == nullptr) {
     throw std::runtime_error(
       "ChainController::init(): \"chain\" and \"service_metrics\" cannot be equal to nullptr");
@@ -35,30 +76,122 @@ void ChainController::init(const std::shared_ptr<Chain> &chain,
   timeout_ = timeout;
   finished_ = false;
   stopped_ = false;
-  exchange_stage_ = WAITING;
-  exchange_traget_ = nullptr;
+  timer_ = timer;
+
+  executor_ = executor;
+  if (executor_ == nullptr) {
+    own_executor_.reset(new Executor(1));
+    executor_ = own_executor_.get();
+  }
+  timers_ = timers;
+  if (timers_ == nullptr) {
+    own_timers_.reset(new TimerWheel());
+    timers_ = own_timers_.get();
+  }
 
-  locker_.clear();
-  worker_ = std::thread([obj = this, timer]() -> void { obj->worker_loop(timer); });
+  // Finish callback is called as soon as the chain stops (right now, if it already has)
+  chain_->set_ready_callback([obj = this]() -> void { obj->on_chain_ready(); });
+  chain_->set_stop_callback([obj = this]() -> void { obj->on_chain_stopped(); });
 }
 
-void ChainController::invoke(const std::function<void(bool)> &func) {
+void ChainController::invoke(const command &func) {
   if (chain_.get() == nullptr || service_metrics_ == nullptr) {
     throw std::runtime_error("ChainController::invoke(): object must be initialized first");
   }
 
-  // Trying to delegate request to worker thread
+  // Trying to delegate request to executor
   bool placed = false;
-  lock();
-  if ((placed = !stopped_)) {
-    queue_.push(func);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((placed = !stopped_)) {
+      queue_.push(func);
+    }
   }
-  unlock();
 
-  // The worker thread was already stopped, just skipping request
+  // The chain was already stopped, just skipping request
   if (!placed) {
-    func(true);
+    func(true, []() -> void { });
+    return;
+  }
+  schedule_drain();
+}
+
+void ChainController::schedule_drain() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (draining_ || finished_) {
+      return;
+    }
+    draining_ = true;
+  }
+  executor_->submit([obj = this]() -> void { obj->drain(); });
+}
+
+void ChainController::on_chain_stopped() {
+  std::vector<std::function<void()> > waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chain_stopped_ = true;
+    waiters.swap(stop_waiters_);
+    waiters.insert(waiters.end(), ready_waiters_.begin(), ready_waiters_.end());
+    ready_waiters_.clear();
+  }
+  for (auto &waiter : waiters) {
+    waiter();
+  }
+
+  // Nobody will exchange with the stopped chain
+  std::shared_ptr<ExchangeOffer> offer;
+  {
+    std::lock_guard<std::mutex> lock(exchange_mutex_);
+    offer.swap(exchange_offer_);
+  }
+  if (offer.get() != nullptr) {
+    timers_->cancel(offer->timer_id);
+    executor_->submit([offer]() -> void {
+      {
+        TimeCounter::Lock time_lock(offer->timer);
+        offer->clb(false);
+      }
+      offer->done();
+    });
+  }
+
+  schedule_drain();
+}
+
+void ChainController::on_chain_ready() {
+  std::vector<std::function<void()> > waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiters.swap(ready_waiters_);
+  }
+  for (auto &waiter : waiters) {
+    waiter();
+  }
+}
+
+void ChainController::when_chain_stopped(const std::function<void()> &clb) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!chain_stopped_) {
+      stop_waiters_.push_back(clb);
+      return;
+    }
+  }
+  clb();
+}
+
+void ChainController::when_chain_ready(const std::function<void()> &clb) {
+  // The chain notifies after it has become ready, so the check under the mutex can't miss it
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!chain_stopped_ && !chain_->ready_for_async_operation()) {
+      ready_waiters_.push_back(clb);
+      return;
+    }
   }
+  clb();
 }
 
 bool ChainController::finished() const {
@@ -72,169 +205,238 @@ bool ChainController::finished() const {
 void ChainController::invoke_exchange(const ChainController *target,
                                       const exchange_callback &clb,
                                       std::shared_ptr<TimeCounter> timer) {
-  auto func = [clb,
-               chain = chain_.get(),
-               exch_stage = &exchange_stage_,
-               exch_chain_ptr = &exchange_traget_,
-               target_chain = target->chain_.get(),
-               target_exch_stage = &target->exchange_stage_,
-               target_exch_chain_ptr = &target->exchange_traget_,
-               timeout = timeout_,
-               timer](bool skipped) -> void {
-    TimeCounter::Lock time_lock(timer);
-    if (!skipped && !chain->stopped() && !target_chain->stopped()) {
-      auto t_start = clock::now();
-
-      // Waiting while target controller is ready for exchange
-      // Important: exchange with our chain, not some other else
-      *exch_stage = WAITING;
-      *exch_chain_ptr = target_chain;
-      while (*target_exch_chain_ptr != chain &&
-             to_seconds(clock::now(), t_start) < timeout) {
-        std::this_thread::yield();
-      }
-      if (*target_exch_chain_ptr != chain) {
-        *exch_stage = FAILED;
-        *exch_chain_ptr = nullptr;
-        clb(false);
-        return;
-      }
+  auto func = [obj = this, target, clb, timer](bool skipped, const done_callback &done) -> void {
+    if (!skipped && !obj->chain_->stopped() && !target->chain_->stopped()) {
+      obj->offer_exchange(target, clb, done, timer);
+      return;
+    }
 
-      // Taking target's tt before it has injected our
-      auto tt = target_chain->actual_timetable();
-      if (tt.get() == nullptr) {
-        *exch_stage = FAILED;
-        *exch_chain_ptr = nullptr;
-        clb(false);
-        return;
-      }
-      *exch_stage = TT_TAKEN;
-      while (*target_exch_stage != TT_TAKEN &&
-             *target_exch_stage != TT_INJECTING &&
-             *target_exch_stage != FAILED &&
-             to_seconds(clock::now(), t_start) < timeout) {
-        std::this_thread::yield();
-      }
-      if (*target_exch_stage != TT_TAKEN &&
-          *target_exch_stage != TT_INJECTING) {
-        *exch_stage = FAILED;
-        *exch_chain_ptr = nullptr;
-        clb(false);
-        return;
-      }
-      
-      // Waiting while our chain will is ready for injection
-      while (!chain->stopped() &&
-             !chain->ready_for_async_operation() &&
-             to_seconds(clock::now(), t_start) < timeout) {
-        std::this_thread::yield();
-      }
-      if (!chain->ready_for_async_operation() || chain->stopped()) {
-        *exch_stage = FAILED;
-        *exch_chain_ptr = nullptr;
-        clb(false);
-        return;
-      }
+    {
+      TimeCounter::Lock time_lock(timer);
+      clb(false);
+    }
+    done();
+  };
 
-      // Ok, expecting the same status on target
-      *exch_stage = TT_INJECTING;
-      while (*target_exch_stage != TT_INJECTING &&
-             *target_exch_stage != FAILED &&
-             to_seconds(clock::now(), t_start) < timeout) {
-        std::this_thread::yield();
-      }
-      if (*target_exch_stage != TT_INJECTING) {
-        *exch_stage = FAILED;
-        *exch_chain_ptr = nullptr;
-        clb(false);
-        return;
-      }
+  invoke(func);
+}
 
-      // Injecting tt taken from the target chain
+void ChainController::offer_exchange(const ChainController *target,
+                                     const exchange_callback &clb,
+                                     const done_callback &done,
+                                     const std::shared_ptr<TimeCounter> &timer) {
+  std::shared_ptr<ExchangeOffer> offer(new ExchangeOffer());
+  offer->owner = this;
+  offer->target = target;
+  offer->clb = clb;
+  offer->done = done;
+  offer->timer = timer;
+  offer->deadline = TimerWheel::clock::now() +
+                    std::chrono::duration_cast<TimerWheel::clock::duration>(
+                      std::chrono::duration<double>(timeout_));
+  offer->timer_id = 0;
+
+  // Important: exchange with our chain, not some other else. Both offers are guarded,
+  // std::lock() takes the mutexes without deadlock whatever order the counterpart uses
+  std::shared_ptr<ExchangeOffer> counter;
+  {
+    std::unique_lock<std::mutex> own_lock(exchange_mutex_, std::defer_lock);
+    std::unique_lock<std::mutex> target_lock;
+    if (target != this) {
+      target_lock = std::unique_lock<std::mutex>(target->exchange_mutex_, std::defer_lock);
+      std::lock(own_lock, target_lock);
+    }
+    else {
+      own_lock.lock();
+    }
+    auto &target_offer = const_cast<ChainController *>(target)->exchange_offer_;
+    if (target_offer.get() != nullptr && target_offer->target == this) {
+      counter.swap(target_offer);
+    }
+    else {
+      // Expiration can't be lost: the timer's callback waits for the mutex
+      offer->timer_id = timers_->schedule(timeout_, [obj = this, offer]() -> void {
+        {
+          std::lock_guard<std::mutex> lock(obj->exchange_mutex_);
+          if (obj->exchange_offer_ != offer) {
+            return;                                   // already taken by the counterpart
+          }
+          obj->exchange_offer_.reset();
+        }
+        obj->executor_->submit([offer]() -> void {
+          {
+            TimeCounter::Lock time_lock(offer->timer);
+            offer->clb(false);
+          }
+          offer->done();
+        });
+      });
+      exchange_offer_ = offer;
+    }
+  }
+
+  // The counterpart is waiting for us, so we are the one who exchanges timetables
+  if (counter.get() != nullptr) {
+    timers_->cancel(counter->timer_id);
+    perform_exchange(counter, offer);
+  }
+}
+
+void ChainController::perform_exchange(const std::shared_ptr<ExchangeOffer> &first,
+                                       const std::shared_ptr<ExchangeOffer> &second) {
+  TraceSpan span(first->owner->chain_->tracer(), "controller.exchange");
+  Chain *chain1 = first->owner->chain_.get();
+  Chain *chain2 = second->owner->chain_.get();
+  const bool stopped = chain1->stopped() || chain2->stopped();
+  const bool ready = !stopped &&
+                     chain1->ready_for_async_operation() &&
+                     chain2->ready_for_async_operation();
+
+  // Some chain hasn't taken the previous async operation yet, checking it again the next tick
+  if (!stopped && !ready &&
+      TimerWheel::clock::now() < std::min(first->deadline, second->deadline)) {
+    ChainController *obj = second->owner;
+    const double tick = std::chrono::duration<double>(obj->timers_->tick()).count();
+    obj->timers_->schedule(tick, [obj, first, second]() -> void {
+      obj->executor_->submit([first, second]() -> void { perform_exchange(first, second); });
+    });
+    return;
+  }
+
+  // Both timetables are taken before the injections
+  bool success = false;
+  if (ready) {
+    TimeCounter::Lock time_lock(second->timer);
+    auto tt1 = chain1->actual_timetable();
+    auto tt2 = chain2->actual_timetable();
+    if (tt1.get() != nullptr && tt2.get() != nullptr) {
       try {
-        chain->inject_timetable_async(target_chain->actual_timetable());
+        chain1->inject_timetable_async(tt2);
+        chain2->inject_timetable_async(tt1);
+        success = true;
       }
       catch (std::exception &ex) {
-        *exch_stage = FAILED;
-        std::cerr << "Exception from ChainController::invoke_exchange(): "
+        std::cerr << "Exception from ChainController::perform_exchange(): "
                   << ex.what() << std::endl;
       }
+    }
+  }
 
-      // Done! Notifying the caller
-      *exch_chain_ptr = nullptr;
-      clb(true);
+  // Done! Notifying both callers
+  for (auto offer : { first, second }) {
+    TimeCounter::Lock time_lock(offer->timer);
+    offer->clb(success);
+  }
+  first->done();
+  second->done();
+}
+
+void ChainController::invoke_interrupt(const finish_callback &clb,
+                                       std::shared_ptr<TimeCounter> timer) {
+  auto func = [obj = this, clb, timer](bool skipped, const done_callback &done) -> void {
+    if (!skipped && obj->chain_->status() == Chain::WORKING) {
+      std::shared_ptr<InterruptRequest> req(new InterruptRequest());
+      req->clb = clb;
+      req->done = done;
+      req->timer = timer;
+      req->deadline = TimerWheel::clock::now() +
+                      std::chrono::duration_cast<TimerWheel::clock::duration>(
+                        std::chrono::duration<double>(obj->timeout_));
+      req->timer_id = 0;
+      req->completed = false;
+      obj->try_interrupt(req);
+      return;
     }
-    else {
-      clb(false);
+
+    {
+      TimeCounter::Lock time_lock(timer);
+      clb(false, obj->chain_->latest_timetable(), std::shared_ptr<MetricsSnapshot>());
     }
+    done();
   };
 
   invoke(func);
 }
 
-void ChainController::invoke_interrupt(const finish_callback &clb,
-                                       std::shared_ptr<TimeCounter> timer) {
-  auto func = [clb,
-               srv_metrics = service_metrics_,
-               chain = chain_.get(),
-               hard_interruption_flag = &stopped_,
-               timeout = timeout_,
-               timer](bool skipped) -> void {
-    TimeCounter::Lock time_lock(timer);
-    std::shared_ptr<TimetableInfoInterface> tt;
-    std::shared_ptr<MetricsSnapshot> metrics;
-    
-    if (!skipped && chain->status() == Chain::WORKING) {
-      auto t_start = clock::now();
-
-      // First of all, checking that chain is ready for operation
-      while (!chain->stopped() &&
-             !chain->ready_for_async_operation() &&
-             (to_seconds(clock::now(), t_start) < timeout)) {
-        std::this_thread::yield();
-      }
-
-      // Not ready? Performing "hard" interruption
-      if (!chain->ready_for_async_operation()) {
-        *hard_interruption_flag = true;
-        metrics.reset(new MetricsSnapshot(*srv_metrics, *chain));
-        clb(true, tt, metrics);
+void ChainController::try_interrupt(const std::shared_ptr<InterruptRequest> &req) {
+  TraceSpan span(chain_->tracer(), "controller.try_interrupt");
+  {
+    TimeCounter::Lock time_lock(req->timer);
+
+    // First of all, checking that chain is ready for operation. If it's not, trying again
+    // when the chain takes its operation, and performing "hard" interruption at the deadline
+    if (!chain_->stopped() && !chain_->ready_for_async_operation()) {
+      if (TimerWheel::clock::now() < req->deadline) {
+        std::shared_ptr<std::atomic<bool> > claimed(new std::atomic<bool>(false));
+        const double remaining = std::chrono::duration<double>(req->deadline - TimerWheel::clock::now()).count();
+        const TimerWheel::TimerId id = timers_->schedule(remaining, [obj = this, req, claimed]() -> void {
+          if (!claimed->exchange(true)) {
+            req->completed = true;
+            obj->executor_->submit([obj, req]() -> void { obj->complete_interrupt(req); });
+          }
+        });
+        when_chain_ready([obj = this, req, claimed, id]() -> void {
+          if (!claimed->exchange(true)) {
+            obj->timers_->cancel(id);
+            obj->executor_->submit([obj, req]() -> void { obj->try_interrupt(req); });
+          }
+        });
         return;
       }
+      req->completed = true;
+      complete_interrupt(req);
+      return;
+    }
 
-      // Trying to enqueue async request
+    // Trying to enqueue async request
+    if (!chain_->stopped()) {
       try {
-        chain->interrupt_async();
+        chain_->interrupt_async();
       }
       catch (std::exception &ex) {
-        std::cerr << "Exception from ChainController::invoke_interrupt(): "
-                  << ex.what() << std::endl;
-        clb(false, tt, metrics);
+        std::cerr << "Exception from ChainController::try_interrupt(): " << ex.what() << std::endl;
+        req->clb(false, chain_->latest_timetable(), std::shared_ptr<MetricsSnapshot>());
+        req->done();
         return;
       }
+    }
+  }
 
-      // Ok, waiting for "soft" interruption
-      while (!chain->stopped() &&
-             (to_seconds(clock::now(), t_start) < timeout)) {
-        std::this_thread::yield();
-      }
+  // Ok, waiting for "soft" interruption: whoever comes first completes the request
+  const double remaining = std::chrono::duration<double>(req->deadline - TimerWheel::clock::now()).count();
+  req->timer_id = timers_->schedule(remaining, [obj = this, req]() -> void {
+    if (!req->completed.exchange(true)) {
+      obj->executor_->submit([obj, req]() -> void { obj->complete_interrupt(req); });
+    }
+  });
+  when_chain_stopped([obj = this, req]() -> void {
+    if (!req->completed.exchange(true)) {
+      obj->timers_->cancel(req->timer_id);
+      obj->executor_->submit([obj, req]() -> void { obj->complete_interrupt(req); });
+    }
+  });
+}
 
-      // Checking that it's actually stopped. If not - starting "hard" interruption
-      metrics.reset(new MetricsSnapshot(*srv_metrics,  *chain));
-      if (chain->stopped()) {
-        clb(chain->status() == Chain::INTERRUPTED, tt, metrics);
-      }
-      else {
-        *hard_interruption_flag = true;
-        clb(true, tt, metrics);
-      }
+void ChainController::complete_interrupt(const std::shared_ptr<InterruptRequest> &req) {
+  TraceSpan span(chain_->tracer(), "controller.complete_interrupt");
+  {
+    // Checking that it's actually stopped. If not - starting "hard" interruption, the chain's
+    // work is abandoned, but its latest timetable is still returned. The plugin keeps running,
+    // so it's not reported as interrupted
+    TimeCounter::Lock time_lock(req->timer);
+    std::shared_ptr<MetricsSnapshot> metrics(new MetricsSnapshot(*service_metrics_, *chain_));
+    if (chain_->stopped()) {
+      req->clb(chain_->status() == Chain::INTERRUPTED, chain_->latest_timetable(), metrics);
     }
     else {
-      clb(false, tt, metrics);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+      }
+      req->clb(false, chain_->latest_timetable(), metrics);
     }
-  };
-
-  invoke(func);
+  }
+  req->done();
 }
 
 void ChainController::invoke_stats(const stats_callback &clb,
@@ -242,61 +444,152 @@ void ChainController::invoke_stats(const stats_callback &clb,
   auto func = [clb,
                serv_metrics = service_metrics_,
                chain = chain_.get(),
-               timer](bool skipped) -> void {
-    TimeCounter::Lock lock(timer);
-    if (!skipped && !chain->stopped()) {
-      std::shared_ptr<MetricsSnapshot> snapshot(new MetricsSnapshot(*serv_metrics, *chain));
-      clb(true, snapshot);
+               timer](bool skipped, const done_callback &done) -> void {
+    {
+      TimeCounter::Lock lock(timer);
+      if (!skipped && !chain->stopped()) {
+        std::shared_ptr<MetricsSnapshot> snapshot(new MetricsSnapshot(*serv_metrics, *chain));
+        clb(true, snapshot);
+      }
+      else {
+        clb(false, std::shared_ptr<MetricsSnapshot>());
+      }
     }
-    else {
-      clb(false, std::shared_ptr<MetricsSnapshot>());
+    done();
+  };
+
+  invoke(func);
+}
+
+void ChainController::invoke_migration(const std::shared_ptr<ExchangeHub> &hub,
+                                       const SwmUID &island,
+                                       const exchange_callback &clb,
+                                       std::shared_ptr<TimeCounter> timer) {
+  if (hub.get() == nullptr) {
+    throw std::runtime_error("ChainController::invoke_migration(): \"hub\" cannot be equal to nullptr");
+  }
+
+  auto func = [hub, island, clb, chain = chain_.get(), timer](bool skipped, const done_callback &done) -> void {
+    {
+      TimeCounter::Lock time_lock(timer);
+      bool migrated = false;
+      if (!skipped && !chain->stopped()) {
+        try {
+          auto own = chain->actual_timetable();
+          if (own.get() != nullptr) {
+            hub->post(island, own);
+          }
+
+          std::shared_ptr<TimetableInfoInterface> best = own;
+          for (const auto &tt : hub->candidates(island)) {
+            if (chain->objective().better(chain->scheduling_info().get(), tt.get(), best.get())) {
+              best = tt;
+            }
+          }
+          if (best != own && !chain->stopped() && chain->ready_for_async_operation()) {
+            chain->inject_timetable_async(best);
+            migrated = true;
+          }
+        }
+        catch (std::exception &ex) {
+          std::cerr << "Exception from ChainController::invoke_migration(): " << ex.what() << std::endl;
+        }
+      }
+      clb(migrated);
     }
+    done();
   };
 
   invoke(func);
 }
 
-void ChainController::worker_loop(const std::shared_ptr<TimeCounter> &timer) {
-  // Processing all incoming requests, time will be measured by callbacks
-  stopped_ = false;
-  finished_ = false;
-  while (!stopped_ && !chain_->stopped()) { // beware, "stopped_" can be set by invoked function!
-    if (!queue_.empty()) {
-      lock();
-      auto func = queue_.front();
-      queue_.pop();
-      unlock();
-      
-      try { func(false); }
-      catch (std::exception &ex) {
-        std::cerr << "Exception from ChainController::worker_loop(): " << ex.what() << std::endl;
-        stopped_ = true;
+void ChainController::drain() {
+  // Processing enqueued requests one by one, time will be measured by callbacks
+  while (true) {
+    command func;
+    bool skipped = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      skipped = stopped_ || chain_->stopped(); // beware, "stopped_" can be set by invoked function!
+      if (queue_.empty()) {
+        if (!skipped) {
+          draining_ = false;                     // the chain will schedule us again when stops
+          return;
+        }
+        break;
       }
+      func = queue_.front();
+      queue_.pop();
+      pending_ = true;
+    }
+
+    try {
+      TraceSpan span(chain_->tracer(), "controller.command");
+      func(skipped, [obj = this]() -> void { obj->resume(); });
+    }
+    catch (std::exception &ex) {
+      std::cerr << "Exception from ChainController::drain(): " << ex.what() << std::endl;
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+      pending_ = false;
+    }
+
+    // Command is waiting for some event, it will resume us
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_) {
+      suspended_ = true;
+      return;
     }
-    std::this_thread::yield();
   }
 
+  finish();
+}
+
+void ChainController::resume() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ = false;
+    if (!suspended_) {
+      return;                                    // completed synchronously
+    }
+    suspended_ = false;
+  }
+  executor_->submit([obj = this]() -> void { obj->drain(); });
+}
+
+void ChainController::finish() {
   // Skipping the last requests
-  TimeCounter::Lock time_lock(timer);
-  lock();
-  bool succeeded = !stopped_ && chain_->status() == Chain::FINISHED;// no errors and interruptions?
-  while (!queue_.empty()) {
-    auto &func = queue_.front();
-    
-    try { func(true); }
+  TimeCounter::Lock time_lock(timer_);
+  TraceSpan span(chain_->tracer(), "controller.finish");
+  std::queue<command> rest;
+  bool succeeded = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    succeeded = !stopped_ && chain_->status() == Chain::FINISHED; // no errors and interruptions?
+    stopped_ = true;
+    rest.swap(queue_);
+  }
+  while (!rest.empty()) {
+    try { rest.front()(true, []() -> void { }); }
     catch (std::exception &ex) {
-      std::cerr << "Exception from ChainController::worker_loop(): " << ex.what() << std::endl;
+      std::cerr << "Exception from ChainController::finish(): " << ex.what() << std::endl;
     }
+    rest.pop();
+  }
 
-    queue_.pop();
+  // Notifying caller about result, interrupted chain returns the best it has got so far
+  try {
+    finish_clb_(succeeded, chain_->latest_timetable(),
+                std::shared_ptr<MetricsSnapshot>(new MetricsSnapshot(*service_metrics_, *chain_)));
+  }
+  catch (std::exception &ex) {
+    std::cerr << "Exception from ChainController::finish(): " << ex.what() << std::endl;
   }
-  stopped_ = true;
-  unlock();
 
-  // Notifying caller about result
-  finish_clb_(succeeded, chain_->actual_timetable(),
-              std::shared_ptr<MetricsSnapshot>(new MetricsSnapshot(*service_metrics_, *chain_)));
+  std::lock_guard<std::mutex> lock(mutex_);
   finished_ = true;
+  draining_ = false;
+  finished_cv_.notify_all();
 }
 
 } // util
@@ -2,16 +2,22 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
 
 #include "defs.h"
 #include "chain.h"
+#include "auxl/timer_wheel.h"
+#include "exchange_hub.h"
 #include "metrics_snapshot.h"
 
 namespace swm {
 namespace util {
 
 // Allows owner to enqueue multiple async commands to chain
-// Spawns personal thread to check timeouts
+// Commands are performed one by one as tasks of the executor (personal one-thread executor
+// is created if it was not specified), the chain notifies controller about its completion.
+// Commands do not wait actively: they are continued by events (chain has stopped, the other
+// side of exchange has come) or by deadlines of the timer wheel (personal one if not specified)
 class ChainController {
  public:
   typedef std::function<void(bool)> exchange_callback;
@@ -22,8 +28,9 @@ class ChainController {
                              const std::shared_ptr<MetricsSnapshot> &)> stats_callback;
 
   ChainController()
-      : timeout_(0.0), finished_(false), stopped_(false),
-        service_metrics_(nullptr), exchange_stage_(WAITING), exchange_traget_(nullptr) { }
+      : timeout_(0.0), executor_(nullptr), timers_(nullptr), draining_(false), pending_(false),
+        suspended_(false), chain_stopped_(false), finished_(false), stopped_(false),
+        service_metrics_(nullptr) { }
   ChainController(const ChainController &) = delete;
   void operator =(const ChainController &) = delete;
   ~ChainController();
@@ -31,8 +38,13 @@ class ChainController {
             const swm::MetricsInterface *service_metrics,
             const finish_callback &clb,
             double timeout,
-            std::shared_ptr<TimeCounter> timer = nullptr);
+            std::shared_ptr<TimeCounter> timer = nullptr,
+            Executor *executor = nullptr,
+            TimerWheel *timers = nullptr);
   bool finished() const;
+  // Chain's plugin still works after the finish callback (the chain was interrupted "hard"),
+  // so releasing the chain would wait for it
+  bool chain_abandoned() const { return chain_.get() != nullptr && !chain_->stopped(); }
 
   void invoke_exchange(const ChainController *target,
                        const exchange_callback &clb,
@@ -41,40 +53,64 @@ class ChainController {
                         std::shared_ptr<TimeCounter> timer = nullptr);
   void invoke_stats(const stats_callback &clb,
                     std::shared_ptr<TimeCounter> timer = nullptr);
+  // Posts the actual tt of the chain as "island" to the hub, injects the best of candidates
+  // if it's better than own one. Never waits: "false" if the chain is not ready right now
+  void invoke_migration(const std::shared_ptr<ExchangeHub> &hub,
+                        const SwmUID &island,
+                        const exchange_callback &clb,
+                        std::shared_ptr<TimeCounter> timer = nullptr);
 
  private:
-  enum ExchangeStage {
-    WAITING        = 0,       // waiting while target controller starts exchange
-    TT_TAKEN       = 2,       // taked tt from target controller, not injected yet
-    TT_INJECTING   = 3,       // ready for injection, expecting the same status from target ctrler
-    FAILED         = 4        // something went wrong!
-  };
-  typedef std::chrono::high_resolution_clock clock;
-  typedef std::chrono::time_point<clock> time_point;
-  static double to_seconds(const time_point &end, const time_point &start) {
-    return (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 1e-6;
-  }
+  // Command must call "done" when it's completed (maybe later and from other thread),
+  // the next command is not started until that
+  typedef std::function<void()> done_callback;
+  typedef std::function<void(bool, const done_callback &)> command;
+
+  struct InterruptRequest;
+  struct ExchangeOffer;
 
-  void invoke(const std::function<void(bool)> &func);
-  void worker_loop(const std::shared_ptr<TimeCounter> &timer);
-  void lock() {
-    while (locker_.test_and_set()) { std::this_thread::yield(); }
-  }
-  void unlock() { locker_.clear(); }
+  void invoke(const command &func);
+  void schedule_drain();
+  void drain();
+  void resume();
+  void finish();
+  void on_chain_stopped();
+  void on_chain_ready();
+  void when_chain_stopped(const std::function<void()> &clb);
+  void when_chain_ready(const std::function<void()> &clb);    // or stopped
+
+  void try_interrupt(const std::shared_ptr<InterruptRequest> &req);
+  void complete_interrupt(const std::shared_ptr<InterruptRequest> &req);
+  void offer_exchange(const ChainController *target,
+                      const exchange_callback &clb,
+                      const done_callback &done,
+                      const std::shared_ptr<TimeCounter> &timer);
+  static void perform_exchange(const std::shared_ptr<ExchangeOffer> &first,
+                               const std::shared_ptr<ExchangeOffer> &second);
 
   double timeout_;
-  std::thread worker_;
-  std::atomic_flag locker_;
+  std::shared_ptr<TimeCounter> timer_;
+  std::unique_ptr<Executor> own_executor_;
+  Executor *executor_;
+  std::unique_ptr<TimerWheel> own_timers_;
+  TimerWheel *timers_;
+  std::mutex mutex_;
+  std::condition_variable finished_cv_;
+  bool draining_;                // commands are being performed by executor, guarded by mutex
+  bool pending_;                 // current command has not called "done" yet, guarded by mutex
+  bool suspended_;               // drain is waiting for "done" of current command, guarded by mutex
+  bool chain_stopped_;           // stop notification was received, guarded by mutex
+  std::vector<std::function<void()> > stop_waiters_;
+  std::vector<std::function<void()> > ready_waiters_;
+  mutable std::mutex exchange_mutex_;     // guards "exchange_offer_", the counterpart's one is locked too
+  std::shared_ptr<ExchangeOffer> exchange_offer_;
 
-  volatile bool finished_;       // the worker thread has finished all work
-  volatile bool stopped_;        // chain has completed its work, but worker thread is still active
+  std::atomic<bool> finished_;   // all commands are performed and finish callback was called
+  std::atomic<bool> stopped_;    // chain has completed its work, but commands are still performed
   finish_callback finish_clb_;
-  std::queue<std::function<void(bool)> > queue_;
+  std::queue<command> queue_;
   std::shared_ptr<Chain> chain_;
   const swm::MetricsInterface *service_metrics_;
-
-  volatile ExchangeStage exchange_stage_;
-  volatile const Chain *exchange_traget_;
 };
 
 } // util
@@ -0,0 +1,101 @@
+#include "exchange_hub.h"
+
+#include <algorithm>
+
+namespace swm {
+namespace util {
+
+bool ExchangeHub::topology_from_string(const std::string &name, Topology *topology) {
+  if (name == "ring") {
+    *topology = RING;
+  }
+  else if (name == "star") {
+    *topology = STAR;
+  }
+  else if (name == "all_to_all") {
+    *topology = ALL_TO_ALL;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+bool ExchangeHub::join(const SwmUID &island) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_of(island) != mailboxes_.size()) {
+    return false;
+  }
+  mailboxes_.push_back(Mailbox { island, nullptr });
+  return true;
+}
+
+void ExchangeHub::leave(const SwmUID &island) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t index = index_of(island);
+  if (index != mailboxes_.size()) {
+    mailboxes_.erase(mailboxes_.begin() + (std::ptrdiff_t)index);
+  }
+}
+
+size_t ExchangeHub::islands() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mailboxes_.size();
+}
+
+void ExchangeHub::post(const SwmUID &island, const std::shared_ptr<TimetableInfoInterface> &tt) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t index = index_of(island);
+  if (index == mailboxes_.size()) {
+    throw std::runtime_error("ExchangeHub::post(): island \"" + island + "\" has not joined");
+  }
+  mailboxes_[index].tt = tt;
+}
+
+std::vector<std::shared_ptr<TimetableInfoInterface> > ExchangeHub::candidates(const SwmUID &island) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t index = index_of(island);
+  if (index == mailboxes_.size()) {
+    throw std::runtime_error("ExchangeHub::candidates(): island \"" + island + "\" has not joined");
+  }
+
+  const size_t count = mailboxes_.size();
+  std::vector<size_t> neighbours;
+  switch (topology_) {
+    case RING:
+      if (count > 1) {
+        neighbours.push_back((index + count - 1) % count);
+      }
+      break;
+    case STAR:
+      if (index != 0) {
+        neighbours.push_back(0);
+        break;
+      }
+      [[fallthrough]];                  // the center pulls from all islands
+    case ALL_TO_ALL:
+      for (size_t i = 0; i < count; ++i) {
+        if (i != index) {
+          neighbours.push_back(i);
+        }
+      }
+      break;
+  }
+
+  std::vector<std::shared_ptr<TimetableInfoInterface> > res;
+  for (size_t i : neighbours) {
+    if (mailboxes_[i].tt.get() != nullptr) {
+      res.push_back(mailboxes_[i].tt);
+    }
+  }
+  return res;
+}
+
+size_t ExchangeHub::index_of(const SwmUID &island) const {
+  auto it = std::find_if(mailboxes_.begin(), mailboxes_.end(),
+                         [&island](const Mailbox &mailbox) -> bool { return mailbox.island == island; });
+  return (size_t)(it - mailboxes_.begin());
+}
+
+} // util
+} // swm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "defs.h"
+#include "ifaces/timetable_info_interface.h"
+
+namespace swm {
+namespace util {
+
+// Mailboxes of islands (chains improving timetables for the same problem) for migration of
+// the best timetables. Island posts its timetable into own mailbox and pulls candidates from
+// mailboxes of its neighbours, which are defined by the topology. Nobody waits for anybody:
+// the mailbox keeps the latest timetable only
+class ExchangeHub {
+ public:
+  enum Topology {
+    RING        = 0,    // from the previous island, in order of joining
+    STAR        = 1,    // the first island from all others, others from the first one
+    ALL_TO_ALL  = 2     // from all other islands
+  };
+
+  explicit ExchangeHub(Topology topology = RING) : topology_(topology) { }
+  ExchangeHub(const ExchangeHub &) = delete;
+  void operator =(const ExchangeHub &) = delete;
+
+  static bool topology_from_string(const std::string &name, Topology *topology);
+  Topology topology() const { return topology_; }
+
+  // Returns false if island has already joined
+  bool join(const SwmUID &island);
+  void leave(const SwmUID &island);
+  size_t islands() const;
+
+  void post(const SwmUID &island, const std::shared_ptr<TimetableInfoInterface> &tt);
+  std::vector<std::shared_ptr<TimetableInfoInterface> > candidates(const SwmUID &island) const;
+
+ private:
+  struct Mailbox {
+    SwmUID island;
+    std::shared_ptr<TimetableInfoInterface> tt;
+  };
+
+  size_t index_of(const SwmUID &island) const;  // size of "mailboxes_" if not found
+
+  const Topology topology_;
+  std::vector<Mailbox> mailboxes_;      // in order of joining
+  mutable std::mutex mutex_;
+};
+
+} // util
+} // swm
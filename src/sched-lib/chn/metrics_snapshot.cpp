@@ -23,7 +23,7 @@ MetricsSnapshot::MetricsSnapshot(const MetricsInterface &service_metrics, const
       chain_metrics_(chain.metrics().object().clone()) {
 
   const auto &algs = chain.algorithms();
-  algorithm_metrics_.resize(algs.size());
+  algorithm_metrics_.reserve(algs.size());
   for (size_t i = 0; i < algs.size(); ++i) {
     algorithm_metrics_.emplace_back(AlgorithmMetricsSnapshot(*algs[i]));
   }
@@ -0,0 +1,68 @@
+#include "timetable_objective.h"
+
+#include <algorithm>
+
+namespace swm {
+
+bool TimetableObjective::from_string(const std::string &name, Type *type) {
+  if (name == "makespan") {
+    *type = MAKESPAN;
+  }
+  else if (name == "total_start_time") {
+    *type = TOTAL_START_TIME;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+double TimetableObjective::score(const SchedulingInfoInterface *info,
+                                 const TimetableInfoInterface *tt) const {
+  if (info == nullptr || tt == nullptr) {
+    throw std::runtime_error("TimetableObjective::score(): \"info\" and \"tt\" cannot be nullptr");
+  }
+
+  double res = 0.0;
+  switch (type_) {
+    case MAKESPAN: {
+      std::unordered_map<std::string, uint64_t> durations;
+      for (const auto job : info->jobs()) {
+        durations[job->get_id()] = job->get_duration();
+      }
+      for (const auto table : tt->tables()) {
+        auto it = durations.find(table->get_job_id());
+        const uint64_t end = table->get_start_time() + (it != durations.end() ? it->second : 0);
+        res = std::max(res, (double)end);
+      }
+      break;
+    }
+    case TOTAL_START_TIME: {
+      for (const auto table : tt->tables()) {
+        res += (double)table->get_start_time();
+      }
+      break;
+    }
+    default:
+      throw std::runtime_error("TimetableObjective::score(): unknown objective");
+  }
+  return res;
+}
+
+bool TimetableObjective::better(const SchedulingInfoInterface *info,
+                                const TimetableInfoInterface *tt,
+                                const TimetableInfoInterface *than) const {
+  if (than == nullptr) {
+    return tt != nullptr;
+  }
+  if (tt == nullptr) {
+    return false;
+  }
+
+  if (tt->tables().size() != than->tables().size()) {
+    return tt->tables().size() > than->tables().size();
+  }
+  return score(info, tt) < score(info, than);
+}
+
+} // swm
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "defs.h"
+#include "ifaces/scheduling_info_interface.h"
+#include "ifaces/timetable_info_interface.h"
+
+namespace swm {
+
+// Compares timetables constructed for the same scheduling info.
+// Timetable with more scheduled jobs is always better, the objective decides between equal ones
+class TimetableObjective {
+ public:
+  enum Type {
+    MAKESPAN          = 0,      // the latest completion time of scheduled jobs
+    TOTAL_START_TIME  = 1       // sum of start times, i.e. overall waiting of the queue
+  };
+
+  explicit TimetableObjective(Type type = MAKESPAN) : type_(type) { }
+
+  static bool from_string(const std::string &name, Type *type);
+  Type type() const { return type_; }
+
+  // Lower is better
+  double score(const SchedulingInfoInterface *info, const TimetableInfoInterface *tt) const;
+  bool better(const SchedulingInfoInterface *info,
+              const TimetableInfoInterface *tt,
+              const TimetableInfoInterface *than) const;
+
+ private:
+  Type type_;
+};
+
+} // swm
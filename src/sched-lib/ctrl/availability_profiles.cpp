@@ -0,0 +1,149 @@
+#include "availability_profiles.h"
+
+#include <algorithm>
+#include <set>
+
+namespace swm {
+namespace util {
+
+// Requests that don't need any resource of the node
+static bool is_dynamic_request(const std::string &name) {
+  return name == "node" || name == "container-image" || name == "cloud-image" ||
+         name == "ports" || name == "submission-address";
+}
+
+// Nodes of RH item are either its direct children or the children of its partitions
+static void collect_nodes(const RhItem &item, std::vector<std::string> *res) {
+  for (const auto &child : item.children()) {
+    if (child.name() == "node") {
+      res->push_back(child.id());
+    }
+    else {
+      collect_nodes(child, res);
+    }
+  }
+}
+
+void AvailabilityProfiles::update(const SchedulingInfoInterface &info, const TimetableInfoInterface &tt,
+                                  clock::time_point origin) {
+  std::unordered_map<std::string, const SwmJob *> jobs;
+  for (const auto job : info.jobs()) {
+    jobs[job->get_id()] = job;
+  }
+  std::unordered_map<std::string, uint64_t> busy_until;
+  for (const auto table : tt.tables()) {
+    auto job = jobs.find(table->get_job_id());
+    const uint64_t end = table->get_start_time() + (job != jobs.end() ? job->second->get_duration() : 0);
+    for (const auto &node : table->get_job_nodes()) {
+      uint64_t &until = busy_until[node];
+      until = std::max(until, end);
+    }
+  }
+  std::unordered_map<std::string, const SwmNode *> nodes;
+  for (const auto node : info.nodes()) {
+    nodes[node->get_id()] = node;
+  }
+
+  // RH starts from the level of grid or clusters
+  const std::vector<RhItem> *rh = &info.resource_hierarchy();
+  if (rh->size() == 1 && (*rh)[0].name() == "grid") {
+    rh = &(*rh)[0].children();
+  }
+  std::unordered_map<std::string, std::shared_ptr<const Profile> > updated;
+  for (const auto &cluster : *rh) {
+    std::vector<std::string> ids;
+    collect_nodes(cluster, &ids);
+
+    // The same nodes as FCFS takes: up and idle ones or templates
+    std::shared_ptr<Profile> profile(new Profile());
+    for (const auto &id : ids) {
+      auto node = nodes.find(id);
+      if (node == nodes.end()) {
+        continue;
+      }
+      const SwmNode *n = node->second;
+      if (n->get_is_template() != "true" && (n->get_state_power() != "up" || n->get_state_alloc() != "idle")) {
+        continue;
+      }
+      auto until = busy_until.find(id);
+      const uint64_t busy = until != busy_until.end() ? until->second : 0;
+      const auto free_from = origin + std::chrono::seconds(static_cast<std::chrono::seconds::rep>(busy));
+      profile->push_back(Node { id, free_from, n->get_resources() });
+    }
+    std::stable_sort(profile->begin(), profile->end(), [](const Node &a, const Node &b) -> bool {
+      return a.free_from < b.free_from;
+    });
+    updated[cluster.id()] = profile;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &rec : updated) {
+    profiles_[rec.first] = rec.second;
+  }
+}
+
+bool AvailabilityProfiles::estimate(const SwmJob &job, SwmTimetable *res, clock::time_point now) const {
+  if (res == nullptr) {
+    throw std::runtime_error("AvailabilityProfiles::estimate(): \"res\" cannot be nullptr");
+  }
+
+  std::shared_ptr<const Profile> profile;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = profiles_.find(job.get_cluster_id());
+    if (it == profiles_.end()) {
+      return false;
+    }
+    profile = it->second;
+  }
+
+  uint64_t count = 1;
+  for (const auto &req : job.get_request()) {
+    if (req.get_name() == "node") {
+      count = std::max<uint64_t>(req.get_count(), 1);
+    }
+  }
+
+  // Nodes that get free first are taken, the job starts when the last of them is free
+  const auto &preset = job.get_nodes();
+  const std::set<std::string> allowed(preset.begin(), preset.end());
+  std::vector<std::string> selected;
+  for (const auto &node : *profile) {
+    if ((!allowed.empty() && allowed.count(node.id) == 0) || !does_node_fit(job, node)) {
+      continue;
+    }
+    selected.push_back(node.id);
+    if (selected.size() == count) {
+      res->set_job_id(job.get_id());
+      res->set_start_time(node.free_from > now
+                          ? std::chrono::ceil<std::chrono::seconds>(node.free_from - now).count() : 0);
+      res->set_job_nodes(selected);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t AvailabilityProfiles::cluster_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return profiles_.size();
+}
+
+bool AvailabilityProfiles::does_node_fit(const SwmJob &job, const Node &node) {
+  for (const auto &req : job.get_request()) {
+    if (is_dynamic_request(req.get_name())) {
+      continue;
+    }
+    auto it = std::find_if(node.resources.begin(), node.resources.end(),
+                           [&req](const SwmResource &res) -> bool {
+      return res.get_name() == req.get_name() && res.get_count() >= req.get_count();
+    });
+    if (it == node.resources.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // util
+} // swm
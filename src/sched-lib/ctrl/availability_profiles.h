@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+#include "defs.h"
+#include "ifaces/scheduling_info_interface.h"
+#include "ifaces/timetable_info_interface.h"
+
+namespace swm {
+namespace util {
+
+// Availability of nodes per cluster as the last completed timetable left them: every node is
+// free since the end of the last job placed on it. Answers "when would this job start if it
+// was submitted now" without scheduling, candidates don't occupy nodes. Thread-safe.
+// Times of timetables are counted from the start of their scheduling, so nodes keep absolute
+// times and estimates are counted from the moment they are asked (in seconds, as timetables)
+//
+// Estimation is rougher than FCFS: resource properties, dependencies and gangs are ignored
+class AvailabilityProfiles {
+ public:
+  typedef std::chrono::steady_clock clock;
+
+  AvailabilityProfiles() { }
+  AvailabilityProfiles(const AvailabilityProfiles &) = delete;
+  void operator =(const AvailabilityProfiles &) = delete;
+
+  // Replaces the profiles of the clusters that "info" contains, "origin" is the start of the
+  // scheduling that has constructed "tt"
+  void update(const SchedulingInfoInterface &info, const TimetableInfoInterface &tt,
+              clock::time_point origin = clock::now());
+
+  // Start time (relative to "now") and nodes of the job, "false" if its cluster is unknown or
+  // has not enough nodes
+  bool estimate(const SwmJob &job, SwmTimetable *res, clock::time_point now = clock::now()) const;
+  size_t cluster_count() const;
+
+ private:
+  struct Node {
+    std::string id;
+    clock::time_point free_from;
+    std::vector<SwmResource> resources;
+  };
+  typedef std::vector<Node> Profile;  // sorted by "free_from"
+
+  static bool does_node_fit(const SwmJob &job, const Node &node);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const Profile> > profiles_;   // by cluster
+};
+
+} // util
+} // swm
@@ -11,15 +11,23 @@ namespace util {
 class CommandContext {
  public:
   CommandContext() = delete;
-  CommandContext(const SwmUID &id) : id_(id), timer_(new TimeCounter()) { }
+  CommandContext(const SwmUID &id, size_t schedules_before = 0, size_t origin = 0)
+      : id_(id), schedules_before_(schedules_before), origin_(origin), timer_(new TimeCounter()) { }
   CommandContext(const CommandContext &) = delete;
   void operator =(const CommandContext &) = delete;
 
   const SwmUID &id() const { return id_; }
+  // Schedule commands received before this one: a control command that comes by its own lane
+  // must not overtake the schedule of its chain
+  size_t schedules_before() const { return schedules_before_; }
+  // Connection the command came from, its response goes back there
+  size_t origin() const { return origin_; }
   const std::shared_ptr<TimeCounter> &timer() { return timer_; }  // can be separated from context
 
  private:
   SwmUID id_;
+  size_t schedules_before_;
+  size_t origin_;
   std::shared_ptr<TimeCounter> timer_;
 };
 
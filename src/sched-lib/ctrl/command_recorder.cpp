@@ -0,0 +1,189 @@
+#include "command_recorder.h"
+
+#include <algorithm>
+
+namespace swm {
+namespace util {
+
+static const char RECORDING_MAGIC[] = "SWMREC1\n";
+static const size_t RECORDING_MAGIC_SIZE = sizeof(RECORDING_MAGIC) - 1;
+
+static void put_number(std::ostream *out, uint64_t value, size_t bytes) {
+  for (size_t i = bytes; i > 0; --i) {
+    out->put((char)(value >> (8 * (i - 1))));
+  }
+}
+
+static bool get_number(std::istream *in, size_t bytes, uint64_t *value) {
+  *value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    const int ch = in->get();
+    if (ch == std::char_traits<char>::eof()) {
+      return false;
+    }
+    *value = (*value << 8) | (uint64_t)(unsigned char)ch;
+  }
+  return true;
+}
+
+static inline uint64_t to_microseconds(double seconds) {
+  return seconds > 0.0 ? (uint64_t)(seconds * 1e6) : 0;
+}
+
+bool CommandRecorder::open(const std::string &path, double slow_threshold, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (recording_ || writer_.joinable()) {
+    throw std::runtime_error("CommandRecorder::open(): recording was already started");
+  }
+  output_.open(path, std::ios::binary | std::ios::trunc);
+  if (!output_.good()) {
+    *errors << "cannot create recording \"" << path << "\"";
+    output_.close();
+    return false;
+  }
+  output_.write(RECORDING_MAGIC, RECORDING_MAGIC_SIZE);
+  output_.flush();
+  slow_threshold_ = slow_threshold;
+  started_ = Clock::now();
+  pending_.clear();
+  queue_.clear();
+  recording_ = true;
+  closing_ = false;
+  writer_ = std::thread([me = this]() -> void { me->writer_loop(); });
+  return true;
+}
+
+void CommandRecorder::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_) {
+      return;
+    }
+
+    // Requests that have never been answered are the slowest ones
+    const auto now = Clock::now();
+    for (auto &item : pending_) {
+      const std::chrono::duration<double> latency = now - item.second.arrival;
+      queue_.push_back(Queued { item.second.arrival, latency.count(), std::move(item.second.frame) });
+    }
+    pending_.clear();
+    recording_ = false;
+    closing_ = true;
+  }
+  queued_cv_.notify_one();
+  writer_.join();
+  output_.close();
+}
+
+void CommandRecorder::record(size_t origin, const SwmUID &uid, const char *frame, size_t size) {
+  const auto now = Clock::now();
+  std::string copy(frame, size);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!recording_) {
+    return;
+  }
+  if (slow_threshold_ <= 0.0) {
+    queue_.push_back(Queued { now, 0.0, std::move(copy) });
+    lock.unlock();
+    queued_cv_.notify_one();
+    return;
+  }
+  pending_[std::make_pair(origin, uid)] = Pending { now, std::move(copy) };
+}
+
+void CommandRecorder::complete(size_t origin, const SwmUID &uid) {
+  const auto now = Clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = pending_.find(std::make_pair(origin, uid));
+  if (it == pending_.end()) {
+    return;
+  }
+  const std::chrono::duration<double> latency = now - it->second.arrival;
+  const bool slow = latency.count() > slow_threshold_;
+  if (slow) {
+    queue_.push_back(Queued { it->second.arrival, latency.count(), std::move(it->second.frame) });
+  }
+  pending_.erase(it);
+  lock.unlock();
+  if (slow) {
+    queued_cv_.notify_one();
+  }
+}
+
+// Entries that came while the previous ones were written go to the file together, flushed once
+void CommandRecorder::writer_loop() {
+  std::deque<Queued> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_cv_.wait(lock, [this]() -> bool { return !queue_.empty() || closing_; });
+      if (queue_.empty()) {
+        return;
+      }
+      batch.swap(queue_);
+    }
+    for (const auto &item : batch) {
+      write(item.arrival, item.latency, item.frame);
+    }
+    output_.flush();
+    batch.clear();
+  }
+}
+
+void CommandRecorder::write(Clock::time_point arrival, double latency, const std::string &frame) {
+  const std::chrono::duration<double> since_start = arrival - started_;
+  put_number(&output_, to_microseconds(since_start.count()), 8);
+  put_number(&output_, to_microseconds(latency), 8);
+  put_number(&output_, frame.size(), 4);
+  output_.write(frame.data(), (std::streamsize)frame.size());
+}
+
+bool CommandRecorder::load(const std::string &path, std::vector<Entry> *entries, std::stringstream *errors) {
+  if (entries == nullptr) {
+    throw std::runtime_error("CommandRecorder::load(): \"entries\" cannot be nullptr");
+  }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  std::ifstream input(path, std::ios::binary);
+  std::string magic(RECORDING_MAGIC_SIZE, '\0');
+  if (!input.read(&magic[0], (std::streamsize)magic.size()) || magic != RECORDING_MAGIC) {
+    *errors << "\"" << path << "\" is not a recording of commands";
+    return false;
+  }
+
+  // Flight recorder writes entries as requests complete, replay goes in the order of arrival
+  std::vector<Entry> res;
+  uint64_t arrival = 0;
+  while (get_number(&input, 8, &arrival)) {
+    uint64_t latency = 0;
+    uint64_t size = 0;
+    Entry entry { (double)arrival / 1e6, 0.0, std::string() };
+    if (!get_number(&input, 8, &latency) || !get_number(&input, 4, &size)) {
+      *errors << "entry #" << res.size() << " of the recording is truncated";
+      return false;
+    }
+    entry.latency = (double)latency / 1e6;
+    entry.frame.resize((size_t)size);
+    if (size != 0 && !input.read(&entry.frame[0], (std::streamsize)size)) {
+      *errors << "frame of entry #" << res.size() << " of the recording is truncated";
+      return false;
+    }
+    res.push_back(std::move(entry));
+  }
+  std::stable_sort(res.begin(), res.end(), [](const Entry &a, const Entry &b) -> bool {
+    return a.arrival < b.arrival;
+  });
+  entries->swap(res);
+  return true;
+}
+
+} // util
+} // swm
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Writes command frames as they were received, so the stream can be replayed offline.
+// File starts with "SWMREC1\n", every entry is: arrival time and end-to-end latency (microseconds,
+// 8 bytes each), frame length (4 bytes) and the frame in the wire format; numbers are big-endian.
+// Full recording writes frames as soon as they come (latency is 0 then). Flight recorder keeps them
+// until their responses are sent and writes only the ones slower than the threshold, the requests
+// left without responses are written on close(). Entries are written and flushed by the recorder's
+// own thread, so the receiver and sender only copy frames. Thread-safe
+class CommandRecorder {
+ public:
+  struct Entry {
+    double arrival;                   // seconds since the recording has started
+    double latency;                   // seconds, 0 if unknown
+    std::string frame;
+  };
+
+  CommandRecorder() : slow_threshold_(0.0), recording_(false), closing_(false) { }
+  CommandRecorder(const CommandRecorder &) = delete;
+  ~CommandRecorder() { close(); }
+  void operator =(const CommandRecorder &) = delete;
+
+  // Positive "slow_threshold" (seconds) turns on the flight recorder
+  bool open(const std::string &path, double slow_threshold, std::stringstream *errors = nullptr);
+  void close();
+
+  // Commands are told apart by "origin" (see CommandContext) and request id
+  void record(size_t origin, const SwmUID &uid, const char *frame, size_t size);
+  void complete(size_t origin, const SwmUID &uid);
+
+  static bool load(const std::string &path, std::vector<Entry> *entries, std::stringstream *errors = nullptr);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  struct Pending {
+    Clock::time_point arrival;
+    std::string frame;
+  };
+  struct Queued {
+    Clock::time_point arrival;
+    double latency;
+    std::string frame;
+  };
+
+  void writer_loop();
+  void write(Clock::time_point arrival, double latency, const std::string &frame);
+
+  double slow_threshold_;
+  std::mutex mutex_;
+  std::condition_variable queued_cv_;
+  bool recording_;                    // guarded by mutex_
+  bool closing_;                      // writer writes the rest and exits, guarded by mutex_
+  std::deque<Queued> queue_;          // guarded by mutex_
+  std::map<std::pair<size_t, SwmUID>, Pending> pending_;    // guarded by mutex_
+  std::thread writer_;
+  std::ofstream output_;              // writer's thread only while recording
+  Clock::time_point started_;
+};
+
+} // util
+} // swm
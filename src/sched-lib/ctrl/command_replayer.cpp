@@ -0,0 +1,195 @@
+#include "command_replayer.h"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <string.h>
+
+#include "service.h"
+#include "shm_client.h"
+#include "auxl/term_compression.h"
+
+namespace swm {
+namespace util {
+
+typedef std::chrono::steady_clock Clock;
+
+void CommandReplayer::set_speed(double speed) {
+  if (speed < 0.0) {
+    throw std::runtime_error("CommandReplayer::set_speed(): \"speed\" cannot be negative");
+  }
+  speed_ = speed;
+}
+
+bool CommandReplayer::frame_uid(const std::string &frame, SwmUID *uid) {
+  if (frame.size() < 5) {
+    return false;
+  }
+  const unsigned char *len = (const unsigned char *)frame.data() + 1;
+  const size_t uid_len = ((size_t)len[0] << 24) | ((size_t)len[1] << 16) | ((size_t)len[2] << 8) | len[3];
+  if (frame.size() < 5 + uid_len) {
+    return false;
+  }
+  uid->assign(frame, 5, uid_len);
+  return true;
+}
+
+// Responses are scheduler results: {scheduler_result, Timetables, Metrics, RequestId, ...}
+bool CommandReplayer::response_uid(const char *data, size_t size, SwmUID *uid) {
+  std::unique_ptr<char[]> inflated;
+  if (is_compressed_term(data, size)) {
+    size_t inflated_size = 0;
+    if (!decompress_term(data, size, &inflated, &inflated_size)) {
+      return false;
+    }
+    data = inflated.get();
+  }
+
+  int index = 0;
+  int version = 0;
+  int arity = 0;
+  return ei_decode_version(data, &index, &version) == 0 &&
+         ei_decode_tuple_header(data, &index, &arity) == 0 && arity >= 4 &&
+         ei_skip_term(data, &index) == 0 &&
+         ei_skip_term(data, &index) == 0 &&
+         ei_skip_term(data, &index) == 0 &&
+         ei_buffer_to_str(data, index, *uid) == 0;
+}
+
+bool CommandReplayer::run(Service *service, const std::vector<CommandRecorder::Entry> &entries,
+                          std::vector<Result> *results, std::stringstream *errors) const {
+  if (service == nullptr || results == nullptr) {
+    throw std::runtime_error("CommandReplayer::run(): \"service\" and \"results\" cannot be nullptr");
+  }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  // Ring must hold the largest frame even if the previous one is still decoded
+  size_t capacity = 16 * 1024 * 1024;
+  std::vector<Result> res(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (!frame_uid(entries[i].frame, &res[i].uid)) {
+      *errors << "entry #" << i << " of the recording is not a command frame";
+      return false;
+    }
+    res[i].recorded_latency = entries[i].latency;
+    res[i].latency = -1.0;
+    capacity = std::max(capacity, 2 * entries[i].frame.size() + 64);
+  }
+
+  ShmClient client;
+  if (!client.create(capacity, errors)) {
+    return false;
+  }
+  service->set_rings(client.commands(), client.responses());
+
+  std::mutex mutex;
+  std::vector<Clock::time_point> sent(entries.size());
+  std::unordered_map<SwmUID, std::deque<size_t>> waiting;   // sent and not answered, by request id
+  std::atomic<bool> served(false);
+  bool service_result = true;
+  std::thread server([service, &served, &service_result]() -> void {
+    service_result = service->main_loop();
+    served = true;
+  });
+
+  // Responses are read until the service has stopped and the ring is drained
+  std::thread reader([&]() -> void {
+    auto on_response = [&](const char *data, size_t size) -> void {
+      const auto now = Clock::now();
+      SwmUID uid;
+      if (!response_uid(data, size, &uid)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = waiting.find(uid);
+      if (it != waiting.end() && !it->second.empty()) {
+        const size_t index = it->second.front();
+        it->second.pop_front();
+        const std::chrono::duration<double> latency = now - sent[index];
+        res[index].latency = latency.count();
+      }
+    };
+    while (true) {
+      const bool was_served = served;
+      if (!client.receive(on_response, 0.1) && was_served) {
+        break;
+      }
+    }
+  });
+
+  const auto start = Clock::now();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (speed_ > 0.0) {
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>(entries[i].arrival / speed_)));
+    }
+    const std::string &frame = entries[i].frame;
+    char *dst = nullptr;
+    while ((dst = client.commands()->reserve(frame.size(), 1.0)) == nullptr && !served) { }
+    if (dst == nullptr) {
+      *errors << "service has stopped before entry #" << i << " was sent";
+      break;
+    }
+    memcpy(dst, frame.data(), frame.size());
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sent[i] = Clock::now();
+      waiting[res[i].uid].push_back(i);
+    }
+    client.commands()->commit();
+  }
+  client.close();
+  server.join();
+  reader.join();
+  service->set_rings(nullptr, nullptr);
+
+  results->swap(res);
+  return service_result && errors->str().empty();
+}
+
+static double percentile(const std::vector<double> &sorted, double share) {
+  const size_t pos = (size_t)(share * (double)(sorted.size() - 1) + 0.5);
+  return sorted[std::min(pos, sorted.size() - 1)];
+}
+
+void CommandReplayer::print_report(const std::vector<Result> &results, std::ostream *out) {
+  if (out == nullptr) {
+    throw std::runtime_error("CommandReplayer::print_report(): \"out\" cannot be nullptr");
+  }
+
+  *out << std::left << std::setw(40) << "REQUEST" << std::right << std::setw(16) << "RECORDED, ms"
+       << std::setw(16) << "REPLAYED, ms" << std::endl;
+  std::vector<double> latencies;
+  for (const auto &result : results) {
+    *out << std::left << std::setw(40) << result.uid << std::right << std::fixed << std::setprecision(3);
+    if (result.recorded_latency > 0.0) {
+      *out << std::setw(16) << result.recorded_latency * 1e3;
+    }
+    else {
+      *out << std::setw(16) << "-";
+    }
+    if (result.latency >= 0.0) {
+      *out << std::setw(16) << result.latency * 1e3 << std::endl;
+      latencies.push_back(result.latency);
+    }
+    else {
+      *out << std::setw(16) << "no response" << std::endl;
+    }
+  }
+
+  *out << std::endl << "requests: " << results.size() << ", answered: " << latencies.size();
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    *out << std::fixed << std::setprecision(3)
+         << ", p50: " << percentile(latencies, 0.5) * 1e3 << " ms"
+         << ", p99: " << percentile(latencies, 0.99) * 1e3 << " ms"
+         << ", max: " << latencies.back() * 1e3 << " ms";
+  }
+  *out << std::endl;
+}
+
+} // util
+} // swm
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "defs.h"
+#include "command_recorder.h"
+
+namespace swm {
+
+class Service;
+
+namespace util {
+
+// Feeds a recording to the service through shared-memory rings (see ShmClient) at the original or
+// accelerated pacing, and measures the time from sending every command to receiving its response.
+// Responses are matched by request id: a repeated id (e.g. the client reuses ids of answered requests)
+// gets them in the order its commands were sent
+class CommandReplayer {
+ public:
+  struct Result {
+    SwmUID uid;
+    double recorded_latency;          // seconds, 0 if the recording doesn't know it
+    double latency;                   // seconds, negative if no response has come
+  };
+
+  CommandReplayer() : speed_(1.0) { }
+  CommandReplayer(const CommandReplayer &) = delete;
+  void operator =(const CommandReplayer &) = delete;
+
+  // 1 keeps the original pacing, 2 sends twice as fast, 0 sends without pauses
+  void   set_speed(double speed);
+  double get_speed() const { return speed_; }
+
+  // Takes the transport of the service, returns when the service has answered everything
+  bool run(Service *service, const std::vector<CommandRecorder::Entry> &entries,
+           std::vector<Result> *results, std::stringstream *errors = nullptr) const;
+
+  // Latency of every request and the summary, in milliseconds
+  static void print_report(const std::vector<Result> &results, std::ostream *out);
+
+  // Request id of the command frame or the response, false if it cannot be decoded
+  static bool frame_uid(const std::string &frame, SwmUID *uid);
+  static bool response_uid(const char *data, size_t size, SwmUID *uid);
+
+ private:
+  double speed_;
+};
+
+} // util
+} // swm
@@ -2,7 +2,10 @@
 #include "commands.h"
 
 #include "wm_io.h"
+#include "auxl/digest.h"
+#include "auxl/term_compression.h"
 
+#include <algorithm>
 #include <string.h>
 
 namespace swm {
@@ -53,28 +56,52 @@ bool ScheduleCommand::AlgorithmSpec
 //--- ScheduleCommand ---
 //-----------------------
 
-bool ScheduleCommand::init(const std::vector<std::unique_ptr<char[]>> &data, std::stringstream *errors) {
+bool ScheduleCommand::init(const std::vector<char *> &data,
+                           const std::vector<size_t> &sizes,
+                           std::stringstream *errors) {
   std::stringstream errors_;
   if (errors == nullptr) {
     errors = &errors_;
   }
 
-  if (data.size() != DataTypeCount) {
+  if (data.size() != DataTypeCount && data.size() != MandatoryDataTypeCount) {
     *errors << "not enough data slices (" << data.size() << " provided, "
-            << DataTypeCount << " expected)";
+            << MandatoryDataTypeCount << " or " << DataTypeCount << " expected)";
+    return false;
+  }
+  if (sizes.size() != data.size()) {
+    *errors << "sizes of data slices are not consistent with data";
     return false;
   }
 
   schedulers_.clear();
+  response_spec_ = ResponseSpec();
   sched_info_ptr_.reset(sched_info_ = new SchedulingInfo());
+  Digest digest;
 
   for (size_t i = 0; i < data.size(); ++i) {
-    char* buf = data[i].get();
+    char *buf = data[i];
     if (!buf) {
       *errors << "The " << i << "-th data slice is empty";
       return false;
     }
 
+    // Large slices can be sent as compressed terms, inflate them in place
+    std::unique_ptr<char[]> inflated;
+    size_t size = sizes[i];
+    if (is_compressed_term(buf, sizes[i])) {
+      if (!decompress_term(buf, sizes[i], &inflated, &size, errors)) {
+        *errors << " (the " << i << "-th data slice)";
+        return false;
+      }
+      buf = inflated.get();
+    }
+
+    // Schedulers and options are digested by their meaning, the way they are encoded doesn't matter
+    if (i != SWM_DATA_TYPE_SCHEDULERS && i != SWM_DATA_TYPE_OPTIONS) {
+      digest.update((uint64_t)i).update((uint64_t)size).update(buf, size);
+    }
+
     int index = 0;
     int version = 0;
     if (ei_decode_version(buf, &index, &version)) {
@@ -139,6 +166,13 @@ bool ScheduleCommand::init(const std::vector<std::unique_ptr<char[]>> &data, std
         }
         break;
       };
+      case SWM_DATA_TYPE_OPTIONS: {
+        if (!apply_options(buf, index, errors)) {
+          *errors << "Could not parse request options";
+          return false;
+        }
+        break;
+      };
       default: {
         *errors << "unknown data type: " << i;
         return false;
@@ -147,21 +181,143 @@ bool ScheduleCommand::init(const std::vector<std::unique_ptr<char[]>> &data, std
   }
 
   sched_info_->validate_references();
+  input_digest_ = digest.hex();
+  return true;
+}
+
+static bool decode_compute_unit(const std::string &name, ComputeUnitInterface::Type *cu) {
+  if (name == "cpu") {
+    *cu = ComputeUnitInterface::Cpu;
+  } else if (name == "gpu") {
+    *cu = ComputeUnitInterface::Gpu;
+  } else {
+    return false;
+  }
   return true;
 }
 
-bool ScheduleCommand::apply_schedulers(char *, int &, std::stringstream *) {
-  //TODO: read schedulers, something like that:
-  size_t nalgs = 1;
-  for (size_t i = 0; i < nalgs; ++i) {
-    std::string family  = "swm-fcfs";
-    bool has_version    = true;
-    std::string version = "1.0";
-    bool cu_specified   = true;
-    auto cu             = ComputeUnitInterface::Cpu;
+std::string ScheduleCommand::scope() const {
+  if (sched_info_ptr_.get() == nullptr) {
+    return std::string();
+  }
+
+  std::string res;
+  const SwmGrid *grid = sched_info_ptr_->grid();
+  if (grid != nullptr && !grid->get_id().empty()) {
+    res = "grid:" + grid->get_id();
+  }
+  else {
+    std::vector<std::string> ids;
+    for (const auto cluster : sched_info_ptr_->clusters()) {
+      ids.push_back(cluster->get_id());
+    }
+    if (ids.empty()) {
+      return std::string();
+    }
+    // Clients are free to send clusters in any order
+    std::sort(ids.begin(), ids.end());
+    res = "clusters:";
+    for (size_t i = 0; i < ids.size(); ++i) {
+      res += (i == 0 ? "" : ",") + ids[i];
+    }
+  }
+  return std::to_string(context_->origin()) + "/" + response_spec_.client() + "/" + res;
+}
+
+// Every scheduler is either a family name or a proplist:
+// ["swm-fcfs", [{family, "swm-fcfs"}, {version, "1.0"}, {cu, cpu}]]
+// Empty list (or empty binary) means the default one: FCFS on CPU
+bool ScheduleCommand::apply_schedulers(char *buf, int &index, std::stringstream *error) {
+  int term_size = 0;
+  int term_type = 0;
+  if (ei_get_type(buf, &index, &term_type, &term_size)) {
+    *error << "Could not get schedulers term type at position " << index << std::endl;
+    return false;
+  }
+  if ((term_type == ERL_BINARY_EXT && term_size == 0) || term_type == ERL_NIL_EXT) {
+    const std::string family  = "swm-fcfs";
+    const std::string version = "1.0";
+    const auto cu             = ComputeUnitInterface::Cpu;
+    schedulers_.emplace_back(AlgorithmSpec(family, &version, &cu));
+    return ei_skip_term(buf, &index) == 0;
+  }
+  if (term_type != ERL_LIST_EXT) {
+    *error << "Schedulers are not packed in a list at position " << index << std::endl;
+    return false;
+  }
+
+  int list_size = 0;
+  if (ei_decode_list_header(buf, &index, &list_size)) {
+    *error << "Could not decode ei list header at " << index << std::endl;
+    return false;
+  }
+  for (int i = 0; i < list_size; ++i) {
+    if (ei_get_type(buf, &index, &term_type, &term_size)) {
+      *error << "Could not get scheduler number " << i << " term type" << std::endl;
+      return false;
+    }
+
+    std::string family;
+    std::string version;
+    ComputeUnitInterface::Type cu = ComputeUnitInterface::Cpu;
+    bool has_version = false;
+    bool has_cu = false;
+    if (term_type == ERL_STRING_EXT) {
+      if (ei_buffer_to_str(buf, index, family)) {
+        *error << "Could not decode family of scheduler number " << i << std::endl;
+        return false;
+      }
+    } else if (term_type == ERL_LIST_EXT) {
+      int props = 0;
+      if (ei_decode_list_header(buf, &index, &props)) {
+        *error << "Could not decode properties of scheduler number " << i << std::endl;
+        return false;
+      }
+      for (int j = 0; j < props; ++j) {
+        int arity = 0;
+        char key[MAXATOMLEN];
+        if (ei_decode_tuple_header(buf, &index, &arity) || arity != 2 || ei_decode_atom(buf, &index, key)) {
+          *error << "Property number " << j << " of scheduler number " << i
+                 << " is not a {key, value} tuple" << std::endl;
+          return false;
+        }
+
+        const std::string name = key;
+        if (name == "family" || name == "version") {
+          if (ei_buffer_to_str(buf, index, name == "family" ? family : version)) {
+            *error << "Value of scheduler's property \"" << name << "\" is not a string" << std::endl;
+            return false;
+          }
+          has_version = has_version || name == "version";
+        } else if (name == "cu") {
+          char value[MAXATOMLEN];
+          if (ei_decode_atom(buf, &index, value) || !decode_compute_unit(value, &cu)) {
+            *error << "Unknown compute unit of scheduler number " << i << std::endl;
+            return false;
+          }
+          has_cu = true;
+        } else {
+          ei_skip_term(buf, &index);
+        }
+      }
+      if (props) {
+        ei_skip_term(buf, &index);  // last element of a list is empty list
+      }
+    } else {
+      *error << "Scheduler number " << i << " is neither a string nor a proplist" << std::endl;
+      return false;
+    }
+
+    if (family.empty()) {
+      *error << "Family of scheduler number " << i << " is not specified" << std::endl;
+      return false;
+    }
     schedulers_.emplace_back(AlgorithmSpec(family,
                                            has_version ? &version : nullptr,
-                                           cu_specified ? &cu : nullptr));
+                                           has_cu ? &cu : nullptr));
+  }
+  if (list_size) {
+    ei_skip_term(buf, &index);  // last element of a list is empty list
   }
   return true;
 }
@@ -390,14 +546,208 @@ bool ScheduleCommand::apply_nodes(char *buf, int &index, std::stringstream *erro
   return true;
 }
 
+// Options are packed as proplist: [{diff, true}, {resync, false}, {client, "c"}, {chain, "main"}, {ack, "id"}]
+bool ScheduleCommand::apply_options(char *buf, int &index, std::stringstream *error) {
+  int term_size = 0;
+  int term_type = 0;
+  if (ei_get_type(buf, &index, &term_type, &term_size)) {
+    *error << "Could not get options term type at position " << index << std::endl;
+    return false;
+  }
+  if (term_type != ERL_LIST_EXT && term_type != ERL_NIL_EXT) {
+    *error << "Options are not packed in a list at position " << index << std::endl;
+    return false;
+  }
+
+  int list_size = 0;
+  if (ei_decode_list_header(buf, &index, &list_size)) {
+    *error << "Could not decode ei list header at " << index << std::endl;
+    return false;
+  }
+
+  for (int i = 0; i < list_size; ++i) {
+    int arity = 0;
+    char key[MAXATOMLEN];
+    if (ei_decode_tuple_header(buf, &index, &arity) || arity != 2 || ei_decode_atom(buf, &index, key)) {
+      *error << "Option number " << i << " is not a {key, value} tuple" << std::endl;
+      return false;
+    }
+
+    const std::string name = key;
+    if (name == "diff" || name == "resync") {
+      char value[MAXATOMLEN];
+      if (ei_decode_atom(buf, &index, value)) {
+        *error << "Value of option \"" << name << "\" is not an atom" << std::endl;
+        return false;
+      }
+      const bool enabled = std::string(value) == "true";
+      if (name == "diff") {
+        response_spec_.set_diff_requested(enabled);
+      } else {
+        response_spec_.set_resync_requested(enabled);
+      }
+    } else if (name == "client" || name == "chain" || name == "ack" || name == "island") {
+      std::string value;
+      if (ei_buffer_to_str(buf, index, value)) {
+        *error << "Value of option \"" << name << "\" is not a string" << std::endl;
+        return false;
+      }
+      if (name == "client") {
+        response_spec_.set_client(value);
+      } else if (name == "chain") {
+        response_spec_.set_chain(value);
+      } else if (name == "island") {
+        chain_spec_.set_island(value);
+      } else {
+        response_spec_.set_acknowledged(value);
+      }
+    } else if (name == "portfolio" || name == "pipeline" || name == "objective" || name == "topology") {
+      char value[MAXATOMLEN];
+      if (ei_decode_atom(buf, &index, value)) {
+        *error << "Value of option \"" << name << "\" is not an atom" << std::endl;
+        return false;
+      }
+      if (name == "portfolio") {
+        chain_spec_.set_portfolio(std::string(value) == "true");
+      } else if (name == "pipeline") {
+        chain_spec_.set_pipeline(std::string(value) == "true");
+      } else if (name == "topology") {
+        ExchangeHub::Topology topology = ExchangeHub::RING;
+        if (!ExchangeHub::topology_from_string(value, &topology)) {
+          *error << "Unknown topology \"" << value << "\"" << std::endl;
+          return false;
+        }
+        chain_spec_.set_topology(topology);
+      } else {
+        TimetableObjective::Type objective = TimetableObjective::MAKESPAN;
+        if (!TimetableObjective::from_string(value, &objective)) {
+          *error << "Unknown objective \"" << value << "\"" << std::endl;
+          return false;
+        }
+        chain_spec_.set_objective(objective);
+      }
+    } else if (name == "budget") {
+      // Seconds, integer or float
+      double seconds = 0.0;
+      long integer = 0;
+      if (ei_decode_long(buf, &index, &integer) == 0) {
+        seconds = (double)integer;
+      } else if (ei_decode_double(buf, &index, &seconds)) {
+        *error << "Value of option \"budget\" is not a number" << std::endl;
+        return false;
+      }
+      if (seconds < 0.0) {
+        *error << "Value of option \"budget\" cannot be negative" << std::endl;
+        return false;
+      }
+      chain_spec_.set_budget(seconds);
+    } else {
+      // Unknown options are skipped to stay compatible with newer clients
+      ei_skip_term(buf, &index);
+    }
+  }
+  if (list_size) {
+    ei_skip_term(buf, &index);  // last element of a list is empty list
+  }
+  return true;
+}
+
+// Chain is addressed by the identifier of its schedule request, packed as a string
+static bool decode_chain_id(const std::vector<char *> &data,
+                            const std::vector<size_t> &sizes,
+                            size_t slice,
+                            SwmUID *chain,
+                            std::stringstream *errors) {
+  if (slice >= data.size() || slice >= sizes.size() || data[slice] == nullptr) {
+    *errors << "chain identifier is not provided (data slice " << slice << ")";
+    return false;
+  }
+
+  const char *buf = data[slice];
+  int index = 0;
+  int version = 0;
+  if (ei_decode_version(buf, &index, &version) || version != ERLANG_BINARY_FORMAT_VERSION) {
+    *errors << "wrong erlang binary format of data slice " << slice;
+    return false;
+  }
+  if (ei_buffer_to_str(buf, index, *chain) || chain->empty()) {
+    *errors << "chain identifier is not a string (data slice " << slice << ")";
+    return false;
+  }
+  return true;
+}
+
 //------------------------
 //--- InterruptCommand ---
 //------------------------
 
-bool InterruptCommand::init(const std::vector<std::unique_ptr<char[]> > &,
-                            std::stringstream *) {
-  //TODO: read chain id
-  chain_ = "42";
+bool InterruptCommand::init(const std::vector<char *> &data,
+                            const std::vector<size_t> &sizes,
+                            std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  return decode_chain_id(data, sizes, SWM_DATA_TYPE_CHAIN, &chain_, errors);
+}
+
+//-----------------------
+//--- EstimateCommand ---
+//-----------------------
+
+bool EstimateCommand::init(const std::vector<char *> &data,
+                           const std::vector<size_t> &sizes,
+                           std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  const size_t slice = SWM_DATA_TYPE_CANDIDATES;
+  if (slice >= data.size() || slice >= sizes.size() || data[slice] == nullptr) {
+    *errors << "candidate jobs are not provided (data slice " << slice << ")";
+    return false;
+  }
+  const char *buf = data[slice];
+  int index = 0;
+  int version = 0;
+  if (ei_decode_version(buf, &index, &version) || version != ERLANG_BINARY_FORMAT_VERSION) {
+    *errors << "wrong erlang binary format of data slice " << slice;
+    return false;
+  }
+  int list_size = 0;
+  if (ei_decode_list_header(buf, &index, &list_size) || list_size == 0) {
+    *errors << "candidate jobs must be a non-empty list";
+    return false;
+  }
+
+  // Job's decoder doesn't report errors, so every candidate must be a tuple it consumes whole
+  candidates_.clear();
+  candidates_.reserve(list_size);
+  for (int i = 0; i < list_size; ++i) {
+    int term_type = 0;
+    int term_size = 0;
+    int end = index;
+    if (ei_get_type(buf, &index, &term_type, &term_size) ||
+        (term_type != ERL_SMALL_TUPLE_EXT && term_type != ERL_LARGE_TUPLE_EXT) ||
+        ei_skip_term(buf, &end) || (size_t)end > sizes[slice]) {
+      *errors << "candidate job number " << i << " is not a tuple";
+      return false;
+    }
+    candidates_.emplace_back(buf, index);
+    if (index != end) {
+      *errors << "could not decode candidate job number " << i;
+      return false;
+    }
+  }
+
+  // Last element of a list is empty list
+  int term_type = 0;
+  int term_size = 0;
+  if (ei_get_type(buf, &index, &term_type, &term_size) || term_type != ERL_NIL_EXT) {
+    *errors << "candidate jobs are not a proper list";
+    return false;
+  }
   return true;
 }
 
@@ -405,23 +755,29 @@ bool InterruptCommand::init(const std::vector<std::unique_ptr<char[]> > &,
 //--- MetricsCommand ---
 //----------------------
 
-bool MetricsCommand::init(const std::vector<std::unique_ptr<char[]> > &,
-                          std::stringstream *) {
-  //TODO: read chain id
-  chain_ = "42";
-  return true;
+bool MetricsCommand::init(const std::vector<char *> &data,
+                          const std::vector<size_t> &sizes,
+                          std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  return decode_chain_id(data, sizes, SWM_DATA_TYPE_CHAIN, &chain_, errors);
 }
 
 //-----------------------
 //--- ExchangeCommand ---
 //-----------------------
 
-bool ExchangeCommand::init(const std::vector<std::unique_ptr<char[]> > &,
-                           std::stringstream *) {
-  //TODO: read chain identifiers
-  source_chain_ = "42";
-  target_chain_ = "42";
-  return true;
+bool ExchangeCommand::init(const std::vector<char *> &data,
+                           const std::vector<size_t> &sizes,
+                           std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  return decode_chain_id(data, sizes, SWM_DATA_TYPE_CHAIN, &source_chain_, errors) &&
+         decode_chain_id(data, sizes, SWM_DATA_TYPE_TARGET_CHAIN, &target_chain_, errors);
 }
 
 } // util
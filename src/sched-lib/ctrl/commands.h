@@ -8,6 +8,8 @@
 #include "scheduling_info.h"
 #include "command_context.h"
 #include "auxl/time_counter.h"
+#include "chn/exchange_hub.h"
+#include "chn/timetable_objective.h"
 #include "ifaces/compute_unit_interface.h"
 
 
@@ -27,7 +29,9 @@ class CommandInterface {
 
  protected:
   CommandInterface() {}
-  virtual bool init(const std::vector<std::unique_ptr<char[]> > &data,
+  // Slices belong to the receiver (own buffers or shared memory), they are valid during the call only
+  virtual bool init(const std::vector<char *> &data,
+                    const std::vector<size_t> &sizes,
                     std::stringstream *errors) = 0;
  friend class Receiver;
 };
@@ -39,7 +43,8 @@ class CorruptedCommand : public CommandInterface {
   virtual CommandType type() const { return SWM_COMMAND_CORRUPTED; }
 
  protected:
-   virtual bool init(const std::vector<std::unique_ptr<char[]> > &,
+   virtual bool init(const std::vector<char *> &,
+                     const std::vector<size_t> &,
                      std::stringstream *) {
      // Important: for compatibility purposes, always returns true
      return true;
@@ -68,21 +73,99 @@ class ScheduleCommand : public CommandInterface {
     bool has_cu_; ComputeUnitInterface::Type cu_;
   };
 
+  // How the resulting timetable must be delivered to the client
+  class ResponseSpec {
+   public:
+    ResponseSpec() : diff_(false), resync_(false) { }
+
+    // Only changes relative to result "acknowledged" are sent for (client, chain) stream
+    bool diff_requested() const { return diff_; }
+    void set_diff_requested(bool diff) { diff_ = diff; }
+    // Full timetable is sent even if diff was requested
+    bool resync_requested() const { return resync_; }
+    void set_resync_requested(bool resync) { resync_ = resync; }
+
+    const std::string &client() const { return client_; }
+    void set_client(const std::string &client) { client_ = client; }
+    const std::string &chain() const { return chain_; }
+    void set_chain(const std::string &chain) { chain_ = chain; }
+    const SwmUID &acknowledged() const { return acknowledged_; }
+    void set_acknowledged(const SwmUID &request_id) { acknowledged_ = request_id; }
+
+   private:
+    bool diff_;
+    bool resync_;
+    std::string client_;
+    std::string chain_;
+    SwmUID acknowledged_;
+  };
+
+  // How the algorithms are combined into chain
+  class ChainSpec {
+   public:
+    ChainSpec()
+        : portfolio_(false), pipeline_(false), objective_(TimetableObjective::MAKESPAN), budget_(0.0),
+          topology_(ExchangeHub::RING) { }
+
+    // All algorithms construct timetables concurrently, the best one by objective is taken
+    bool portfolio() const { return portfolio_; }
+    void set_portfolio(bool portfolio) { portfolio_ = portfolio; }
+    // Improvers start on intermediate timetables of the previous algorithms (if not portfolio)
+    bool pipeline() const { return pipeline_; }
+    void set_pipeline(bool pipeline) { pipeline_ = pipeline; }
+    TimetableObjective::Type objective() const { return objective_; }
+    void set_objective(TimetableObjective::Type objective) { objective_ = objective; }
+    // Seconds given to the algorithms, zero means they run until completion or interruption
+    double budget() const { return budget_; }
+    void set_budget(double budget) { budget_ = budget; }
+    // Chains of the same island group exchange their best timetables periodically
+    const std::string &island() const { return island_; }
+    void set_island(const std::string &group) { island_ = group; }
+    // Applied by the first chain of the group
+    ExchangeHub::Topology topology() const { return topology_; }
+    void set_topology(ExchangeHub::Topology topology) { topology_ = topology; }
+
+   private:
+    bool portfolio_;
+    bool pipeline_;
+    TimetableObjective::Type objective_;
+    double budget_;
+    std::string island_;
+    ExchangeHub::Topology topology_;
+  };
+
   // Version for unit tests only!
   ScheduleCommand(const std::shared_ptr<CommandContext> &context,
                   const std::vector<AlgorithmSpec> &schedulers,
-                  const std::shared_ptr<SchedulingInfoInterface> &sched_info)
-      : context_(context), schedulers_(schedulers), sched_info_ptr_(sched_info) {
+                  const std::shared_ptr<SchedulingInfoInterface> &sched_info,
+                  const ResponseSpec &response_spec = ResponseSpec(),
+                  const ChainSpec &chain_spec = ChainSpec(),
+                  const std::string &input_digest = std::string())
+      : context_(context), schedulers_(schedulers), response_spec_(response_spec),
+        chain_spec_(chain_spec), sched_info_ptr_(sched_info), input_digest_(input_digest) {
     sched_info_ = static_cast<SchedulingInfo *>(sched_info_ptr_.get());
   }
   ScheduleCommand(const std::shared_ptr<CommandContext> &context) : context_(context) { }
   const std::vector<AlgorithmSpec> &schedulers() const { return schedulers_; }
+  const ResponseSpec &response_spec() const { return response_spec_; }
+  const ChainSpec &chain_spec() const { return chain_spec_; }
   const std::shared_ptr<SchedulingInfoInterface> &scheduling_info() const { return sched_info_ptr_; }
   virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
   virtual CommandType type() const override { return SWM_COMMAND_SCHEDULE; };
 
+  // Part of the world the request schedules: the connection and the client it has named,
+  // and either its grid or its clusters.
+  // Newer request of the same scope makes older ones obsolete. Empty if the request has no grid
+  // and no clusters, such requests never replace each other
+  std::string scope() const;
+
+  // Digest of the raw jobs, resources, grid, clusters, partitions and nodes, the same for
+  // identical input. Empty if unknown, such requests are never served from cache
+  const std::string &input_digest() const { return input_digest_; }
+
  protected:
-  bool init(const std::vector<std::unique_ptr<char[]> > &data,
+  bool init(const std::vector<char *> &data,
+            const std::vector<size_t> &sizes,
             std::stringstream *errors = nullptr) override;
 
  private:
@@ -93,11 +176,15 @@ class ScheduleCommand : public CommandInterface {
   bool apply_clusters(char *buf, int &index, std::stringstream *error = nullptr);
   bool apply_partitions(char *buf, int &index, std::stringstream *error = nullptr);
   bool apply_nodes(char *buf, int &index, std::stringstream *error = nullptr);
+  bool apply_options(char *buf, int &index, std::stringstream *error = nullptr);
 
   std::shared_ptr<CommandContext> context_;
   std::vector<AlgorithmSpec> schedulers_;
+  ResponseSpec response_spec_;
+  ChainSpec chain_spec_;
   std::shared_ptr<SchedulingInfoInterface> sched_info_ptr_;
   SchedulingInfo *sched_info_;
+  std::string input_digest_;
 };
 
 
@@ -113,7 +200,8 @@ class InterruptCommand : public CommandInterface {
   virtual CommandType type() const override { return SWM_COMMAND_INTERRUPT; };
 
  protected:
-  bool init(const std::vector<std::unique_ptr<char[]> > &data,
+  bool init(const std::vector<char *> &data,
+            const std::vector<size_t> &sizes,
             std::stringstream *errors = nullptr) override;
 
  private:
@@ -122,6 +210,28 @@ class InterruptCommand : public CommandInterface {
 };
 
 
+// Hypothetical start times of jobs, answered from availability profiles without scheduling
+class EstimateCommand : public CommandInterface {
+ public:
+  // For unit tests only!
+  EstimateCommand(const std::shared_ptr<CommandContext> &context, const std::vector<SwmJob> &candidates)
+      : context_(context), candidates_(candidates) { }
+  EstimateCommand(const std::shared_ptr<CommandContext> &context) : context_(context) { }
+  const std::vector<SwmJob> &candidates() const { return candidates_; }
+  virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
+  virtual CommandType type() const override { return SWM_COMMAND_ESTIMATE; };
+
+ protected:
+  bool init(const std::vector<char *> &data,
+            const std::vector<size_t> &sizes,
+            std::stringstream *errors = nullptr) override;
+
+ private:
+  std::shared_ptr<CommandContext> context_;
+  std::vector<SwmJob> candidates_;
+};
+
+
 class MetricsCommand : public CommandInterface {
  public:
   // For unit tests only!
@@ -134,8 +244,9 @@ class MetricsCommand : public CommandInterface {
   virtual CommandType type() const override { return SWM_COMMAND_METRICS; }
 
  protected:
-  bool init(const std::vector<std::unique_ptr<char[]> > &,
-            std::stringstream *) override;
+  bool init(const std::vector<char *> &data,
+            const std::vector<size_t> &sizes,
+            std::stringstream *errors = nullptr) override;
 
  private:
   std::shared_ptr<CommandContext> context_;
@@ -157,8 +268,9 @@ class ExchangeCommand : public CommandInterface {
   virtual CommandType type() const override { return SWM_COMMAND_EXCHANGE; };
 
  protected:
-  bool init(const std::vector<std::unique_ptr<char[]> > &data,
-            std::stringstream *errors) override;
+  bool init(const std::vector<char *> &data,
+            const std::vector<size_t> &sizes,
+            std::stringstream *errors = nullptr) override;
 
  private:
   std::shared_ptr<CommandContext> context_;
@@ -16,9 +16,10 @@ enum CommandType {
   SWM_COMMAND_INTERRUPT    = 1,
   SWM_COMMAND_METRICS      = 2,
   SWM_COMMAND_EXCHANGE     = 3,
-  SWM_COMMAND_CORRUPTED    = 4      // internal value, cannot be received from SWM
+  SWM_COMMAND_ESTIMATE     = 4,
+  SWM_COMMAND_CORRUPTED    = 5      // internal value, cannot be received from SWM
 };
-const size_t CommandTypeCount = 4;
+const size_t CommandTypeCount = 5;
 
 /*enum {
   SWM_PREEMTION_DISABLED   = 0,
@@ -33,12 +34,35 @@ enum DataType {
   SWM_DATA_TYPE_CLUSTERS   = 4,
   SWM_DATA_TYPE_PARTITIONS = 5,
   SWM_DATA_TYPE_NODES      = 6,
+  SWM_DATA_TYPE_OPTIONS    = 7,     // optional, can be omitted by clients
+};
+const size_t DataTypeCount = 8;
+const size_t MandatoryDataTypeCount = 7;
+
+// Data slices of the commands that address chains by identifiers of their schedule requests
+enum ChainDataType {
+  SWM_DATA_TYPE_CHAIN        = 0,     // interrupted or inspected chain, source of exchange
+  SWM_DATA_TYPE_TARGET_CHAIN = 1,     // target of exchange
+};
+
+// Data slices of the estimation command
+enum EstimateDataType {
+  SWM_DATA_TYPE_CANDIDATES   = 0,     // jobs that are not submitted yet
+};
+
+// Status of scheduler_result sent back to SWM
+enum ResultStatus {
+  SWM_RESULT_FAILED          = 0,
+  SWM_RESULT_SUCCEEDED       = 1,
+  SWM_RESULT_SUPERSEDED      = 2,     // dropped in favour of a newer request for the same scope
+  SWM_RESULT_PARTIAL         = 3,     // interrupted, the best timetable so far (may lack jobs)
+  SWM_RESULT_TOO_LARGE       = 4,     // result doesn't fit into a frame of the shared memory ring
 };
-const size_t DataTypeCount = 7;
 
 // TODO: autogenerate from schema.json:
 const size_t SwmTimeTableTupleSize = 4;
 const size_t SwmSchedulerResultTupleSize = 8;
+const size_t SwmSchedulerResultDiffTupleSize = 11;
 const size_t SwmMetricTupleSize = 4;
 
 } // util
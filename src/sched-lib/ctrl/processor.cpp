@@ -2,34 +2,35 @@
 #include "processor.h"
 
 #include <algorithm>
-#include <thread> // for sleep
 
 #include "hw/scanner.h"
 #include "alg/algorithm_factory.h"
+#include "auxl/affinity.h"
+#include "auxl/digest.h"
 
 namespace swm {
 namespace util {
 
 Processor::Processor()
-    : timeout_(0.0), closed_(false),
+    : timeout_(0.0), inline_threshold_(0), migration_interval_(0.1), placement_(NUMA_NODES),
+      coalescing_(false), memoization_capacity_(0), memoization_ttl_(60.0), metrics_replies_(false),
+      tracer_(nullptr), closed_(false), migration_due_(false), migration_scheduled_(false),
       factory_(nullptr), scanner_(nullptr),
-      in_queue_(nullptr), out_queue_(nullptr) {
+      in_queue_(nullptr), control_queue_(nullptr), out_queue_(nullptr) {
 }
 
 Processor::~Processor() {
-  closed_ = true;
-  if (worker_.joinable()) {
-    worker_.join();
-  }
+  stop_worker();
 
   // Chain's threads were stopped by worker, no need to clear collections
 }
 
 void Processor::init(const AlgorithmFactory *factory, 
                      const Scanner *scanner,
-                     MyQueue<std::shared_ptr<CommandInterface> > *in_queue,
-                     MyQueue<std::shared_ptr<ResponseInterface> > *out_queue,
-                     double timeout) {
+                     BlockingQueue<std::shared_ptr<CommandInterface> > *in_queue,
+                     BlockingQueue<std::shared_ptr<ResponseInterface> > *out_queue,
+                     double timeout,
+                     BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue) {
   // Fatal errors
   if (in_queue_ != nullptr || out_queue_ != nullptr) {
     throw std::runtime_error("Processor::init(): object was already initialized");
@@ -52,13 +53,69 @@ void Processor::init(const AlgorithmFactory *factory,
               << "timeout value is too small, requests will be refused" << std::endl;
   }
 
+  // Pools are sized by CPUs the process can use (cgroup quota and cpuset are taken into account).
+  // Requests to controllers are short, so their thread isn't counted, but inline chains take
+  // one more thread out of the limit. It's a pool of its own: controllers' commands, deadlines
+  // and estimates never wait for a chain. At least two chains must be able to work simultaneously
+  // to exchange timetables
+  const size_t cpus = scanner->cpu()->cores();
+  const size_t inline_threads = inline_threshold_ != 0 ? 1 : 0;
+  const size_t chains_threads = std::max<size_t>(cpus > inline_threads ? cpus - inline_threads : 0, 2);
+  timers_.reset(new TimerWheel());
+  chains_executors_.clear();
+  chains_units_.clear();
+  next_chains_executor_ = 0;
+  if (placement_ == FLOATING || scanner->numa_nodes().empty()) {
+    chains_executors_.emplace_back(new Executor(chains_threads));
+    chains_units_.push_back(scanner->cpu());
+  }
+  else {
+    // Threads don't leave the node, so the data touched by chains stay in its memory and caches.
+    // Nodes' shares of the limit are rounded up, so the last nodes get what is left (one at least)
+    const auto &nodes = scanner->numa_nodes();
+    size_t left = std::max(chains_threads, nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const auto node = nodes[i];
+      const size_t threads = std::max<size_t>(std::min(node->cores(), left - (nodes.size() - i - 1)),
+                                              nodes.size() == 1 ? 2 : 1);
+      left -= threads;
+      std::vector<std::vector<size_t> > affinity;
+      if (placement_ == PINNED_CPUS) {
+        for (const size_t cpu : node->cpus()) {
+          affinity.push_back(std::vector<size_t>(1, cpu));
+        }
+      }
+      else {
+        affinity.push_back(node->cpus());
+      }
+      chains_executors_.emplace_back(new Executor(threads, affinity));
+      chains_units_.push_back(node);
+    }
+  }
+  requests_executor_.reset(new Executor(1));
+  inline_executor_.reset(inline_threads != 0 ? new Executor(inline_threads) : nullptr);
+
   metrics_.reset(new ServiceMetrics());
+  update_pool_metrics();
+  history_.reset(new TimetableHistory());
+  profiles_.reset(new AvailabilityProfiles());
+  if (memoization_capacity_ != 0) {
+    cache_.reset(new TimetableCache(memoization_capacity_, memoization_ttl_));
+  }
   factory_ = factory;
   scanner_ = scanner;
   in_queue_ = in_queue;
+  control_queue_ = control_queue;
   out_queue_ = out_queue;
+  schedules_taken_.clear();
+  deferred_.clear();
   timeout_ = timeout;
   closed_ = false;
+  finished_chains_.clear();
+  migration_due_ = false;
+  migration_scheduled_ = false;
+  hubs_.clear();
+  islands_.clear();
 
   worker_ = std::thread([obj = this]() -> void { obj->worker_thread(); });
 }
@@ -68,19 +125,24 @@ void Processor::close() {
     throw std::runtime_error("Processor::close(): object must be initialized first");
   }
 
-  closed_ = true;
-  if (worker_.joinable()) {
-    worker_.join();
-  }
+  stop_worker();
 
+  // Pools wait for the abandoned plugins anyway
+  abandoned_.clear();
+  chains_executors_.clear();
+  chains_units_.clear();
+  inline_executor_.reset();
+  requests_executor_.reset();
+  timers_.reset();
   factory_ = nullptr;
   scanner_ = nullptr;
   in_queue_ = nullptr;
+  control_queue_ = nullptr;
   out_queue_ = nullptr;
 }
 
 bool Processor::create_algorithms(const AlgorithmFactory *factory,
-                                  const Scanner *scanner,
+                                  const ComputeUnit *cu,
                                   const std::vector<ScheduleCommand::AlgorithmSpec> &specs,
                                   std::vector<std::shared_ptr<Algorithm> > *res,
                                   std::stringstream *errors) {
@@ -147,13 +209,13 @@ bool Processor::create_algorithms(const AlgorithmFactory *factory,
     selected[i] = *it;
   }
 
-  // Now, we can create algorithm instances and bind them to CPU
+  // Now, we can create algorithm instances and bind them to the compute unit
   res->clear();
   res->resize(selected.size());
   for (size_t i = 0; i < selected.size(); i++) {
     std::shared_ptr<Algorithm> alg;
     if (!factory->create(selected[i], &alg, errors) ||
-        !alg->bind_to(scanner->cpu(), errors)) {
+        !alg->bind_to(cu, errors)) {
       res->clear();
       return false;
     }
@@ -162,7 +224,34 @@ bool Processor::create_algorithms(const AlgorithmFactory *factory,
   return true;
 }
 
-void Processor::respond_chain_not_found(MyQueue<std::shared_ptr<ResponseInterface> > *queue,
+std::shared_ptr<ResponseInterface> Processor::create_timetable_response(
+                                      TimetableHistory *history,
+                                      const ScheduleCommand::ResponseSpec &spec,
+                                      const std::shared_ptr<CommandContext> &context,
+                                      const std::shared_ptr<TimetableInfoInterface> &tt,
+                                      const std::shared_ptr<MetricsSnapshot> &metrics,
+                                      bool partial) {
+  if (!spec.diff_requested()) {
+    return std::shared_ptr<ResponseInterface>(new TimetableResponse(context, tt, metrics, partial));
+  }
+
+  std::shared_ptr<TimetableHistory::Snapshot> current(new TimetableHistory::Snapshot());
+  for (const auto table : tt->tables()) {
+    current->insert(std::make_pair(table->get_job_id(), *table));
+  }
+
+  // Client that is not in sync with us receives the whole timetable
+  // Clients of different connections may have the same name, they don't share histories
+  const std::string client = std::to_string(context->origin()) + "/" + spec.client();
+  auto base = history->push(client, spec.chain(), spec.acknowledged(), context->id(), current);
+  if (base.get() == nullptr || spec.resync_requested()) {
+    return std::shared_ptr<ResponseInterface>(new TimetableResponse(context, tt, metrics, partial));
+  }
+  return std::shared_ptr<ResponseInterface>(
+    new TimetableDiffResponse(context, spec.acknowledged(), *base, *current, metrics, partial));
+}
+
+void Processor::respond_chain_not_found(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
                                         const std::shared_ptr<CommandContext> &context,
                                         const SwmUID &chain_id) {
   std::cerr << "Processor::worker_thread(): failed to perform request "
@@ -172,7 +261,7 @@ void Processor::respond_chain_not_found(MyQueue<std::shared_ptr<ResponseInterfac
   queue->push(std::shared_ptr<ResponseInterface>(new util::EmptyResponse(context, false)));
 }
 
-void Processor::respond_chain_already_exists(MyQueue<std::shared_ptr<ResponseInterface> > *queue,
+void Processor::respond_chain_already_exists(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
                                              const std::shared_ptr<CommandContext> &context,
                                              const SwmUID &chain_id) {
   std::cerr << "Processor::worker_thread(): failed to perform request "
@@ -182,168 +271,655 @@ void Processor::respond_chain_already_exists(MyQueue<std::shared_ptr<ResponseInt
   queue->push(std::shared_ptr<ResponseInterface>(new util::EmptyResponse(context, false)));
 }
 
+std::string Processor::memoization_key(const ScheduleCommand *req) {
+  // Results of islands and of chains given a budget depend on timing, they are never reused
+  const auto &spec = req->chain_spec();
+  if (req->input_digest().empty() || !spec.island().empty() || spec.budget() > 0.0) {
+    return std::string();
+  }
+
+  Digest digest;
+  digest.update(req->input_digest());
+  digest.update((uint64_t)req->schedulers().size());
+  for (const auto &alg : req->schedulers()) {
+    std::string version;
+    ComputeUnitInterface::Type cu = ComputeUnitInterface::Cpu;
+    const bool has_version = alg.version_specified(&version);
+    const bool has_cu = alg.compute_unit_specified(&cu);
+    digest.update(alg.family()).update((uint64_t)has_version).update(version);
+    digest.update((uint64_t)has_cu).update((uint64_t)cu);
+  }
+  digest.update((uint64_t)spec.portfolio()).update((uint64_t)spec.pipeline());
+  digest.update((uint64_t)spec.objective());
+  return digest.hex();
+}
+
+std::string Processor::island_key(const ScheduleCommand *req) {
+  // Timetables are exchanged only by chains of the same input: the group's name is chosen by
+  // the client, so the input (or, if it wasn't digested, the sets of jobs and nodes) is a part of the key
+  Digest digest;
+  digest.update(req->chain_spec().island());
+  if (!req->input_digest().empty()) {
+    digest.update(req->input_digest());
+    return digest.hex();
+  }
+
+  const auto &info = *req->scheduling_info();
+  std::vector<std::string> ids;
+  for (const auto job : info.jobs()) {
+    ids.push_back(job->get_id());
+  }
+  std::sort(ids.begin(), ids.end());
+  digest.update(static_cast<uint64_t>(ids.size()));
+  for (const auto &id : ids) {
+    digest.update(id);
+  }
+  ids.clear();
+  for (const auto node : info.nodes()) {
+    ids.push_back(node->get_id());
+  }
+  std::sort(ids.begin(), ids.end());
+  digest.update(static_cast<uint64_t>(ids.size()));
+  for (const auto &id : ids) {
+    digest.update(id);
+  }
+  return digest.hex();
+}
+
+void Processor::set_memoization(size_t capacity, double ttl) {
+  if (ttl <= 0.0) {
+    throw std::runtime_error("Processor::set_memoization(): \"ttl\" must be positive");
+  }
+  memoization_capacity_ = capacity;
+  memoization_ttl_ = ttl;
+}
+
+void Processor::respond_superseded(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
+                                   const std::shared_ptr<CommandContext> &context,
+                                   const SwmUID &superseded_by) {
+  queue->push(std::shared_ptr<ResponseInterface>(new SupersededResponse(context, superseded_by)));
+}
+
+bool Processor::pop_request(bool wait, std::shared_ptr<CommandInterface> *req) {
+  // Deferred commands go first: schedules of their chains could have been taken since then
+  for (auto it = deferred_.begin(); it != deferred_.end(); ++it) {
+    if ((*it)->context()->schedules_before() <= schedules_taken_[(*it)->context()->origin()]) {
+      *req = *it;
+      deferred_.erase(it);
+      return true;
+    }
+  }
+
+  // Control commands overtake schedules, but not the ones they are addressed to
+  while (control_queue_ != nullptr && control_queue_->try_pop(req)) {
+    const auto &ctx = (*req)->context();
+    if (ctx->schedules_before() <= schedules_taken_[ctx->origin()] || targets_exist(req->get())) {
+      return true;
+    }
+    deferred_.push_back(*req);
+  }
+
+  // Worker sleeps on "in_queue" only, producer of control commands wakes it up.
+  // Coalescing takes all the queued requests at once, so the newer ones supersede the older ones
+  // before the latter are started. Backlog is limited by the queue's size to keep the backpressure
+  if (coalescing_) {
+    std::shared_ptr<CommandInterface> next;
+    while (backlog_.size() < in_queue_->size() && in_queue_->try_pop(&next)) {
+      admit_request(next);
+    }
+    if (backlog_.empty() && wait && in_queue_->pop(&next)) {
+      admit_request(next);
+    }
+    if (!backlog_.empty()) {
+      *req = backlog_.front();
+      backlog_.pop_front();
+      ++schedules_taken_[(*req)->context()->origin()];
+      return true;
+    }
+  }
+  else if (wait ? in_queue_->pop(req) : in_queue_->try_pop(req)) {
+    ++schedules_taken_[(*req)->context()->origin()];
+    return true;
+  }
+
+  // Nothing else is coming, chains of deferred commands will never appear
+  if (!wait && !deferred_.empty()) {
+    *req = deferred_.front();
+    deferred_.erase(deferred_.begin());
+    return true;
+  }
+  return false;
+}
+
+void Processor::admit_request(const std::shared_ptr<CommandInterface> &req) {
+  backlog_.push_back(req);
+  if (req->type() != SWM_COMMAND_SCHEDULE) {
+    return;
+  }
+  const std::string scope = static_cast<const ScheduleCommand *>(req.get())->scope();
+  if (scope.empty()) {
+    return;
+  }
+  const SwmUID &id = req->context()->id();
+
+  // Queued requests of the scope are answered without scheduling, they count as taken
+  for (auto it = backlog_.begin(); it + 1 != backlog_.end(); ) {
+    if ((*it)->type() == SWM_COMMAND_SCHEDULE &&
+        static_cast<const ScheduleCommand *>(it->get())->scope() == scope) {
+      respond_superseded(out_queue_, (*it)->context(), id);
+      metrics_->update_superseded_requests(1);
+      ++schedules_taken_[(*it)->context()->origin()];
+      it = backlog_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  // Running chain works on the obsolete input, its callback responds instead of the timetable
+  auto running = scopes_.find(scope);
+  if (running != scopes_.end()) {
+    auto chain = chains_.find(running->second.chain);
+    if (chain != chains_.end() && !chain->second->finished()) {
+      const auto &supersession = running->second.supersession;
+      supersession->by = id;
+      supersession->superseded = true;
+      metrics_->update_superseded_requests(1);
+      chain->second->invoke_interrupt([](bool,
+                                         const std::shared_ptr<TimetableInfoInterface> &,
+                                         const std::shared_ptr<MetricsSnapshot> &) -> void {});
+    }
+    scopes_.erase(running);
+  }
+}
+
+SwmUID Processor::chain_key(size_t origin, const SwmUID &id) {
+  return std::to_string(origin) + ":" + id;
+}
+
+bool Processor::targets_exist(const CommandInterface *req) const {
+  const size_t origin = req->context()->origin();
+  switch (req->type()) {
+    case SWM_COMMAND_INTERRUPT:
+      return chains_.count(chain_key(origin, static_cast<const InterruptCommand *>(req)->chain())) != 0;
+    case SWM_COMMAND_METRICS:
+      return chains_.count(chain_key(origin, static_cast<const MetricsCommand *>(req)->chain())) != 0;
+    case SWM_COMMAND_EXCHANGE: {
+      auto ereq = static_cast<const ExchangeCommand *>(req);
+      return chains_.count(chain_key(origin, ereq->source_chain())) != 0 &&
+             chains_.count(chain_key(origin, ereq->target_chain())) != 0;
+    }
+    default:
+      return true;
+  }
+}
+
+void Processor::on_chain_finished(const SwmUID &chain_id) {
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    finished_chains_.push_back(chain_id);
+    finished_cv_.notify_one();
+  }
+  in_queue_->wake_consumer();
+}
+
+size_t Processor::select_chains_executor() {
+  // The least loaded pool relative to its size, ties are broken round-robin
+  const size_t count = chains_executors_.size();
+  size_t best = next_chains_executor_ % count;
+  for (size_t i = 1; i < count; ++i) {
+    const size_t cand = (next_chains_executor_ + i) % count;
+    const Executor *a = chains_executors_[cand].get();
+    const Executor *b = chains_executors_[best].get();
+    if ((a->busy_threads() + a->queued_tasks()) * b->threads() <
+        (b->busy_threads() + b->queued_tasks()) * a->threads()) {
+      best = cand;
+    }
+  }
+  next_chains_executor_ = best + 1;
+  return best;
+}
+
+void Processor::update_pool_metrics() {
+  size_t threads = 0;
+  size_t busy = 0;
+  size_t queued = 0;
+  for (const auto &executor : chains_executors_) {
+    threads += executor->threads();
+    busy += executor->busy_threads();
+    queued += executor->queued_tasks();
+  }
+  if (inline_executor_.get() != nullptr) {
+    threads += inline_executor_->threads();
+    busy += inline_executor_->busy_threads();
+    queued += inline_executor_->queued_tasks();
+  }
+  metrics_->update_pool(threads, busy, queued);
+}
+
+void Processor::set_migration_interval(double seconds) {
+  if (seconds <= 0.0) {
+    throw std::runtime_error("Processor::set_migration_interval(): \"seconds\" must be positive");
+  }
+  migration_interval_ = seconds;
+}
+
+void Processor::on_migration_due() {
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    migration_due_ = true;
+  }
+  if (!closed_) {
+    in_queue_->wake_consumer();
+  }
+}
+
+void Processor::schedule_migration() {
+  if (migration_scheduled_ || islands_.empty()) {
+    return;
+  }
+  migration_scheduled_ = true;
+  timers_->schedule(migration_interval_, [obj = this]() -> void { obj->on_migration_due(); });
+}
+
+void Processor::migrate_islands() {
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    if (!migration_due_) {
+      return;
+    }
+    migration_due_ = false;
+  }
+  migration_scheduled_ = false;
+
+  // Controllers perform migrations asynchronously, islands never wait for each other
+  for (const auto &island : islands_) {
+    auto it = chains_.find(island.first);
+    if (it == chains_.end()) {
+      continue;
+    }
+    it->second->invoke_migration(hubs_[island.second], island.first,
+                                 [metrics = metrics_](bool migrated) -> void {
+      if (migrated) {
+        metrics->update_migrations(1);
+      }
+    });
+  }
+  schedule_migration();
+}
+
+void Processor::release_finished_chains() {
+  std::vector<SwmUID> finished;
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    finished.swap(finished_chains_);
+  }
+
+  // Chain abandoned by "hard" interruption is released by the first call after its plugin has returned,
+  // the worker never waits for it
+  abandoned_.erase(std::remove_if(abandoned_.begin(), abandoned_.end(),
+                                  [](const std::shared_ptr<ChainController> &controller) -> bool {
+                                    return !controller->chain_abandoned();
+                                  }),
+                   abandoned_.end());
+
+  // Controller's thread has already called its callback, so joining it is quick
+  for (const auto &id : finished) {
+    try {
+      auto it = chains_.find(id);
+      if (it != chains_.end() && it->second->chain_abandoned()) {
+        abandoned_.push_back(it->second);
+      }
+      chains_.erase(id);
+    }
+    catch (std::exception &ex) {
+      std::cerr << "Exception from Processor::worker_thread(): failed to release chain, " << ex.what() << std::endl;
+    }
+
+    // The last island of the group takes its hub away
+    auto it = islands_.find(id);
+    if (it != islands_.end()) {
+      auto hub = hubs_.find(it->second);
+      hub->second->leave(id);
+      if (hub->second->islands() == 0) {
+        hubs_.erase(hub);
+      }
+      islands_.erase(it);
+    }
+
+    // Scope could have been taken by a newer chain already
+    auto scope = chain_scopes_.find(id);
+    if (scope != chain_scopes_.end()) {
+      auto latest = scopes_.find(scope->second);
+      if (latest != scopes_.end() && latest->second.chain == id) {
+        scopes_.erase(latest);
+      }
+      chain_scopes_.erase(scope);
+    }
+  }
+}
+
+void Processor::wait_for_finished_chains() {
+  std::unique_lock<std::mutex> lock(finished_mutex_);
+  finished_cv_.wait(lock, [this]() -> bool { return !finished_chains_.empty(); });
+}
+
+void Processor::stop_worker() {
+  closed_ = true;
+  if (in_queue_ != nullptr) {
+    in_queue_->wake_consumer();
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
 void Processor::worker_thread() {
-  // Stop when: owner called close(), no new requests, all zombies are killed
-  while (!closed_ || in_queue_->element_count() != 0 || !chains_.empty()) {
-    if (in_queue_->element_count() != 0) {
-      auto req = in_queue_->pop();
-      TimeCounter::Lock time_lock(req->context()->timer());
-
-      try {
-        switch (req->type()) {
-
-          // Create new chain, start the asynchronous construction of timetable
-          case SWM_COMMAND_SCHEDULE: {
-            auto sreq = static_cast<ScheduleCommand *>(req.get());
-            if (chains_.find(sreq->context()->id()) != chains_.end()) {
-              respond_chain_already_exists(out_queue_, sreq->context(), sreq->context()->id());
-              break;
-            }
-
-            std::stringstream errors;
-            std::vector<std::shared_ptr<Algorithm> > algs;
-            if (!create_algorithms(factory_, scanner_, sreq->schedulers(), &algs, &errors)) {
-              std::cerr << "Processor::worker_thread(): failed to create algorithms for "
-                        << "request with ID=\"" << sreq->context()->id() << "\", details: "
-                        << errors.str() << std::endl;
-              out_queue_->push(std::shared_ptr<ResponseInterface>(
-                new EmptyResponse(sreq->context(), false)));
-              break;
-            }
-            std::shared_ptr<Chain> chain;
-            chain.reset(new Chain());
-            chain->init(sreq->scheduling_info(), algs, sreq->context()->timer());
-
-            std::shared_ptr<ChainController> controller;
-            auto clb = [queue = out_queue_,
-                        ctx = sreq->context()]
-                       (bool succeeded,
-                        const std::shared_ptr<TimetableInfoInterface> &tt,
-                        const std::shared_ptr<MetricsSnapshot> &m) -> void {
-              std::shared_ptr<ResponseInterface> resp;
-              if (succeeded) {
-                resp.reset(new util::TimetableResponse(ctx, tt, m));
-              }
-              else {
-                resp.reset(new util::EmptyResponse(ctx, false));
-              }
-              queue->push(resp);
-            };
-            controller.reset(new ChainController());
-            controller->init(chain, &metrics_->object(), clb, timeout_, sreq->context()->timer());
-            chains_.insert(std::make_pair(sreq->context()->id(), controller));
-
-            break;
-          }
-          // Stop the chain execution
-          case SWM_COMMAND_INTERRUPT: {
-            auto ireq = static_cast<InterruptCommand *>(req.get());
-
-            auto it = chains_.find(ireq->chain());
-            if (it == chains_.end()) {
-              respond_chain_not_found(out_queue_, ireq->context(), ireq->chain());
-              break;
-            }
-
-            it->second->invoke_interrupt([queue = out_queue_, ctx = ireq->context()]
-                                         (bool succeeded,
-                                          const std::shared_ptr<TimetableInfoInterface> &,
-                                          const std::shared_ptr<MetricsSnapshot> &) -> void {
-              queue->push(std::shared_ptr<ResponseInterface>(
-                new util::EmptyResponse(ctx, succeeded)));
-            }, ireq->context()->timer());
-
-            break;
-          }
-
-          // Take snapshot of the targets metrics and warp it into response
-          case SWM_COMMAND_METRICS: {
-            auto mreq = static_cast<MetricsCommand *>(req.get());
-
-            auto it = chains_.find(mreq->chain());
-            if (it == chains_.end()) {
-              respond_chain_not_found(out_queue_, mreq->context(), mreq->chain());
-              break;
-            }
-
-            it->second->invoke_stats([queue = out_queue_,
-                                      ctx = mreq->context()]
-                                     (bool succeeded,
-                                      const std::shared_ptr<MetricsSnapshot> &m) -> void {
-              std::shared_ptr<ResponseInterface> resp;
-              if (succeeded) {
-                resp.reset(new util::MetricsResponse(ctx, m));
-              }
-              else {
-                resp.reset(new util::EmptyResponse(ctx, false));
-              }
-              queue->push(resp);
-            }, mreq->context()->timer());
-
-            break;
-          }
-
-          // Exchange timetables from two chains
-          case SWM_COMMAND_EXCHANGE: {
-            auto ereq = static_cast<ExchangeCommand *>(req.get());
-
-            auto src = chains_.find(ereq->source_chain());
-            if (src == chains_.end()) {
-              respond_chain_not_found(out_queue_, ereq->context(), ereq->source_chain());
-              break;
-            }
-            auto trg = chains_.find(ereq->target_chain());
-            if (trg == chains_.end()) {
-              respond_chain_not_found(out_queue_, ereq->context(), ereq->target_chain());
-              break;
-            }
-
-            src->second->invoke_exchange(trg->second.get(),
-                                         [q = out_queue_,
-                                          ctx = ereq->context()](bool succeeded) -> void {
-              q->push(std::shared_ptr<ResponseInterface>(new EmptyResponse(ctx, succeeded)));
-            }, ereq->context()->timer());
-            trg->second->invoke_exchange(src->second.get(), [](bool) -> void {}, ereq->context()->timer());
-
-            break;
-          }
-
-          // Command was not parsed, just notify about it
-          case SWM_COMMAND_CORRUPTED: {
-            out_queue_->push(std::shared_ptr<ResponseInterface>(
-              new util::EmptyResponse(req->context(), false)));
-            break;
-          }
-        } // switch
-      } // try
-      catch (std::exception &ex) {
-        std::cerr << "Exception from Processor::worker_thread():"
-                  << "failed to process request with UID=\"" << req->context()->id()
-                  << "\", details: " << ex.what() << std::endl;
+  // Stop when: owner called close() (or closed the queue), no new requests, all chains are released
+  while (true) {
+    release_finished_chains();
+    migrate_islands();
+
+    // Sleeps until new request, chain's completion or close()
+    std::shared_ptr<CommandInterface> req;
+    bool received = false;
+    if (!closed_ && !in_queue_->closed()) {
+      received = pop_request(true, &req);
+    }
+    else if (!(received = pop_request(false, &req))) {
+      if (chains_.empty()) {
+        break;
       }
+      wait_for_finished_chains();
+    }
 
-      metrics_->update_requests(1);
-    } // if
-
-    // To kill zombies: remove and release chains with stopped threads
-    // Assuming that the total number of chains is small enough
-    auto it = chains_.begin();
-    while (it != chains_.end()) {
-      auto chain = it->second.get();
-      if (chain->finished()) {
-        try { it = chains_.erase(it); }
-        catch (std::exception &ex) {
-          std::cerr << "Exception from Processor::worker_thread(): failed to release chain, " << ex.what() << std::endl;
-        }
+    if (received) {
+      handle_request(req);
+    }
+  }
+}
+
+void Processor::handle_request(const std::shared_ptr<CommandInterface> &req) {
+  TimeCounter::Lock time_lock(req->context()->timer());
+  TraceSpan span(tracer_, "processor.request");
+  update_pool_metrics();
+
+  try {
+    switch (req->type()) {
+      case SWM_COMMAND_SCHEDULE:
+        handle_schedule(static_cast<const ScheduleCommand *>(req.get()));
+        break;
+      case SWM_COMMAND_INTERRUPT:
+        handle_interrupt(static_cast<const InterruptCommand *>(req.get()));
+        break;
+      case SWM_COMMAND_METRICS:
+        handle_metrics(static_cast<const MetricsCommand *>(req.get()));
+        break;
+      case SWM_COMMAND_EXCHANGE:
+        handle_exchange(static_cast<const ExchangeCommand *>(req.get()));
+        break;
+      case SWM_COMMAND_ESTIMATE:
+        handle_estimate(req);
+        break;
+
+      // Command was not parsed, just notify about it
+      case SWM_COMMAND_CORRUPTED:
+        out_queue_->push(std::shared_ptr<ResponseInterface>(
+          new util::EmptyResponse(req->context(), false)));
+        break;
+    }
+  }
+  catch (std::exception &ex) {
+    std::cerr << "Exception from Processor::worker_thread():"
+              << "failed to process request with UID=\"" << req->context()->id()
+              << "\", details: " << ex.what() << std::endl;
+  }
+
+  metrics_->update_requests(1);
+}
+
+// Create new chain, start the asynchronous construction of timetable
+void Processor::handle_schedule(const ScheduleCommand *sreq) {
+  const SwmUID key = chain_key(sreq->context()->origin(), sreq->context()->id());
+  if (chains_.find(key) != chains_.end()) {
+    respond_chain_already_exists(out_queue_, sreq->context(), sreq->context()->id());
+    return;
+  }
+
+  // Nothing has changed since the same request was scheduled, its result is still valid
+  const std::string memo_key = cache_.get() != nullptr ? memoization_key(sreq) : std::string();
+  if (!memo_key.empty() && respond_memoized(sreq, memo_key)) {
+    return;
+  }
+
+  // Small requests are not worth of the NUMA placement and the snapshot copy
+  const bool run_inline = inline_threshold_ != 0 &&
+                          sreq->scheduling_info()->jobs().size() <= inline_threshold_;
+  const size_t pool = run_inline ? 0 : select_chains_executor();
+  std::vector<std::shared_ptr<Algorithm> > algs;
+  if (!create_chain_algorithms(sreq, run_inline ? scanner_->cpu() : chains_units_[pool], &algs)) {
+    return;
+  }
+  if (run_inline) {
+    metrics_->update_inline_chains(1);
+  }
+  const std::shared_ptr<Chain> chain = create_chain(sreq, algs, run_inline, pool);
+
+  // Newer request of the same scope will find the chain to supersede it
+  std::shared_ptr<Supersession> supersession;
+  const std::string scope = coalescing_ ? sreq->scope() : std::string();
+  if (!scope.empty()) {
+    supersession.reset(new Supersession());
+    scopes_[scope] = ScopeChain { key, supersession };
+    chain_scopes_[key] = scope;
+  }
+
+  std::shared_ptr<ChainController> controller(new ChainController());
+  controller->init(chain, &metrics_->object(), chain_callback(sreq, key, supersession, memo_key), timeout_,
+                   sreq->context()->timer(), requests_executor_.get(), timers_.get());
+  chains_.insert(std::make_pair(key, controller));
+
+  // Island joins the hub of its group for the same input
+  if (!sreq->chain_spec().island().empty()) {
+    const std::string group = island_key(sreq);
+    auto &hub = hubs_[group];
+    if (hub.get() == nullptr) {
+      hub.reset(new ExchangeHub(sreq->chain_spec().topology()));
+    }
+    hub->join(key);
+    islands_[key] = group;
+    schedule_migration();
+  }
+}
+
+bool Processor::respond_memoized(const ScheduleCommand *sreq, const std::string &memo_key) {
+  TimetableCache::Result cached;
+  const bool hit = cache_->find(memo_key, &cached);
+  metrics_->update_memoization(hit);
+  if (hit) {
+    out_queue_->push(create_timetable_response(history_.get(), sreq->response_spec(), sreq->context(),
+                                               cached.timetable, cached.metrics));
+  }
+  return hit;
+}
+
+bool Processor::create_chain_algorithms(const ScheduleCommand *sreq, const ComputeUnit *cu,
+                                        std::vector<std::shared_ptr<Algorithm> > *algs) {
+  std::stringstream errors;
+  const auto algorithms_start = LatencyHistogram::clock::now();
+  const bool created = create_algorithms(factory_, cu, sreq->schedulers(), algs, &errors);
+  const auto algorithms_end = LatencyHistogram::clock::now();
+  metrics_->record_latency(ServiceMetrics::ALGORITHMS, algorithms_end - algorithms_start);
+  if (tracer_ != nullptr) {
+    tracer_->add_span("processor.create_algorithms", algorithms_start, algorithms_end);
+  }
+  if (!created) {
+    std::cerr << "Processor::worker_thread(): failed to create algorithms for "
+              << "request with ID=\"" << sreq->context()->id() << "\", details: "
+              << errors.str() << std::endl;
+    out_queue_->push(std::shared_ptr<ResponseInterface>(
+      new EmptyResponse(sreq->context(), false)));
+    return false;
+  }
+  const std::shared_ptr<LatencyHistogram> stages(metrics_, metrics_->latency(ServiceMetrics::CHAIN_STAGE));
+  for (const auto &alg : *algs) {
+    alg->set_latency_histogram(stages);
+  }
+  return true;
+}
+
+std::shared_ptr<Chain> Processor::create_chain(const ScheduleCommand *sreq,
+                                               const std::vector<std::shared_ptr<Algorithm> > &algs,
+                                               bool run_inline, size_t pool) {
+  std::shared_ptr<Chain> chain;
+  chain.reset(new Chain());
+  const auto &chain_spec = sreq->chain_spec();
+  const Chain::ModeType mode = chain_spec.portfolio() ? Chain::PORTFOLIO
+                             : chain_spec.pipeline() ? Chain::PIPELINE : Chain::SEQUENTIAL;
+  chain->set_mode(mode, TimetableObjective(chain_spec.objective()), chain_spec.budget());
+  chain->set_tracer(tracer_);
+
+  // Snapshot was allocated by the receiver's thread, the chain's algorithms get a copy in memory
+  // of its node. The copy is made by the node's pool, the processor doesn't wait for it
+  if (!run_inline && chains_executors_.size() > 1) {
+    chain->set_input_copy([node = chains_units_[pool]->device_number()]
+                          (const std::shared_ptr<SchedulingInfoInterface> &input)
+                          -> std::shared_ptr<SchedulingInfoInterface> {
+      PreferredNodeScope scope(node);
+      if (!scope.applied()) {
+        return input;
       }
-      else {
-        ++it;
+      return std::shared_ptr<SchedulingInfoInterface>(
+        new SchedulingInfo(*static_cast<const SchedulingInfo *>(input.get())));
+    });
+  }
+  // Small chain runs on the inline pool, so control commands aren't waiting for it here
+  Executor *executor = run_inline ? inline_executor_.get() : chains_executors_[pool].get();
+  chain->init(sreq->scheduling_info(), algs, sreq->context()->timer(), executor);
+  return chain;
+}
+
+ChainController::finish_callback Processor::chain_callback(const ScheduleCommand *sreq, const SwmUID &key,
+                                                           const std::shared_ptr<Supersession> &supersession,
+                                                           const std::string &memo_key) {
+  return [processor = this,
+          queue = out_queue_,
+          history = history_,
+          spec = sreq->response_spec(),
+          ctx = sreq->context(),
+          key,
+          supersession,
+          cache = memo_key.empty() ? nullptr : cache_,
+          memo_key,
+          profiles = profiles_,
+          info = sreq->scheduling_info(),
+          origin = AvailabilityProfiles::clock::now()]
+         (bool succeeded,
+          const std::shared_ptr<TimetableInfoInterface> &tt,
+          const std::shared_ptr<MetricsSnapshot> &m) -> void {
+    // Interrupted chain still responds with its best-so-far timetable if it has one,
+    // it's marked as partial
+    std::shared_ptr<ResponseInterface> resp;
+    if (supersession.get() != nullptr && supersession->superseded) {
+      resp.reset(new util::SupersededResponse(ctx, supersession->by));
+    }
+    else if (succeeded || tt.get() != nullptr) {
+      resp = create_timetable_response(history.get(), spec, ctx, tt, m, !succeeded);
+      // Only complete results are reused and learnt from, partial ones are truncated
+      if (succeeded && cache.get() != nullptr) {
+        cache->insert(memo_key, TimetableCache::Result { tt, m });
+      }
+      if (succeeded) {
+        profiles->update(*info, *tt, origin);
       }
-    } // while
+    }
+    else {
+      resp.reset(new util::EmptyResponse(ctx, false));
+    }
+    queue->push(resp);
+    processor->on_chain_finished(key);
+  };
+}
+
+// Stop the chain execution
+void Processor::handle_interrupt(const InterruptCommand *ireq) {
+  auto it = chains_.find(chain_key(ireq->context()->origin(), ireq->chain()));
+  if (it == chains_.end()) {
+    respond_chain_not_found(out_queue_, ireq->context(), ireq->chain());
+    return;
+  }
+
+  it->second->invoke_interrupt([queue = out_queue_, ctx = ireq->context()]
+                               (bool succeeded,
+                                const std::shared_ptr<TimetableInfoInterface> &,
+                                const std::shared_ptr<MetricsSnapshot> &) -> void {
+    queue->push(std::shared_ptr<ResponseInterface>(
+      new util::EmptyResponse(ctx, succeeded)));
+  }, ireq->context()->timer());
+}
+
+// Take snapshot of the targets metrics and warp it into response
+void Processor::handle_metrics(const MetricsCommand *mreq) {
+  auto it = chains_.find(chain_key(mreq->context()->origin(), mreq->chain()));
+  if (it == chains_.end()) {
+    respond_chain_not_found(out_queue_, mreq->context(), mreq->chain());
+    return;
+  }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(2));  // TODO: wait for some event / conditional variable?
-    std::this_thread::yield();
-  } // while
+  metrics_->publish_latencies();
+  it->second->invoke_stats([queue = out_queue_,
+                            ctx = mreq->context(),
+                            replies = metrics_replies_]
+                           (bool succeeded,
+                            const std::shared_ptr<MetricsSnapshot> &m) -> void {
+    std::shared_ptr<ResponseInterface> resp;
+    if (succeeded) {
+      resp.reset(new util::MetricsResponse(ctx, m, replies));
+    }
+    else {
+      resp.reset(new util::EmptyResponse(ctx, false));
+    }
+    queue->push(resp);
+  }, mreq->context()->timer());
+}
+
+// Exchange timetables from two chains
+void Processor::handle_exchange(const ExchangeCommand *ereq) {
+  auto src = chains_.find(chain_key(ereq->context()->origin(), ereq->source_chain()));
+  if (src == chains_.end()) {
+    respond_chain_not_found(out_queue_, ereq->context(), ereq->source_chain());
+    return;
+  }
+  auto trg = chains_.find(chain_key(ereq->context()->origin(), ereq->target_chain()));
+  if (trg == chains_.end()) {
+    respond_chain_not_found(out_queue_, ereq->context(), ereq->target_chain());
+    return;
+  }
+
+  src->second->invoke_exchange(trg->second.get(),
+                               [q = out_queue_,
+                                ctx = ereq->context()](bool succeeded) -> void {
+    q->push(std::shared_ptr<ResponseInterface>(new EmptyResponse(ctx, succeeded)));
+  }, ereq->context()->timer());
+  trg->second->invoke_exchange(src->second.get(), [](bool) -> void {}, ereq->context()->timer());
+}
+
+// Answered from availability profiles by the requests' pool, no chain is created
+void Processor::handle_estimate(const std::shared_ptr<CommandInterface> &req) {
+  requests_executor_->submit([queue = out_queue_, profiles = profiles_, req]() -> void {
+    auto ereq = static_cast<EstimateCommand *>(req.get());
+    TimeCounter::Lock time_lock(ereq->context()->timer());
+    std::vector<SwmTimetable> estimates;
+    estimates.reserve(ereq->candidates().size());
+    const auto now = AvailabilityProfiles::clock::now();
+    for (const auto &job : ereq->candidates()) {
+      SwmTimetable estimate;
+      if (profiles->estimate(job, &estimate, now)) {
+        estimates.push_back(estimate);
+      }
+    }
+    queue->push(std::shared_ptr<ResponseInterface>(new util::EstimateResponse(ereq->context(), estimates)));
+  });
 }
 
 } // util
@@ -1,13 +1,25 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 #include "defs.h"
 
+#include "availability_profiles.h"
 #include "commands.h"
 #include "responses.h"
 #include "service_metrics.h"
-#include "auxl/my_queue.h"
+#include "timetable_cache.h"
+#include "timetable_history.h"
+#include "auxl/blocking_queue.h"
+#include "auxl/executor.h"
+#include "auxl/timer_wheel.h"
 #include "chn/chain_controller.h"
+#include "hw/compute_unit.h"
+#include "ifaces/trace_interface.h"
 
 namespace swm {
 namespace util {
@@ -15,42 +27,185 @@ namespace util {
 // Processor for incoming requests. Not a CPU or something like that
 class Processor {
  public:
+  enum PlacementType {
+    FLOATING    = 0,      // single pool, threads are moved by OS freely
+    NUMA_NODES  = 1,      // pool per NUMA node, its threads are bound to the node's CPUs
+    PINNED_CPUS = 2       // pool per NUMA node, every thread is bound to a single CPU
+  };
+
   Processor();
   Processor(const Processor &) = delete;
   ~Processor();
   void operator =(const Processor &) = delete;
 
+  // Commands from "control_queue" (if specified) are performed ahead of "in_queue" ones,
+  // its producer must wake up the consumer of "in_queue" after every push
   void init(const AlgorithmFactory *factory,
             const Scanner *scanner,
-            MyQueue<std::shared_ptr<CommandInterface> > *in_queue,
-            MyQueue<std::shared_ptr<ResponseInterface> > *out_queue,
-            double timeout);
+            BlockingQueue<std::shared_ptr<CommandInterface> > *in_queue,
+            BlockingQueue<std::shared_ptr<ResponseInterface> > *out_queue,
+            double timeout,
+            BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue = nullptr);
   void close();
 
+  const std::shared_ptr<ServiceMetrics> &metrics() const { return metrics_; }
+  // Filled by completed chains, answers estimation commands
+  const std::shared_ptr<AvailabilityProfiles> &availability() const { return profiles_; }
+
+  // Chains of requests with no more than "jobs" jobs skip the chains' pools and the snapshot copy,
+  // they run one by one on a thread of their own. 0 means that all chains go to the chains' pools.
+  // Must be set before init()
+  void   set_inline_threshold(size_t jobs) { inline_threshold_ = jobs; }
+  size_t get_inline_threshold() const { return inline_threshold_; }
+
+  // Chains of the same island group exchange their best timetables every "seconds"
+  void   set_migration_interval(double seconds);
+  double get_migration_interval() const { return migration_interval_; }
+
+  // Placement of chains' threads, falls back to FLOATING if CPU topology is unknown.
+  // Must be set before init()
+  void          set_placement(PlacementType placement) { placement_ = placement; }
+  PlacementType get_placement() const { return placement_; }
+
+  // Schedule request is superseded by a newer one of the same scope (see ScheduleCommand::scope()):
+  // the queued one is dropped, the running one is interrupted, both are answered with
+  // SupersededResponse. Must be set before init()
+  void set_coalescing(bool enabled) { coalescing_ = enabled; }
+  bool get_coalescing() const { return coalescing_; }
+
+  // Completed timetables are reused for requests with the same input, schedulers and chain spec
+  // during "ttl" seconds, at most "capacity" of them are kept. Zero capacity disables the cache,
+  // so does island group (its chains depend on each other). Must be set before init()
+  void   set_memoization(size_t capacity, double ttl);
+  size_t get_memoization_capacity() const { return memoization_capacity_; }
+  double get_memoization_ttl() const { return memoization_ttl_; }
+
+  // Metrics command is answered with the service metrics in a scheduler_result (see MetricsResponse),
+  // clients that expect no answer would take it for a stray response, so it's off by default
+  void set_metrics_replies(bool enabled) { metrics_replies_ = enabled; }
+  bool get_metrics_replies() const { return metrics_replies_; }
+
+  // Requests and their chains record spans into "tracer", nullptr (default) disables tracing.
+  // Tracer must outlive the processor. Must be set before init()
+  void set_tracer(TraceInterface *tracer) { tracer_ = tracer; }
+
  private:
+  // Shared by the worker thread and the chain's callback, "by" is written before the flag is raised
+  struct Supersession {
+    Supersession() : superseded(false) { }
+    std::atomic<bool> superseded;
+    SwmUID by;
+  };
+  struct ScopeChain {
+    SwmUID chain;                     // see chain_key()
+    std::shared_ptr<Supersession> supersession;
+  };
+
   static bool create_algorithms(const AlgorithmFactory *factory,
-                                const Scanner *scanner,
+                                const ComputeUnit *cu,
                                 const std::vector<ScheduleCommand::AlgorithmSpec> &specs,
                                 std::vector<std::shared_ptr<Algorithm> > *res,
                                 std::stringstream *errors = nullptr);
-  static void respond_chain_not_found(MyQueue<std::shared_ptr<ResponseInterface> > *queue,
+  static std::shared_ptr<ResponseInterface> create_timetable_response(
+                                      TimetableHistory *history,
+                                      const ScheduleCommand::ResponseSpec &spec,
+                                      const std::shared_ptr<CommandContext> &context,
+                                      const std::shared_ptr<TimetableInfoInterface> &tt,
+                                      const std::shared_ptr<MetricsSnapshot> &metrics,
+                                      bool partial = false);
+  static void respond_chain_not_found(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
                                       const std::shared_ptr<CommandContext> &context,
                                       const SwmUID &chain_id);
-  static void respond_chain_already_exists(MyQueue<std::shared_ptr<ResponseInterface> > *queue,
+  static void respond_chain_already_exists(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
                                            const std::shared_ptr<CommandContext> &context,
                                            const SwmUID &chain_id);
+  static std::string memoization_key(const ScheduleCommand *req);
+  static std::string island_key(const ScheduleCommand *req);
+  static void respond_superseded(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue,
+                                 const std::shared_ptr<CommandContext> &context,
+                                 const SwmUID &superseded_by);
+  bool pop_request(bool wait, std::shared_ptr<CommandInterface> *req);
+  void admit_request(const std::shared_ptr<CommandInterface> &req);
+  // Chains are identified by the connection and the ID its client has given, so clients never
+  // reach (or collide with) the chains of each other
+  static SwmUID chain_key(size_t origin, const SwmUID &id);
+  bool targets_exist(const CommandInterface *req) const;
+  void on_chain_finished(const SwmUID &chain_id);
+  void release_finished_chains();
+  void wait_for_finished_chains();
+  void on_migration_due();
+  void schedule_migration();
+  void migrate_islands();
+  size_t select_chains_executor();
+  void update_pool_metrics();
+  void stop_worker();
   void worker_thread();
+  void handle_request(const std::shared_ptr<CommandInterface> &req);
+  void handle_schedule(const ScheduleCommand *sreq);
+  bool respond_memoized(const ScheduleCommand *sreq, const std::string &memo_key);
+  // False if the request was answered with a failure
+  bool create_chain_algorithms(const ScheduleCommand *sreq, const ComputeUnit *cu,
+                               std::vector<std::shared_ptr<Algorithm> > *algs);
+  std::shared_ptr<Chain> create_chain(const ScheduleCommand *sreq,
+                                      const std::vector<std::shared_ptr<Algorithm> > &algs,
+                                      bool run_inline, size_t pool);
+  // Responds with the chain's result, learns from it and lets the worker release the chain
+  ChainController::finish_callback chain_callback(const ScheduleCommand *sreq, const SwmUID &key,
+                                                  const std::shared_ptr<Supersession> &supersession,
+                                                  const std::string &memo_key);
+  void handle_interrupt(const InterruptCommand *ireq);
+  void handle_metrics(const MetricsCommand *mreq);
+  void handle_exchange(const ExchangeCommand *ereq);
+  void handle_estimate(const std::shared_ptr<CommandInterface> &req);
   
   double timeout_;
+  size_t inline_threshold_;
+  double migration_interval_;
+  PlacementType placement_;
+  bool coalescing_;
+  size_t memoization_capacity_;
+  double memoization_ttl_;
+  bool metrics_replies_;
+  TraceInterface *tracer_;
   std::thread worker_;
   volatile bool closed_;                            // forces to stop waiting for new requests
 
+  // Chains that have notified about their completion, released by the worker thread
+  std::mutex finished_mutex_;
+  std::condition_variable finished_cv_;
+  std::vector<SwmUID> finished_chains_;
+  bool migration_due_;
+  bool migration_scheduled_;                        // worker thread only
+
   std::shared_ptr<ServiceMetrics> metrics_;         // as pointer because we need to reset them
+  std::shared_ptr<TimetableHistory> history_;       // results sent in diff mode
+  std::shared_ptr<TimetableCache> cache_;           // nullptr if memoization is disabled
+  std::shared_ptr<AvailabilityProfiles> profiles_;
   const AlgorithmFactory *factory_;
   const Scanner *scanner_;
-  MyQueue<std::shared_ptr<CommandInterface> > *in_queue_;
-  MyQueue<std::shared_ptr<ResponseInterface> > *out_queue_;
-  std::unordered_map<SwmUID, std::shared_ptr<ChainController> > chains_;
+  BlockingQueue<std::shared_ptr<CommandInterface> > *in_queue_;
+  BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue_;
+  BlockingQueue<std::shared_ptr<ResponseInterface> > *out_queue_;
+  std::unordered_map<size_t, size_t> schedules_taken_;        // from "in_queue" by origin, worker thread only
+  std::vector<std::shared_ptr<CommandInterface> > deferred_;   // control ones waiting for their chains
+  std::deque<std::shared_ptr<CommandInterface> > backlog_;     // taken from "in_queue" if coalescing
+
+  // Must outlive the chains. Requests to controllers have their own pool, otherwise they would
+  // wait for long running algorithms. Timeouts of all requests are tracked by the single wheel
+  std::unique_ptr<TimerWheel> timers_;
+  // Chains' pools with compute units their threads are bound to (one per NUMA node if placed)
+  std::vector<std::unique_ptr<Executor> > chains_executors_;
+  std::vector<const ComputeUnit *> chains_units_;
+  size_t next_chains_executor_;                     // worker thread only
+  std::unique_ptr<Executor> requests_executor_;
+  std::unique_ptr<Executor> inline_executor_;       // small chains, if there is inline threshold
+  std::unordered_map<SwmUID, std::shared_ptr<ChainController> > chains_;  // by chain_key()
+  // Finished controllers of chains whose plugins still work, released once they return
+  std::vector<std::shared_ptr<ChainController> > abandoned_;
+  std::unordered_map<std::string, std::shared_ptr<ExchangeHub> > hubs_;   // by island group and input
+  std::unordered_map<SwmUID, std::string> islands_;                       // chain -> its group
+  std::unordered_map<std::string, ScopeChain> scopes_;                    // the latest running chain
+  std::unordered_map<SwmUID, std::string> chain_scopes_;                  // chain -> its scope
 };
 
 } // util
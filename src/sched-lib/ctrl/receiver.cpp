@@ -6,13 +6,17 @@ namespace util {
 
 Receiver::~Receiver() {
   closed_ = true;
+  if (ring_ != nullptr && worker_.joinable()) {
+    ring_->interrupt();
+  }
   if (worker_.joinable()) {
     worker_.join();
   }
 }
 
-void Receiver::init(MyQueue<std::shared_ptr<CommandInterface> > *queue, std::istream *input) {
-  if (queue_ != nullptr || input_ != nullptr) {
+void Receiver::init(BlockingQueue<std::shared_ptr<CommandInterface> > *queue, std::istream *input,
+                    BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue) {
+  if (queue_ != nullptr || input_ != nullptr || ring_ != nullptr) {
     throw std::runtime_error("Receiver::init(): object was already initialized");
   }
   if (queue == nullptr || input == nullptr) {
@@ -20,34 +24,79 @@ void Receiver::init(MyQueue<std::shared_ptr<CommandInterface> > *queue, std::ist
       "Receiver::init(): \"queue\" and \"input\" cannot be equal to nullptr");
   }
 
+  input_ = input;
+  start(queue, control_queue);
+}
+
+void Receiver::init_ring(BlockingQueue<std::shared_ptr<CommandInterface> > *queue, ShmRing *ring,
+                         BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue) {
+  if (queue_ != nullptr || input_ != nullptr || ring_ != nullptr) {
+    throw std::runtime_error("Receiver::init_ring(): object was already initialized");
+  }
+  if (queue == nullptr || ring == nullptr) {
+    throw std::runtime_error(
+      "Receiver::init_ring(): \"queue\" and \"ring\" cannot be equal to nullptr");
+  }
+
+  ring_ = ring;
+  start(queue, control_queue);
+}
+
+void Receiver::start(BlockingQueue<std::shared_ptr<CommandInterface> > *queue,
+                     BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue) {
   if (worker_.joinable()) {
     worker_.join();
   }
 
-  input_ = input;
   queue_ = queue;
+  control_queue_ = control_queue;
   closed_ = false;
   finished_ = false;
+  schedules_ = 0;
+  commands_ = 0;
+  if (control_queue_ != nullptr) {
+    frames_.clear();
+    frames_closed_ = false;
+    parser_ = std::thread([me = this]() -> void { me->parser_loop(); });
+  }
   worker_ = std::thread([me = this]() -> void { me->worker_loop(); });
 }
 
 bool Receiver::finished() {
-  if (queue_ == nullptr || input_ == nullptr) {
-    throw std::runtime_error("Receiver::init(): object must be initialized first");
+  if (queue_ == nullptr) {
+    throw std::runtime_error("Receiver::finished(): object must be initialized first");
   }
 
   return finished_;
 }
 
+void Receiver::wait() {
+  if (queue_ == nullptr) {
+    throw std::runtime_error("Receiver::wait(): object must be initialized first");
+  }
+
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+static inline bool is_known_command(char command) {
+  return command == SWM_COMMAND_SCHEDULE || command == SWM_COMMAND_INTERRUPT ||
+         command == SWM_COMMAND_METRICS  || command == SWM_COMMAND_EXCHANGE ||
+         command == SWM_COMMAND_ESTIMATE;
+}
+
 bool Receiver::get_data(std::vector<std::unique_ptr<char[]>> *data,
+                        std::vector<size_t> *sizes,
                         CommandType *cmd,
                         SwmUID *uid,
                         std::stringstream *errors) {
-  if (data == nullptr || cmd == nullptr || uid == nullptr) {
+  if (data == nullptr || sizes == nullptr || cmd == nullptr || uid == nullptr) {
     throw std::runtime_error(
-      "Receiver::get_data(): \"data\", \"cmd\", \"uid\" cannot be equal to nullptr");
+      "Receiver::get_data(): \"data\", \"sizes\", \"cmd\", \"uid\" cannot be equal to nullptr");
   }
   data->clear();
+  sizes->clear();
 
   std::stringstream errors_;
   if (errors == nullptr) {
@@ -59,51 +108,150 @@ bool Receiver::get_data(std::vector<std::unique_ptr<char[]>> *data,
     *errors << "could not read command";
     return false;
   }
-  if (command != SWM_COMMAND_SCHEDULE && command != SWM_COMMAND_INTERRUPT &&
-      command != SWM_COMMAND_METRICS  && command != SWM_COMMAND_EXCHANGE) {
+  if (!is_known_command(command)) {
     *errors << "unknown command #" << int(command);
     return false;
   }
   *cmd = (CommandType)command;
+  frame_start_ = LatencyHistogram::clock::now();
 
-  //TODO: read uid
-  *uid = 1;
+  // Request identifier follows the command: length (4 bytes, big-endian) and characters
+  uint32_t uid_len = 0;
+  if (!swm_read_length(input_, &uid_len)) {
+    *errors << "could not read request identifier length";
+    return false;
+  }
+  if (uid_len > MAX_UID_LENGTH) {
+    *errors << "request identifier of " << uid_len << " bytes is too long";
+    return false;
+  }
+  uid->assign(uid_len, '\0');
+  if (!swm_read_exact(input_, &(*uid)[0], uid_len)) {
+    *errors << "couldn't get " << uid_len << " bytes of request identifier";
+    return false;
+  }
 
-  char total = 0;
-  if (!swm_read_exact(input_, &total, 1)) {
+  unsigned char total = 0;
+  if (!swm_read_exact(input_, (char *)&total, 1)) {
     *errors << "could not read total data count";
     return false;
   }
   
   data->resize(total);
+  sizes->resize(total);
   for (unsigned char i = 0; i < total; ++i) {
-    char type = 0;
-    if (!swm_read_exact(input_, &type, 1)) {
-      *errors << "could not read data type (i=" << i << ")";
+    unsigned char type = 0;
+    if (!swm_read_exact(input_, (char *)&type, 1)) {
+      *errors << "could not read data type (i=" << (int)i << ")";
       return false;
     }
     if (type >= total) {
-      *errors << "wrong data type: " << type;
+      *errors << "wrong data type: " << (int)type;
       return false;
     }
 
     uint32_t len = 0;
     if(!swm_read_length(input_, &len)) {
-      *errors << "data length is 0 (type=" << type << ")";
+      *errors << "data length is 0 (type=" << (int)type << ")";
       return false;
     }
 
     (*data)[type].reset(new char[len]);
+    (*sizes)[type] = len;
     auto ptr = (*data)[type].get();
     if (!swm_read_exact(input_, ptr, len)) {
-      *errors << "couldn't get " << len << " bytes of data type " << type;
+      *errors << "couldn't get " << len << " bytes of data type " << (int)type;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Frame has the same layout as the stream: command, request id (length and characters),
+// slice count, slices (type, length, data). Lengths are 4 bytes, big-endian
+bool Receiver::get_ring_data(Frame *frame, std::stringstream *errors) {
+  if (!ring_->acquire(&frame->slot, -1.0, errors)) {
+    return false;                     // end of stream or interrupted is not an error
+  }
+  frame->ring = ring_;
+  frame_start_ = LatencyHistogram::clock::now();
+
+  char *cur = frame->slot.data;
+  const char *end = frame->slot.data + frame->slot.size;
+  auto read_length = [&cur, end](uint32_t *len) -> bool {
+    if (end - cur < 4) {
       return false;
     }
+    const unsigned char *bytes = (const unsigned char *)cur;
+    *len = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+    cur += 4;
+    return true;
+  };
+
+  if (cur == end || !is_known_command(*cur)) {
+    *errors << "unknown command in the frame at " << frame->slot.begin;
+    return false;
+  }
+  frame->type = (CommandType)*cur++;
+
+  uint32_t uid_len = 0;
+  if (!read_length(&uid_len) || uid_len > MAX_UID_LENGTH || (size_t)(end - cur) < uid_len) {
+    *errors << "could not read request identifier";
+    return false;
   }
+  frame->uid.assign(cur, uid_len);
+  cur += uid_len;
 
+  if (cur == end) {
+    *errors << "could not read total data count";
+    return false;
+  }
+  const unsigned char total = (unsigned char)*cur++;
+  frame->data.assign(total, nullptr);
+  frame->sizes.assign(total, 0);
+  for (unsigned char i = 0; i < total; ++i) {
+    const unsigned char type = cur != end ? (unsigned char)*cur++ : total;
+    uint32_t len = 0;
+    if (type >= total || !read_length(&len) || (size_t)(end - cur) < len) {
+      *errors << "wrong data slice #" << (int)i << " in the frame";
+      return false;
+    }
+    frame->data[type] = cur;
+    frame->sizes[type] = len;
+    cur += len;
+  }
   return true;
 }
 
+// Frames of the stream are recorded in the same layout with slices in the order of their types
+void Receiver::record(const Frame &frame) {
+  if (frame.ring != nullptr) {
+    recorder_->record(origin_, frame.uid, frame.slot.data, frame.slot.size);
+    return;
+  }
+
+  std::string bytes;
+  auto put_length = [&bytes](size_t len) -> void {
+    bytes.push_back((char)(len >> 24));
+    bytes.push_back((char)(len >> 16));
+    bytes.push_back((char)(len >> 8));
+    bytes.push_back((char)len);
+  };
+  bytes.push_back((char)frame.type);
+  put_length(frame.uid.size());
+  bytes.append(frame.uid);
+  bytes.push_back((char)frame.data.size());
+  for (size_t i = 0; i < frame.data.size(); ++i) {
+    bytes.push_back((char)i);
+    put_length(frame.sizes[i]);
+    if (frame.data[i] != nullptr) {
+      bytes.append(frame.data[i], frame.sizes[i]);
+    }
+  }
+  recorder_->record(origin_, frame.uid, bytes.data(), bytes.size());
+}
+
 static inline bool is_good(std::istream *str) {
   if (str != nullptr) {
     str->peek();
@@ -112,77 +260,193 @@ static inline bool is_good(std::istream *str) {
   return false;
 }
 
+std::shared_ptr<CommandInterface> Receiver::parse(const Frame &frame, std::stringstream *errors) {
+  std::shared_ptr<CommandContext> context(new CommandContext(frame.uid, frame.schedules_before, origin_));
+  std::shared_ptr<CommandInterface> command = nullptr;
+  TraceSpan span(tracer_, "receiver.parse");
+  context->timer()->turn_on();
+  try {
+    switch (frame.type) {
+      case SWM_COMMAND_SCHEDULE: {
+        command.reset(new ScheduleCommand(context));
+        break;
+      }
+      case SWM_COMMAND_INTERRUPT: {
+        command.reset(new InterruptCommand(context));
+        break;
+      }
+      case SWM_COMMAND_METRICS: {
+        command.reset(new MetricsCommand(context));
+        break;
+      }
+      case SWM_COMMAND_EXCHANGE: {
+        command.reset(new ExchangeCommand(context));
+        break;
+      }
+      case SWM_COMMAND_ESTIMATE: {
+        command.reset(new EstimateCommand(context));
+        break;
+      }
+      default: {
+        std::cerr << "Receiver::worker_loop(): received unknown command (UID="
+                  << frame.uid << ", type=#" << (int)frame.type << "), ignoring it." << std::endl;
+        command.reset(new CorruptedCommand(context));
+      }
+    }
+
+    LatencyHistogram::Scope decode(metrics_.get() != nullptr ? metrics_->latency(ServiceMetrics::DECODE) : nullptr);
+    if (!command->init(frame.data, frame.sizes, errors)) {
+      std::cerr << "Receiver::worker_loop(): failed to parse command's data (UID="
+                << frame.uid << "), ignoring it." << std::endl;
+      std::cerr << "Errors: " << errors->str() << std::endl;
+      command.reset(new CorruptedCommand(context));
+    }
+  }
+  catch (std::runtime_error &ex) {
+    std::cerr << "Exception from Receiver::worker_loop(): " << ex.what() << ". "
+              << "Ignoring corrupted command." << std::endl;
+    command.reset(new CorruptedCommand(context));
+  }
+  context->timer()->turn_off();
+  return command;
+}
+
 void Receiver::worker_loop() {
-  std::vector<std::unique_ptr<char[]>> data;
-  CommandType cmd_type;
-  SwmUID uid;
   std::stringstream errors;
 
-  while (is_good(input_) && !closed_) {
-    data.clear();
+  while ((ring_ != nullptr || is_good(input_)) && !closed_) {
+    std::shared_ptr<Frame> frame(new Frame());
+    frame->schedules_before = schedules_;
     errors.str("");
 
     // The first stage - to read raw data
     // We cannot recover stream after any error
     try {
-      if (!get_data(&data, &cmd_type, &uid, &errors)) {
-        std::cerr << "Receiver::worker_loop(): failed to read command's data, details: "
-                  << errors.str() << std::endl;
-        break;
+      if (ring_ != nullptr) {
+        // Frames are delimited, so the next one can be read after a broken one
+        if (!get_ring_data(frame.get(), &errors)) {
+          if (errors.str().empty()) {
+            break;
+          }
+          if (ring_->corrupted()) {
+            std::cerr << "Receiver::worker_loop(): failed to acquire command's frame, details: "
+                      << errors.str() << std::endl;
+            break;
+          }
+          std::cerr << "Receiver::worker_loop(): failed to decode command's frame, skipping it. "
+                    << "Details: " << errors.str() << std::endl;
+          continue;
+        }
+      }
+      else {
+        if (!get_data(&frame->buffers, &frame->sizes, &frame->type, &frame->uid, &errors)) {
+          std::cerr << "Receiver::worker_loop(): failed to read command's data, details: "
+                    << errors.str() << std::endl;
+          break;
+        }
+        for (const auto &buffer : frame->buffers) {
+          frame->data.push_back(buffer.get());
+        }
       }
     }
     catch (std::runtime_error &ex) {
       std::cerr << "Exception from Receiver::worker_loop(): " << ex.what() << ". "
                 << "Aborting." << std::endl;
+      break;
     }
 
-    // The second stage - to parse raw data
-    // Now, we can handle errors
-    try {
-      std::shared_ptr<CommandInterface> command = nullptr;
-      std::shared_ptr<CommandContext> context(new CommandContext(uid));
-      context->timer()->turn_on();
-      switch (cmd_type) {
-        case SWM_COMMAND_SCHEDULE: {
-          command.reset(new ScheduleCommand(context));
-          break;
-        }
-        case SWM_COMMAND_INTERRUPT: {
-          command.reset(new InterruptCommand(context));
-          break;
-        }
-        case SWM_COMMAND_METRICS: {
-          command.reset(new MetricsCommand(context));
-          break;
-        }
-        case SWM_COMMAND_EXCHANGE: {
-          command.reset(new ExchangeCommand(context));
-          break;
-        }
-        default: {
-          std::cerr << "Receiver::worker_loop(): received unknown command (UID="
-                    << uid << ", type=#" << (int)cmd_type << "), ignoring it." << std::endl;
-          command.reset(new CorruptedCommand(context));
-        }
-      }
+    const auto received = LatencyHistogram::clock::now();
+    if (metrics_.get() != nullptr) {
+      metrics_->record_latency(ServiceMetrics::RECEIVE, received - frame_start_);
+    }
+    if (tracer_ != nullptr) {
+      tracer_->add_span("receiver.read", frame_start_, received);
+    }
+    if (recorder_ != nullptr) {
+      record(*frame);
+    }
 
-      if (!command->init(data, &errors)) {
-        std::cerr << "Receiver::worker_loop(): failed to parse command's data (UID="
-                  << uid << "), ignoring it." << std::endl;
-        std::cerr << "Errors: " << errors.str() << std::endl;
-        command.reset(new CorruptedCommand(context));
+    // Schedule commands are parsed by the other thread, control ones don't wait for them
+    if (control_queue_ != nullptr && frame->type == SWM_COMMAND_SCHEDULE) {
+      ++schedules_;
+      if (!put_frame(frame)) {
+        break;                        // parser has stopped, it has already reported why
       }
+      continue;
+    }
 
-      context->timer()->turn_off();
-      queue_->push(command);
+    // The second stage - to parse raw data
+    // Now, we can handle errors
+    auto queue = control_queue_ != nullptr ? control_queue_ : queue_;
+    if (!queue->push(parse(*frame, &errors))) {
+      std::cerr << "Receiver::worker_loop(): command queue was closed, "
+                << "stop receiving commands." << std::endl;
+      break;
     }
-    catch (std::runtime_error &ex) {
-      std::cerr << "Exception from Receiver::worker_loop(): " << ex.what() << ". "
-                << "Ignoring corrupted command." << std::endl;
+    ++commands_;
+    if (control_queue_ != nullptr) {
+      queue_->wake_consumer();        // consumer sleeps on the queue of schedule commands
     }
   }
 
+  if (parser_.joinable()) {
+    close_frames(false);
+    parser_.join();
+  }
   finished_ = true;
+  if (finish_clb_) {
+    finish_clb_();
+  }
+}
+
+void Receiver::parser_loop() {
+  std::shared_ptr<Frame> frame;
+  std::stringstream errors;
+  while (take_frame(&frame)) {
+    errors.str("");
+    if (!queue_->push(parse(*frame, &errors))) {
+      std::cerr << "Receiver::parser_loop(): command queue was closed, "
+                << "stop receiving commands." << std::endl;
+      close_frames(true);
+      break;
+    }
+    ++commands_;
+    frame.reset();
+  }
+}
+
+bool Receiver::put_frame(const std::shared_ptr<Frame> &frame) {
+  std::unique_lock<std::mutex> lock(frames_mutex_);
+  frames_cv_.wait(lock, [this]() -> bool { return frames_.size() < queue_->size() || frames_closed_; });
+  if (frames_closed_) {
+    return false;
+  }
+  frames_.push_back(frame);
+  frames_cv_.notify_all();
+  return true;
+}
+
+bool Receiver::take_frame(std::shared_ptr<Frame> *frame) {
+  std::unique_lock<std::mutex> lock(frames_mutex_);
+  frames_cv_.wait(lock, [this]() -> bool { return !frames_.empty() || frames_closed_; });
+  if (frames_.empty()) {
+    return false;
+  }
+  *frame = frames_.front();
+  frames_.pop_front();
+  frames_cv_.notify_all();
+  return true;
+}
+
+void Receiver::close_frames(bool drop) {
+  // Dropped frames release their slots of the ring
+  std::deque<std::shared_ptr<Frame> > dropped;
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  frames_closed_ = true;
+  if (drop) {
+    dropped.swap(frames_);
+  }
+  frames_cv_.notify_all();
 }
 
 } // util
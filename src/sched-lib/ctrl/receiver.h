@@ -2,10 +2,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <condition_variable>
+#include <deque>
 
 #include "defs.h"
 #include "commands.h"
-#include "auxl/my_queue.h"
+#include "command_recorder.h"
+#include "service_metrics.h"
+#include "auxl/blocking_queue.h"
+#include "auxl/shm_ring.h"
+#include "ifaces/trace_interface.h"
 
 
 namespace swm {
@@ -13,26 +19,95 @@ namespace util {
 
 class Receiver {
  public:  
-  Receiver() : closed_(false), finished_(false), input_(nullptr), queue_(nullptr) { }
+  Receiver()
+      : closed_(false), finished_(false), input_(nullptr), ring_(nullptr), queue_(nullptr), control_queue_(nullptr),
+        frames_closed_(false), recorder_(nullptr), tracer_(nullptr), origin_(0), schedules_(0), commands_(0) { }
   Receiver(const Receiver &) = delete;
   void operator =(const Receiver &) = delete;
   ~Receiver();
 
-  void init(MyQueue<std::shared_ptr<CommandInterface>> *queue, std::istream *input);
+  // If "control_queue" is specified, interrupt, metrics and exchange commands are put there
+  // as soon as they are read, while schedule commands are parsed by the separate thread
+  void init(BlockingQueue<std::shared_ptr<CommandInterface>> *queue, std::istream *input,
+            BlockingQueue<std::shared_ptr<CommandInterface>> *control_queue = nullptr);
+  // Commands are decoded in place from the frames of the ring, every frame is released as soon as
+  // its command is parsed. Receiving is finished when the ring is closed and drained
+  void init_ring(BlockingQueue<std::shared_ptr<CommandInterface>> *queue, ShmRing *ring,
+                 BlockingQueue<std::shared_ptr<CommandInterface>> *control_queue = nullptr);
   bool finished();
+  void wait();                        // blocks caller until all data are received
+
+  // Commands are marked by "origin" to send their responses back. Must be set before init()
+  void   set_origin(size_t origin) { origin_ = origin; }
+  size_t get_origin() const { return origin_; }
+  // Every frame that is read is passed to the recorder. Must be set before init()
+  void set_recorder(CommandRecorder *recorder) { recorder_ = recorder; }
+  // Reading and parsing of commands are traced there, nullptr disables it. Must be set before init()
+  void set_tracer(TraceInterface *tracer) { tracer_ = tracer; }
+  // Latencies of reading and decoding of commands are recorded there. Must be set before init()
+  void set_metrics(const std::shared_ptr<ServiceMetrics> &metrics) { metrics_ = metrics; }
+  // Called by the worker thread once all data are received (see finished()). Must be set before init()
+  void set_finish_callback(const std::function<void()> &clb) { finish_clb_ = clb; }
+  // Commands put to the queues so far, every one gets exactly one response
+  size_t commands() const { return commands_; }
 
  private:
+  // Longer request identifier means the stream is corrupted
+  static constexpr uint32_t MAX_UID_LENGTH = 256;
+
+  // Command's data as it was read from the input, slices point to own buffers or to the ring
+  struct Frame {
+    Frame() : ring(nullptr) { }
+    ~Frame() { if (ring != nullptr) { ring->release(slot); } }
+
+    CommandType type;
+    SwmUID uid;
+    size_t schedules_before;
+    std::vector<std::unique_ptr<char[]>> buffers;
+    std::vector<char *> data;
+    std::vector<size_t> sizes;
+    ShmRing *ring;
+    ShmRing::Frame slot;
+  };
+
   bool get_data(std::vector<std::unique_ptr<char[]>> *data,
+                std::vector<size_t> *sizes,
                 CommandType *cmd,
                 SwmUID *uid,
                 std::stringstream *errors = nullptr);
+  bool get_ring_data(Frame *frame, std::stringstream *errors);
+  void record(const Frame &frame);
+  void start(BlockingQueue<std::shared_ptr<CommandInterface>> *queue,
+             BlockingQueue<std::shared_ptr<CommandInterface>> *control_queue);
+  std::shared_ptr<CommandInterface> parse(const Frame &frame, std::stringstream *errors);
   void worker_loop();
+  void parser_loop();
+  bool put_frame(const std::shared_ptr<Frame> &frame);
+  bool take_frame(std::shared_ptr<Frame> *frame);
+  void close_frames(bool drop);
 
   volatile bool closed_;              // forces the worker thread to stop
   volatile bool finished_;            // all data were wrapped into commands
   std::istream *input_;
-  MyQueue<std::shared_ptr<CommandInterface> > *queue_;
+  ShmRing *ring_;
+  BlockingQueue<std::shared_ptr<CommandInterface> > *queue_;
+  BlockingQueue<std::shared_ptr<CommandInterface> > *control_queue_;
+  // Schedules waiting for the parser, at most as many as the queue of schedule commands holds. Control
+  // frames that follow them are routed at once while the bound isn't reached, then the reader waits
+  std::deque<std::shared_ptr<Frame> > frames_;
+  std::mutex frames_mutex_;
+  std::condition_variable frames_cv_;      // frame was put or taken, or frames were closed
+  bool frames_closed_;                // no more frames will be put or taken
+  CommandRecorder *recorder_;
+  TraceInterface *tracer_;
+  std::shared_ptr<ServiceMetrics> metrics_;
+  std::function<void()> finish_clb_;
+  LatencyHistogram::clock::time_point frame_start_;   // the first byte of frame is read, worker thread only
+  size_t origin_;
+  size_t schedules_;                  // schedule commands read so far, worker thread only
+  std::atomic<size_t> commands_;
   std::thread worker_;
+  std::thread parser_;
 };
 
 } // util
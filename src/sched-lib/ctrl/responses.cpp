@@ -1,6 +1,8 @@
 
 #include "responses.h"
 
+#include <algorithm>
+
 #include "constants.h"
 #include "chn/metrics_snapshot.h"
 
@@ -31,7 +33,11 @@ ei_x_buff ResponseInterface::make_timetables_ei_buffer(
     *errors << "Can't create new ei_x_buff for timetables" << std::endl;
     return x;
   }
-  if (ei_x_encode_list_header(&x, timetables.size())) {
+  // Timetables without nodes are not sent, the header must count only the encoded ones
+  const auto count = std::count_if(timetables.begin(), timetables.end(), [](const SwmTimetable &table) -> bool {
+    return !table.get_job_nodes().empty();
+  });
+  if (ei_x_encode_list_header(&x, count)) {
     *errors << "Can't create timetables: can't encode list header" << std::endl;
     ei_x_free(&x);
     return x;
@@ -71,6 +77,7 @@ ei_x_buff ResponseInterface::make_timetables_ei_buffer(
     }
     for (size_t i = 0; i < nodes_cnt; ++i) {
       if (ei_x_encode_string(&x, nodes[nodes_cnt - i - 1].c_str())) {
+        *errors << "Can't create timetable: can't encode node" << std::endl;
         ei_x_free(&x);
         return x;
       }
@@ -82,7 +89,7 @@ ei_x_buff ResponseInterface::make_timetables_ei_buffer(
     }
   }
 
-  if (timetables.size() && ei_x_encode_empty_list(&x)) {
+  if (count != 0 && ei_x_encode_empty_list(&x)) {
     *errors << "Can't create timetables list: can't encode last element" << std::endl;
     ei_x_free(&x);
   }
@@ -212,8 +219,9 @@ ei_x_buff ResponseInterface::make_scheduler_result_ei_buffer(const std::vector<S
 
 TimetableResponse::TimetableResponse(const std::shared_ptr<CommandContext> &context,
                                      const std::shared_ptr<swm::TimetableInfoInterface> &tables_info,
-                                     const std::shared_ptr<MetricsSnapshot> &metrics)
-      : context_(context), metrics_(metrics) {
+                                     const std::shared_ptr<MetricsSnapshot> &metrics,
+                                     bool partial)
+      : context_(context), metrics_(metrics), partial_(partial) {
   result_.set_request_id(context_->id());
 
   const auto ttp = tables_info->tables();
@@ -223,7 +231,7 @@ TimetableResponse::TimetableResponse(const std::shared_ptr<CommandContext> &cont
     tt.push_back(*t);
   }
   result_.set_timetable(tt);
-  result_.set_status(succeeded());
+  result_.set_status(partial_ ? SWM_RESULT_PARTIAL : SWM_RESULT_SUCCEEDED);
   result_.print("   ", '\n');
 }
 
@@ -246,31 +254,163 @@ bool TimetableResponse::serialize(std::unique_ptr<char[]> *data,
   return x.buff != nullptr;
 }
 
+//-----------------------------
+//--- TimetableDiffResponse ---
+//-----------------------------
+
+TimetableDiffResponse::TimetableDiffResponse(const std::shared_ptr<CommandContext> &context,
+                                             const SwmUID &base_request_id,
+                                             const TimetableHistory::Snapshot &base,
+                                             const TimetableHistory::Snapshot &current,
+                                             const std::shared_ptr<MetricsSnapshot> &metrics,
+                                             bool partial)
+      : context_(context), metrics_(metrics), base_request_id_(base_request_id), partial_(partial) {
+  result_.set_request_id(context_->id());
+  result_.set_status(partial_ ? SWM_RESULT_PARTIAL : SWM_RESULT_SUCCEEDED);
+
+  // Timetables without nodes are not sent, so for the client such jobs are removed
+  for (const auto &rec : current) {
+    if (rec.second.get_job_nodes().empty()) {
+      continue;
+    }
+    auto it = base.find(rec.first);
+    if (it == base.end()) {
+      added_.push_back(rec.second);
+    }
+    else if (it->second.get_start_time() != rec.second.get_start_time() ||
+             it->second.get_job_nodes() != rec.second.get_job_nodes()) {
+      changed_.push_back(rec.second);
+    }
+  }
+  for (const auto &rec : base) {
+    auto it = current.find(rec.first);
+    if (!rec.second.get_job_nodes().empty() && (it == current.end() || it->second.get_job_nodes().empty())) {
+      removed_.push_back(rec.first);
+    }
+  }
+}
+
+bool TimetableDiffResponse::serialize(std::unique_ptr<char[]> *data,
+                                      size_t *size,
+                                      std::stringstream *errors) {
+  if (data == nullptr || size == nullptr) {
+    throw std::runtime_error(
+      "TimetableDiffResponse::serialize(): \"data\" and \"size\" cannot be equal to nullptr");
+  }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  refresh_timers();
+
+  ei_x_buff added_buff = make_timetables_ei_buffer(added_, errors);
+  ei_x_buff changed_buff = make_timetables_ei_buffer(changed_, errors);
+  ei_x_buff metrics_buff = make_metrics_ei_buffer(result_.get_metrics(), errors);
+
+  ei_x_buff x;
+  bool ok = ei_x_new_with_version(&x) == 0 &&
+            ei_x_encode_tuple_header(&x, SwmSchedulerResultDiffTupleSize) == 0 &&
+            ei_x_encode_atom(&x, "scheduler_result_diff") == 0 &&
+            ei_x_append(&x, &added_buff) == 0 &&
+            ei_x_encode_list_header(&x, (long)removed_.size()) == 0;
+  for (size_t i = 0; ok && i < removed_.size(); ++i) {
+    ok = ei_x_encode_string(&x, removed_[i].c_str()) == 0;
+  }
+  ok = ok && (removed_.empty() || ei_x_encode_empty_list(&x) == 0) &&
+       ei_x_append(&x, &changed_buff) == 0 &&
+       ei_x_append(&x, &metrics_buff) == 0 &&
+       ei_x_encode_string(&x, base_request_id_.c_str()) == 0 &&
+       ei_x_encode_string(&x, result_.get_request_id().c_str()) == 0 &&
+       ei_x_encode_long(&x, result_.get_status()) == 0 &&
+       ei_x_encode_double(&x, result_.get_astro_time()) == 0 &&
+       ei_x_encode_double(&x, result_.get_idle_time()) == 0 &&
+       ei_x_encode_double(&x, result_.get_work_time()) == 0;
+
+  ei_x_free(&added_buff);
+  ei_x_free(&changed_buff);
+  ei_x_free(&metrics_buff);
+  if (!ok) {
+    *errors << "Can't create scheduler result diff" << std::endl;
+    ei_x_free(&x);
+    return false;
+  }
+
+  data->reset(x.buff);
+  *size = x.index;
+  return true;
+}
+
 //-----------------------
 //--- MetricsResponse ---
 //-----------------------
 
-bool MetricsResponse::serialize(std::unique_ptr<char[]> *data, size_t *size, std::stringstream *) {
+bool MetricsResponse::serialize(std::unique_ptr<char[]> *data, size_t *size, std::stringstream *errors) {
   if (data == nullptr || size == nullptr) {
     throw std::runtime_error("MetricsResponse::serialize(): \"data\" and \"size\" cannot be equal to nullptr");
   }
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+  if (!reply_) {
+    data->reset(nullptr);
+    *size = 0;
+    return true;
+  }
 
-  //TODO: we need to serialize request with metrics only
-  //auto alg_metrics = metrics_->algorithm_metrics(); // per algorithm metrics
-  //auto chain_metrics = metrics_->chain_metrics();   // chain metrics
-  //auto serv_metrics = metrics_->service_metrics();  // global service metrics
+  // Only global service metrics are sent for now, integers and doubles by their names
+  std::vector<SwmMetric> metrics;
+  if (metrics_.get() != nullptr) {
+    const MetricsInterface &service = metrics_->service_metrics();
+    for (const auto &index : service.int_value_indices()) {
+      SwmMetric metric;
+      metric.set_name(index.second);
+      metric.set_value_integer((uint64_t)std::max(service.int_value(index.first), 0));
+      metric.set_value_float64(0.0);
+      metrics.push_back(metric);
+    }
+    for (const auto &index : service.double_value_indices()) {
+      SwmMetric metric;
+      metric.set_name(index.second);
+      metric.set_value_integer(0);
+      metric.set_value_float64(service.double_value(index.first));
+      metrics.push_back(metric);
+    }
+  }
 
-  // Enumeration can be implemented as:
-  //auto en = chain_metrics.int_value_indices();
-  //for (const auto rec : en) {
-  //  auto ival = chain_metrics.int_value(rec.first);
-  //  auto name = rec.second;
-  //}
-  // And the same for double values (if needed)
+  result_.set_request_id(context_->id());
+  result_.set_status(SWM_RESULT_SUCCEEDED);
+  result_.set_metrics(metrics);
+  refresh_timers();
+  const ei_x_buff x = make_scheduler_result_ei_buffer({}, result_.get_metrics(), errors);
+  data->reset(x.buff);
+  *size = x.index;
+  return x.buff != nullptr;
+}
 
-  data->reset(nullptr);
-  *size = 0;
-  return true;
+//------------------------
+//--- EstimateResponse ---
+//------------------------
+
+EstimateResponse::EstimateResponse(const std::shared_ptr<CommandContext> &context,
+                                   const std::vector<SwmTimetable> &estimates)
+    : context_(context) {
+  result_.set_request_id(context_->id());
+  result_.set_timetable(estimates);
+  result_.set_status(SWM_RESULT_SUCCEEDED);
+}
+
+bool EstimateResponse::serialize(std::unique_ptr<char[]> *data,
+                                 size_t *size,
+                                 std::stringstream *errors) {
+  if (data == nullptr || size == nullptr) {
+    throw std::runtime_error(
+      "EstimateResponse::serialize(): \"data\" and \"size\" cannot be equal to nullptr");
+  }
+  const ei_x_buff x = make_scheduler_result_ei_buffer(result_.get_timetable(), {}, errors);
+  data->reset(x.buff);
+  *size = x.index;
+  return x.buff != nullptr;
 }
 
 //---------------------
@@ -290,5 +430,52 @@ bool EmptyResponse::serialize(std::unique_ptr<char[]> *data,
   return x.buff != nullptr;
 }
 
+//--------------------------
+//--- SupersededResponse ---
+//--------------------------
+
+SupersededResponse::SupersededResponse(const std::shared_ptr<CommandContext> &context,
+                                       const SwmUID &superseded_by)
+    : context_(context), superseded_by_(superseded_by) {
+  result_.set_request_id(context_->id());
+  result_.set_status(SWM_RESULT_SUPERSEDED);
+}
+
+bool SupersededResponse::serialize(std::unique_ptr<char[]> *data,
+                                   size_t *size,
+                                   std::stringstream *errors) {
+  if (data == nullptr || size == nullptr) {
+    throw std::runtime_error(
+      "SupersededResponse::serialize(): \"data\" and \"size\" cannot be equal to nullptr");
+  }
+  const ei_x_buff x =  make_scheduler_result_ei_buffer({}, {}, errors);
+  data->reset(x.buff);
+  *size = x.index;
+  return x.buff != nullptr;
+}
+
+//------------------------
+//--- TooLargeResponse ---
+//------------------------
+
+TooLargeResponse::TooLargeResponse(const std::shared_ptr<CommandContext> &context)
+    : context_(context) {
+  result_.set_request_id(context_->id());
+  result_.set_status(SWM_RESULT_TOO_LARGE);
+}
+
+bool TooLargeResponse::serialize(std::unique_ptr<char[]> *data,
+                                 size_t *size,
+                                 std::stringstream *errors) {
+  if (data == nullptr || size == nullptr) {
+    throw std::runtime_error(
+      "TooLargeResponse::serialize(): \"data\" and \"size\" cannot be equal to nullptr");
+  }
+  const ei_x_buff x =  make_scheduler_result_ei_buffer({}, {}, errors);
+  data->reset(x.buff);
+  *size = x.index;
+  return x.buff != nullptr;
+}
+
 } // util
 } // swm
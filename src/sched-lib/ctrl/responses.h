@@ -3,6 +3,7 @@
 
 #include "defs.h"
 #include "command_context.h"
+#include "timetable_history.h"
 #include "ifaces/timetable_info_interface.h"
 
 #include "wm_scheduler_result.h"
@@ -33,25 +34,53 @@ class ResponseInterface {
                                std::unique_ptr<char[]> *data,
                                std::stringstream *errors) const;
   void refresh_timers();
+  ei_x_buff make_timetables_ei_buffer(const std::vector<SwmTimetable> &timetables, std::stringstream *errors) const;
+  ei_x_buff make_metrics_ei_buffer(const std::vector<SwmMetric> &metrics, std::stringstream *errors) const;
 
   SwmSchedulerResult result_;
 
  friend class Sender;
-
- private:
-  ei_x_buff make_timetables_ei_buffer(const std::vector<SwmTimetable> &timetables, std::stringstream *errors) const;
-  ei_x_buff make_metrics_ei_buffer(const std::vector<SwmMetric> &metrics, std::stringstream *errors) const;
 };
 
 
+// Partial timetable is the best-so-far result of interrupted scheduling, it's sent with SWM_RESULT_PARTIAL
 class TimetableResponse : public ResponseInterface {
  public:
   TimetableResponse(const std::shared_ptr<CommandContext> &context,
                     const std::shared_ptr<swm::TimetableInfoInterface>&,
-                    const std::shared_ptr<MetricsSnapshot> &metrics);
+                    const std::shared_ptr<MetricsSnapshot> &metrics,
+                    bool partial = false);
+
+  virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
+  virtual bool succeeded() const override { return !partial_; }
+  bool partial() const { return partial_; }
+
+ private:
+  virtual bool serialize(std::unique_ptr<char[]> *data,
+                         size_t *size, std::stringstream *errors) override;
+
+  std::shared_ptr<CommandContext> context_;
+  std::shared_ptr<MetricsSnapshot> metrics_;
+  bool partial_;
+};
+
+// Only added, removed and changed timetables relative to the result already applied by client
+class TimetableDiffResponse : public ResponseInterface {
+ public:
+  TimetableDiffResponse(const std::shared_ptr<CommandContext> &context,
+                        const SwmUID &base_request_id,
+                        const TimetableHistory::Snapshot &base,
+                        const TimetableHistory::Snapshot &current,
+                        const std::shared_ptr<MetricsSnapshot> &metrics,
+                        bool partial = false);
 
   virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
-  virtual bool succeeded() const override { return true; }
+  virtual bool succeeded() const override { return !partial_; }
+  bool partial() const { return partial_; }
+
+  const std::vector<SwmTimetable> &added() const { return added_; }
+  const std::vector<std::string> &removed() const { return removed_; }
+  const std::vector<SwmTimetable> &changed() const { return changed_; }
 
  private:
   virtual bool serialize(std::unique_ptr<char[]> *data,
@@ -59,13 +88,20 @@ class TimetableResponse : public ResponseInterface {
 
   std::shared_ptr<CommandContext> context_;
   std::shared_ptr<MetricsSnapshot> metrics_;
+  SwmUID base_request_id_;
+  bool partial_;
+  std::vector<SwmTimetable> added_;
+  std::vector<std::string> removed_;
+  std::vector<SwmTimetable> changed_;
 };
 
+// Service metrics are sent in a scheduler_result only if "reply" is set, nothing is sent otherwise
+// (the original protocol has no answer to the metrics command)
 class MetricsResponse : public ResponseInterface {
  public:
   MetricsResponse(const std::shared_ptr<CommandContext> &context,
-                  const std::shared_ptr<MetricsSnapshot> &metrics)
-      : context_(context), metrics_(metrics) { }
+                  const std::shared_ptr<MetricsSnapshot> &metrics, bool reply = false)
+      : context_(context), metrics_(metrics), reply_(reply) { }
 
   virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
   virtual bool succeeded() const override { return true; };
@@ -75,6 +111,23 @@ class MetricsResponse : public ResponseInterface {
                          std::stringstream *errors) override;
   std::shared_ptr<CommandContext> context_;
   std::shared_ptr<MetricsSnapshot> metrics_;
+  bool reply_;
+};
+
+
+// Estimated start of every candidate job that fits the cluster, in the format of timetable
+class EstimateResponse : public ResponseInterface {
+ public:
+  EstimateResponse(const std::shared_ptr<CommandContext> &context, const std::vector<SwmTimetable> &estimates);
+
+  virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
+  virtual bool succeeded() const override { return true; };
+  const std::vector<SwmTimetable> &estimates() const { return result_.get_timetable(); }
+
+ private:
+  virtual bool serialize(std::unique_ptr<char[]> *data, size_t *size,
+                         std::stringstream *errors) override;
+  std::shared_ptr<CommandContext> context_;
 };
 
 
@@ -94,5 +147,37 @@ class EmptyResponse : public ResponseInterface {
   bool succeeded_;
 };
 
+// Schedule request was not completed because a newer one for the same scope replaced it,
+// client must wait for the result of the newer request
+class SupersededResponse : public ResponseInterface {
+ public:
+  SupersededResponse(const std::shared_ptr<CommandContext> &context, const SwmUID &superseded_by);
+
+  virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
+  virtual bool succeeded() const override { return false; };
+  const SwmUID &superseded_by() const { return superseded_by_; }
+
+ private:
+  virtual bool serialize(std::unique_ptr<char[]> *data, size_t *size,
+                         std::stringstream *errors) override;
+  std::shared_ptr<CommandContext> context_;
+  SwmUID superseded_by_;
+};
+
+// Result was ready, but it's larger than the transport can pass (frame of the shared memory ring),
+// it's sent with SWM_RESULT_TOO_LARGE instead
+class TooLargeResponse : public ResponseInterface {
+ public:
+  explicit TooLargeResponse(const std::shared_ptr<CommandContext> &context);
+
+  virtual const std::shared_ptr<CommandContext> &context() const override { return context_; }
+  virtual bool succeeded() const override { return false; };
+
+ private:
+  virtual bool serialize(std::unique_ptr<char[]> *data, size_t *size,
+                         std::stringstream *errors) override;
+  std::shared_ptr<CommandContext> context_;
+};
+
 } // util
 } // swm
@@ -4,6 +4,12 @@
 namespace swm {
 namespace util {
 
+SchedulingInfo::SchedulingInfo(const SchedulingInfo &other)
+    : are_references_valid_(false), grid_(other.grid_), rh_(other.rh_), clusters_(other.clusters_),
+      parts_(other.parts_), nodes_(other.nodes_), jobs_(other.jobs_) {
+  validate_references();
+}
+
 const std::vector<const SwmCluster *> &SchedulingInfo::clusters() const {
   if (!are_references_valid_) {
     throw std::runtime_error("SchedulingInfo::clusters(): references must be validated first");
@@ -11,6 +11,9 @@ namespace util {
 class SchedulingInfo : public SchedulingInfoInterface {
  public:
   SchedulingInfo() : are_references_valid_(true) { };
+  // Deep copy with own references, allocated by the calling thread (e.g. on its NUMA node)
+  SchedulingInfo(const SchedulingInfo &other);
+  void operator =(const SchedulingInfo &) = delete;
 
   virtual const SwmGrid *grid() const override { return &grid_; }
   void set_grid(const SwmGrid &grid) { grid_ = grid; }
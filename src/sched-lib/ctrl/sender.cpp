@@ -1,7 +1,9 @@
 
 #include "sender.h"
 
-#include <thread> // for sleep
+#include <string.h>
+
+#include "auxl/term_compression.h"
 
 namespace swm {
 namespace util {
@@ -13,8 +15,9 @@ Sender::~Sender() {
   }
 }
 
-void Sender::init(MyQueue<std::shared_ptr<ResponseInterface> > *queue, std::ostream *output) {
-  if (queue_ != nullptr || output_ != nullptr) {
+void Sender::init(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue, std::ostream *output,
+                  const std::shared_ptr<ServiceMetrics> &metrics) {
+  if (queue_ != nullptr || output_ != nullptr || ring_ != nullptr) {
     throw std::runtime_error("Sender::init(): object was already initialized");
   }
   if (queue == nullptr || output == nullptr) {
@@ -24,12 +27,30 @@ void Sender::init(MyQueue<std::shared_ptr<ResponseInterface> > *queue, std::ostr
 
   queue_ = queue;
   output_ = output;
+  metrics_ = metrics;
+  closed_ = false;
+  worker_ = std::thread([me = this]() -> void { me->worker_thread(); });
+}
+
+void Sender::init_ring(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue, ShmRing *ring,
+                       const std::shared_ptr<ServiceMetrics> &metrics) {
+  if (queue_ != nullptr || output_ != nullptr || ring_ != nullptr) {
+    throw std::runtime_error("Sender::init_ring(): object was already initialized");
+  }
+  if (queue == nullptr || ring == nullptr) {
+    throw std::runtime_error(
+      "Sender::init_ring(): \"queue\" and \"ring\" cannot be equal to nullptr");
+  }
+
+  queue_ = queue;
+  ring_ = ring;
+  metrics_ = metrics;
   closed_ = false;
   worker_ = std::thread([me = this]() -> void { me->worker_thread(); });
 }
 
 void Sender::close() {
-  if (queue_ == nullptr || output_ == nullptr) {
+  if (queue_ == nullptr) {
     throw std::runtime_error("Sender::close(): object must be initialized first");
   }
 
@@ -40,27 +61,71 @@ void Sender::close() {
 
   queue_ = nullptr;
   output_ = nullptr;
+  ring_ = nullptr;
+  metrics_.reset();
+}
+
+void Sender::compress(std::unique_ptr<char[]> *data, size_t *size) {
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<char[]> compressed;
+  size_t compressed_size = 0;
+  std::stringstream errors;
+  const bool done = compress_term(data->get(), *size, COMPRESSION_LEVEL,
+                                  &compressed, &compressed_size, &errors);
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  if (!done && !errors.str().empty()) {
+    std::cerr << "Sender::compress(): response is sent uncompressed, " << errors.str() << std::endl;
+  }
+  if (metrics_.get() != nullptr) {
+    metrics_->update_compression(*size, done ? compressed_size : *size, elapsed.count(), done);
+  }
+  if (done) {
+    *data = std::move(compressed);
+    *size = compressed_size;
+  }
+}
+
+// Encoded response is copied to the ring once, no system calls unless the client sleeps
+bool Sender::put_frame(const char *data, size_t size) {
+  char *frame = ring_->reserve(size, -1.0);
+  if (frame == nullptr) {
+    return false;
+  }
+  memcpy(frame, data, size);
+  ring_->commit();
+  return true;
 }
 
 void Sender::worker_thread() {
-  while (!closed_ || queue_->element_count() > 0) {
-    if (queue_->element_count() > 0) {
-      try {
-        auto resp = queue_->pop();
-        if (resp.get() == nullptr) {
-          std::cerr << "Sender::worker_thread(): received nullptr instead of response, "
-                    << "looks like it's a bug" << std::endl;
-          continue;
-        }
+  // Stop when: owner called close() or closed the queue, and all responses are sent
+  while ((!closed_ && !queue_->closed()) || queue_->element_count() > 0) {
+    std::shared_ptr<ResponseInterface> resp;
+    if (!queue_->pop_for(&resp, std::chrono::milliseconds(100))) {
+      continue;
+    }
+
+    try {
+      if (resp.get() == nullptr) {
+        std::cerr << "Sender::worker_thread(): received nullptr instead of response, "
+                  << "looks like it's a bug" << std::endl;
+        continue;
+      }
 
-        if (!resp->succeeded()) {
-          std::cerr << "Sender::worker_thread(): response was not successfully formed "
-                    << "(UID=" << resp->context()->id() << ")" << std::endl;
-          continue;
+      if (!resp->succeeded()) {
+        std::cerr << "Sender::worker_thread(): response was not successfully formed "
+                  << "(UID=" << resp->context()->id() << ")" << std::endl;
+        if (recorder_ != nullptr) {
+          recorder_->complete(resp->context()->origin(), resp->context()->id());
         }
+        continue;
+      }
 
-        std::unique_ptr<char[]> data;
-        size_t size = 0;
+      std::unique_ptr<char[]> data;
+      size_t size = 0;
+      {
+        LatencyHistogram::Scope encode(metrics_.get() != nullptr ? metrics_->latency(ServiceMetrics::ENCODE) : nullptr);
+        TraceSpan span(tracer_, "sender.encode");
         std::stringstream errors;
         if (!resp->serialize(&data, &size, &errors)) {
           std::cerr << "Sender::worker_thread(): failed to serialize response (UID="
@@ -68,19 +133,38 @@ void Sender::worker_thread() {
           size = 0;
         }
 
-        if (size != 0) {
-          if (!swm_write_exact(output_, data.get(), size)) {
-            std::cerr << "Sender::worker_thread(): failed to send serialized response data (UID="
-                      << resp->context()->id() << ")" << std::endl;
+        if (compression_threshold_ != 0 && size >= compression_threshold_) {
+          compress(&data, &size);
+        }
+
+        // Client is told that the result is lost, so it doesn't wait for it
+        if (ring_ != nullptr && size > ring_->max_frame_size()) {
+          std::cerr << "Sender::worker_thread(): response of " << size << " bytes doesn't fit into the ring (UID="
+                    << resp->context()->id() << "), sending an error instead" << std::endl;
+          std::shared_ptr<ResponseInterface> too_large(new TooLargeResponse(resp->context()));
+          if (!too_large->serialize(&data, &size, &errors)) {
+            std::cerr << "Sender::worker_thread(): failed to serialize response (UID="
+                      << resp->context()->id() << "): " << errors.str().c_str() << std::endl;
+            size = 0;
           }
         }
-      } catch (std::exception &ex) {
-        std::cerr << "Exception from Sender::worker_thread(): " << ex.what() << std::endl;
       }
-    } else {
-      std::this_thread::yield();
+
+      if (size != 0) {
+        LatencyHistogram::Scope send(metrics_.get() != nullptr ? metrics_->latency(ServiceMetrics::SEND) : nullptr);
+        TraceSpan span(tracer_, "sender.send");
+        const bool sent = ring_ != nullptr ? put_frame(data.get(), size) : swm_write_exact(output_, data.get(), size);
+        if (!sent) {
+          std::cerr << "Sender::worker_thread(): failed to send serialized response data (UID="
+                    << resp->context()->id() << ")" << std::endl;
+        }
+      }
+      if (recorder_ != nullptr) {
+        recorder_->complete(resp->context()->origin(), resp->context()->id());
+      }
+    } catch (std::exception &ex) {
+      std::cerr << "Exception from Sender::worker_thread(): " << ex.what() << std::endl;
     }
-    std::this_thread::sleep_for (std::chrono::seconds(1)); // FIXME
   }
 }
 
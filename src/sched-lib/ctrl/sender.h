@@ -3,27 +3,56 @@
 
 #include "defs.h"
 #include "responses.h"
-#include "auxl/my_queue.h"
+#include "service_metrics.h"
+#include "command_recorder.h"
+#include "auxl/blocking_queue.h"
+#include "auxl/shm_ring.h"
+#include "ifaces/trace_interface.h"
 
 namespace swm {
 namespace util {
 
 class Sender {
  public:
-  Sender() : closed_(false), output_(nullptr), queue_(nullptr) { }
+  Sender()
+      : closed_(false), compression_threshold_(0), recorder_(nullptr), tracer_(nullptr), output_(nullptr),
+        ring_(nullptr), queue_(nullptr) { }
   Sender(const Sender &) = delete;
   ~Sender();
   void operator =(const Sender &) = delete;
 
-  void init(MyQueue<std::shared_ptr<ResponseInterface> > *queue, std::ostream *output);
+  void init(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue, std::ostream *output,
+            const std::shared_ptr<ServiceMetrics> &metrics = nullptr);
+  // Every response is put into a frame of the ring, waits while the ring is full
+  void init_ring(BlockingQueue<std::shared_ptr<ResponseInterface> > *queue, ShmRing *ring,
+                 const std::shared_ptr<ServiceMetrics> &metrics = nullptr);
   void close();
 
+  // Responses of at least "bytes" size are sent as compressed terms, 0 disables compression
+  void   set_compression_threshold(size_t bytes) { compression_threshold_ = bytes; }
+  size_t get_compression_threshold() const { return compression_threshold_; }
+
+  // Recorder is told about every response when it's sent (or dropped). Must be set before init()
+  void set_recorder(CommandRecorder *recorder) { recorder_ = recorder; }
+  // Encoding and sending of responses are traced there, nullptr disables it. Must be set before init()
+  void set_tracer(TraceInterface *tracer) { tracer_ = tracer; }
+
  private:
+  // Fast level is preferred, repeated node identifiers are squeezed well anyway
+  static constexpr int COMPRESSION_LEVEL = 1;
+
   void worker_thread();
-  
+  void compress(std::unique_ptr<char[]> *data, size_t *size);
+  bool put_frame(const char *data, size_t size);
+
   volatile bool closed_;                     // forces the worker thread to stop
+  size_t compression_threshold_;
+  std::shared_ptr<ServiceMetrics> metrics_;
+  CommandRecorder *recorder_;
+  TraceInterface *tracer_;
   std::ostream *output_;
-  MyQueue<std::shared_ptr<ResponseInterface> > *queue_;
+  ShmRing *ring_;
+  BlockingQueue<std::shared_ptr<ResponseInterface> > *queue_;
   std::thread worker_;
 };
 
@@ -1,35 +1,416 @@
-
 #include "service.h"
 
 #include <algorithm>
+#include <chrono>
+#include <deque>
 
 #include "receiver.h"
 #include "processor.h"
 #include "sender.h"
+#include "auxl/tracer.h"
+#include "auxl/unix_socket.h"
 #include "chn/metrics_snapshot.h"
 
 using namespace swm;
 
-void Service::main_loop() {
-  util::MyQueue<std::shared_ptr<util::CommandInterface>> in_queue(in_queue_size_);
-  util::MyQueue<std::shared_ptr<util::ResponseInterface>> out_queue(out_queue_size_);
+// Client of server mode, the socket is read by receiver and written by sender
+struct Service::Connection {
+  Connection(int socket, size_t queue_size)
+      : fd(socket), buffer(socket), input(&buffer), output(&buffer), responses(queue_size), routed(0),
+        dropped(false) { }
 
-  // Start processing asynchronously
+  int fd;
+  util::SocketStreamBuf buffer;
+  std::istream input;
+  std::ostream output;
+  util::BlockingQueue<std::shared_ptr<util::ResponseInterface>> responses;
+  size_t routed;                      // responses passed to sender or dropped, guarded by connections' mutex
+  bool dropped;                       // client was too slow and was disconnected, router's thread only
+  std::deque<std::shared_ptr<util::ResponseInterface>> pending;   // didn't fit into responses, router's only
+  std::chrono::steady_clock::time_point progress;   // when the pending ones last moved, router's only
   util::Receiver receiver;
-  receiver.init(&in_queue, input_);
+  util::Sender sender;
+};
+
+// Responses go back to the connections their commands came from, the ones of gone clients are dropped.
+// Connection is not released while its response is being routed: the response is not counted yet.
+// Router never waits for a client, so the slow one doesn't hold the responses of the others: the
+// responses that don't fit into its queue are kept until it takes some or stalls for too long.
+// Accepting loop is woken up when a connection may be released
+class Service::Router {
+ public:
+  Router(util::BlockingQueue<std::shared_ptr<util::ResponseInterface>> *responses, std::mutex *mutex,
+         std::unordered_map<size_t, std::unique_ptr<Connection>> *connections,
+         util::UnixSocketListener *listener, double stall_timeout)
+      : responses_(responses), mutex_(mutex), connections_(connections), listener_(listener),
+        stall_timeout_(stall_timeout) { }
+  Router(const Router &) = delete;
+  void operator =(const Router &) = delete;
+
+  // Returns when "responses" is closed and drained and nothing is pending
+  void run() {
+    std::shared_ptr<util::ResponseInterface> resp;
+    std::chrono::duration<double> period(RETRY_PERIOD);
+    while (true) {
+      const bool closed = responses_->closed();
+      if (responses_->pop_for(&resp, period)) {
+        route(resp);
+      }
+      else if (closed) {
+        if (stalled_.empty()) {
+          return;
+        }
+        std::this_thread::sleep_for(period);
+      }
+      // Client that has just taken some of its pending responses is likely to take the next ones soon
+      period = std::chrono::duration<double>(!stalled_.empty() && retry() ? DRAIN_PERIOD : RETRY_PERIOD);
+    }
+  }
+
+ private:
+  static constexpr double RETRY_PERIOD = 0.05;
+  static constexpr double DRAIN_PERIOD = 0.001;
+
+  void route(const std::shared_ptr<util::ResponseInterface> &resp) {
+    Connection *conn = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(*mutex_);
+      auto it = connections_->find(resp->context()->origin());
+      if (it != connections_->end()) {
+        conn = it->second.get();
+      }
+    }
+    if (conn == nullptr) {
+      return;
+    }
+    if (conn->dropped || (conn->pending.empty() && conn->responses.try_push(resp))) {
+      count(conn, 1);
+      return;
+    }
+    if (conn->pending.empty()) {
+      conn->progress = std::chrono::steady_clock::now();
+      stalled_.push_back(conn);
+    }
+    conn->pending.push_back(resp);
+  }
+
+  // True if some pending responses were passed to senders.
+  // Connection may be released once the last of its responses is counted
+  bool retry() {
+    const auto now = std::chrono::steady_clock::now();
+    bool moved = false;
+    for (auto it = stalled_.begin(); it != stalled_.end(); ) {
+      Connection *conn = *it;
+      size_t routed = 0;
+      while (!conn->pending.empty() && conn->responses.try_push(conn->pending.front())) {
+        conn->pending.pop_front();
+        ++routed;
+      }
+      if (routed != 0) {
+        conn->progress = now;
+        moved = true;
+      }
+      else if (now - conn->progress > std::chrono::duration<double>(stall_timeout_)) {
+        std::cerr << "Service::server_loop(): client #" << conn->pending.front()->context()->origin()
+                  << " doesn't read its responses, disconnecting it" << std::endl;
+        conn->dropped = true;
+        util::UnixSocketListener::disconnect(conn->fd);
+        routed = conn->pending.size();
+        conn->pending.clear();
+      }
+      it = conn->pending.empty() ? stalled_.erase(it) : it + 1;
+      if (routed != 0) {
+        count(conn, routed);
+      }
+    }
+    return moved;
+  }
+
+  void count(Connection *conn, size_t routed) {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    conn->routed += routed;
+    if (conn->receiver.finished() && conn->routed == conn->receiver.commands()) {
+      listener_->wake();
+    }
+  }
+
+  util::BlockingQueue<std::shared_ptr<util::ResponseInterface>> *responses_;
+  std::mutex *mutex_;
+  std::unordered_map<size_t, std::unique_ptr<Connection>> *connections_;    // guarded by mutex_
+  util::UnixSocketListener *listener_;
+  double stall_timeout_;
+  std::vector<Connection *> stalled_;       // connections with pending responses
+};
+
+bool Service::main_loop() {
+  util::CommandRecorder recorder;
+  util::CommandRecorder *used_recorder = nullptr;
+  if (!record_path_.empty()) {
+    std::stringstream errors;
+    if (!recorder.open(record_path_, record_slow_threshold_, &errors)) {
+      std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+      return false;
+    }
+    used_recorder = &recorder;
+  }
+
+  // Empty trace is written right away, so the wrong path is reported before the work
+  std::unique_ptr<util::Tracer> tracer;
+  if (!trace_path_.empty()) {
+    std::stringstream errors;
+    tracer.reset(new util::Tracer());
+    if (!tracer->dump(trace_path_, &errors)) {
+      std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(trace_mutex_);
+    tracer_ = tracer.get();
+  }
+
+  bool succeeded = true;
+  if (!socket_path_.empty()) {
+    succeeded = server_loop(used_recorder, tracer.get());
+  }
+  else if (!shm_path_.empty()) {
+    succeeded = shm_loop(used_recorder, tracer.get());
+  }
+  else {
+    stream_loop(used_recorder, tracer.get(), command_ring_, response_ring_);
+  }
+
+  // All threads of the loop are joined, nobody traces anymore
+  if (tracer.get() != nullptr) {
+    {
+      std::lock_guard<std::mutex> lock(trace_mutex_);
+      tracer_ = nullptr;
+    }
+    std::stringstream errors;
+    if (!tracer->dump(trace_path_, &errors)) {
+      std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+      succeeded = false;
+    }
+  }
+  return succeeded;
+}
+
+bool Service::dump_trace(std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  std::lock_guard<std::mutex> lock(trace_mutex_);
+  if (tracer_ == nullptr) {
+    *errors << "tracing is not active";
+    return false;
+  }
+  return tracer_->dump(trace_path_, errors);
+}
+
+void Service::stop() {
+  stopped_ = true;
+  std::lock_guard<std::mutex> lock(stop_mutex_);
+  if (listener_ != nullptr) {
+    listener_->wake();
+  }
+  if (shm_commands_ != nullptr) {
+    shm_commands_->interrupt();
+  }
+}
+
+void Service::configure(util::Processor *processor) const {
+  processor->set_inline_threshold(inline_threshold_);
+  processor->set_coalescing(coalescing_);
+  processor->set_memoization(memoization_capacity_, memoization_ttl_);
+  processor->set_metrics_replies(metrics_replies_);
+}
+
+void Service::stream_loop(util::CommandRecorder *recorder, TraceInterface *tracer,
+                          util::ShmRing *commands, util::ShmRing *responses) {
+  util::BlockingQueue<std::shared_ptr<util::CommandInterface>> in_queue(in_queue_size_);
+  util::BlockingQueue<std::shared_ptr<util::CommandInterface>> control_queue(in_queue_size_);
+  util::BlockingQueue<std::shared_ptr<util::ResponseInterface>> out_queue(out_queue_size_);
 
+  // Start processing asynchronously. Interrupts and other small commands have their own lane,
+  // so they don't wait for parsing and setup of large schedule commands
   util::Processor processor;
-  processor.init(factory_, scanner_, &in_queue, &out_queue, timeout_);
+  configure(&processor);
+  processor.set_tracer(tracer);
+  processor.init(factory_, scanner_, &in_queue, &out_queue, timeout_, &control_queue);
+
+  util::Receiver receiver;
+  receiver.set_recorder(recorder);
+  receiver.set_tracer(tracer);
+  receiver.set_metrics(processor.metrics());
+  if (commands != nullptr) {
+    receiver.init_ring(&in_queue, commands, &control_queue);
+  }
+  else {
+    receiver.init(&in_queue, input_, &control_queue);
+  }
 
   util::Sender sender;
-  sender.init(&out_queue, output_);
+  sender.set_compression_threshold(compression_threshold_);
+  sender.set_recorder(recorder);
+  sender.set_tracer(tracer);
+  if (responses != nullptr) {
+    sender.init_ring(&out_queue, responses, processor.metrics());
+  }
+  else {
+    sender.init(&out_queue, output_, processor.metrics());
+  }
 
   // Wait until all incoming requests are not received
-  while (!receiver.finished()) {
-    std::this_thread::sleep_for(std::chrono::seconds(1)); // FIXME should it be less?
-  }
+  receiver.wait();
 
   // Current thread will be blocked by close() until all requests are not performed
   processor.close();
+  out_queue.close();
   sender.close();
 }
+
+// The only client gets the rings over the handshake socket, the socket is removed right after that
+bool Service::shm_loop(util::CommandRecorder *recorder, TraceInterface *tracer) {
+  util::UnixSocketListener listener;
+  std::stringstream errors;
+  if (!listener.listen(shm_path_, &errors)) {
+    std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    listener_ = &listener;
+  }
+  int fd = -1;
+  while (!stopped_ && fd == -1) {
+    fd = listener.accept(-1.0);
+  }
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    listener_ = nullptr;
+  }
+  listener.close();
+  if (fd == -1) {
+    return true;                      // stopped before the client came
+  }
+
+  util::ShmRing commands;
+  util::ShmRing responses;
+  const bool shared = commands.create(shm_capacity_, &errors) && responses.create(shm_capacity_, &errors) &&
+                      commands.share(fd, &errors) && responses.share(fd, &errors);
+  util::UnixSocketListener::close(fd);
+  if (!shared) {
+    std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+    return false;
+  }
+
+  // Client closes the ring of commands when it's done, stop() interrupts it
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    shm_commands_ = &commands;
+    if (stopped_) {
+      commands.interrupt();
+    }
+  }
+  stream_loop(recorder, tracer, &commands, &responses);
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    shm_commands_ = nullptr;
+  }
+  responses.close();
+  return true;
+}
+
+bool Service::server_loop(util::CommandRecorder *recorder, TraceInterface *tracer) {
+  util::UnixSocketListener listener;
+  std::stringstream errors;
+  if (!listener.listen(socket_path_, &errors)) {
+    std::cerr << "Service::main_loop(): " << errors.str() << std::endl;
+    return false;
+  }
+
+  // All the clients feed the single processor
+  util::BlockingQueue<std::shared_ptr<util::CommandInterface>> in_queue(in_queue_size_);
+  util::BlockingQueue<std::shared_ptr<util::CommandInterface>> control_queue(in_queue_size_);
+  util::BlockingQueue<std::shared_ptr<util::ResponseInterface>> out_queue(out_queue_size_);
+  util::Processor processor;
+  configure(&processor);
+  processor.set_tracer(tracer);
+  processor.init(factory_, scanner_, &in_queue, &out_queue, timeout_, &control_queue);
+
+  std::mutex mutex;
+  std::unordered_map<size_t, std::unique_ptr<Connection>> connections;     // by origin
+  Router routing(&out_queue, &mutex, &connections, &listener, client_stall_timeout_);
+  std::thread router([&routing]() -> void { routing.run(); });
+
+  auto release = [](std::unique_ptr<Connection> &conn) -> void {
+    conn->receiver.wait();
+    conn->responses.close();
+    conn->sender.close();
+    util::UnixSocketListener::close(conn->fd);
+    conn.reset();
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    listener_ = &listener;
+  }
+  size_t next_origin = 1;             // 0 is left for stream mode
+  while (!stopped_) {
+    const int fd = listener.accept(-1.0);
+    if (fd != -1) {
+      std::unique_ptr<Connection> conn(new Connection(fd, client_queue_size_));
+      Connection *ref = conn.get();
+      ref->receiver.set_origin(next_origin);
+      ref->receiver.set_recorder(recorder);
+      ref->receiver.set_tracer(tracer);
+      ref->receiver.set_metrics(processor.metrics());
+      ref->sender.set_compression_threshold(compression_threshold_);
+      ref->sender.set_recorder(recorder);
+      ref->sender.set_tracer(tracer);
+      ref->sender.init(&ref->responses, &ref->output, processor.metrics());
+      ref->receiver.set_finish_callback([&listener]() -> void { listener.wake(); });
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        connections[next_origin++] = std::move(conn);
+      }
+      ref->receiver.init(&in_queue, &ref->input, &control_queue);
+    }
+
+    // Client has closed its side and has got all its responses
+    std::vector<std::unique_ptr<Connection>> finished;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto it = connections.begin(); it != connections.end(); ) {
+        if (it->second->receiver.finished() && it->second->routed == it->second->receiver.commands()) {
+          finished.push_back(std::move(it->second));
+          it = connections.erase(it);
+        }
+        else {
+          ++it;
+        }
+      }
+    }
+    for (auto &conn : finished) {
+      release(conn);
+    }
+  }
+
+  // Requests that were received are performed and answered before the connections are closed
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    listener_ = nullptr;
+  }
+  listener.close();
+  for (auto &conn : connections) {
+    util::UnixSocketListener::shutdown(conn.second->fd);
+    conn.second->receiver.wait();
+  }
+  processor.close();
+  out_queue.close();
+  router.join();
+  for (auto &conn : connections) {
+    release(conn.second);
+  }
+  return true;
+}
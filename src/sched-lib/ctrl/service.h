@@ -1,20 +1,34 @@
 
 #pragma once
 
+#include <atomic>
 #include <iostream>
 
 #include "defs.h"
 #include "alg/algorithm_factory.h"
 #include "hw/scanner.h"
+#include "ifaces/trace_interface.h"
 
 namespace swm {
+namespace util {
+class Processor;
+class ShmRing;
+class CommandRecorder;
+class Tracer;
+class UnixSocketListener;
+} // util
 
 class Service {
  public:
   Service(const AlgorithmFactory *factory, const Scanner *scanner)
       : factory_(factory), scanner_(scanner), debug_mode_(false),
         input_(&std::cin), output_(&std::cout),
-        in_queue_size_(4), out_queue_size_(4), timeout_(10.0) { }
+        in_queue_size_(4), out_queue_size_(4), client_queue_size_(64), client_stall_timeout_(10.0),
+        timeout_(10.0), compression_threshold_(0),
+        inline_threshold_(8), coalescing_(false), memoization_capacity_(0), memoization_ttl_(60.0),
+        metrics_replies_(false), shm_capacity_(1 << 24), record_slow_threshold_(0.0),
+        command_ring_(nullptr), response_ring_(nullptr), tracer_(nullptr),
+        stopped_(false), listener_(nullptr), shm_commands_(nullptr) { }
   Service(const Service &) = delete;
   void operator =(const Service &) = delete;
 
@@ -36,9 +50,86 @@ class Service {
   void   set_timeout(double seconds) { timeout_ = seconds; }
   double get_timeout() const { return timeout_; }
 
-  void main_loop();
+  void   set_compression_threshold(size_t bytes) { compression_threshold_ = bytes; }
+  size_t get_compression_threshold() const { return compression_threshold_; }
+
+  void   set_inline_threshold(size_t jobs) { inline_threshold_ = jobs; }
+  size_t get_inline_threshold() const { return inline_threshold_; }
+
+  // Newer schedule request of the same scope supersedes the older ones (SWM_RESULT_SUPERSEDED),
+  // clients must expect it, so it's off by default
+  void set_coalescing(bool enabled) { coalescing_ = enabled; }
+  bool get_coalescing() const { return coalescing_; }
+
+  // Zero capacity (the default) disables reuse of results for identical requests
+  void   set_memoization(size_t capacity, double ttl) { memoization_capacity_ = capacity; memoization_ttl_ = ttl; }
+  size_t get_memoization_capacity() const { return memoization_capacity_; }
+  double get_memoization_ttl() const { return memoization_ttl_; }
+
+  // Metrics command is answered with the service metrics (a scheduler_result), off by default
+  // because clients of the original protocol expect no answer
+  void set_metrics_replies(bool enabled) { metrics_replies_ = enabled; }
+  bool get_metrics_replies() const { return metrics_replies_; }
+
+  // Commands are decoded in place from the ring shared with a co-located client, responses are
+  // put into the other one. Replaces input and output, the rings must outlive main_loop()
+  void set_rings(util::ShmRing *commands, util::ShmRing *responses) {
+    command_ring_ = commands;
+    response_ring_ = responses;
+  }
+
+  // Received commands are written to "path" for replay, see CommandRecorder. Positive threshold
+  // (seconds) keeps only the requests that were answered slower than that
+  void set_recording(const std::string &path, double slow_threshold) {
+    record_path_ = path;
+    record_slow_threshold_ = slow_threshold;
+  }
+  const std::string &get_recording_path() const { return record_path_; }
+
+  // Spans of all components are collected while main_loop() works and written to "path" in Chrome
+  // trace format at exit, see Tracer
+  void set_tracing(const std::string &path) { trace_path_ = path; }
+  const std::string &get_tracing_path() const { return trace_path_; }
+  // Writes the spans collected so far, false if main_loop() is not tracing right now. Thread-safe
+  bool dump_trace(std::stringstream *errors = nullptr);
+
+  // Server mode: clients connect to the Unix socket "path" instead of using input and output.
+  // Every connection has its own receiver and sender, plugins, thread pools and caches are shared.
+  // Client that has taken none of its pending responses for the stall timeout is disconnected,
+  // the rest of its responses are dropped
+  void set_socket_path(const std::string &path) { socket_path_ = path; }
+  const std::string &get_socket_path() const { return socket_path_; }
+
+  // Responses queued for the sender of every connection, the ones beyond it wait in the router
+  void   set_client_queue_size(size_t size) { client_queue_size_ = size; }
+  size_t get_client_queue_size() const { return client_queue_size_; }
+
+  // Seconds a client with pending responses may take none of them before it's disconnected
+  void   set_client_stall_timeout(double seconds) { client_stall_timeout_ = seconds; }
+  double get_client_stall_timeout() const { return client_stall_timeout_; }
+
+  // Shared memory mode: a co-located client connects to the Unix socket "path" once and gets two rings
+  // of "capacity" bytes (see ShmRing::attach()), then the rings replace input and output
+  void set_shm(const std::string &path, size_t capacity) { shm_path_ = path; shm_capacity_ = capacity; }
+  const std::string &get_shm_path() const { return shm_path_; }
+  size_t get_shm_capacity() const { return shm_capacity_; }
+
+  // False if the socket of server or shared memory mode cannot be listened, the rings cannot be passed,
+  // the recording or the trace cannot be created
+  bool main_loop();
+  // Server and shared memory modes stop receiving, perform the received requests and return, thread-safe
+  void stop();
 
  private:
+  struct Connection;
+  class Router;
+
+  void configure(util::Processor *processor) const;
+  void stream_loop(util::CommandRecorder *recorder, TraceInterface *tracer,
+                   util::ShmRing *commands, util::ShmRing *responses);
+  bool server_loop(util::CommandRecorder *recorder, TraceInterface *tracer);
+  bool shm_loop(util::CommandRecorder *recorder, TraceInterface *tracer);
+
   const AlgorithmFactory *factory_;
   const Scanner *scanner_;
   bool debug_mode_;
@@ -46,7 +137,29 @@ class Service {
   std::ostream *output_;
   size_t in_queue_size_;
   size_t out_queue_size_;
+  size_t client_queue_size_;
+  double client_stall_timeout_;
   double timeout_;
+  size_t compression_threshold_;
+  size_t inline_threshold_;
+  bool coalescing_;
+  size_t memoization_capacity_;
+  double memoization_ttl_;
+  bool metrics_replies_;
+  std::string socket_path_;
+  std::string shm_path_;
+  size_t shm_capacity_;
+  std::string record_path_;
+  double record_slow_threshold_;
+  util::ShmRing *command_ring_;
+  util::ShmRing *response_ring_;
+  std::string trace_path_;
+  std::mutex trace_mutex_;
+  util::Tracer *tracer_;                 // active while main_loop() works, guarded by trace_mutex_
+  std::atomic<bool> stopped_;
+  std::mutex stop_mutex_;
+  util::UnixSocketListener *listener_;   // woken up by stop(), guarded by stop_mutex_
+  util::ShmRing *shm_commands_;          // interrupted by stop(), guarded by stop_mutex_
 };
 
 } // swm
@@ -1,11 +1,101 @@
-
 #include "service_metrics.h"
 
 namespace swm {
 namespace util {
 
-ServiceMetrics::ServiceMetrics() {
+ServiceMetrics::ServiceMetrics() : metrics_(64) {
   metrics_.register_int_value(REQUESTS_ID, "the total number of processed requests");
+  metrics_.register_int_value(COMPRESSED_RESPONSES_ID, "the number of responses sent compressed");
+  metrics_.register_double_value(COMPRESSION_INPUT_ID, "bytes of responses passed to compressor");
+  metrics_.register_double_value(COMPRESSION_OUTPUT_ID, "bytes of responses after compressor");
+  metrics_.register_double_value(COMPRESSION_TIME_ID, "seconds spent in compression of responses");
+  metrics_.register_int_value(POOL_THREADS_ID, "the number of threads in chains' pool");
+  metrics_.register_int_value(POOL_BUSY_THREADS_ID, "the number of busy threads in chains' pool");
+  metrics_.register_int_value(POOL_QUEUED_TASKS_ID, "the number of tasks waiting for chains' pool");
+  metrics_.register_int_value(INLINE_CHAINS_ID, "the number of chains performed without thread pool");
+  metrics_.register_int_value(MIGRATIONS_ID, "the number of timetables migrated between islands");
+  metrics_.register_int_value(SUPERSEDED_REQUESTS_ID, "the number of schedule requests superseded by newer ones");
+  metrics_.register_int_value(MEMOIZATION_HITS_ID, "the number of schedule requests answered from cache");
+  metrics_.register_int_value(MEMOIZATION_MISSES_ID, "the number of cacheable schedule requests not found in cache");
+
+  requests_ = metrics_.int_handle(REQUESTS_ID);
+  compressed_responses_ = metrics_.int_handle(COMPRESSED_RESPONSES_ID);
+  compression_input_ = metrics_.double_handle(COMPRESSION_INPUT_ID);
+  compression_output_ = metrics_.double_handle(COMPRESSION_OUTPUT_ID);
+  compression_time_ = metrics_.double_handle(COMPRESSION_TIME_ID);
+  pool_threads_ = metrics_.int_handle(POOL_THREADS_ID);
+  pool_busy_threads_ = metrics_.int_handle(POOL_BUSY_THREADS_ID);
+  pool_queued_tasks_ = metrics_.int_handle(POOL_QUEUED_TASKS_ID);
+  inline_chains_ = metrics_.int_handle(INLINE_CHAINS_ID);
+  migrations_ = metrics_.int_handle(MIGRATIONS_ID);
+  superseded_requests_ = metrics_.int_handle(SUPERSEDED_REQUESTS_ID);
+  memoization_hits_ = metrics_.int_handle(MEMOIZATION_HITS_ID);
+  memoization_misses_ = metrics_.int_handle(MEMOIZATION_MISSES_ID);
+
+  const char *quantile_names[] = { "p50", "p99", "p999" };
+  for (size_t stage = 0; stage < STAGES; ++stage) {
+    for (size_t i = 0; i < LATENCY_QUANTILES.size(); ++i) {
+      const uint32_t id = (uint32_t)(LATENCY_FIRST_ID + stage * LATENCY_QUANTILES.size() + i);
+      metrics_.register_double_value(id, std::string(stage_name((Stage)stage)) + " latency " + quantile_names[i] +
+                                         ", seconds");
+      latency_percentiles_.push_back(metrics_.double_handle(id));
+    }
+  }
+}
+
+const char *ServiceMetrics::stage_name(Stage stage) {
+  switch (stage) {
+    case RECEIVE:     return "receive";
+    case DECODE:      return "decode";
+    case ALGORITHMS:  return "algorithms creation";
+    case CHAIN_STAGE: return "chain stage";
+    case ENCODE:      return "encode";
+    case SEND:        return "send";
+    default:          return "unknown";
+  }
+}
+
+// Percentiles are gauges written only by processor, like the pool's ones
+void ServiceMetrics::publish_latencies() {
+  auto update = metrics_.update();
+  for (size_t stage = 0; stage < STAGES; ++stage) {
+    for (size_t i = 0; i < LATENCY_QUANTILES.size(); ++i) {
+      const auto handle = latency_percentiles_[stage * LATENCY_QUANTILES.size() + i];
+      update.add_double(handle, latencies_[stage].percentile(LATENCY_QUANTILES[i]) - metrics_.double_sum(handle));
+    }
+  }
+}
+
+double ServiceMetrics::compression_ratio() const {
+  const double output = compression_output_bytes();
+  return output > 0.0 ? compression_input_bytes() / output : 1.0;
+}
+
+void ServiceMetrics::update_compression(size_t input_bytes, size_t output_bytes,
+                                        double seconds, bool compressed) {
+  metrics_.update()
+      .add_double(compression_input_, (double)input_bytes)
+      .add_double(compression_output_, (double)output_bytes)
+      .add_double(compression_time_, seconds)
+      .add_int(compressed_responses_, compressed ? 1 : 0);
+}
+
+double ServiceMetrics::pool_occupancy() const {
+  const size_t threads = pool_threads();
+  return threads != 0 ? (double)pool_busy_threads() / (double)threads : 0.0;
+}
+
+// Gauges are written only by processor, so increments are enough to set them
+void ServiceMetrics::update_pool(size_t threads, size_t busy_threads, size_t queued_tasks) {
+  metrics_.update()
+      .add_int(pool_threads_, (int64_t)threads - metrics_.int_sum(pool_threads_))
+      .add_int(pool_busy_threads_, (int64_t)busy_threads - metrics_.int_sum(pool_busy_threads_))
+      .add_int(pool_queued_tasks_, (int64_t)queued_tasks - metrics_.int_sum(pool_queued_tasks_));
+}
+
+size_t ServiceMetrics::update_int_value(MetricsRegistry::Handle handle, size_t increment) {
+  metrics_.update().add_int(handle, (int64_t)increment);
+  return (size_t)metrics_.int_sum(handle);
 }
 
 } // util
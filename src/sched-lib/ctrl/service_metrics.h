@@ -1,28 +1,114 @@
-
 #pragma once
 
 #include "defs.h"
-#include "auxl/metrics.h"
+#include "auxl/latency_histogram.h"
+#include "auxl/metrics_registry.h"
 
 namespace swm {
 namespace util {
 
-// Global metrics counted by service
+// Global metrics counted by service, values are updated by handles without locks
 class ServiceMetrics {
  public:
+  // Stages of the request's way through service, every one has its histogram of latencies
+  enum Stage {
+    RECEIVE       = 0,      // the frame of command is read
+    DECODE        = 1,      // command is initialized from the frame's data
+    ALGORITHMS    = 2,      // algorithms of schedule command are created
+    CHAIN_STAGE   = 3,      // an algorithm of chain has created or improved timetable
+    ENCODE        = 4,      // response is serialized (and compressed)
+    SEND          = 5,      // response is written
+    STAGES        = 6
+  };
+
   ServiceMetrics();
   ServiceMetrics(const ServiceMetrics &) = delete;
   void operator =(const ServiceMetrics &) = delete;
   const MetricsInterface &object() const { return metrics_; }
 
-  size_t requests() const { return (size_t)metrics_.int_value(REQUESTS_ID); }
+  size_t requests() const { return (size_t)metrics_.int_sum(requests_); }
   size_t update_requests(size_t new_requests) {
-    return (size_t)metrics_.update_int_value(REQUESTS_ID, (int32_t)new_requests);
+    return update_int_value(requests_, new_requests);
   }
 
+  // Compression of outgoing terms, bytes are stored as doubles to not overflow
+  size_t compressed_responses() const { return (size_t)metrics_.int_sum(compressed_responses_); }
+  double compression_input_bytes() const { return metrics_.double_sum(compression_input_); }
+  double compression_output_bytes() const { return metrics_.double_sum(compression_output_); }
+  double compression_time() const { return metrics_.double_sum(compression_time_); }
+  double compression_ratio() const;
+  void update_compression(size_t input_bytes, size_t output_bytes, double seconds, bool compressed);
+
+  // Occupancy of the chains' thread pool, refreshed by processor
+  size_t pool_threads() const { return (size_t)metrics_.int_sum(pool_threads_); }
+  size_t pool_busy_threads() const { return (size_t)metrics_.int_sum(pool_busy_threads_); }
+  size_t pool_queued_tasks() const { return (size_t)metrics_.int_sum(pool_queued_tasks_); }
+  double pool_occupancy() const;
+  void update_pool(size_t threads, size_t busy_threads, size_t queued_tasks);
+
+  // Chains of small requests performed right in the processor's thread
+  size_t inline_chains() const { return (size_t)metrics_.int_sum(inline_chains_); }
+  size_t update_inline_chains(size_t new_chains) {
+    return update_int_value(inline_chains_, new_chains);
+  }
+
+  // Timetables taken by islands from their neighbours
+  size_t migrations() const { return (size_t)metrics_.int_sum(migrations_); }
+  size_t update_migrations(size_t new_migrations) {
+    return update_int_value(migrations_, new_migrations);
+  }
+
+  // Schedule requests dropped or interrupted because a newer one for the same scope came
+  size_t superseded_requests() const { return (size_t)metrics_.int_sum(superseded_requests_); }
+  size_t update_superseded_requests(size_t new_requests) {
+    return update_int_value(superseded_requests_, new_requests);
+  }
+
+  // Schedule requests answered from the cache of results and the ones that ran their chains
+  size_t memoization_hits() const { return (size_t)metrics_.int_sum(memoization_hits_); }
+  size_t memoization_misses() const { return (size_t)metrics_.int_sum(memoization_misses_); }
+  void update_memoization(bool hit) { metrics_.update().add_int(hit ? memoization_hits_ : memoization_misses_, 1); }
+
+  // Latencies are recorded by any thread, percentiles are seen by snapshots of object() after publish_latencies()
+  static const char *stage_name(Stage stage);
+  LatencyHistogram *latency(Stage stage) { return &latencies_[stage]; }
+  void record_latency(Stage stage, LatencyHistogram::clock::duration duration) { latencies_[stage].record(duration); }
+  void publish_latencies();
+
  private:
+  size_t update_int_value(MetricsRegistry::Handle handle, size_t increment);
+
   const int REQUESTS_ID = 1;
-  Metrics metrics_;
+  const int COMPRESSED_RESPONSES_ID = 2;
+  const int COMPRESSION_INPUT_ID = 3;
+  const int COMPRESSION_OUTPUT_ID = 4;
+  const int COMPRESSION_TIME_ID = 5;
+  const int POOL_THREADS_ID = 6;
+  const int POOL_BUSY_THREADS_ID = 7;
+  const int POOL_QUEUED_TASKS_ID = 8;
+  const int INLINE_CHAINS_ID = 9;
+  const int MIGRATIONS_ID = 10;
+  const int SUPERSEDED_REQUESTS_ID = 11;
+  const int MEMOIZATION_HITS_ID = 12;
+  const int MEMOIZATION_MISSES_ID = 13;
+  const int LATENCY_FIRST_ID = 100;                 // p50, p99 and p999 of every stage in a row
+  const std::vector<double> LATENCY_QUANTILES = { 0.5, 0.99, 0.999 };
+  MetricsRegistry metrics_;
+  MetricsRegistry::Handle requests_;
+  MetricsRegistry::Handle compressed_responses_;
+  MetricsRegistry::Handle compression_input_;
+  MetricsRegistry::Handle compression_output_;
+  MetricsRegistry::Handle compression_time_;
+  MetricsRegistry::Handle pool_threads_;
+  MetricsRegistry::Handle pool_busy_threads_;
+  MetricsRegistry::Handle pool_queued_tasks_;
+  MetricsRegistry::Handle inline_chains_;
+  MetricsRegistry::Handle migrations_;
+  MetricsRegistry::Handle superseded_requests_;
+  MetricsRegistry::Handle memoization_hits_;
+  MetricsRegistry::Handle memoization_misses_;
+  std::vector<MetricsRegistry::Handle> latency_percentiles_;
+  LatencyHistogram latencies_[STAGES];
 };
 
 } // util
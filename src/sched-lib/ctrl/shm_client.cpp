@@ -0,0 +1,79 @@
+#include "shm_client.h"
+
+#include <string.h>
+
+#include "auxl/unix_socket.h"
+
+namespace swm {
+namespace util {
+
+static inline char *put_length(char *dst, size_t len) {
+  dst[0] = (char)(len >> 24);
+  dst[1] = (char)(len >> 16);
+  dst[2] = (char)(len >> 8);
+  dst[3] = (char)len;
+  return dst + 4;
+}
+
+bool ShmClient::create(size_t capacity, std::stringstream *errors) {
+  return commands_.create(capacity, errors) && responses_.create(capacity, errors);
+}
+
+bool ShmClient::connect(const std::string &path, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  const int fd = UnixSocketListener::connect(path, errors);
+  if (fd == -1) {
+    return false;
+  }
+  const bool attached = commands_.attach(fd, errors) && responses_.attach(fd, errors);
+  UnixSocketListener::close(fd);
+  return attached;
+}
+
+bool ShmClient::send(CommandType type, const SwmUID &uid, const std::vector<ei_x_buff> &slices, double timeout) {
+  if (slices.size() > 255) {
+    throw std::runtime_error("ShmClient::send(): command cannot have more than 255 slices");
+  }
+
+  // Layout of the wire format: command, request id (length and characters), slice count,
+  // slices (type, length, data)
+  size_t size = 1 + 4 + uid.size() + 1;
+  for (const auto &slice : slices) {
+    size += 1 + 4 + (size_t)slice.index;
+  }
+  char *dst = commands_.reserve(size, timeout);
+  if (dst == nullptr) {
+    return false;
+  }
+
+  *dst++ = (char)type;
+  dst = put_length(dst, uid.size());
+  memcpy(dst, uid.data(), uid.size());
+  dst += uid.size();
+  *dst++ = (char)slices.size();
+  for (size_t i = 0; i < slices.size(); ++i) {
+    *dst++ = (char)i;
+    dst = put_length(dst, (size_t)slices[i].index);
+    memcpy(dst, slices[i].buff, (size_t)slices[i].index);
+    dst += slices[i].index;
+  }
+  commands_.commit();
+  return true;
+}
+
+bool ShmClient::receive(const std::function<void(const char *, size_t)> &clb, double timeout) {
+  ShmRing::Frame frame;
+  if (!responses_.acquire(&frame, timeout)) {
+    return false;
+  }
+  clb(frame.data, frame.size);
+  responses_.release(frame);
+  return true;
+}
+
+} // util
+} // swm
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defs.h"
+#include "constants.h"
+#include "auxl/shm_ring.h"
+
+namespace swm {
+namespace util {
+
+// Co-located client of the ring transport: writes commands straight into the ring of commands and
+// reads responses in place. Rings are either created by the client (tests and benchmarks that pass
+// them to the service) or received from the service in shared memory mode
+class ShmClient {
+ public:
+  ShmClient() { }
+  ShmClient(const ShmClient &) = delete;
+  void operator =(const ShmClient &) = delete;
+
+  bool create(size_t capacity, std::stringstream *errors = nullptr);
+  // Handshake with the service started with Service::set_shm("path", ...)
+  bool connect(const std::string &path, std::stringstream *errors = nullptr);
+  ShmRing *commands() { return &commands_; }
+  ShmRing *responses() { return &responses_; }
+
+  // Slices are encoded erlang terms, their indices are data types of the command
+  bool send(CommandType type, const SwmUID &uid, const std::vector<ei_x_buff> &slices, double timeout);
+  // Response is passed to "clb" while it's in the ring, false if nothing has come in "timeout"
+  bool receive(const std::function<void(const char *, size_t)> &clb, double timeout);
+  // Service receives the commands that were sent and finishes
+  void close() { commands_.close(); }
+
+ private:
+  ShmRing commands_;
+  ShmRing responses_;
+};
+
+} // util
+} // swm
@@ -0,0 +1,59 @@
+#include "timetable_cache.h"
+
+namespace swm {
+namespace util {
+
+TimetableCache::TimetableCache(size_t capacity, double ttl)
+    : capacity_(capacity),
+      ttl_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(ttl))) {
+  if (capacity == 0) {
+    throw std::runtime_error("TimetableCache::TimetableCache(): \"capacity\" must be positive");
+  }
+  if (ttl <= 0.0) {
+    throw std::runtime_error("TimetableCache::TimetableCache(): \"ttl\" must be positive");
+  }
+}
+
+bool TimetableCache::find(const std::string &key, Result *res) {
+  if (res == nullptr) {
+    throw std::runtime_error("TimetableCache::find(): \"res\" cannot be nullptr");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  if (it->second->expires <= Clock::now()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *res = it->second->result;
+  return true;
+}
+
+void TimetableCache::insert(const std::string &key, const Result &result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  entries_.push_front(Entry { key, result, Clock::now() + ttl_ });
+  index_[key] = entries_.begin();
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+}
+
+size_t TimetableCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+} // util
+} // swm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <mutex>
+
+#include "defs.h"
+#include "ifaces/timetable_info_interface.h"
+
+namespace swm {
+
+class MetricsSnapshot;
+
+namespace util {
+
+// Results of completed chains by digest of their input (see Processor), so the same request
+// is answered without scheduling. The least recently used results are evicted when there are
+// more than "capacity" of them, results older than "ttl" seconds are never returned. Thread-safe.
+class TimetableCache {
+ public:
+  struct Result {
+    std::shared_ptr<TimetableInfoInterface> timetable;
+    std::shared_ptr<MetricsSnapshot> metrics;
+  };
+
+  TimetableCache(size_t capacity, double ttl);
+  TimetableCache(const TimetableCache &) = delete;
+  void operator =(const TimetableCache &) = delete;
+
+  bool find(const std::string &key, Result *res);
+  void insert(const std::string &key, const Result &result);
+  size_t size() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  struct Entry {
+    std::string key;
+    Result result;
+    Clock::time_point expires;
+  };
+
+  size_t capacity_;
+  Clock::duration ttl_;
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;                                          // the most recent first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+} // util
+} // swm
@@ -0,0 +1,57 @@
+#include "timetable_history.h"
+
+#include <algorithm>
+
+namespace swm {
+namespace util {
+
+TimetableHistory::TimetableHistory(size_t depth, size_t max_streams) : depth_(depth), max_streams_(max_streams) {
+  if (max_streams == 0) {
+    throw std::runtime_error("TimetableHistory::TimetableHistory(): \"max_streams\" must be positive");
+  }
+}
+
+std::shared_ptr<const TimetableHistory::Snapshot> TimetableHistory::push(
+    const std::string &client, const std::string &chain,
+    const SwmUID &acknowledged, const SwmUID &request_id,
+    const std::shared_ptr<const Snapshot> &tables) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::string key = client + '\0' + chain;
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    streams_.splice(streams_.begin(), streams_, found->second);
+  }
+  else {
+    streams_.push_front(Entry { key, Stream() });
+    index_[key] = streams_.begin();
+    while (streams_.size() > max_streams_) {
+      index_.erase(streams_.back().key);
+      streams_.pop_back();
+    }
+  }
+  auto &stream = streams_.front().stream;
+
+  std::shared_ptr<const Snapshot> base;
+  auto it = std::find_if(stream.begin(), stream.end(),
+                         [&acknowledged](const Stream::value_type &rec) -> bool {
+                           return rec.first == acknowledged;
+                         });
+  if (it != stream.end()) {
+    base = it->second;
+    stream.erase(stream.begin(), it);
+  }
+
+  stream.emplace_back(request_id, tables);
+  while (stream.size() > depth_) {
+    stream.pop_front();
+  }
+  return base;
+}
+
+size_t TimetableHistory::stream_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.size();
+}
+
+} // util
+} // swm
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <deque>
+#include <list>
+#include <mutex>
+
+#include "defs.h"
+
+namespace swm {
+namespace util {
+
+// Timetables that were sent in diff mode, kept per (client, chain) stream
+// to be the base for the following diff responses. The least recently used streams are
+// forgotten when there are more than "max_streams" of them (their clients resync). Thread-safe.
+class TimetableHistory {
+ public:
+  typedef std::unordered_map<std::string, SwmTimetable> Snapshot;  // by job id
+
+  explicit TimetableHistory(size_t depth = 4, size_t max_streams = 1024);
+  TimetableHistory(const TimetableHistory &) = delete;
+  void operator =(const TimetableHistory &) = delete;
+
+  // Remembers "tables" as result "request_id" of the stream and returns the result
+  // "acknowledged" by client, nullptr if it is unknown (full resync is required then).
+  // Results older than the acknowledged one are not needed anymore and are released.
+  std::shared_ptr<const Snapshot> push(const std::string &client, const std::string &chain,
+                                       const SwmUID &acknowledged, const SwmUID &request_id,
+                                       const std::shared_ptr<const Snapshot> &tables);
+  size_t stream_count() const;
+
+ private:
+  typedef std::deque<std::pair<SwmUID, std::shared_ptr<const Snapshot> > > Stream;
+  struct Entry {
+    std::string key;
+    Stream stream;
+  };
+
+  size_t depth_;
+  size_t max_streams_;
+  mutable std::mutex mutex_;
+  std::list<Entry> streams_;                                          // the most recent first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+} // util
+} // swm
@@ -17,10 +17,14 @@ class ComputeUnit : public ComputeUnitInterface {
   virtual size_t cores() const override { return cores_; }
   virtual double frequency_mhz() const override { return freq_; }
 
+  // Logical CPUs that threads of the unit can be bound to, empty if the unit is not bindable
+  const std::vector<size_t> &cpus() const { return cpus_; }
+
  private:
   ComputeUnit(const ComputeUnit &) = delete;
-  ComputeUnit(Type type, int num, const std::string &name, size_t cores, double freq)
-      : type_(type), num_(num), name_(name), cores_(cores), freq_(freq) {}
+  ComputeUnit(Type type, int num, const std::string &name, size_t cores, double freq,
+              const std::vector<size_t> &cpus = std::vector<size_t>())
+      : type_(type), num_(num), name_(name), cores_(cores), freq_(freq), cpus_(cpus) {}
   void operator =(const ComputeUnit &) = delete;
 
   Type type_;
@@ -28,6 +32,7 @@ class ComputeUnit : public ComputeUnitInterface {
   std::string name_;
   size_t cores_;
   double freq_;
+  std::vector<size_t> cpus_;
   friend class Scanner;
 };
 
@@ -0,0 +1,164 @@
+#include "cpu_limits.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cpu_topology.h"
+#include "auxl/file.h"
+
+namespace swm {
+
+// Limits are checked up to the root of the hierarchy: the parent's one is also applied.
+// Namespaced container sees its own group as root of the mount, while "/proc/self/cgroup"
+// can contain the path of the host, so the mount root is the last candidate
+static std::vector<std::string> group_dirs(const std::string &mount, const std::string &path) {
+  std::vector<std::string> dirs;
+  std::string cur = path;
+  while (!cur.empty() && cur != "/") {
+    dirs.push_back(mount + cur);
+    cur = cur.substr(0, cur.find_last_of('/'));
+  }
+  dirs.push_back(mount);
+  return dirs;
+}
+
+static void apply_quota(double quota, double *res) {
+  if (quota > 0.0 && (*res == 0.0 || quota < *res)) {
+    *res = quota;
+  }
+}
+
+// Returns false if the file is not found, keeps "cpus" unchanged if the list is empty
+static bool read_cpuset(const std::string &path, std::vector<size_t> *cpus) {
+  std::string line;
+  if (!util::read_first_line(path, &line)) {
+    return false;
+  }
+  std::vector<size_t> list;
+  if (CpuTopology::parse_cpu_list(line, &list) && !list.empty()) {
+    cpus->swap(list);
+  }
+  return true;
+}
+
+bool CpuLimits::read(const std::string &root, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  std::string content;
+  if (!util::read_file(root + "/proc/self/cgroup", &content)) {
+    *errors << "cannot open \"" << root << "/proc/self/cgroup\"";
+    return false;
+  }
+
+  // Lines look like "0::/path" (v2) or "4:cpu,cpuacct:/path" (v1)
+  const std::string cgroup_dir = root + "/sys/fs/cgroup";
+  double quota = 0.0;
+  std::vector<size_t> cpuset;
+  std::stringstream lines(content);
+  std::string line;
+  while (std::getline(lines, line)) {
+    const size_t first = line.find(':');
+    const size_t second = first == std::string::npos ? first : line.find(':', first + 1);
+    if (second == std::string::npos) {
+      continue;
+    }
+    const std::string controllers = line.substr(first + 1, second - first - 1);
+    const std::string path = line.substr(second + 1);
+
+    if (controllers.empty()) {
+      // "max 100000" or "200000 100000"
+      bool cpuset_found = false;
+      for (const auto &dir : group_dirs(cgroup_dir, path)) {
+        std::string max;
+        if (util::read_first_line(dir + "/cpu.max", &max)) {
+          double limit = 0.0;
+          double period = 0.0;
+          std::stringstream sstr(max);
+          std::string limit_str;
+          if ((sstr >> limit_str >> period) && limit_str != "max" && period > 0.0) {
+            limit = atof(limit_str.c_str());
+            apply_quota(limit / period, &quota);
+          }
+        }
+        // Effective list already includes restrictions of parents
+        if (!cpuset_found) {
+          cpuset_found = read_cpuset(dir + "/cpuset.cpus.effective", &cpuset);
+        }
+      }
+      continue;
+    }
+
+    std::stringstream sstr(controllers);
+    std::string controller;
+    while (std::getline(sstr, controller, ',')) {
+      if (controller == "cpu") {
+        for (const auto &mount : { cgroup_dir + "/" + controllers, cgroup_dir + "/cpu" }) {
+          for (const auto &dir : group_dirs(mount, path)) {
+            std::string limit;
+            std::string period;
+            if (util::read_first_line(dir + "/cpu.cfs_quota_us", &limit) &&
+                util::read_first_line(dir + "/cpu.cfs_period_us", &period) && atof(period.c_str()) > 0.0) {
+              apply_quota(atof(limit.c_str()) / atof(period.c_str()), &quota);
+            }
+          }
+        }
+      }
+      else if (controller == "cpuset") {
+        for (const auto &dir : group_dirs(cgroup_dir + "/" + controllers, path)) {
+          if (read_cpuset(dir + "/cpuset.effective_cpus", &cpuset) ||
+              read_cpuset(dir + "/cpuset.cpus", &cpuset)) {
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  quota_ = quota;
+  cpuset_.swap(cpuset);
+  return true;
+}
+
+void CpuLimits::restrict_to(const std::vector<size_t> &cpus) {
+  if (cpus.empty()) {
+    return;
+  }
+  if (cpuset_.empty()) {
+    cpuset_ = cpus;
+    std::sort(cpuset_.begin(), cpuset_.end());
+    return;
+  }
+  // Disjoint lists are a misconfiguration, the cgroup one is kept then
+  auto narrowed = filter(cpus);
+  if (!narrowed.empty()) {
+    std::sort(narrowed.begin(), narrowed.end());
+    cpuset_.swap(narrowed);
+  }
+}
+
+std::vector<size_t> CpuLimits::filter(const std::vector<size_t> &cpus) const {
+  if (cpuset_.empty()) {
+    return cpus;
+  }
+  std::vector<size_t> res;
+  for (const size_t cpu : cpus) {
+    if (std::find(cpuset_.begin(), cpuset_.end(), cpu) != cpuset_.end()) {
+      res.push_back(cpu);
+    }
+  }
+  return res;
+}
+
+size_t CpuLimits::usable_cpus(const std::vector<size_t> &cpus) const {
+  size_t res = filter(cpus).size();
+  if (quota_ > 0.0) {
+    // Quota of 1.5 CPUs still lets two threads work in parallel for a part of period
+    res = std::min(res, (size_t)std::ceil(quota_));
+  }
+  return std::max<size_t>(res, 1);
+}
+
+} // swm
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "defs.h"
+
+namespace swm {
+
+// CPU limits that cgroups (v1 or v2) impose on the current process: CFS quota and cpuset.
+// Containers usually see all CPUs of the host, but may use only a part of them
+class CpuLimits {
+ public:
+  CpuLimits() : quota_(0.0) { }
+
+  // Paths are prefixed by "root" ("<root>/proc/self/cgroup", "<root>/sys/fs/cgroup/...").
+  // Missing cgroup files mean no limits, it's not a failure
+  bool read(const std::string &root, std::stringstream *errors);
+
+  double quota() const { return quota_; }                       // CPUs, 0 if unlimited
+  const std::vector<size_t> &cpuset() const { return cpuset_; }  // empty if unrestricted
+
+  // Count of threads that can run simultaneously on "cpus" within the limits
+  size_t usable_cpus(const std::vector<size_t> &cpus) const;
+
+  // Narrows the cpuset, e.g. by the affinity mask of the process
+  void restrict_to(const std::vector<size_t> &cpus);
+
+  // Leaves CPUs that belong to the cpuset only
+  std::vector<size_t> filter(const std::vector<size_t> &cpus) const;
+
+ private:
+  double quota_;
+  std::vector<size_t> cpuset_;
+};
+
+} // swm
@@ -0,0 +1,182 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <set>
+
+#include "auxl/file.h"
+
+namespace swm {
+
+static bool read_int(const std::string &path, int *res) {
+  std::string line;
+  if (!util::read_first_line(path, &line) || line.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  const long val = strtol(line.c_str(), &end, 10);
+  if (end == line.c_str()) {
+    return false;
+  }
+  *res = (int)val;
+  return true;
+}
+
+// Sizes are printed as "32K", "16384K" or "16M"
+static size_t parse_cache_size_kb(const std::string &str) {
+  char *end = nullptr;
+  const unsigned long val = strtoul(str.c_str(), &end, 10);
+  switch (*end) {
+    case 'G': return (size_t)val * 1024 * 1024;
+    case 'M': return (size_t)val * 1024;
+    case 'K': return (size_t)val;
+    default:  return (size_t)val / 1024;
+  }
+}
+
+bool CpuTopology::parse_cpu_list(const std::string &str, std::vector<size_t> *res) {
+  if (res == nullptr) {
+    throw std::runtime_error("CpuTopology::parse_cpu_list(): \"res\" cannot be nullptr");
+  }
+
+  std::vector<size_t> cpus;
+  std::stringstream sstr(str);
+  std::string range;
+  while (std::getline(sstr, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    char *end = nullptr;
+    const unsigned long first = strtoul(range.c_str(), &end, 10);
+    unsigned long last = first;
+    if (end == range.c_str()) {
+      return false;
+    }
+    if (*end == '-') {
+      const char *start = end + 1;
+      last = strtoul(start, &end, 10);
+      if (end == start || last < first) {
+        return false;
+      }
+    }
+    if (*end != '\0') {
+      return false;
+    }
+    for (unsigned long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back((size_t)cpu);
+    }
+  }
+
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  res->swap(cpus);
+  return true;
+}
+
+bool CpuTopology::read(const std::string &root, std::stringstream *errors) {
+  std::stringstream errors_;
+  if (errors == nullptr) {
+    errors = &errors_;
+  }
+
+  const std::string cpu_dir = root + "/cpu/";
+  std::string line;
+  std::vector<size_t> online;
+  if (!util::read_first_line(cpu_dir + "online", &line) || !parse_cpu_list(line, &online) || online.empty()) {
+    *errors << "cannot read the list of online CPUs from \"" << cpu_dir << "online\"";
+    return false;
+  }
+
+  std::vector<LogicalCpu> cpus;
+  std::vector<Cache> caches;
+  std::set<std::pair<std::pair<int, std::string>, std::vector<size_t> > > known_caches;
+  for (const size_t id : online) {
+    const std::string dir = cpu_dir + "cpu" + std::to_string(id) + "/";
+    LogicalCpu cpu { id, (int)id, 0, 0, std::vector<size_t>() };
+
+    // Topology can be hidden (e.g. some virtual machines), every CPU is a core then
+    read_int(dir + "topology/core_id", &cpu.core);
+    read_int(dir + "topology/physical_package_id", &cpu.package);
+    if (!util::read_first_line(dir + "topology/thread_siblings_list", &line) ||
+        !parse_cpu_list(line, &cpu.siblings) || cpu.siblings.empty()) {
+      cpu.siblings.assign(1, id);
+    }
+    cpus.push_back(cpu);
+
+    // Shared caches are listed by every CPU that shares them
+    for (size_t index = 0; ; ++index) {
+      const std::string cache_dir = dir + "cache/index" + std::to_string(index) + "/";
+      Cache cache { 0, std::string(), 0, std::vector<size_t>() };
+      if (!read_int(cache_dir + "level", &cache.level)) {
+        break;
+      }
+      util::read_first_line(cache_dir + "type", &cache.type);
+      if (util::read_first_line(cache_dir + "size", &line)) {
+        cache.size_kb = parse_cache_size_kb(line);
+      }
+      if (!util::read_first_line(cache_dir + "shared_cpu_list", &line) || !parse_cpu_list(line, &cache.cpus)) {
+        cache.cpus.assign(1, id);
+      }
+      if (known_caches.insert(std::make_pair(std::make_pair(cache.level, cache.type), cache.cpus)).second) {
+        caches.push_back(cache);
+      }
+    }
+  }
+
+  // Kernels without NUMA support have no "node" directory, all CPUs are on the node 0 then
+  const std::string node_dir = root + "/node/";
+  std::vector<size_t> nodes;
+  if (util::read_first_line(node_dir + "online", &line) && parse_cpu_list(line, &nodes)) {
+    for (const size_t node : nodes) {
+      std::vector<size_t> node_cpus;
+      if (!util::read_first_line(node_dir + "node" + std::to_string(node) + "/cpulist", &line) ||
+          !parse_cpu_list(line, &node_cpus)) {
+        continue;
+      }
+      for (auto &cpu : cpus) {
+        if (std::binary_search(node_cpus.begin(), node_cpus.end(), cpu.id)) {
+          cpu.node = (int)node;
+        }
+      }
+    }
+  }
+
+  cpus_.swap(cpus);
+  caches_.swap(caches);
+  return true;
+}
+
+size_t CpuTopology::physical_cores() const {
+  std::set<std::pair<int, int> > cores;
+  for (const auto &cpu : cpus_) {
+    cores.insert(std::make_pair(cpu.package, cpu.core));
+  }
+  return cores.size();
+}
+
+std::vector<int> CpuTopology::nodes() const {
+  std::set<int> nodes;
+  for (const auto &cpu : cpus_) {
+    nodes.insert(cpu.node);
+  }
+  return std::vector<int>(nodes.begin(), nodes.end());
+}
+
+std::vector<size_t> CpuTopology::node_cpus(int node) const {
+  std::vector<size_t> first_threads;
+  std::vector<size_t> siblings;
+  for (const auto &cpu : cpus_) {
+    if (cpu.node != node) {
+      continue;
+    }
+    if (cpu.siblings.front() == cpu.id) {
+      first_threads.push_back(cpu.id);
+    }
+    else {
+      siblings.push_back(cpu.id);
+    }
+  }
+  first_threads.insert(first_threads.end(), siblings.begin(), siblings.end());
+  return first_threads;
+}
+
+} // swm
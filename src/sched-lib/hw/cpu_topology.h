@@ -0,0 +1,52 @@
+#pragma once
+
+#include "defs.h"
+
+namespace swm {
+
+// Layout of logical CPUs: cores, SMT siblings, caches and NUMA nodes, as it's described by
+// sysfs ("<root>/cpu" and "<root>/node", where root is usually "/sys/devices/system").
+// Empty topology means that the layout is unknown (no sysfs, e.g. Windows)
+class CpuTopology {
+ public:
+  struct LogicalCpu {
+    size_t id;
+    int core;                         // core_id, unique within the package only
+    int package;
+    int node;                         // 0 if the kernel has no NUMA support
+    std::vector<size_t> siblings;     // SMT threads of the same core, including this one
+  };
+
+  struct Cache {
+    int level;
+    std::string type;                 // "Data", "Instruction" or "Unified"
+    size_t size_kb;
+    std::vector<size_t> cpus;         // logical CPUs that share the cache
+  };
+
+  CpuTopology() { }
+
+  // Replaces the current layout, keeps it untouched if fails
+  bool read(const std::string &root, std::stringstream *errors);
+
+  bool empty() const { return cpus_.empty(); }
+  const std::vector<LogicalCpu> &cpus() const { return cpus_; }
+  const std::vector<Cache> &caches() const { return caches_; }
+  size_t physical_cores() const;
+
+  // Ascending identifiers of NUMA nodes that have CPUs
+  std::vector<int> nodes() const;
+
+  // CPUs of the node, the first threads of all cores go before their SMT siblings,
+  // so the prefix of the list is spread over physical cores
+  std::vector<size_t> node_cpus(int node) const;
+
+  // Parses kernel's CPU list format, e.g. "0-3,8,10-11"
+  static bool parse_cpu_list(const std::string &str, std::vector<size_t> *res);
+
+ private:
+  std::vector<LogicalCpu> cpus_;
+  std::vector<Cache> caches_;
+};
+
+} // swm
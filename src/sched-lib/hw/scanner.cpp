@@ -6,14 +6,55 @@
 #if defined(WIN32)
 #include <Windows.h>
 #else
-#include <sys/sysinfo.h>
-#include <cstring>
+#include <sched.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+
+#include "auxl/file.h"
+
 namespace swm {
 
-std::string Scanner::find_cpu_name() {
+#if !defined(WIN32)
+// Values of "key : value" lines of /proc/cpuinfo, one per processor
+static std::vector<std::string> cpuinfo_values(const std::string &cpuinfo, const std::string &key) {
+  std::vector<std::string> res;
+  std::stringstream sstr(cpuinfo);
+  std::string line;
+  while (std::getline(sstr, line)) {
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos || line.compare(0, key.size(), key) != 0 ||
+        line.find_first_not_of(" \t", key.size()) != colon) {
+      continue;
+    }
+    const size_t begin = line.find_first_not_of(" \t", colon + 1);
+    const size_t end = line.find_last_not_of(" \t\r");
+    res.push_back(begin == std::string::npos ? std::string() : line.substr(begin, end - begin + 1));
+  }
+  return res;
+}
+#endif
+
+std::vector<size_t> Scanner::find_affinity() {
+  std::vector<size_t> res;
+#if !defined(WIN32)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        res.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return res;
+}
+
+std::string Scanner::find_cpu_name(const std::string &cpuinfo) {
 #if defined(WIN32)
+  (void)cpuinfo;
   HKEY r_key;
   if (RegOpenKeyExA(HKEY_LOCAL_MACHINE,
                     "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0",
@@ -38,63 +79,33 @@ std::string Scanner::find_cpu_name() {
     return res.substr(0, res.find('\0'));
   }
 #else
-  FILE *fp;
-  char res[2048] = { 0 };
-  fp = popen("/bin/cat /proc/cpuinfo | grep 'model name'", "r");
-  const char* fr = fgets(res, sizeof(res) - 1, fp);
-
-  if (fr == NULL) {
-    throw std::runtime_error("Scanner::find_cpu_name(): cannot read file");
-  }
-
-  if (!res[0]) {
+  const auto names = cpuinfo_values(cpuinfo, "model name");
+  if (names.empty() || names.front().empty()) {
     throw std::runtime_error("Scanner::find_cpu_name(): unknown CPU model");
   }
-  char *mn = strchr(res, ':');
-  if (mn && strlen(mn) > 2) {
-    mn += 2;
-    //while (mn[0] && mn[strlen(mn) - 1] == '\n')
-      // FIXME the loop is endless!
-      //mn[strlen(mn) - 1] = 0;
-  }
-
-  pclose(fp);
-  return mn;
+  return names.front();
 #endif
 }
 
-size_t Scanner::find_cpu_cores() {
+size_t Scanner::find_cpu_cores(const std::string &cpuinfo) {
 #if defined(WIN32)
+  (void)cpuinfo;
   SYSTEM_INFO s_info;
   GetSystemInfo(&s_info);
   return s_info.dwNumberOfProcessors;
 #else
-  FILE *fp;
-  char res[8] = { 0 };
-  static const char* cmd = "/bin/cat /proc/cpuinfo | grep -c '^processor'";
-  fp = popen(cmd, "r");
-  if (fp == NULL) {
-    const std::string err = std::string("Scanner::find_cpu_cores(): cannot run command: ") + cmd;
-    throw std::runtime_error(err);
-  }
-
-  const size_t fr = fread(res, 1, sizeof(res) - 1, fp);
-
-  if (fr <= 0) {
-    throw std::runtime_error("Scanner::find_cpu_cores(): cannot read command output");
-  }
-
-  if (!res[0]) {
+  const size_t cores = cpuinfo_values(cpuinfo, "processor").size();
+  if (cores == 0) {
     throw std::runtime_error("Scanner::find_cpu_cores(): unknown cores");
   }
-
-  pclose(fp);
-  return std::max(1, atoi(res));
+  return cores;
 #endif
 }
 
-double Scanner::find_cpu_freq() {
+double Scanner::find_cpu_freq(const std::string &cpuinfo, const std::string &sysfs_root) {
 #if defined(WIN32)
+  (void)cpuinfo;
+  (void)sysfs_root;
   HKEY r_key;
   if (RegOpenKeyExA(HKEY_LOCAL_MACHINE,
                     "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0",
@@ -119,24 +130,20 @@ double Scanner::find_cpu_freq() {
     return res;
   }
 #else
-  FILE * fp;
-  char res[2048] = { 0 };
-  fp = popen("/bin/cat /proc/cpuinfo | grep 'cpu MHz'", "r");
-  double mhz = 0;
-  while (fgets(res, sizeof(res) - 1, fp)) {
-    char *mh = strchr(res, ':');
-    if (mh && strlen(mh) > 2) {
-      mh += 2;
-      double cand = atof(mh);
-      if (cand > mhz) {
-        mhz = cand;
-      } else {
-        throw std::runtime_error("Scanner::find_cpu_freq(): unknown frequency");
-      }
-    }
+  // Nominal maximum is more stable than the current frequency of cpuinfo, but it's not virtualized
+  std::string khz;
+  if (util::read_first_line(sysfs_root + "/cpu/cpu0/cpufreq/cpuinfo_max_freq", &khz) &&
+      atof(khz.c_str()) > 0.0) {
+    return atof(khz.c_str()) / 1000.0;
   }
 
-  pclose(fp);
+  double mhz = 0;
+  for (const auto &value : cpuinfo_values(cpuinfo, "cpu MHz")) {
+    mhz = std::max(mhz, atof(value.c_str()));
+  }
+  if (mhz <= 0.0) {
+    throw std::runtime_error("Scanner::find_cpu_freq(): unknown frequency");
+  }
   return mhz;
 #endif
 }
@@ -146,27 +153,60 @@ bool Scanner::scan() {
     return false;
   }
 
+  // Files of procfs are generated on read, the whole one is read at once
+  const std::string sysfs_root = root_ + "/sys/devices/system";
+  std::string cpuinfo;
+#if !defined(WIN32)
+  if (!util::read_file(root_ + "/proc/cpuinfo", &cpuinfo)) {
+    std::cerr << "Failed to read \"" << root_ << "/proc/cpuinfo\"" << std::endl;
+  }
+
+  std::stringstream errors;
+  if (!topology_.read(sysfs_root, &errors)) {
+    std::cerr << "Failed to determine CPU topology: " << errors.str() << std::endl;
+  }
+  errors.str(std::string());
+  if (!limits_.read(root_, &errors)) {
+    std::cerr << "Failed to determine CPU limits: " << errors.str() << std::endl;
+  }
+  if (root_.empty()) {
+    limits_.restrict_to(find_affinity());
+  }
+#endif
+
   std::string name;
   try {
-    name = find_cpu_name();
+    name = find_cpu_name(cpuinfo);
   }
   catch (const std::exception &ex) {
     name = "Unknown CPU";
     std::cerr << "Failed to determine CPU model: " << ex.what() << std::endl;
   }
 
-  size_t cores;
-  try {
-    cores = find_cpu_cores();
+  // Online CPUs of the host, the usable part of them is limited by cgroups and affinity
+  std::vector<size_t> online;
+  for (const auto &cpu : topology_.cpus()) {
+    online.push_back(cpu.id);
   }
-  catch (const std::exception &ex) {
-    cores = 1;
-    std::cerr << "Failed to determine count of CPU cores: " << ex.what() << std::endl;
+  if (online.empty()) {
+    size_t cores;
+    try {
+      cores = find_cpu_cores(cpuinfo);
+    }
+    catch (const std::exception &ex) {
+      cores = 1;
+      std::cerr << "Failed to determine count of CPU cores: " << ex.what() << std::endl;
+    }
+    for (size_t i = 0; i < cores; ++i) {
+      online.push_back(i);
+    }
   }
+  const size_t cores = limits_.usable_cpus(online);
+  const auto allowed = limits_.filter(online);
 
   double freq_mhz;
   try {
-    freq_mhz = find_cpu_freq();
+    freq_mhz = find_cpu_freq(cpuinfo, sysfs_root);
   }
   catch (const std::exception &ex) {
     freq_mhz = 1000;
@@ -174,7 +214,23 @@ bool Scanner::scan() {
     //std::cerr << "Failed to determine CPU frequency: " << ex.what() << std::endl;
   }
 
-  cpu_.reset(new swm::ComputeUnit(swm::ComputeUnit::Type::Cpu, 1, name, cores, freq_mhz));
+  // CPU list is known only if there is topology, otherwise the unit cannot be bound
+  cpu_.reset(new swm::ComputeUnit(swm::ComputeUnit::Type::Cpu, 1, name, cores, freq_mhz,
+                                  topology_.empty() ? std::vector<size_t>() : allowed));
+
+  // Quota is shared by nodes in proportion to their usable CPUs
+  for (const int node : topology_.nodes()) {
+    const auto cpus = limits_.filter(topology_.node_cpus(node));
+    if (cpus.empty()) {
+      continue;
+    }
+    const size_t share = (size_t)std::ceil((double)cores * (double)cpus.size() / (double)allowed.size());
+    numa_nodes_.emplace_back(new swm::ComputeUnit(swm::ComputeUnit::Type::Cpu, node, name,
+                                                  std::max<size_t>(std::min(share, cpus.size()), 1),
+                                                  freq_mhz, cpus));
+    numa_nodes_ptrs_.push_back(numa_nodes_.back().get());
+  }
+
   inited_ = true;
   return true;
 }
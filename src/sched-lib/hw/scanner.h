@@ -1,14 +1,19 @@
-
 #pragma once
 
 #include "defs.h"
 #include "compute_unit.h"
+#include "cpu_limits.h"
+#include "cpu_topology.h"
 
 namespace swm {
 
+// Discovers the hardware by reading procfs and sysfs directly. CPU units report only cores
+// that the process can actually use: cgroup quota and cpuset are taken into account
 class Scanner {
  public:
-  Scanner() : inited_(false) {}
+  // "root" prefixes "/proc" and "/sys" paths, tests point it to a fake tree
+  explicit Scanner(const std::string &root = std::string())
+      : inited_(false), root_(root) {}
   bool scan();
     
   const ComputeUnit *cpu() const {
@@ -19,15 +24,35 @@ class Scanner {
     return gpus_ptrs_;
   }
 
+  // Part of the CPU on every NUMA node as a unit with its usable CPU list,
+  // empty if the topology is unknown
+  const std::vector<const ComputeUnit *> &numa_nodes() const {
+    return numa_nodes_ptrs_;
+  }
+
+  const CpuTopology &topology() const {
+    return topology_;
+  }
+
+  const CpuLimits &limits() const {
+    return limits_;
+  }
+
  private:
-  static std::string find_cpu_name();
-  static size_t find_cpu_cores();
-  static double find_cpu_freq();
+  static std::string find_cpu_name(const std::string &cpuinfo);
+  static size_t find_cpu_cores(const std::string &cpuinfo);
+  static double find_cpu_freq(const std::string &cpuinfo, const std::string &sysfs_root);
+  static std::vector<size_t> find_affinity();
 
   bool inited_;
+  std::string root_;
+  CpuTopology topology_;
+  CpuLimits limits_;
   std::unique_ptr<ComputeUnit> cpu_;
   std::vector<std::unique_ptr<ComputeUnit> > gpus_;
   std::vector<const ComputeUnit *> gpus_ptrs_;
+  std::vector<std::unique_ptr<ComputeUnit> > numa_nodes_;
+  std::vector<const ComputeUnit *> numa_nodes_ptrs_;
 };
 
 } // swm
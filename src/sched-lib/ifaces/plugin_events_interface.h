@@ -1,17 +1,94 @@
-
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 #include "defs.h"
 #include "timetable_info_interface.h"
+#include "trace_interface.h"
 
 extern "C" {
 namespace swm {
 
+// Flag of cooperative cancellation: the algorithm has to stop as soon as possible.
+// Checking it costs a single relaxed load without virtual calls, so it fits the hottest loops.
+// Token is cancelled when its own flag or the flag of some ancestor is set: cancellation is pushed
+// down to the children when it happens, the check doesn't walk the ancestors.
+// Parent must outlive its children
+class CancellationToken {
+ public:
+  explicit CancellationToken(const CancellationToken *parent = nullptr)
+      : cancelled_(false), parent_(parent) {
+    if (parent_ != nullptr) {
+      std::lock_guard<std::mutex> lock(parent_->mutex_);
+      parent_->children_.push_back(this);
+      cancelled_.store(parent_->cancelled(), std::memory_order_relaxed);
+    }
+  }
+  CancellationToken(const CancellationToken &) = delete;
+  ~CancellationToken() {
+    if (parent_ != nullptr) {
+      std::lock_guard<std::mutex> lock(parent_->mutex_);
+      auto &children = parent_->children_;
+      children.erase(std::find(children.begin(), children.end(), this));
+    }
+  }
+  void operator =(const CancellationToken &) = delete;
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+  void cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto child : children_) {
+      child->cancel();
+    }
+  }
+  // Own flag only: the token stays cancelled while some ancestor is. Parent's lock orders it with
+  // the cancellation coming from above
+  void reset() {
+    if (parent_ == nullptr) {
+      cancelled_.store(false, std::memory_order_relaxed);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(parent_->mutex_);
+    cancelled_.store(parent_->cancelled(), std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> cancelled_;
+  const CancellationToken *parent_;
+  mutable std::mutex mutex_;                          // guards "children_"
+  mutable std::vector<CancellationToken *> children_;
+};
+
 class PluginEventsInterface {
  public:
+  typedef std::chrono::steady_clock clock;
+
   virtual ~PluginEventsInterface() { }
   virtual bool forced_to_interrupt() const = 0;
   virtual void commit_intermediate_timetable(const std::shared_ptr<TimetableInfoInterface> &tt) = 0;
+
+  // Valid during the call of the algorithm. It's cancelled in the same cases as forced_to_interrupt()
+  // returns true, except the deadline: the clock is checked by forced_to_interrupt() or by the algorithm
+  virtual const CancellationToken &cancellation_token() const = 0;
+
+  // Result is expected by this moment, the algorithm is forced to stop after it.
+  // "clock::time_point::max()" if there is no limit
+  virtual clock::time_point deadline() const = 0;
+
+  // Seconds left until the deadline: zero if it has passed, infinity if there is no limit
+  double remaining_budget() const {
+    const clock::time_point at = deadline();
+    if (at == clock::time_point::max()) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return std::max(std::chrono::duration<double>(at - clock::now()).count(), 0.0);
+  }
+
+  // Spans of the algorithm go there, nullptr if tracing is off
+  virtual TraceInterface *trace() const { return nullptr; }
 };
 
 } // extern "C"
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+
+#include "defs.h"
+
+extern "C" {
+namespace swm {
+
+// Timeline of the service: spans are recorded by the thread that has performed them.
+// "name" is not copied, so it must outlive the trace (string literals are expected)
+class TraceInterface {
+ public:
+  typedef std::chrono::steady_clock clock;
+
+  virtual ~TraceInterface() { }
+  virtual void add_span(const char *name, clock::time_point begin, clock::time_point end) = 0;
+};
+
+// Records time from construction to destruction, does nothing (even clock reads) without trace
+class TraceSpan {
+ public:
+  TraceSpan(TraceInterface *trace, const char *name)
+      : trace_(trace), name_(name),
+        begin_(trace != nullptr ? TraceInterface::clock::now() : TraceInterface::clock::time_point()) { }
+  TraceSpan(const TraceSpan &) = delete;
+  ~TraceSpan() {
+    if (trace_ != nullptr) {
+      trace_->add_span(name_, begin_, TraceInterface::clock::now());
+    }
+  }
+  void operator =(const TraceSpan &) = delete;
+
+ private:
+  TraceInterface *trace_;
+  const char *name_;
+  TraceInterface::clock::time_point begin_;
+};
+
+} // extern "C"
+} // swm
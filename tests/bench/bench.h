@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "defs.h"
+
+// Minimal harness for microbenchmarks: runs the body several times and prints the best result
+inline void run_benchmark(const std::string &name, size_t operations, size_t repeats,
+                          const std::function<void()> &body) {
+  double best = 0.0;
+  for (size_t i = 0; i < repeats; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  std::cout << std::left << std::setw(48) << name
+            << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+            << best * 1e9 / (double)operations << " ns/op"
+            << std::setw(14) << std::setprecision(2) << (double)operations / best / 1e6 << " Mops/s"
+            << std::endl;
+}
@@ -0,0 +1,11 @@
+#include "metrics_bench.h"
+#include "queue_bench.h"
+#include "transport_bench.h"
+
+// Microbenchmarks for the hot paths of sched-lib, results are printed to stdout
+int main() {
+  run_queue_benchmarks();
+  run_transport_benchmarks();
+  run_metrics_benchmarks();
+  return 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "bench.h"
+#include "auxl/metrics.h"
+#include "auxl/metrics_registry.h"
+
+// Every thread makes "updates" updates of three values, as service does for every compressed response
+template <class Body>
+void metrics_contention(size_t threads_count, size_t updates, const Body &body) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&body, updates]() -> void {
+      for (size_t i = 0; i < updates; ++i) {
+        body();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+inline void run_metrics_benchmarks() {
+  const size_t updates = 1 << 17;
+  const size_t repeats = 3;
+  for (size_t threads : { 1, 2, 4, 8 }) {
+    const std::string suffix = "(" + std::to_string(threads) + " threads)";
+
+    swm::util::Metrics metrics;
+    metrics.register_int_value(1, "count");
+    metrics.register_double_value(2, "bytes");
+    metrics.register_double_value(3, "seconds");
+    run_benchmark("Metrics update " + suffix, updates * threads, repeats, [&]() -> void {
+      metrics_contention(threads, updates, [&metrics]() -> void {
+        metrics.update_int_value(1, 1);
+        metrics.update_double_value(2, 100.0);
+        metrics.update_double_value(3, 0.001);
+      });
+    });
+
+    swm::util::MetricsRegistry registry;
+    registry.register_int_value(1, "count");
+    registry.register_double_value(2, "bytes");
+    registry.register_double_value(3, "seconds");
+    const auto count = registry.int_handle(1);
+    const auto bytes = registry.double_handle(2);
+    const auto seconds = registry.double_handle(3);
+    run_benchmark("MetricsRegistry update " + suffix, updates * threads, repeats, [&]() -> void {
+      metrics_contention(threads, updates, [&]() -> void {
+        registry.update().add_int(count, 1).add_double(bytes, 100.0).add_double(seconds, 0.001);
+      });
+    });
+  }
+
+  swm::util::Metrics metrics;
+  swm::util::MetricsRegistry registry;
+  for (uint32_t id = 0; id < 16; ++id) {
+    metrics.register_int_value(id, "value");
+    registry.register_int_value(id, "value");
+  }
+  run_benchmark("Metrics clone (16 values)", updates / 16, repeats, [&]() -> void {
+    for (size_t i = 0; i < updates / 16; ++i) {
+      metrics.clone();
+    }
+  });
+  run_benchmark("MetricsRegistry snapshot (16 values)", updates / 16, repeats, [&]() -> void {
+    for (size_t i = 0; i < updates / 16; ++i) {
+      registry.snapshot();
+    }
+  });
+}
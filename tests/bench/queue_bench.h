@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+#include "bench.h"
+#include "auxl/blocking_queue.h"
+
+// Reference implementation: the plain mutex-protected queue with two condition variables
+template <class T>
+class MutexQueue {
+ public:
+  explicit MutexQueue(size_t max_size) : max_size_(max_size) { }
+  MutexQueue(const MutexQueue &) = delete;
+  void operator =(const MutexQueue &) = delete;
+
+  void push(const T &value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() -> bool { return queue_.size() < max_size_; });
+    queue_.push(value);
+    not_empty_.notify_one();
+  }
+
+  T pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() -> bool { return !queue_.empty(); });
+    T value = queue_.front();
+    queue_.pop();
+    not_full_.notify_one();
+    return value;
+  }
+
+ private:
+  size_t max_size_;
+  std::queue<T> queue_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+// Producers push "items" elements in total, consumers pop all of them
+template <class Queue>
+void queue_contention(Queue *queue, size_t producers, size_t consumers, size_t items) {
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([queue, count = items / producers]() -> void {
+      auto value = std::make_shared<int>(0);
+      for (size_t i = 0; i < count; ++i) {
+        queue->push(value);
+      }
+    });
+  }
+  for (size_t c = 0; c < consumers; ++c) {
+    threads.emplace_back([queue, count = items / consumers]() -> void {
+      for (size_t i = 0; i < count; ++i) {
+        queue->pop();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+inline void run_queue_benchmarks() {
+  const size_t items = 1 << 17;
+  const size_t repeats = 3;
+  const std::vector<std::pair<size_t, size_t> > configs = { {1, 1}, {2, 2}, {4, 1}, {4, 4}, {8, 8} };
+  const std::vector<size_t> capacities = { 4, 1024 };
+
+  for (size_t capacity : capacities) {
+    for (const auto &config : configs) {
+      std::stringstream suffix;
+      suffix << "(" << config.first << "P/" << config.second << "C, capacity " << capacity << ")";
+
+      run_benchmark("MutexQueue " + suffix.str(), items, repeats, [&]() -> void {
+        MutexQueue<std::shared_ptr<int> > queue(capacity);
+        queue_contention(&queue, config.first, config.second, items);
+      });
+      run_benchmark("BlockingQueue " + suffix.str(), items, repeats, [&]() -> void {
+        swm::util::BlockingQueue<std::shared_ptr<int> > queue(capacity);
+        queue_contention(&queue, config.first, config.second, items);
+      });
+    }
+  }
+}
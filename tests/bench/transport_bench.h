@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string.h>
+
+#include "bench.h"
+#include "auxl/shm_ring.h"
+
+#if !defined(WIN32)
+#include <unistd.h>
+
+// Reference transport: length-prefixed frames through a pipe, every frame is copied into
+// a new buffer by the reader (as the receiver does with the standard input)
+inline void pipe_transfer(size_t frame_size, size_t frames) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return;
+  }
+  std::thread writer([fd = fds[1], frame_size, frames]() -> void {
+    std::vector<char> frame(4 + frame_size, 'x');
+    const uint32_t len = (uint32_t)frame_size;
+    memcpy(frame.data(), &len, 4);
+    for (size_t i = 0; i < frames; ++i) {
+      for (size_t done = 0; done < frame.size(); ) {
+        const ssize_t res = write(fd, frame.data() + done, frame.size() - done);
+        if (res <= 0) {
+          return;
+        }
+        done += (size_t)res;
+      }
+    }
+  });
+  auto read_all = [fd = fds[0]](char *dst, size_t size) -> void {
+    while (size > 0) {
+      const ssize_t res = read(fd, dst, size);
+      if (res <= 0) {
+        return;
+      }
+      dst += res;
+      size -= (size_t)res;
+    }
+  };
+  for (size_t i = 0; i < frames; ++i) {
+    uint32_t len = 0;
+    read_all((char *)&len, 4);
+    std::unique_ptr<char[]> data(new char[len]);
+    read_all(data.get(), len);
+  }
+  writer.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Frames are filled in place by the producer and read in place by the consumer
+inline void ring_transfer(swm::util::ShmRing *ring, size_t frame_size, size_t frames) {
+  std::thread producer([ring, frame_size, frames]() -> void {
+    for (size_t i = 0; i < frames; ++i) {
+      char *data = ring->reserve(frame_size, 10.0);
+      if (data == nullptr) {
+        return;
+      }
+      memset(data, 'x', frame_size);
+      ring->commit();
+    }
+  });
+  swm::util::ShmRing::Frame frame;
+  for (size_t i = 0; i < frames && ring->acquire(&frame, 10.0); ++i) {
+    ring->release(frame);
+  }
+  producer.join();
+}
+
+inline void run_transport_benchmarks() {
+  const size_t repeats = 3;
+  const std::vector<size_t> frame_sizes = { 4 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+
+  for (size_t frame_size : frame_sizes) {
+    const size_t frames = std::max<size_t>(16, (64 * 1024 * 1024) / frame_size);
+    std::stringstream suffix;
+    suffix << "(" << frame_size / 1024 << " KiB frames)";
+
+    run_benchmark("Pipe " + suffix.str(), frames, repeats, [&]() -> void {
+      pipe_transfer(frame_size, frames);
+    });
+    swm::util::ShmRing ring;
+    if (!ring.create(std::max<size_t>(4 * frame_size + 64, 1 << 20))) {
+      continue;
+    }
+    run_benchmark("ShmRing " + suffix.str(), frames, repeats, [&]() -> void {
+      ring_transfer(&ring, frame_size, frames);
+    });
+  }
+}
+
+#else
+
+inline void run_transport_benchmarks() { }
+
+#endif
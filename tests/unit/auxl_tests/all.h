@@ -1,10 +1,17 @@
-
 #pragma once
 
+#include "blocking_queue_tests.h"
 #include "cli_args_parser_tests.h"
+#include "digest_tests.h"
 #include "directory_tests.h"
+#include "executor_tests.h"
 #include "file_tests.h"
+#include "latency_histogram_tests.h"
 #include "lib_funcs_tests.h"
+#include "metrics_registry_tests.h"
 #include "metrics_tests.h"
-#include "my_queue_tests.h"
+#include "shm_ring_tests.h"
+#include "term_compression_tests.h"
 #include "time_counter_tests.h"
+#include "timer_wheel_tests.h"
+#include "tracer_tests.h"
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/blocking_queue.h"
+
+TEST(auxl, blocking_queue_logic) {
+  swm::util::BlockingQueue<int> q(4);
+  ASSERT_EQ(q.size(), 4);
+  ASSERT_EQ(q.element_count(), 0);
+  q.push(2);
+  q.push(3);
+  q.push(4);
+  ASSERT_EQ(q.element_count(), 3);
+  ASSERT_EQ(q.pop(), 2);
+  ASSERT_EQ(q.pop(), 3);
+  ASSERT_EQ(q.pop(), 4);
+  ASSERT_EQ(q.element_count(), 0);
+}
+
+TEST(auxl, blocking_queue_looping) {
+  swm::util::BlockingQueue<float> q(3);
+  q.push(0.0f);
+  for (size_t i = 0; i < 10; ++i) {
+    q.push(2.0f);
+    q.push(3.0f);
+    q.pop();
+    q.pop();
+  }
+  ASSERT_EQ(q.element_count(), 1);
+  ASSERT_EQ(q.pop(), 3.0f);
+}
+
+TEST(auxl, blocking_queue_try_operations) {
+  int tmp = -1;
+  swm::util::BlockingQueue<int> queue(2);
+  ASSERT_ANY_THROW(queue.try_pop(nullptr));
+  ASSERT_FALSE(queue.try_pop(&tmp));
+  ASSERT_TRUE(queue.try_push(2));
+  ASSERT_TRUE(queue.try_push(3));
+  ASSERT_FALSE(queue.try_push(4));
+  ASSERT_TRUE(queue.try_pop(&tmp));
+  ASSERT_EQ(tmp, 2);
+  ASSERT_EQ(queue.element_count(), 1);
+}
+
+TEST(auxl, blocking_queue_timed_pop) {
+  int tmp = -1;
+  swm::util::BlockingQueue<int> queue(2);
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_FALSE(queue.pop_for(&tmp, std::chrono::milliseconds(20)));
+  ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+  std::thread writer([&queue]() -> void {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.push(42);
+  });
+  ASSERT_TRUE(queue.pop_for(&tmp, std::chrono::seconds(10)));
+  ASSERT_EQ(tmp, 42);
+  writer.join();
+}
+
+TEST(auxl, blocking_queue_close_and_drain) {
+  int tmp = -1;
+  swm::util::BlockingQueue<int> queue(2);
+  queue.push(1);
+
+  // Blocked producer must be released by close()
+  std::thread writer([&queue]() -> void {
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_FALSE(queue.push(3));
+  });
+  while (queue.element_count() < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.close();
+  writer.join();
+
+  ASSERT_TRUE(queue.closed());
+  ASSERT_FALSE(queue.try_push(4));
+  ASSERT_TRUE(queue.pop(&tmp));
+  ASSERT_EQ(tmp, 1);
+  ASSERT_TRUE(queue.pop_for(&tmp, std::chrono::seconds(10)));
+  ASSERT_EQ(tmp, 2);
+  ASSERT_FALSE(queue.pop(&tmp));
+  ASSERT_ANY_THROW(queue.pop());
+}
+
+TEST(auxl, blocking_queue_close_wakes_consumers) {
+  swm::util::BlockingQueue<int> queue(2);
+  std::thread reader([&queue]() -> void {
+    int tmp = -1;
+    ASSERT_FALSE(queue.pop(&tmp));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.close();
+  reader.join();
+}
+
+TEST(auxl, blocking_queue_wake_consumer) {
+  swm::util::BlockingQueue<int> queue(2);
+  std::thread reader([&queue]() -> void {
+    int tmp = -1;
+    ASSERT_FALSE(queue.pop(&tmp));
+    ASSERT_EQ(tmp, -1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue.wake_consumer();
+  reader.join();
+
+  // Request is not lost when nobody is waiting, and it is consumed only once
+  int tmp = -1;
+  queue.wake_consumer();
+  ASSERT_FALSE(queue.pop_for(&tmp, std::chrono::seconds(10)));
+  ASSERT_FALSE(queue.pop_for(&tmp, std::chrono::milliseconds(1)));
+  ASSERT_TRUE(queue.push(5));
+  queue.wake_consumer();
+  ASSERT_TRUE(queue.pop(&tmp));
+  ASSERT_EQ(tmp, 5);
+  ASSERT_FALSE(queue.closed());
+}
+
+TEST(auxl, blocking_queue_concurrency) {
+  const int n = 16 * 1024;
+  const int writers = 4;
+  swm::util::BlockingQueue<int> queue(64);
+  std::vector<std::vector<int> > values(2);
+  std::atomic<bool> go_flag(false);
+
+  auto writer = [go = &go_flag, q = &queue, n, writers](int shift) -> void {
+    while (!*go) std::this_thread::yield();
+    for (int i = shift; i < n; i += writers)
+      q->push(i);
+  };
+  auto reader = [go = &go_flag, q = &queue](std::vector<int> *vals) -> void {
+    while (!*go) std::this_thread::yield();
+    int value;
+    while (q->pop(&value))
+      vals->push_back(value);
+  };
+  std::vector<std::thread> writer_threads;
+  for (int i = 0; i < writers; ++i)
+    writer_threads.emplace_back(writer, i);
+  std::thread reader_thread1(reader, &values[0]);
+  std::thread reader_thread2(reader, &values[1]);
+
+  go_flag = true;
+  for (auto &thread : writer_threads)
+    thread.join();
+  queue.close();
+  reader_thread1.join();
+  reader_thread2.join();
+
+  std::set<int> all(values[0].begin(), values[0].end());
+  all.insert(values[1].begin(), values[1].end());
+  ASSERT_EQ(values[0].size() + values[1].size(), (size_t)n);
+  ASSERT_EQ(all.size(), (size_t)n);
+}
+
+TEST(auxl, blocking_queue_single_cell) {
+  int tmp = -1;
+  swm::util::BlockingQueue<int> queue(1);
+  ASSERT_TRUE(queue.try_push(1));
+  ASSERT_FALSE(queue.try_push(2));
+  ASSERT_EQ(queue.element_count(), 1);
+  ASSERT_TRUE(queue.try_pop(&tmp));
+  ASSERT_FALSE(queue.try_pop(&tmp));
+  ASSERT_TRUE(queue.try_push(3));
+  ASSERT_EQ(queue.pop(), 3);
+}
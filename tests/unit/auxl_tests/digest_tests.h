@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/digest.h"
+
+TEST(auxl, digest_stable) {
+  const std::string empty = swm::util::Digest().hex();
+  ASSERT_EQ(empty.size(), 32);
+  ASSERT_EQ(empty, swm::util::Digest().hex());
+
+  swm::util::Digest a, b;
+  a.update(std::string("jobs")).update((uint64_t)42).update(0.5);
+  b.update(std::string("jobs")).update((uint64_t)42).update(0.5);
+  ASSERT_EQ(a.hex(), b.hex());
+  ASSERT_NE(a.hex(), empty);
+}
+
+TEST(auxl, digest_boundaries) {
+  // Strings are length-prefixed, so moving a byte between them changes the digest
+  swm::util::Digest a, b;
+  a.update(std::string("ab")).update(std::string("c"));
+  b.update(std::string("a")).update(std::string("bc"));
+  ASSERT_NE(a.hex(), b.hex());
+
+  swm::util::Digest c, d;
+  c.update("abc", 3);
+  d.update("abd", 3);
+  ASSERT_NE(c.hex(), d.hex());
+}
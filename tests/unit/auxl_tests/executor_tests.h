@@ -0,0 +1,68 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/executor.h"
+
+#if !defined(WIN32)
+#include <sched.h>
+#endif
+
+TEST(auxl, executor_inline) {
+  swm::util::Executor executor(0);
+  ASSERT_TRUE(executor.inline_mode());
+  ASSERT_EQ(executor.threads(), 0);
+  ASSERT_ANY_THROW(executor.submit(swm::util::Executor::Task()));
+
+  std::thread::id id;
+  executor.submit([&id]() -> void { id = std::this_thread::get_id(); });
+  ASSERT_EQ(id, std::this_thread::get_id());
+  ASSERT_EQ(executor.executed_tasks(), 1);
+}
+
+TEST(auxl, executor_all_tasks_performed) {
+  const size_t TASKS = 1000;
+  std::atomic<size_t> counter(0);
+  {
+    swm::util::Executor executor(4);
+    ASSERT_EQ(executor.threads(), 4);
+    for (size_t i = 0; i < TASKS; ++i) {
+      executor.submit([&counter, &executor]() -> void {
+        counter.fetch_add(1);
+        executor.submit([&counter]() -> void { counter.fetch_add(1); });
+      });
+    }
+  } // destructor waits for enqueued tasks
+  ASSERT_EQ(counter.load(), 2 * TASKS);
+}
+
+TEST(auxl, executor_stealing) {
+  const size_t TASKS = 100;
+  std::atomic<size_t> counter(0);
+  swm::util::Executor executor(2);
+
+  // Tasks are placed into the deque of busy worker, so they can be performed only by thief
+  std::atomic<bool> release(false);
+  executor.submit([&]() -> void {
+    for (size_t i = 0; i < TASKS; ++i) {
+      executor.submit([&counter]() -> void { counter.fetch_add(1); });
+    }
+    while (!release.load()) { std::this_thread::yield(); }
+  });
+  while (counter.load() < TASKS) { std::this_thread::yield(); }
+  ASSERT_EQ(executor.stolen_tasks(), TASKS);
+  ASSERT_EQ(executor.busy_threads(), 1);
+  release.store(true);
+}
+
+#if !defined(WIN32)
+TEST(auxl, executor_affinity) {
+  int cpu = -1;
+  {
+    swm::util::Executor executor(1, { { 0 } });
+    executor.submit([&cpu]() -> void { cpu = sched_getcpu(); });
+  }
+  ASSERT_EQ(cpu, 0);
+}
+#endif
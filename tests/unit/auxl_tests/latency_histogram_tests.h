@@ -0,0 +1,51 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/latency_histogram.h"
+
+TEST(auxl, latency_histogram_percentiles) {
+  swm::util::LatencyHistogram histogram;
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.percentile(0.99), 0.0);
+  ASSERT_ANY_THROW(histogram.percentile(1.5));
+
+  // 1..1000 us and a single outlier of one second
+  for (int us = 1; us <= 1000; ++us) {
+    histogram.record(std::chrono::microseconds(us));
+  }
+  histogram.record(1.0);
+  ASSERT_EQ(histogram.count(), 1001);
+  ASSERT_EQ(histogram.max(), 1.0);
+  ASSERT_NEAR(histogram.percentile(0.5), 501e-6, 501e-6 / 32);
+  ASSERT_NEAR(histogram.percentile(0.99), 991e-6, 991e-6 / 32);
+  ASSERT_EQ(histogram.percentile(1.0), 1.0);
+  ASSERT_EQ(histogram.percentile(0.0), 1e-6);
+
+  // Small values are exact
+  histogram.reset();
+  histogram.record(std::chrono::microseconds(42));
+  ASSERT_EQ(histogram.percentile(0.5), 42e-6);
+  histogram.record(-1.0);
+  ASSERT_EQ(histogram.percentile(0.0), 0.0);
+}
+
+TEST(auxl, latency_histogram_threads) {
+  swm::util::LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t]() -> void {
+      for (int i = 0; i < 10000; ++i) {
+        swm::util::LatencyHistogram::Scope scope(i % 2 == 0 ? &histogram : nullptr);
+      }
+      histogram.record(std::chrono::seconds(t + 1));
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(histogram.count(), 4 * 5001);
+  ASSERT_EQ(histogram.max(), 4.0);
+  ASSERT_LT(histogram.percentile(0.99), 0.1);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/metrics_registry.h"
+
+TEST(auxl, metrics_registry_register_get_set) {
+  swm::util::MetricsRegistry metrics(4);
+  ASSERT_NO_THROW(metrics.register_int_value(1, "int"));
+  ASSERT_NO_THROW(metrics.register_double_value(1, "double"));
+  ASSERT_ANY_THROW(metrics.register_int_value(1, "again"));
+  ASSERT_ANY_THROW(metrics.int_value(2));
+  ASSERT_ANY_THROW(metrics.double_handle(2));
+
+  ASSERT_EQ(metrics.update_int_value(1, 4), 4);
+  ASSERT_EQ(metrics.update_int_value(1, -6), -2);
+  ASSERT_EQ(metrics.update_double_value(1, 2.5), 2.5);
+  ASSERT_EQ(metrics.int_value(1), -2);
+  ASSERT_EQ(metrics.double_value(1), 2.5);
+
+  const auto ints = metrics.int_value_indices();
+  ASSERT_EQ(ints.size(), 1);
+  ASSERT_EQ(ints[0].second, "int");
+  ASSERT_EQ(metrics.double_value_indices().size(), 1);
+
+  ASSERT_NO_THROW(metrics.register_int_value(2, "third"));
+  ASSERT_NO_THROW(metrics.register_int_value(3, "fourth"));
+  ASSERT_ANY_THROW(metrics.register_int_value(4, "over capacity"));
+}
+
+TEST(auxl, metrics_registry_handles_reset) {
+  swm::util::MetricsRegistry metrics;
+  metrics.register_int_value(1, "count");
+  metrics.register_double_value(2, "seconds");
+  const auto count = metrics.int_handle(1);
+  const auto seconds = metrics.double_handle(2);
+
+  metrics.update().add_int(count, 3).add_double(seconds, 0.5);
+  {
+    auto outer = metrics.update();
+    outer.add_int(count, 1);
+    metrics.update().add_int(count, 1);
+  }
+  ASSERT_EQ(metrics.int_sum(count), 5);
+  ASSERT_EQ(metrics.double_sum(seconds), 0.5);
+
+  metrics.reset_int_value(1);
+  metrics.reset_double_value(2);
+  ASSERT_EQ(metrics.int_value(1), 0);
+  ASSERT_EQ(metrics.double_value(2), 0.0);
+  metrics.update().add_int(count, 2);
+  ASSERT_EQ(metrics.int_sum(count), 2);
+}
+
+TEST(auxl, metrics_registry_snapshot) {
+  swm::util::MetricsRegistry metrics;
+  metrics.register_int_value(1, "i#1");
+  metrics.register_double_value(2, "d#2");
+  metrics.update_int_value(1, 2);
+  metrics.update_double_value(2, 3.0);
+
+  std::shared_ptr<swm::MetricsInterface> snapshot = metrics.clone();
+  metrics.update_int_value(1, 10);
+  ASSERT_EQ(snapshot->int_value(1), 2);
+  ASSERT_EQ(snapshot->double_value(2), 3.0);
+  ASSERT_EQ(snapshot->int_value_indices().size(), 1);
+  ASSERT_EQ(snapshot->double_value_indices()[0].second, "d#2");
+  ASSERT_ANY_THROW(snapshot->int_value(2));
+  ASSERT_ANY_THROW(snapshot->update_int_value(1, 1));
+  ASSERT_ANY_THROW(snapshot->reset_double_value(2));
+  ASSERT_EQ(snapshot->clone()->int_value(1), 2);
+}
+
+TEST(auxl, metrics_registry_concurrency) {
+  swm::util::MetricsRegistry metrics;
+  metrics.register_int_value(1, "first");
+  metrics.register_int_value(2, "second");
+  const auto first = metrics.int_handle(1);
+  const auto second = metrics.int_handle(2);
+
+  // Values are updated together, so every snapshot has to see them equal
+  const size_t updates = 20000;
+  std::atomic<size_t> running(4);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() -> void {
+      for (size_t i = 0; i < updates; ++i) {
+        metrics.update().add_int(first, 1).add_int(second, 1);
+      }
+      running.fetch_sub(1);
+    });
+  }
+  size_t snapshots = 0;
+  while (running.load() != 0 || snapshots == 0) {
+    auto snapshot = metrics.snapshot();
+    ASSERT_EQ(snapshot->int_value(1), snapshot->int_value(2));
+    ++snapshots;
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(metrics.int_sum(first), 4 * (int64_t)updates);
+  ASSERT_EQ(metrics.int_value(2), 4 * (int32_t)updates);
+}
+
+TEST(auxl, metrics_registry_short_lived_threads) {
+  // Threads come and go (their ids are reused), registries are written by the same threads in turn
+  swm::util::MetricsRegistry first, second;
+  first.register_int_value(1, "first");
+  second.register_double_value(1, "second");
+  const auto ints = first.int_handle(1);
+  const auto doubles = second.double_handle(1);
+  const size_t rounds = 200;
+  for (size_t i = 0; i < rounds; ++i) {
+    std::thread([&]() -> void {
+      first.update().add_int(ints, 1);
+      second.update().add_double(doubles, 0.5);
+      first.update().add_int(ints, 1);
+    }).join();
+  }
+  ASSERT_EQ(first.int_sum(ints), 2 * (int64_t)rounds);
+  ASSERT_EQ(second.double_sum(doubles), 0.5 * (double)rounds);
+}
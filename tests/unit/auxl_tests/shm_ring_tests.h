@@ -0,0 +1,181 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test_defs.h"
+#include "auxl/shm_ring.h"
+
+#if !defined(WIN32)
+
+TEST(auxl, shm_ring_frames) {
+  swm::util::ShmRing ring;
+  ASSERT_ANY_THROW(ring.reserve(1, 0.0));
+  ASSERT_TRUE(ring.create(64));
+  ASSERT_EQ(ring.max_frame_size(), 56);
+  ASSERT_EQ(ring.reserve(57, 0.0), nullptr);
+
+  // 24 + 24 bytes with headers, the third frame doesn't fit until the first one is released
+  char *first = ring.reserve(10, 0.0);
+  ASSERT_NE(first, nullptr);
+  memcpy(first, "0123456789", 10);
+  ring.commit();
+  char *second = ring.reserve(16, 0.0);
+  ASSERT_NE(second, nullptr);
+  memcpy(second, "abcdefghijklmnop", 16);
+  ring.commit();
+  ASSERT_EQ(ring.reserve(16, 0.0), nullptr);
+
+  swm::util::ShmRing::Frame frame1, frame2, frame3;
+  ASSERT_TRUE(ring.acquire(&frame1, 0.0));
+  ASSERT_EQ(std::string(frame1.data, frame1.size), "0123456789");
+  ASSERT_TRUE(ring.acquire(&frame2, 0.0));
+  ASSERT_EQ(std::string(frame2.data, frame2.size), "abcdefghijklmnop");
+  ASSERT_FALSE(ring.acquire(&frame3, 0.0));
+
+  // Out of order release doesn't free the room of the earlier frame
+  ring.release(frame2);
+  ASSERT_EQ(ring.reserve(16, 0.0), nullptr);
+  ring.release(frame1);
+
+  // The end of the region is skipped, the frame starts from the beginning
+  char *third = ring.reserve(32, 0.0);
+  ASSERT_NE(third, nullptr);
+  memcpy(third, "0123456789abcdef0123456789abcdef", 32);
+  ring.commit();
+  ASSERT_TRUE(ring.acquire(&frame3, 0.0));
+  ASSERT_EQ(std::string(frame3.data, frame3.size), "0123456789abcdef0123456789abcdef");
+  ring.release(frame3);
+
+  // Committed frames are delivered after close
+  ASSERT_NE(ring.reserve(3, 0.0), nullptr);
+  ring.commit();
+  ring.close();
+  ASSERT_EQ(ring.reserve(3, 0.0), nullptr);
+  ASSERT_FALSE(ring.finished());
+  ASSERT_TRUE(ring.acquire(&frame1, 0.0));
+  ASSERT_EQ(frame1.size, 3);
+  ASSERT_TRUE(ring.finished());
+  ASSERT_FALSE(ring.acquire(&frame2, 1.0));
+}
+
+TEST(auxl, shm_ring_corrupted_frames) {
+  // Frame header is written by the other process: its size must fit into the committed bytes
+  swm::util::ShmRing ring;
+  ASSERT_TRUE(ring.create(64));
+  char *data = ring.reserve(8, 0.0);
+  ASSERT_NE(data, nullptr);
+  ring.commit();
+  uint32_t size = 40;
+  memcpy(data - 8, &size, sizeof(size));
+  swm::util::ShmRing::Frame frame;
+  std::stringstream errors;
+  ASSERT_FALSE(ring.corrupted());
+  ASSERT_FALSE(ring.acquire(&frame, 0.0, &errors));
+  ASSERT_FALSE(errors.str().empty());
+  ASSERT_TRUE(ring.corrupted());
+
+  // Nothing is read after the broken frame
+  ASSERT_NE(ring.reserve(8, 0.0), nullptr);
+  ring.commit();
+  ASSERT_FALSE(ring.acquire(&frame, 0.0));
+
+  // ... and it never crosses the end of the region, even if the next frames are committed
+  swm::util::ShmRing other;
+  ASSERT_TRUE(other.create(64));
+  swm::util::ShmRing::Frame frames[2];
+  for (auto &f : frames) {
+    ASSERT_NE(other.reserve(16, 0.0), nullptr);
+    other.commit();
+    ASSERT_TRUE(other.acquire(&f, 0.0));
+  }
+  for (auto &f : frames) {
+    other.release(f);
+  }
+  data = other.reserve(8, 0.0);
+  ASSERT_NE(data, nullptr);
+  other.commit();
+  ASSERT_NE(other.reserve(16, 0.0), nullptr);
+  other.commit();
+  size = 24;
+  memcpy(data - 8, &size, sizeof(size));
+  ASSERT_FALSE(other.acquire(&frame, 0.0));
+  ASSERT_TRUE(other.corrupted());
+}
+
+TEST(auxl, shm_ring_handshake) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  swm::util::ShmRing ring, attached;
+  ASSERT_ANY_THROW(ring.share(fds[0]));
+  ASSERT_TRUE(ring.create(4096));
+  ASSERT_TRUE(ring.share(fds[0]));
+  ASSERT_TRUE(attached.attach(fds[1]));
+  ASSERT_ANY_THROW(attached.attach(fds[1]));
+  ASSERT_EQ(attached.capacity(), ring.capacity());
+
+  // Frames written to either mapping are seen in the other one
+  char *data = attached.reserve(5, 0.0);
+  ASSERT_NE(data, nullptr);
+  memcpy(data, "hello", 5);
+  attached.commit();
+  swm::util::ShmRing::Frame frame;
+  ASSERT_TRUE(ring.acquire(&frame, -1.0));
+  ASSERT_EQ(std::string(frame.data, frame.size), "hello");
+  ring.release(frame);
+
+  // Blocked consumer is woken up by its own process only
+  std::thread consumer([&ring, &frame]() -> void { ASSERT_FALSE(ring.acquire(&frame, -1.0)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ring.interrupt();
+  consumer.join();
+  ASSERT_FALSE(attached.closed());
+  ASSERT_NE(attached.reserve(5, 0.0), nullptr);
+
+  // Nothing is attached from a closed connection
+  close(fds[0]);
+  swm::util::ShmRing broken;
+  std::stringstream errors;
+  ASSERT_FALSE(broken.attach(fds[1], &errors));
+  ASSERT_FALSE(errors.str().empty());
+  close(fds[1]);
+}
+
+TEST(auxl, shm_ring_threads) {
+  swm::util::ShmRing ring;
+  ASSERT_TRUE(ring.create(4096));
+
+  // Producer waits for room, consumer waits for frames
+  const size_t count = 2000;
+  std::thread producer([&ring, count]() -> void {
+    for (size_t i = 0; i < count; ++i) {
+      const size_t size = 1 + (i * 37) % 1000;
+      char *data = ring.reserve(size, 10.0);
+      if (data == nullptr) {
+        break;
+      }
+      memset(data, (int)(i % 251), size);
+      ring.commit();
+    }
+    ring.close();
+  });
+
+  size_t received = 0;
+  bool valid = true;
+  swm::util::ShmRing::Frame frame;
+  while (ring.acquire(&frame, 10.0)) {
+    const size_t size = 1 + (received * 37) % 1000;
+    valid = valid && frame.size == size && frame.data[0] == (char)(received % 251) &&
+            frame.data[size - 1] == (char)(received % 251);
+    ring.release(frame);
+    ++received;
+  }
+  producer.join();
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(received, count);
+  ASSERT_TRUE(ring.finished());
+}
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/term_compression.h"
+
+static void make_repetitive_term(ei_x_buff *x, int count) {
+  ASSERT_EQ(ei_x_new_with_version(x), 0);
+  ASSERT_EQ(ei_x_encode_list_header(x, count), 0);
+  for (int i = 0; i < count; ++i) {
+    ASSERT_EQ(ei_x_encode_string(x, "node-00000000-0000-0000-0000-000000000001"), 0);
+  }
+  ASSERT_EQ(ei_x_encode_empty_list(x), 0);
+}
+
+TEST(auxl, term_compression_round_trip) {
+  ei_x_buff x;
+  make_repetitive_term(&x, 1000);
+  const size_t size = (size_t)x.index;
+
+  std::unique_ptr<char[]> compressed;
+  size_t compressed_size = 0;
+  std::stringstream errors;
+  ASSERT_FALSE(swm::util::is_compressed_term(x.buff, size));
+  ASSERT_TRUE(swm::util::compress_term(x.buff, size, 1, &compressed, &compressed_size, &errors))
+    << errors.str();
+  ASSERT_TRUE(swm::util::is_compressed_term(compressed.get(), compressed_size));
+  ASSERT_LT(compressed_size * 10, size);
+
+  std::unique_ptr<char[]> inflated;
+  size_t inflated_size = 0;
+  ASSERT_TRUE(swm::util::decompress_term(compressed.get(), compressed_size,
+                                         &inflated, &inflated_size, &errors)) << errors.str();
+  ASSERT_EQ(inflated_size, size);
+  ASSERT_EQ(memcmp(inflated.get(), x.buff, size), 0);
+  ei_x_free(&x);
+}
+
+TEST(auxl, term_compression_not_profitable) {
+  ei_x_buff x;
+  ASSERT_EQ(ei_x_new_with_version(&x), 0);
+  ASSERT_EQ(ei_x_encode_atom(&x, "ok"), 0);
+
+  std::unique_ptr<char[]> compressed;
+  size_t compressed_size = 0;
+  std::stringstream errors;
+  ASSERT_FALSE(swm::util::compress_term(x.buff, (size_t)x.index, 1, &compressed, &compressed_size, &errors));
+  ASSERT_TRUE(errors.str().empty());
+  ASSERT_EQ(compressed.get(), nullptr);
+  ei_x_free(&x);
+}
+
+TEST(auxl, term_compression_corrupted) {
+  const char not_term[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const char broken[] = { (char)131, 80, 0, 0, 0, 10, 1, 2, 3 };
+  std::unique_ptr<char[]> res;
+  size_t res_size = 0;
+  std::stringstream errors;
+  ASSERT_FALSE(swm::util::compress_term(not_term, sizeof(not_term), 1, &res, &res_size, &errors));
+  ASSERT_FALSE(swm::util::decompress_term(not_term, sizeof(not_term), &res, &res_size, &errors));
+  ASSERT_FALSE(swm::util::decompress_term(broken, sizeof(broken), &res, &res_size, &errors));
+  ASSERT_ANY_THROW(swm::util::decompress_term(broken, sizeof(broken), nullptr, &res_size));
+}
+
+TEST(auxl, term_compression_tiny_terms) {
+  // Terms not longer than the compressed header are never compressed, nothing is written out of bounds
+  const char data[] = { (char)131, 106, 106, 106, 106, 106 };
+  for (size_t size = 1; size <= sizeof(data); ++size) {
+    std::unique_ptr<char[]> res;
+    size_t res_size = 0;
+    std::stringstream errors;
+    ASSERT_FALSE(swm::util::compress_term(data, size, 9, &res, &res_size, &errors)) << size;
+    ASSERT_EQ(res.get(), nullptr);
+    ASSERT_EQ(res_size, 0);
+  }
+}
+
+TEST(auxl, term_compression_declared_size) {
+  // Declared size over the deflate limit is rejected before allocation
+  const char huge[] = { (char)131, 80, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, 1, 2 };
+  const char empty[] = { (char)131, 80, 0, 0, 0, 0, 1, 2 };
+  std::unique_ptr<char[]> res;
+  size_t res_size = 0;
+  std::stringstream errors;
+  ASSERT_FALSE(swm::util::decompress_term(huge, sizeof(huge), &res, &res_size, &errors));
+  ASSERT_NE(errors.str().find("declared term size"), std::string::npos);
+  ASSERT_FALSE(swm::util::decompress_term(empty, sizeof(empty), &res, &res_size));
+  ASSERT_EQ(res.get(), nullptr);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "auxl/timer_wheel.h"
+
+static double seconds_since(const std::chrono::steady_clock::time_point &start) {
+  return (double)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start).count() * 1e-6;
+}
+
+TEST(auxl, timer_wheel_order) {
+  swm::util::TimerWheel wheel;
+  ASSERT_ANY_THROW(wheel.schedule(0.1, swm::util::TimerWheel::Callback()));
+
+  std::mutex mutex;
+  std::vector<int> fired;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<double> delays(3, 0.0);
+  for (int i : { 2, 0, 1 }) {
+    wheel.schedule(0.02 * (i + 1), [&, i]() -> void {
+      std::lock_guard<std::mutex> lock(mutex);
+      fired.push_back(i);
+      delays[(size_t)i] = seconds_since(start);
+    });
+  }
+  ASSERT_EQ(wheel.pending(), 3);
+  while (wheel.pending() != 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(fired, std::vector<int>({ 0, 1, 2 }));
+  for (size_t i = 0; i < delays.size(); ++i) {
+    ASSERT_GE(delays[i], 0.02 * (double)(i + 1));
+  }
+}
+
+TEST(auxl, timer_wheel_cancel) {
+  swm::util::TimerWheel wheel;
+  std::atomic<size_t> counter(0);
+  auto id1 = wheel.schedule(0.05, [&counter]() -> void { counter.fetch_add(1); });
+  auto id2 = wheel.schedule(0.01, [&counter]() -> void { counter.fetch_add(10); });
+  ASSERT_NE(id1, id2);
+  ASSERT_TRUE(wheel.cancel(id1));
+  ASSERT_FALSE(wheel.cancel(id1));
+  ASSERT_EQ(wheel.pending(), 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_FALSE(wheel.cancel(id2));                  // already fired
+  ASSERT_EQ(counter.load(), 10);
+}
+
+TEST(auxl, timer_wheel_coarse_levels) {
+  // 0.3 seconds is beyond the first level, so the timer is moved down by cascades
+  swm::util::TimerWheel wheel(std::chrono::microseconds(100));
+  std::atomic<bool> fired(false);
+  auto start = std::chrono::steady_clock::now();
+  wheel.schedule(0.3, [&fired]() -> void { fired = true; });
+  while (!fired.load() && seconds_since(start) < 1.0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(fired.load());
+  ASSERT_GE(seconds_since(start), 0.3);
+}
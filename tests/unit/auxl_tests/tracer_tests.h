@@ -0,0 +1,104 @@
+#pragma once
+
+#include <fstream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "helpers.h"
+#include "auxl/tracer.h"
+
+TEST(auxl, tracer_threads) {
+  swm::util::Tracer tracer;
+  const size_t spans = 1000;
+  std::atomic<size_t> running(4);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() -> void {
+      for (size_t i = 0; i < spans; ++i) {
+        swm::TraceSpan span(&tracer, "work");
+      }
+      running.fetch_sub(1);
+    });
+  }
+
+  // Rings are read while they are written
+  while (running.load() != 0) {
+    ASSERT_LE(tracer.spans_count(), 4 * spans);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(tracer.spans_count(), 4 * spans);
+
+  std::stringstream json;
+  tracer.write_json(&json);
+  for (size_t tid = 1; tid <= 4; ++tid) {
+    EXPECT_NE(json.str().find("\"tid\":" + std::to_string(tid) + ","), std::string::npos);
+  }
+}
+
+TEST(auxl, tracer_ring_overwrites_oldest) {
+  ASSERT_ANY_THROW(swm::util::Tracer(0));
+
+  swm::util::Tracer tracer(8);
+  const auto now = swm::util::Tracer::clock::now();
+  for (size_t i = 0; i < 12; ++i) {
+    tracer.add_span("old", now, now);
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    tracer.add_span("new \"quoted\"", now, now + std::chrono::microseconds(5));
+  }
+  ASSERT_EQ(tracer.spans_count(), 8);
+
+  std::stringstream json;
+  tracer.write_json(&json);
+  EXPECT_EQ(json.str().find("old"), std::string::npos);
+  EXPECT_NE(json.str().find("\"name\":\"new \\\"quoted\\\"\",\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(json.str().find("\"dur\":5.000}"), std::string::npos);
+}
+
+TEST(auxl, tracer_short_lived_threads) {
+  // Threads come and go (their ids are reused), tracers are written by the same threads in turn
+  swm::util::Tracer first, second;
+  const size_t rounds = 200;
+  for (size_t i = 0; i < rounds; ++i) {
+    std::thread([&]() -> void {
+      swm::TraceSpan span(&first, "first");
+      swm::TraceSpan(&second, "second");
+    }).join();
+  }
+  ASSERT_EQ(first.spans_count(), rounds);
+  ASSERT_EQ(second.spans_count(), rounds);
+
+  std::stringstream json;
+  second.write_json(&json);
+  EXPECT_EQ(json.str().find("first"), std::string::npos);
+}
+
+TEST(auxl, tracer_dump) {
+  {
+    swm::TraceSpan span(nullptr, "lost");
+  }
+
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".json";
+  {
+    swm::util::Tracer tracer;
+    {
+      swm::TraceSpan span(&tracer, "kept");
+    }
+    ASSERT_EQ(tracer.spans_count(), 1);
+    ASSERT_TRUE(tracer.dump(path));
+    std::stringstream errors;
+    ASSERT_FALSE(tracer.dump(find_temp_dir() + "/not-existing-directory/trace.json", &errors));
+    ASSERT_FALSE(errors.str().empty());
+  }
+
+  std::ifstream file(path);
+  std::stringstream json;
+  json << file.rdbuf();
+  EXPECT_EQ(json.str().find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0);
+  EXPECT_NE(json.str().find("\"name\":\"kept\""), std::string::npos);
+  EXPECT_EQ(json.str().find("lost"), std::string::npos);
+  std::remove(path.c_str());
+}
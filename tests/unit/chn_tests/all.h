@@ -3,4 +3,5 @@
 
 #include "chain_tests.h"
 #include "chain_controller_tests.h"
+#include "exchange_hub_tests.h"
 
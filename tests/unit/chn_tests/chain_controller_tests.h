@@ -80,14 +80,54 @@ TEST_F(chn, chain_controller_interrupt) {
   {
     volatile bool tt_scheduled = true;             // should be switched to false
     volatile bool chain_interrupted = false;       // should be switched to true
+    std::shared_ptr<swm::TimetableInfoInterface> tt;
+    auto clb = [res = &tt, flag = &tt_scheduled](bool success,
+                                                const std::shared_ptr<swm::TimetableInfoInterface> &tt,
+                                                const std::shared_ptr<swm::util::MetricsSnapshot> &) -> void {
+      *flag = success;
+      *res = tt;
+    };
     swm::util::ChainController ctrler;
-    ASSERT_NO_THROW(ctrler.init(chain, &metrics, empty_finish_callback(&tt_scheduled), 10.0));
+    ASSERT_NO_THROW(ctrler.init(chain, &metrics, clb, 10.0));
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
     ASSERT_FALSE(ctrler.finished());
     ASSERT_NO_THROW(ctrler.invoke_interrupt(empty_finish_callback(&chain_interrupted)));
     while (!ctrler.finished()) { std::this_thread::yield(); }
     ASSERT_TRUE(chain_interrupted);
     ASSERT_FALSE(tt_scheduled);
+
+    // Intermediate timetable of the interrupted algorithm is returned
+    ASSERT_NE(tt.get(), nullptr);
+    ASSERT_EQ(tt->tables().size(), 1);
+    ASSERT_EQ(tt->tables()[0]->get_job_id(), "hold_on");
+  }
+}
+
+TEST_F(chn, chain_controller_interrupt_after_injection) {
+  std::vector<std::shared_ptr<swm::Algorithm> > fcfs_alg, algs;
+  ASSERT_TRUE(create_fcfs_algorithms(&fcfs_alg, 1));
+  swm::Chain fcfs_chain;
+  ASSERT_NO_THROW(fcfs_chain.init(SchedulingInfoPresets::one_node_one_job("1"), fcfs_alg));
+  while (!fcfs_chain.stopped()) { std::this_thread::yield(); }
+
+  ASSERT_TRUE(create_dummy_algorithms(&algs, 2));
+  std::shared_ptr<swm::Chain> chain(new swm::Chain());
+  ASSERT_NO_THROW(chain->init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs));
+  swm::util::Metrics metrics;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  {
+    // Interruption waits for the chain to take the injection, not for the deadline
+    volatile bool chain_interrupted = false;
+    swm::util::ChainController ctrler;
+    ASSERT_NO_THROW(ctrler.init(chain, &metrics, empty_finish_callback(), 10.0));
+    ASSERT_NO_THROW(chain->inject_timetable_async(fcfs_chain.actual_timetable()));
+    auto t_start = std::chrono::steady_clock::now();
+    ASSERT_NO_THROW(ctrler.invoke_interrupt(empty_finish_callback(&chain_interrupted)));
+    while (!ctrler.finished()) { std::this_thread::yield(); }
+    ASSERT_LT(std::chrono::steady_clock::now() - t_start, std::chrono::seconds(5));
+    ASSERT_EQ(chain_interrupted, chain->status() == swm::Chain::INTERRUPTED);
+    ASSERT_EQ(chain->actual_timetable()->tables()[0]->get_job_id(), "1");
   }
 }
 
@@ -211,3 +251,40 @@ TEST_F(chn, chain_controller_time_counting) {
   timer->get_times(nullptr, nullptr, &working);
   ASSERT_NE(working, 0.0);    // at least, some overheads must be measured
 }
+
+TEST_F(chn, chain_controller_shared_executor) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs1, algs2;
+  ASSERT_TRUE(create_dummy_algorithms(&algs1, 1));
+  ASSERT_TRUE(create_fcfs_algorithms(&algs2, 1));
+  swm::util::Executor chains(2), requests(2), inline_executor(0);
+  swm::util::Metrics metrics;
+
+  std::shared_ptr<swm::Chain> chain1(new swm::Chain()), chain2(new swm::Chain());
+  ASSERT_NO_THROW(chain1->init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs1,
+                               nullptr, &chains));
+  ASSERT_NO_THROW(chain2->init(SchedulingInfoPresets::one_node_one_job("1"), algs2,
+                               nullptr, &inline_executor));
+
+  {
+    // Chain performed inline is finished by the controller's init()
+    volatile bool succeeded = false;
+    swm::util::ChainController ctrler;
+    ASSERT_NO_THROW(ctrler.init(chain2, &metrics, empty_finish_callback(&succeeded), 10.0,
+                                nullptr, &inline_executor));
+    ASSERT_TRUE(ctrler.finished());
+    ASSERT_TRUE(succeeded);
+  }
+
+  {
+    volatile bool tt_scheduled = true;
+    volatile bool chain_interrupted = false;
+    swm::util::ChainController ctrler;
+    ASSERT_NO_THROW(ctrler.init(chain1, &metrics, empty_finish_callback(&tt_scheduled), 10.0,
+                                nullptr, &requests));
+    ASSERT_FALSE(ctrler.finished());
+    ASSERT_NO_THROW(ctrler.invoke_interrupt(empty_finish_callback(&chain_interrupted)));
+    while (!ctrler.finished()) { std::this_thread::yield(); }
+    ASSERT_TRUE(chain_interrupted);
+    ASSERT_FALSE(tt_scheduled);
+  }
+}
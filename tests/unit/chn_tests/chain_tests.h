@@ -147,3 +147,212 @@ TEST_F(chn, chain_time_counting) {
   ASSERT_LE(working, 0.06);
   ASSERT_GE(working, 0.04);
 }
+
+TEST_F(chn, chain_executor) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs;
+  bool notified = false;
+  {
+    // Executor without threads performs the chain right in init()
+    ASSERT_TRUE(create_fcfs_algorithms(&algs, 2));
+    swm::util::Executor executor(0);
+    swm::Chain fcfs_chain;
+    ASSERT_NO_THROW(fcfs_chain.init(SchedulingInfoPresets::one_node_one_job("1"), algs,
+                                    nullptr, &executor));
+    ASSERT_EQ(fcfs_chain.status(), swm::Chain::FINISHED);
+    fcfs_chain.set_stop_callback([&notified]() -> void { notified = true; });
+    ASSERT_TRUE(notified);
+  }
+
+  {
+    notified = false;
+    ASSERT_TRUE(create_dummy_algorithms(&algs, 1));
+    swm::util::Executor executor(1);
+    swm::Chain dummy_chain;
+    ASSERT_NO_THROW(dummy_chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs,
+                                     nullptr, &executor));
+    dummy_chain.set_stop_callback([&notified]() -> void { notified = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(dummy_chain.status(), swm::Chain::WORKING);
+    ASSERT_EQ(executor.busy_threads(), 1);
+    ASSERT_FALSE(notified);
+    ASSERT_NO_THROW(dummy_chain.interrupt_async());
+    while (!dummy_chain.stopped()) { std::this_thread::yield(); }
+  } // chain waits for its task
+  ASSERT_TRUE(notified);
+}
+
+TEST_F(chn, chain_input_copy) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs;
+  ASSERT_TRUE(create_fcfs_algorithms(&algs, 1));
+  const auto input = SchedulingInfoPresets::one_node_one_job("1");
+  const auto copy = SchedulingInfoPresets::one_node_one_job("1");
+  std::thread::id copied_by;
+
+  // Copy is made by the executor's thread, algorithms work on it
+  swm::util::Executor executor(1);
+  swm::Chain chain;
+  chain.set_input_copy([&](const std::shared_ptr<swm::SchedulingInfoInterface> &info)
+                       -> std::shared_ptr<swm::SchedulingInfoInterface> {
+    EXPECT_EQ(info.get(), input.get());
+    copied_by = std::this_thread::get_id();
+    return copy;
+  });
+  ASSERT_NO_THROW(chain.init(input, algs, nullptr, &executor));
+  ASSERT_ANY_THROW(chain.set_input_copy(nullptr));
+  while (!chain.stopped()) { std::this_thread::yield(); }
+  ASSERT_EQ(chain.status(), swm::Chain::FINISHED);
+  ASSERT_NE(copied_by, std::this_thread::get_id());
+  ASSERT_NE(copied_by, std::thread::id());
+  ASSERT_EQ(chain.scheduling_info().get(), input.get());
+}
+
+TEST_F(chn, chain_portfolio) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs, fcfs_alg;
+  ASSERT_TRUE(create_dummy_algorithms(&algs, 1));
+  ASSERT_TRUE(create_fcfs_algorithms(&fcfs_alg, 1));
+  algs.push_back(fcfs_alg[0]);
+
+  {
+    swm::Chain chain;
+    ASSERT_ANY_THROW(chain.set_mode(swm::Chain::PORTFOLIO, swm::TimetableObjective(), -1.0));
+    ASSERT_NO_THROW(chain.set_mode(swm::Chain::PORTFOLIO, swm::TimetableObjective(), 0.1));
+    ASSERT_EQ(chain.mode(), swm::Chain::PORTFOLIO);
+
+    // Dummy holds on till the budget is over, but FCFS has constructed timetable
+    auto t_start = std::chrono::steady_clock::now();
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs));
+    ASSERT_ANY_THROW(chain.set_mode(swm::Chain::SEQUENTIAL));
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_GE(std::chrono::steady_clock::now() - t_start, std::chrono::milliseconds(100));
+    ASSERT_EQ(chain.status(), swm::Chain::FINISHED);
+    ASSERT_NE(chain.actual_timetable().get(), nullptr);
+    ASSERT_FALSE(chain.actual_timetable()->empty());
+  }
+
+  {
+    // Nothing is completed before interruption
+    ASSERT_TRUE(create_dummy_algorithms(&algs, 2));
+    swm::util::Executor executor(2);
+    swm::Chain chain;
+    ASSERT_NO_THROW(chain.set_mode(swm::Chain::PORTFOLIO));
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs, nullptr, &executor));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(chain.status(), swm::Chain::WORKING);
+    ASSERT_NO_THROW(chain.interrupt_async());
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_EQ(chain.status(), swm::Chain::INTERRUPTED);
+  }
+}
+
+TEST_F(chn, cancellation_token) {
+  swm::CancellationToken chain;
+  swm::CancellationToken group(&chain);
+  swm::CancellationToken member(&group);
+  ASSERT_FALSE(member.cancelled());
+
+  member.cancel();
+  ASSERT_TRUE(member.cancelled());
+  ASSERT_FALSE(group.cancelled());
+  member.reset();
+  ASSERT_FALSE(member.cancelled());
+
+  // Ancestor cancels all descendants, their own reset doesn't help
+  chain.cancel();
+  ASSERT_TRUE(group.cancelled());
+  member.reset();
+  ASSERT_TRUE(member.cancelled());
+
+  // Token created under the cancelled ancestor is cancelled, removed one isn't notified anymore
+  {
+    swm::CancellationToken late(&group);
+    ASSERT_TRUE(late.cancelled());
+  }
+  chain.reset();
+  group.reset();
+  ASSERT_FALSE(group.cancelled());
+  group.cancel();
+
+  EmptyPluginEvents events;
+  ASSERT_FALSE(events.cancellation_token().cancelled());
+  ASSERT_EQ(events.remaining_budget(), std::numeric_limits<double>::infinity());
+}
+
+TEST_F(chn, chain_sequential_budget) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs, dummy_alg;
+  ASSERT_TRUE(create_fcfs_algorithms(&algs, 1));
+  ASSERT_TRUE(create_dummy_algorithms(&dummy_alg, 1));
+  algs.push_back(dummy_alg[0]);
+
+  // FCFS constructs timetable, dummy holds on improving it till the budget is over
+  swm::Chain chain;
+  ASSERT_NO_THROW(chain.set_mode(swm::Chain::SEQUENTIAL, swm::TimetableObjective(), 0.1));
+  auto t_start = std::chrono::steady_clock::now();
+  ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs));
+  while (!chain.stopped()) { std::this_thread::yield(); }
+  ASSERT_GE(std::chrono::steady_clock::now() - t_start, std::chrono::milliseconds(100));
+  ASSERT_EQ(chain.status(), swm::Chain::FINISHED);
+  ASSERT_NE(chain.actual_timetable().get(), nullptr);
+  ASSERT_FALSE(chain.actual_timetable()->empty());
+}
+
+TEST_F(chn, chain_pipeline) {
+  std::vector<std::shared_ptr<swm::Algorithm> > algs;
+  {
+    ASSERT_TRUE(create_fcfs_algorithms(&algs, 3));
+    swm::util::Executor executor(2);
+    swm::Chain chain;
+    ASSERT_NO_THROW(chain.set_mode(swm::Chain::PIPELINE));
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("1"), algs, nullptr, &executor));
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_EQ(chain.status(), swm::Chain::FINISHED);
+    ASSERT_NE(chain.actual_timetable().get(), nullptr);
+    ASSERT_FALSE(chain.actual_timetable()->empty());
+  }
+
+  {
+    // Improvers hold on the intermediate timetable of the first algorithm, all of them are stopped
+    ASSERT_TRUE(create_dummy_algorithms(&algs, 3));
+    swm::Chain chain;
+    ASSERT_NO_THROW(chain.set_mode(swm::Chain::PIPELINE));
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(chain.status(), swm::Chain::WORKING);
+    ASSERT_NE(chain.intermediate_timetable().get(), nullptr);
+    ASSERT_NO_THROW(chain.interrupt_async());
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_EQ(chain.status(), swm::Chain::INTERRUPTED);
+  }
+
+  {
+    // Budget is over before the construction, its truncated result is not the chain's one
+    ASSERT_TRUE(create_fcfs_algorithms(&algs, 2));
+    swm::Chain chain;
+    ASSERT_NO_THROW(chain.set_mode(swm::Chain::PIPELINE, swm::TimetableObjective(), 1e-6));
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("1"), algs));
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_EQ(chain.status(), swm::Chain::INTERRUPTED);
+    ASSERT_EQ(chain.actual_timetable().get(), nullptr);
+  }
+}
+
+TEST_F(chn, chain_concurrent_interrupted_partial) {
+  // Members commit their intermediate timetables and hold on, the interrupted chain returns them
+  for (const auto mode : { swm::Chain::PORTFOLIO, swm::Chain::PIPELINE }) {
+    std::vector<std::shared_ptr<swm::Algorithm> > algs;
+    ASSERT_TRUE(create_dummy_algorithms(&algs, 2));
+    swm::util::Executor executor(2);
+    swm::Chain chain;
+    ASSERT_NO_THROW(chain.set_mode(mode));
+    ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("hold_on"), algs, nullptr, &executor));
+    while (chain.intermediate_timetable().get() == nullptr) { std::this_thread::yield(); }
+    while (!chain.ready_for_async_operation()) { std::this_thread::yield(); }
+    ASSERT_NO_THROW(chain.interrupt_async());
+    while (!chain.stopped()) { std::this_thread::yield(); }
+    ASSERT_EQ(chain.status(), swm::Chain::INTERRUPTED);
+    ASSERT_EQ(chain.actual_timetable().get(), nullptr);
+    auto tt = chain.latest_timetable();
+    ASSERT_NE(tt.get(), nullptr);
+    ASSERT_EQ(tt->tables().size(), 1);
+    ASSERT_EQ(tt->tables()[0]->get_job_id(), "hold_on");
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "scheduling_info_presets.h"
+#include "chn.h"
+#include "chn/chain.h"
+#include "chn/exchange_hub.h"
+
+TEST_F(chn, exchange_hub_topologies) {
+  swm::util::ExchangeHub::Topology topology = swm::util::ExchangeHub::RING;
+  ASSERT_TRUE(swm::util::ExchangeHub::topology_from_string("star", &topology));
+  ASSERT_EQ(topology, swm::util::ExchangeHub::STAR);
+  ASSERT_FALSE(swm::util::ExchangeHub::topology_from_string("mesh", &topology));
+
+  // Any non-empty timetable, only pointers are compared
+  std::vector<std::shared_ptr<swm::Algorithm> > alg;
+  ASSERT_TRUE(create_fcfs_algorithms(&alg, 1));
+  swm::Chain chain;
+  ASSERT_NO_THROW(chain.init(SchedulingInfoPresets::one_node_one_job("1"), alg));
+  while (!chain.stopped()) { std::this_thread::yield(); }
+  auto tt = chain.actual_timetable();
+  ASSERT_NE(tt.get(), nullptr);
+
+  const std::vector<std::string> islands = { "A", "B", "C" };
+  std::vector<size_t> expected_ring = { 1, 1, 1 }, expected_star = { 2, 1, 1 };
+  std::vector<size_t> expected_all = { 2, 2, 2 };
+  for (auto topology : { swm::util::ExchangeHub::RING,
+                         swm::util::ExchangeHub::STAR,
+                         swm::util::ExchangeHub::ALL_TO_ALL }) {
+    swm::util::ExchangeHub hub(topology);
+    ASSERT_ANY_THROW(hub.post("A", tt));
+    for (const auto &island : islands) {
+      ASSERT_TRUE(hub.join(island));
+    }
+    ASSERT_FALSE(hub.join("A"));
+    ASSERT_EQ(hub.islands(), 3);
+    ASSERT_TRUE(hub.candidates("A").empty());    // nothing was posted yet
+
+    for (const auto &island : islands) {
+      hub.post(island, tt);
+    }
+    auto &expected = topology == swm::util::ExchangeHub::RING ? expected_ring :
+                     topology == swm::util::ExchangeHub::STAR ? expected_star : expected_all;
+    for (size_t i = 0; i < islands.size(); ++i) {
+      ASSERT_EQ(hub.candidates(islands[i]).size(), expected[i]);
+    }
+
+    hub.leave("B");
+    ASSERT_EQ(hub.islands(), 2);
+    ASSERT_ANY_THROW(hub.candidates("B"));
+  }
+}
+
+TEST_F(chn, chain_controller_migration) {
+  std::vector<std::shared_ptr<swm::Algorithm> > fcfs_alg, dummy_alg;
+  ASSERT_TRUE(create_fcfs_algorithms(&fcfs_alg, 1));
+  ASSERT_TRUE(create_dummy_algorithms(&dummy_alg, 1));
+  swm::Chain fcfs_chain;
+  ASSERT_NO_THROW(fcfs_chain.init(SchedulingInfoPresets::one_node_one_job("1"), fcfs_alg));
+  while (!fcfs_chain.stopped()) { std::this_thread::yield(); }
+
+  std::shared_ptr<swm::util::ExchangeHub> hub(new swm::util::ExchangeHub());
+  ASSERT_TRUE(hub->join("fcfs"));
+  ASSERT_TRUE(hub->join("dummy"));
+  hub->post("fcfs", fcfs_chain.actual_timetable());
+
+  // Dummy has no timetable yet, so it takes the one of its neighbour and finishes
+  std::shared_ptr<swm::Chain> chain(new swm::Chain());
+  ASSERT_NO_THROW(chain->init(SchedulingInfoPresets::one_node_one_job("hold_on"), dummy_alg));
+  swm::util::Metrics metrics;
+  volatile bool finished = false;
+  {
+    swm::util::ChainController ctrler;
+    ASSERT_NO_THROW(ctrler.init(chain, &metrics, empty_finish_callback(&finished), 10.0));
+    ASSERT_ANY_THROW(ctrler.invoke_migration(nullptr, "dummy", [](bool) -> void { }));
+    std::atomic<bool> migrated(false);
+    ASSERT_NO_THROW(ctrler.invoke_migration(hub, "dummy", [&migrated](bool success) -> void {
+      migrated = success;
+    }));
+    while (!ctrler.finished()) { std::this_thread::yield(); }
+    ASSERT_TRUE(migrated.load());
+  }
+  ASSERT_TRUE(finished);
+  ASSERT_EQ(chain->actual_timetable()->tables()[0]->get_job_id(), "1");
+}
@@ -84,3 +84,118 @@ TEST(auxl, args_timeout) {
   ASSERT_GT(val, 3.1);
   ASSERT_LT(val, 3.2);
 }
+
+TEST(auxl, args_compress) {
+  swm::CliArgs args;
+  const char *wrong_argv[] = { "", "--compress", "big" };
+  ASSERT_FALSE(args.init(3, wrong_argv));
+
+  const char *correct_argv[] = { "", "--compress", "65536" };
+  ASSERT_TRUE(args.init(3, correct_argv));
+  size_t val;
+  ASSERT_TRUE(args.has_compress_flag(&val));
+  ASSERT_EQ(val, 65536);
+}
+
+TEST(auxl, args_coalesce) {
+  swm::CliArgs args;
+  const char *default_argv[] = { "" };
+  ASSERT_TRUE(args.init(1, default_argv));
+  ASSERT_FALSE(args.has_coalesce_flag());
+  ASSERT_FALSE(args.has_reply_metrics_flag());
+
+  const char *correct_argv[] = { "", "--coalesce", "--reply-metrics" };
+  ASSERT_TRUE(args.init(3, correct_argv));
+  ASSERT_TRUE(args.has_coalesce_flag());
+  ASSERT_TRUE(args.has_reply_metrics_flag());
+  ASSERT_FALSE(args.has_memoize_flag());
+}
+
+TEST(auxl, args_memoize) {
+  swm::CliArgs args;
+  const char *wrong_argv[] = { "", "--memoize", "0" };
+  ASSERT_FALSE(args.init(3, wrong_argv));
+
+  const char *correct_argv[] = { "", "--memoize", "32" };
+  ASSERT_TRUE(args.init(3, correct_argv));
+  size_t val;
+  ASSERT_TRUE(args.has_memoize_flag(&val));
+  ASSERT_EQ(val, 32);
+}
+
+TEST(auxl, args_shm) {
+  swm::CliArgs args;
+  const char *wrong_argv1[] = { "", "--shm-size", "4096" };
+  ASSERT_FALSE(args.init(3, wrong_argv1));
+
+  const char *wrong_argv2[] = { "", "--shm", "ring.sock", "-s", "server.sock" };
+  ASSERT_FALSE(args.init(5, wrong_argv2));
+
+  const char *wrong_argv3[] = { "", "--shm", "ring.sock", "--shm-size", "0" };
+  ASSERT_FALSE(args.init(5, wrong_argv3));
+
+  const char *correct_argv[] = { "", "--shm", "ring.sock", "--shm-size", "4096" };
+  ASSERT_TRUE(args.init(5, correct_argv));
+  std::string path;
+  size_t size;
+  ASSERT_TRUE(args.has_shm_flag(&path));
+  ASSERT_EQ(path, "ring.sock");
+  ASSERT_TRUE(args.has_shm_size_flag(&size));
+  ASSERT_EQ(size, 4096);
+}
+
+TEST(auxl, args_client_limits) {
+  swm::CliArgs args;
+  const char *wrong_argv1[] = { "", "--client-queue", "16" };
+  ASSERT_FALSE(args.init(3, wrong_argv1));
+
+  const char *wrong_argv2[] = { "", "-s", "server.sock", "--client-queue", "0" };
+  ASSERT_FALSE(args.init(5, wrong_argv2));
+
+  const char *wrong_argv3[] = { "", "-s", "server.sock", "--client-stall", "-1" };
+  ASSERT_FALSE(args.init(5, wrong_argv3));
+
+  const char *correct_argv[] = { "", "-s", "server.sock", "--client-queue", "16", "--client-stall", "2.5" };
+  ASSERT_TRUE(args.init(7, correct_argv));
+  size_t size;
+  double seconds;
+  ASSERT_TRUE(args.has_client_queue_flag(&size));
+  ASSERT_EQ(size, 16);
+  ASSERT_TRUE(args.has_client_stall_flag(&seconds));
+  ASSERT_DOUBLE_EQ(seconds, 2.5);
+}
+
+TEST(auxl, args_recording) {
+  swm::CliArgs args;
+  const char *wrong_argv1[] = { "", "--record-slow", "0.5" };
+  ASSERT_FALSE(args.init(3, wrong_argv1));
+
+  const char *wrong_argv2[] = { "", "--record", "rec.bin", "--record-slow", "0" };
+  ASSERT_FALSE(args.init(5, wrong_argv2));
+
+  const char *wrong_argv3[] = { "", "--replay", "foo.bin" };
+  ASSERT_FALSE(args.init(3, wrong_argv3));
+
+  const char *correct_argv[] = { "", "--record", "rec.bin", "--record-slow", "0.25" };
+  ASSERT_TRUE(args.init(5, correct_argv));
+  std::string path;
+  double val;
+  ASSERT_TRUE(args.has_record_flag(&path));
+  ASSERT_EQ(path, "rec.bin");
+  ASSERT_TRUE(args.has_record_slow_flag(&val));
+  ASSERT_EQ(val, 0.25);
+  ASSERT_FALSE(args.has_replay_flag());
+}
+
+TEST(auxl, args_trace) {
+  swm::CliArgs args;
+  const char *wrong_argv[] = { "", "--trace" };
+  ASSERT_FALSE(args.init(2, wrong_argv));
+
+  const char *correct_argv[] = { "", "--trace", "trace.json" };
+  ASSERT_TRUE(args.init(3, correct_argv));
+  std::string path;
+  ASSERT_TRUE(args.has_trace_flag(&path));
+  ASSERT_EQ(path, "trace.json");
+  ASSERT_FALSE(args.has_record_flag());
+}
@@ -5,3 +5,9 @@
 #include "receiver_tests.h"
 #include "processor_tests.h"
 #include "sender_tests.h"
+#include "service_metrics_tests.h"
+#include "timetable_history_tests.h"
+#include "timetable_cache_tests.h"
+#include "availability_profiles_tests.h"
+#include "service_tests.h"
+#include "command_recorder_tests.h"
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "ctrl.h"
+#include "scheduling_info_configurator.h"
+#include "ctrl/availability_profiles.h"
+
+static swm::SwmJob make_candidate(const std::string &cluster, uint64_t nodes,
+                                  const std::vector<std::pair<std::string, uint64_t> > &requests = {}) {
+  swm::SwmJob job;
+  job.set_id("candidate");
+  job.set_cluster_id(cluster);
+  std::vector<swm::SwmResource> resources(1);
+  resources[0].set_name("node");
+  resources[0].set_count(nodes);
+  for (const auto &req : requests) {
+    resources.emplace_back();
+    resources.back().set_name(req.first);
+    resources.back().set_count(req.second);
+  }
+  job.set_request(resources);
+  return job;
+}
+
+TEST_F(ctrl, availability_profiles_estimate) {
+  SchedulingInfoConfigurator config;
+  auto part = config.create_cluster("c", "up")->create_partition("p", "up");
+  for (const auto &id : { "a", "b", "c" }) {
+    part->create_node(id, "up", "idle")->create_resource("cpu", 8);
+  }
+  part->create_node("d", "down", "idle")->create_resource("cpu", 8);
+  config.create_job("1", "c", 10)->create_request("node", 2);
+  config.create_job("2", "c", 5)->create_request("node", 1);
+  std::shared_ptr<swm::SchedulingInfoInterface> info;
+  config.construct(&info);
+
+  swm::SwmTimetable t1, t2;
+  t1.set_job_id("1");
+  t1.set_start_time(0);
+  t1.set_job_nodes({ "a", "b" });
+  t2.set_job_id("2");
+  t2.set_start_time(0);
+  t2.set_job_nodes({ "c" });
+  TimetableInfoForTests tt(std::vector<const swm::SwmTimetable *>({ &t1, &t2 }));
+
+  swm::util::AvailabilityProfiles profiles;
+  swm::SwmTimetable res;
+  ASSERT_FALSE(profiles.estimate(make_candidate("c", 1), &res));
+  profiles.update(*info, tt);
+  ASSERT_EQ(profiles.cluster_count(), 1);
+
+  // The earliest free nodes are taken, candidates don't occupy them
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 1), &res));
+  ASSERT_EQ(res.get_job_id(), "candidate");
+  ASSERT_EQ(res.get_start_time(), 5);
+  ASSERT_EQ(res.get_job_nodes(), std::vector<std::string>({ "c" }));
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 2), &res));
+  ASSERT_EQ(res.get_start_time(), 10);
+  ASSERT_EQ(res.get_job_nodes().size(), 2);
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 3, { { "cpu", 8 } }), &res));
+  ASSERT_EQ(res.get_start_time(), 10);
+
+  // Broken nodes, missing resources and unknown clusters give no estimation
+  ASSERT_FALSE(profiles.estimate(make_candidate("c", 4), &res));
+  ASSERT_FALSE(profiles.estimate(make_candidate("c", 1, { { "cpu", 16 } }), &res));
+  ASSERT_FALSE(profiles.estimate(make_candidate("x", 1), &res));
+
+  swm::SwmJob pinned = make_candidate("c", 1);
+  pinned.set_nodes({ "a" });
+  ASSERT_TRUE(profiles.estimate(pinned, &res));
+  ASSERT_EQ(res.get_start_time(), 10);
+  ASSERT_EQ(res.get_job_nodes(), std::vector<std::string>({ "a" }));
+
+  // Estimates are counted from the moment they are asked, not from the start of the scheduling
+  const auto origin = swm::util::AvailabilityProfiles::clock::now();
+  profiles.update(*info, tt, origin);
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 1), &res, origin + std::chrono::seconds(3)));
+  ASSERT_EQ(res.get_start_time(), 2);
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 2), &res, origin + std::chrono::milliseconds(2500)));
+  ASSERT_EQ(res.get_start_time(), 8);
+  ASSERT_TRUE(profiles.estimate(make_candidate("c", 2), &res, origin + std::chrono::seconds(60)));
+  ASSERT_EQ(res.get_start_time(), 0);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <unistd.h>
+
+#include "ctrl.h"
+#include "ctrl/command_recorder.h"
+#include "ctrl/command_replayer.h"
+#include "ctrl/service.h"
+
+static std::string recording_path(const std::string &name) {
+  return find_temp_dir() + "/swm-sched-tests-" + name + "-" + std::to_string(getpid()) + ".rec";
+}
+
+TEST_F(ctrl, command_recorder_full) {
+  const std::string path = recording_path("full");
+  swm::util::CommandRecorder recorder;
+  ASSERT_TRUE(recorder.open(path, 0.0));
+  recorder.record(0, "#1", "first", 5);
+  recorder.record(1, "#2", "second", 6);
+  recorder.complete(0, "#1");
+  recorder.close();
+
+  std::vector<swm::util::CommandRecorder::Entry> entries;
+  std::stringstream errors;
+  ASSERT_TRUE(swm::util::CommandRecorder::load(path, &entries, &errors)) << errors.str();
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].frame, "first");
+  EXPECT_EQ(entries[1].frame, "second");
+  EXPECT_LE(entries[0].arrival, entries[1].arrival);
+  EXPECT_EQ(entries[0].latency, 0.0);
+  std::remove(path.c_str());
+
+  ASSERT_FALSE(swm::util::CommandRecorder::load(path, &entries));
+}
+
+TEST_F(ctrl, command_recorder_slow) {
+  const std::string path = recording_path("slow");
+  swm::util::CommandRecorder recorder;
+  ASSERT_TRUE(recorder.open(path, 0.05));
+
+  // Fast request is dropped, slow and unanswered ones are kept in the order of arrival
+  recorder.record(0, "#fast", "fast", 4);
+  recorder.record(0, "#slow", "slow", 4);
+  recorder.record(1, "#slow", "lost", 4);
+  recorder.complete(0, "#fast");
+  std::this_thread::sleep_for(std::chrono::milliseconds(80));
+  recorder.complete(0, "#slow");
+  recorder.close();
+
+  std::vector<swm::util::CommandRecorder::Entry> entries;
+  ASSERT_TRUE(swm::util::CommandRecorder::load(path, &entries));
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].frame, "slow");
+  EXPECT_EQ(entries[1].frame, "lost");
+  EXPECT_GT(entries[0].latency, 0.05);
+  EXPECT_GT(entries[1].latency, 0.05);
+  std::remove(path.c_str());
+}
+
+TEST_F(ctrl, receiver_recording) {
+  const std::string path = recording_path("receiver");
+  std::stringstream stream;
+  write_empty_schedule_command("#recorded", nullptr, &stream);
+  const std::string frame = stream.str();
+
+  swm::util::CommandRecorder recorder;
+  ASSERT_TRUE(recorder.open(path, 0.0));
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+  swm::util::Receiver receiver;
+  receiver.set_recorder(&recorder);
+  receiver.init(&queue, &stream);
+  receiver.wait();
+  recorder.close();
+  ASSERT_EQ(queue.element_count(), 1);
+
+  // Frame is recorded byte to byte and is identified as the request
+  std::vector<swm::util::CommandRecorder::Entry> entries;
+  ASSERT_TRUE(swm::util::CommandRecorder::load(path, &entries));
+  ASSERT_EQ(entries.size(), 1);
+  EXPECT_EQ(entries[0].frame, frame);
+  SwmUID uid;
+  ASSERT_TRUE(swm::util::CommandReplayer::frame_uid(entries[0].frame, &uid));
+  EXPECT_EQ(uid, "#recorded");
+  std::remove(path.c_str());
+}
+
+#if !defined(WIN32)
+
+TEST_F(ctrl, command_replayer_latency) {
+  std::vector<swm::util::CommandRecorder::Entry> entries;
+  // Id of an answered request is reused, every command gets its own response
+  const std::vector<SwmUID> uids = { "#replay-1", "#replay-2", "#replay-3", "#replay-1" };
+  for (size_t i = 0; i < uids.size(); ++i) {
+    std::stringstream stream;
+    write_empty_schedule_command(uids[i], nullptr, &stream);
+    entries.push_back(swm::util::CommandRecorder::Entry { i + 1 < uids.size() ? 0.01 * (double)i : 0.3, 0.0,
+                                                          stream.str() });
+  }
+
+  swm::Service service(factory(), scanner());
+  service.set_timeout(1.0);
+  swm::util::CommandReplayer replayer;
+  ASSERT_ANY_THROW(replayer.set_speed(-1.0));
+  replayer.set_speed(2.0);
+  std::vector<swm::util::CommandReplayer::Result> results;
+  std::stringstream errors;
+  ASSERT_TRUE(replayer.run(&service, entries, &results, &errors)) << errors.str();
+  ASSERT_EQ(results.size(), uids.size());
+  for (size_t i = 0; i < uids.size(); ++i) {
+    EXPECT_EQ(results[i].uid, uids[i]);
+    EXPECT_GE(results[i].latency, 0.0);
+  }
+
+  std::stringstream report;
+  swm::util::CommandReplayer::print_report(results, &report);
+  EXPECT_NE(report.str().find("#replay-3"), std::string::npos);
+  EXPECT_NE(report.str().find("answered: 4"), std::string::npos);
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include "test_defs.h"
 #include "ctrl/commands.h"
 #include "ctrl/receiver.h"
+#include "ctrl/responses.h"
 #include "ifaces/timetable_info_interface.h"
 
 // Universal test fixture for Receiver, Sender and Service
@@ -86,6 +87,12 @@ class ctrl : public ::testing::Test {
     return resp;
   }
 
+  // Timetable of interrupted chain: not succeeded, but still sent
+  bool is_partial(const std::shared_ptr<swm::util::ResponseInterface> &resp) const {
+    auto tt = dynamic_cast<const swm::util::TimetableResponse *>(resp.get());
+    return tt != nullptr && tt->partial() && !resp->succeeded();
+  }
+
   std::shared_ptr<swm::util::CommandInterface> create_metrics_request(const SwmUID &uid,
                                                                       const SwmUID &chain) {
     std::shared_ptr<swm::util::CommandInterface> resp;
@@ -101,6 +108,61 @@ class ctrl : public ::testing::Test {
     return resp;
   }
 
+  // Writes command in the wire format of SWM: command, request id (length and characters),
+  // slice count, slices (type, length, data)
+  void write_raw_command(char command, const SwmUID &uid, const std::vector<ei_x_buff> &slices,
+                         std::ostream *out) {
+    const uint32_t uid_len = (uint32_t)uid.size();
+    const char uid_header[] = { command, (char)(uid_len >> 24), (char)(uid_len >> 16), (char)(uid_len >> 8),
+                                (char)uid_len };
+    out->write(uid_header, sizeof(uid_header));
+    out->write(uid.data(), uid_len);
+    out->put((char)slices.size());
+    for (size_t i = 0; i < slices.size(); ++i) {
+      const uint32_t len = (uint32_t)slices[i].index;
+      const char header[] = { (char)i, (char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len };
+      out->write(header, sizeof(header));
+      out->write(slices[i].buff, len);
+    }
+  }
+
+  // Schedule command with empty scheduling info, given options and schedulers (if not nullptr)
+  void write_empty_schedule_command(const SwmUID &uid, const ei_x_buff *options, std::ostream *out,
+                                    const ei_x_buff *schedulers = nullptr) {
+    std::vector<ei_x_buff> slices(swm::util::MandatoryDataTypeCount);
+    for (size_t i = 0; i < slices.size(); ++i) {
+      if (i == swm::util::SWM_DATA_TYPE_SCHEDULERS && schedulers != nullptr) {
+        slices[i] = *schedulers;
+        continue;
+      }
+      ASSERT_EQ(ei_x_new_with_version(&slices[i]), 0);
+      ASSERT_EQ(ei_x_encode_empty_list(&slices[i]), 0);
+    }
+    if (options != nullptr) {
+      slices.push_back(*options);
+    }
+    write_raw_command(swm::util::SWM_COMMAND_SCHEDULE, uid, slices, out);
+    for (size_t i = 0; i < swm::util::MandatoryDataTypeCount; ++i) {
+      if (i != swm::util::SWM_DATA_TYPE_SCHEDULERS || schedulers == nullptr) {
+        ei_x_free(&slices[i]);
+      }
+    }
+  }
+
+  // Interrupt, metrics or exchange command, chains are packed as strings
+  void write_chain_command(char command, const SwmUID &uid, const std::vector<SwmUID> &chains,
+                           std::ostream *out) {
+    std::vector<ei_x_buff> slices(chains.size());
+    for (size_t i = 0; i < chains.size(); ++i) {
+      ASSERT_EQ(ei_x_new_with_version(&slices[i]), 0);
+      ASSERT_EQ(ei_x_encode_string(&slices[i], chains[i].c_str()), 0);
+    }
+    write_raw_command(command, uid, slices, out);
+    for (auto &slice : slices) {
+      ei_x_free(&slice);
+    }
+  }
+
   // Fills stream with ErlBIN data (created according to JSON config)
   void prepare_input_stream(const std::string &json, std::istringstream *istr, bool *failed) {
     *failed = true;
@@ -145,7 +207,7 @@ class ctrl : public ::testing::Test {
     prepare_input_stream(json, &istr, &failed);
     ASSERT_FALSE(failed);
 
-    swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+    swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
     swm::util::Receiver receiver;
     ASSERT_NO_THROW(receiver.init(&queue, &istr));
     while (!receiver.finished() && queue.element_count() < queue.size()) {
@@ -14,8 +14,8 @@ TEST_F(ctrl, processor_no_init) {
 }
 
 TEST_F(ctrl, processor_multiple_init) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -24,8 +24,8 @@ TEST_F(ctrl, processor_multiple_init) {
 }
 
 TEST_F(ctrl, processor_unknown_algorithm) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -41,8 +41,8 @@ TEST_F(ctrl, processor_unknown_algorithm) {
 }
 
 TEST_F(ctrl, processor_corrupted_data) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -57,8 +57,8 @@ TEST_F(ctrl, processor_corrupted_data) {
 }
 
 TEST_F(ctrl, processor_schedule) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -75,8 +75,8 @@ TEST_F(ctrl, processor_schedule) {
 }
 
 TEST_F(ctrl, processor_interrupt) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(4);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(4);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(4);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(4);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -94,8 +94,13 @@ TEST_F(ctrl, processor_interrupt) {
     ASSERT_EQ(out_queue.element_count(), 4);
     while (out_queue.element_count() > 0) {
       auto resp = out_queue.pop();
-      // Responses are not sorted, so we use if's to differ them
-      if (resp->context()->id() == "#schedule1" || resp->context()->id() == "#schedule2") {
+      // Responses are not sorted, so we use if's to differ them. Interrupted chains return
+      // the latest timetables they have (intermediate one of "swm-dummy" for the first one),
+      // the second one can be interrupted before FCFS has placed anything
+      if (resp->context()->id() == "#schedule1") {
+        ASSERT_TRUE(is_partial(resp));
+      }
+      else if (resp->context()->id() == "#schedule2") {
         ASSERT_FALSE(resp->succeeded());
       }
       else if (resp->context()->id() == "#interrupt1" || resp->context()->id() == "#interrupt2") {
@@ -109,8 +114,8 @@ TEST_F(ctrl, processor_interrupt) {
 }
 
 TEST_F(ctrl, processor_metrics) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(3);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -123,7 +128,7 @@ TEST_F(ctrl, processor_metrics) {
   while (out_queue.element_count() > 0) {
     auto resp = out_queue.pop();
     if (resp->context()->id() == "#schedule") {
-      ASSERT_FALSE(resp->succeeded());
+      ASSERT_TRUE(is_partial(resp));      // intermediate timetable of the interrupted chain
     }
     else if (resp->context()->id() == "#metrics" ||
              resp->context()->id() == "#interrupt") {
@@ -136,8 +141,8 @@ TEST_F(ctrl, processor_metrics) {
 }
 
 TEST_F(ctrl, processor_exchange) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(5);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(5);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -154,7 +159,7 @@ TEST_F(ctrl, processor_exchange) {
   while (out_queue.element_count() > 0) {
     auto resp = out_queue.pop();
     if (resp->context()->id() == "#schedule1" || resp->context()->id() == "#schedule2") {
-      ASSERT_FALSE(resp->succeeded());
+      ASSERT_TRUE(is_partial(resp));      // FCFS timetable of the interrupted chain
     }
     else if (resp->context()->id() == "#exchange" ||
              resp->context()->id() == "#interrupt1" ||
@@ -164,9 +169,47 @@ TEST_F(ctrl, processor_exchange) {
   }
 }
 
+TEST_F(ctrl, processor_islands_of_different_inputs) {
+  auto request = [this](const SwmUID &uid, const std::vector<std::string> &names, const std::string &digest) {
+    std::vector<swm::util::ScheduleCommand::AlgorithmSpec> algs;
+    for (const auto &name : names) {
+      algs.push_back(swm::util::ScheduleCommand::AlgorithmSpec(name));
+    }
+    swm::util::ScheduleCommand::ChainSpec spec;
+    spec.set_island("group");
+    return std::shared_ptr<swm::util::CommandInterface>(new swm::util::ScheduleCommand(
+      create_context(uid), algs, SchedulingInfoPresets::one_node_one_job("hold_on"),
+      swm::util::ScheduleCommand::ResponseSpec(), spec, digest));
+  };
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(6);
+  swm::util::Processor processor;
+  processor.set_migration_interval(0.01);
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  // Island of the same group name but of another input doesn't take the donor's timetable
+  in_queue.push(request("#donor", { "swm-fcfs", "swm-dummy" }, "a"));
+  in_queue.push(request("#other", { "swm-dummy" }, "b"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_EQ(processor.metrics()->migrations(), 0);
+
+  in_queue.push(request("#taker", { "swm-dummy" }, "a"));
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (processor.metrics()->migrations() == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_GT(processor.metrics()->migrations(), 0);
+
+  in_queue.push(create_interrupt_request("#interrupt1", "#donor"));
+  in_queue.push(create_interrupt_request("#interrupt2", "#other"));
+  in_queue.push(create_interrupt_request("#interrupt3", "#taker"));
+  ASSERT_NO_THROW(processor.close());
+  ASSERT_EQ(out_queue.element_count(), 6);
+}
+
 TEST_F(ctrl, processor_uid_conflict) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -178,10 +221,13 @@ TEST_F(ctrl, processor_uid_conflict) {
     in_queue.push(create_interrupt_request("#interrupt", "#schedule"));
   }
   ASSERT_EQ(out_queue.element_count(), 3);
+  size_t schedule_partial = 0, schedule_failed = 0;
   while (out_queue.element_count() > 0) {
     auto resp = out_queue.pop();
     if (resp->context()->id() == "#schedule") {
+      // The interrupted chain returns its timetable, the conflicting request is rejected
       ASSERT_FALSE(resp->succeeded());
+      ++(is_partial(resp) ? schedule_partial : schedule_failed);
     }
     else if (resp->context()->id() == "#interrupt") {
       ASSERT_TRUE(resp->succeeded());
@@ -190,11 +236,267 @@ TEST_F(ctrl, processor_uid_conflict) {
       ASSERT_TRUE(false) << "Wrong SwmUID";
     }
   }
+  ASSERT_EQ(schedule_partial, 1);
+  ASSERT_EQ(schedule_failed, 1);
+}
+
+TEST_F(ctrl, processor_uid_of_other_connection) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(5);
+  {
+    swm::util::Processor processor;
+    ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+    // Clients choose their ids independently: the same id of the other connection is not a conflict,
+    // and a control command reaches the chains of its own connection only
+    std::vector<swm::util::ScheduleCommand::AlgorithmSpec> dummy(1, { "swm-dummy" });
+    std::shared_ptr<swm::util::CommandContext> schedule(new swm::util::CommandContext("#schedule", 0, 1));
+    std::shared_ptr<swm::util::CommandContext> foreign(new swm::util::CommandContext("#foreign", 0, 2));
+    in_queue.push(create_schedule_request("#schedule", { "swm-dummy" },
+                                          SchedulingInfoPresets::one_node_one_job("hold_on")));
+    in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                    new swm::util::ScheduleCommand(schedule, dummy, SchedulingInfoPresets::one_node_one_job("1"))));
+    in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                    new swm::util::InterruptCommand(foreign, "#schedule")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    in_queue.push(create_interrupt_request("#interrupt", "#schedule"));
+  }
+  ASSERT_EQ(out_queue.element_count(), 4);
+  while (out_queue.element_count() > 0) {
+    auto resp = out_queue.pop();
+    const auto &id = resp->context()->id();
+    if (id == "#schedule") {
+      if (resp->context()->origin() == 0) {
+        ASSERT_TRUE(is_partial(resp));
+      }
+      else {
+        ASSERT_TRUE(resp->succeeded());
+      }
+    }
+    else if (id == "#foreign") {
+      ASSERT_FALSE(resp->succeeded());
+    }
+    else if (id == "#interrupt") {
+      ASSERT_TRUE(resp->succeeded());
+    }
+    else {
+      ASSERT_TRUE(false) << "Wrong SwmUID";
+    }
+  }
+}
+
+TEST_F(ctrl, processor_out_of_order) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
+  swm::util::Processor processor;
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  // The first request is in flight while the second one completes
+  in_queue.push(create_schedule_request("#slow", { "swm-dummy" },
+                                        SchedulingInfoPresets::one_node_one_job("hold_on")));
+  in_queue.push(create_schedule_request("#fast", { "swm-fcfs" },
+                                        SchedulingInfoPresets::one_node_one_job("1")));
+  auto fast = out_queue.pop();
+  ASSERT_EQ(fast->context()->id(), "#fast");
+  ASSERT_TRUE(fast->succeeded());
+
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(create_interrupt_request("#interrupt", "#slow")));
+  ASSERT_NO_THROW(processor.close());
+  ASSERT_EQ(out_queue.element_count(), 2);
+  while (out_queue.element_count() > 0) {
+    auto resp = out_queue.pop();
+    ASSERT_TRUE(resp->context()->id() == "#slow" || resp->context()->id() == "#interrupt");
+    ASSERT_TRUE(resp->context()->id() == "#slow" ? is_partial(resp) : resp->succeeded());
+  }
+}
+
+TEST_F(ctrl, processor_control_lane) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > control_queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
+  swm::util::Processor processor;
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0, &control_queue));
+
+  // Metrics of unknown chain fail at once, interrupt waits for the schedule sent before it
+  std::shared_ptr<swm::util::CommandContext> metrics_ctx(new swm::util::CommandContext("#metrics", 0));
+  std::shared_ptr<swm::util::CommandContext> interrupt_ctx(new swm::util::CommandContext("#interrupt", 1));
+  control_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                       new swm::util::MetricsCommand(metrics_ctx, "#schedule")));
+  control_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                       new swm::util::InterruptCommand(interrupt_ctx, "#schedule")));
+  in_queue.wake_consumer();
+  auto metrics = out_queue.pop();
+  ASSERT_EQ(metrics->context()->id(), "#metrics");
+  ASSERT_FALSE(metrics->succeeded());
+
+  in_queue.push(create_schedule_request("#schedule", { "swm-dummy" },
+                                        SchedulingInfoPresets::one_node_one_job("hold_on")));
+  ASSERT_NO_THROW(processor.close());
+  ASSERT_EQ(out_queue.element_count(), 2);
+  while (out_queue.element_count() > 0) {
+    auto resp = out_queue.pop();
+    ASSERT_TRUE(resp->context()->id() == "#schedule" || resp->context()->id() == "#interrupt");
+    ASSERT_TRUE(resp->context()->id() == "#schedule" ? is_partial(resp) : resp->succeeded());
+  }
+}
+
+TEST_F(ctrl, processor_coalescing) {
+  auto grid_job = [](const std::string &job_id) -> std::shared_ptr<swm::SchedulingInfoInterface> {
+    auto info = SchedulingInfoPresets::one_node_one_job(job_id);
+    swm::SwmGrid grid;
+    grid.set_id("grid");
+    static_cast<swm::util::SchedulingInfo *>(info.get())->set_grid(grid);
+    return info;
+  };
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(5);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(5);
+  swm::util::Processor processor;
+  processor.set_coalescing(true);
+
+  // Queued requests of the grid are replaced by the latest one, request without scope is kept,
+  // as well as the request of the same grid that came from the other connection
+  std::vector<swm::util::ScheduleCommand::AlgorithmSpec> fcfs(1, { "swm-fcfs" });
+  std::shared_ptr<swm::util::CommandContext> foreign(new swm::util::CommandContext("#foreign", 0, 1));
+  in_queue.push(create_schedule_request("#old1", { "swm-fcfs" }, grid_job("1")));
+  in_queue.push(create_schedule_request("#old2", { "swm-fcfs" }, grid_job("1")));
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                  new swm::util::ScheduleCommand(foreign, fcfs, grid_job("1"))));
+  in_queue.push(create_schedule_request("#other", { "swm-fcfs" },
+                                        SchedulingInfoPresets::one_node_one_job("1")));
+  in_queue.push(create_schedule_request("#new", { "swm-fcfs" }, grid_job("1")));
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+  for (size_t i = 0; i < 5; ++i) {
+    auto resp = out_queue.pop();
+    const auto &id = resp->context()->id();
+    if (id == "#old1" || id == "#old2") {
+      auto superseded = dynamic_cast<swm::util::SupersededResponse *>(resp.get());
+      ASSERT_NE(superseded, nullptr);
+      ASSERT_EQ(superseded->superseded_by(), id == "#old1" ? "#old2" : "#new");
+      ASSERT_FALSE(resp->succeeded());
+    }
+    else {
+      ASSERT_TRUE(id == "#other" || id == "#foreign" || id == "#new");
+      ASSERT_TRUE(resp->succeeded());
+    }
+  }
+
+  // Running chain of the grid is interrupted by the newer request
+  in_queue.push(create_schedule_request("#running", { "swm-dummy" }, grid_job("hold_on")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  in_queue.push(create_schedule_request("#newer", { "swm-fcfs" }, grid_job("1")));
+  ASSERT_NO_THROW(processor.close());
+  ASSERT_EQ(out_queue.element_count(), 2);
+  while (out_queue.element_count() > 0) {
+    auto resp = out_queue.pop();
+    if (resp->context()->id() == "#running") {
+      auto superseded = dynamic_cast<swm::util::SupersededResponse *>(resp.get());
+      ASSERT_NE(superseded, nullptr);
+      ASSERT_EQ(superseded->superseded_by(), "#newer");
+    }
+    else {
+      ASSERT_EQ(resp->context()->id(), "#newer");
+      ASSERT_TRUE(resp->succeeded());
+    }
+  }
+  ASSERT_EQ(processor.metrics()->superseded_requests(), 3);
+}
+
+TEST_F(ctrl, processor_memoization) {
+  auto request = [this](const SwmUID &uid, const std::string &digest, const std::string &alg,
+                        const std::string &job = "1", double budget = 0.0) {
+    std::vector<swm::util::ScheduleCommand::AlgorithmSpec> algs(1, swm::util::ScheduleCommand::AlgorithmSpec(alg));
+    swm::util::ScheduleCommand::ChainSpec spec;
+    spec.set_budget(budget);
+    return std::shared_ptr<swm::util::CommandInterface>(new swm::util::ScheduleCommand(
+      create_context(uid), algs, SchedulingInfoPresets::one_node_one_job(job),
+      swm::util::ScheduleCommand::ResponseSpec(), spec, digest));
+  };
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::Processor processor;
+  processor.set_memoization(4, 60.0);
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  // The same input is scheduled once, other schedulers or unknown digest run their chains
+  const std::vector<std::tuple<SwmUID, std::string, std::string> > requests = {
+    std::make_tuple("#1", "input", "swm-fcfs"),
+    std::make_tuple("#2", "input", "swm-fcfs"),
+    std::make_tuple("#3", "input", "swm-dummy"),
+    std::make_tuple("#4", "other", "swm-fcfs"),
+    std::make_tuple("#5", "", "swm-fcfs"),
+    std::make_tuple("#6", "input", "swm-fcfs"),
+  };
+  std::vector<std::shared_ptr<swm::util::ResponseInterface> > responses;
+  for (const auto &req : requests) {
+    in_queue.push(request(std::get<0>(req), std::get<1>(req), std::get<2>(req)));
+    responses.push_back(out_queue.pop());
+    ASSERT_EQ(responses.back()->context()->id(), std::get<0>(req));
+    ASSERT_TRUE(responses.back()->succeeded());
+  }
+  ASSERT_EQ(processor.metrics()->memoization_hits(), 2);
+  ASSERT_EQ(processor.metrics()->memoization_misses(), 3);
+
+  // Partial result of the interrupted chain isn't reused, results of chains with budget are never reused
+  for (const SwmUID uid : { "#held1", "#held2" }) {
+    in_queue.push(request(uid, "held", "swm-dummy", "hold_on"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    in_queue.push(create_interrupt_request(uid + "_interrupt", uid));
+    for (size_t i = 0; i < 2; ++i) {
+      auto resp = out_queue.pop();
+      ASSERT_TRUE(resp->context()->id() == uid ? !resp->succeeded() : resp->succeeded());
+    }
+  }
+  for (const SwmUID uid : { "#budget1", "#budget2" }) {
+    in_queue.push(request(uid, "input", "swm-fcfs", "1", 10.0));
+    ASSERT_TRUE(out_queue.pop()->succeeded());
+  }
+  ASSERT_NO_THROW(processor.close());
+  ASSERT_EQ(processor.metrics()->memoization_hits(), 2);
+  ASSERT_EQ(processor.metrics()->memoization_misses(), 5);
+}
+
+TEST_F(ctrl, processor_estimate) {
+  auto estimate_request = [this](const SwmUID &uid) {
+    swm::SwmJob known, unknown;
+    std::vector<swm::SwmResource> request(1);
+    request[0].set_name("node");
+    request[0].set_count(1);
+    known.set_id("known");
+    known.set_cluster_id("1");
+    known.set_request(request);
+    unknown.set_id("unknown");
+    unknown.set_cluster_id("2");
+    unknown.set_request(request);
+    return std::shared_ptr<swm::util::CommandInterface>(
+      new swm::util::EstimateCommand(create_context(uid), { known, unknown }));
+  };
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::Processor processor;
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  // Nothing was scheduled yet, so nothing is known
+  in_queue.push(estimate_request("#estimate1"));
+  auto resp = out_queue.pop();
+  ASSERT_TRUE(resp->succeeded());
+  ASSERT_TRUE(static_cast<swm::util::EstimateResponse *>(resp.get())->estimates().empty());
+
+  in_queue.push(create_schedule_request("#schedule", { "swm-fcfs" }, SchedulingInfoPresets::one_node_one_job("1")));
+  ASSERT_TRUE(out_queue.pop()->succeeded());
+  in_queue.push(estimate_request("#estimate2"));
+  resp = out_queue.pop();
+  ASSERT_EQ(resp->context()->id(), "#estimate2");
+  const auto &estimates = static_cast<swm::util::EstimateResponse *>(resp.get())->estimates();
+  ASSERT_EQ(estimates.size(), 1);
+  ASSERT_EQ(estimates[0].get_job_id(), "known");
+  ASSERT_EQ(estimates[0].get_job_nodes(), std::vector<std::string>({ "1" }));
+  ASSERT_EQ(processor.availability()->cluster_count(), 1);
+  ASSERT_NO_THROW(processor.close());
 }
 
 TEST_F(ctrl, processor_no_such_uid) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(3);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -212,8 +514,8 @@ TEST_F(ctrl, processor_no_such_uid) {
 }
 
 TEST_F(ctrl, processor_time_counting) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(2);
   {
     swm::util::Processor processor;
     ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
@@ -232,7 +534,7 @@ TEST_F(ctrl, processor_time_counting) {
     ASSERT_GE(working, 0.0);
 
     if (resp->context()->id() == "#schedule") {
-      ASSERT_FALSE(resp->succeeded());
+      ASSERT_TRUE(is_partial(resp));
       ASSERT_GE(astro, 0.025); ASSERT_LE(astro, 0.075);
       ASSERT_GE(working, 0.025); ASSERT_LE(working, 0.075);
       ASSERT_LE(idling, 0.010);
@@ -247,3 +549,127 @@ TEST_F(ctrl, processor_time_counting) {
   }
 }
 
+
+TEST_F(ctrl, processor_diff_response) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::Processor processor;
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  swm::util::ScheduleCommand::ResponseSpec spec;
+  spec.set_diff_requested(true);
+  spec.set_client("client");
+  std::vector<swm::util::ScheduleCommand::AlgorithmSpec> algs = { { "swm-fcfs" } };
+  auto info = SchedulingInfoPresets::one_node_one_job("1");
+
+  // Nothing was acknowledged yet, so the whole timetable is expected
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                  new swm::util::ScheduleCommand(create_context("#schedule1"), algs, info, spec)));
+  auto resp1 = out_queue.pop();
+  ASSERT_TRUE(resp1->succeeded());
+  ASSERT_TRUE(dynamic_cast<swm::util::TimetableResponse *>(resp1.get()) != nullptr);
+
+  spec.set_acknowledged("#schedule1");
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                  new swm::util::ScheduleCommand(create_context("#schedule2"), algs, info, spec)));
+  auto resp2 = out_queue.pop();
+  auto diff = dynamic_cast<swm::util::TimetableDiffResponse *>(resp2.get());
+  ASSERT_TRUE(diff != nullptr);
+  ASSERT_TRUE(diff->added().empty());
+  ASSERT_TRUE(diff->removed().empty());
+  ASSERT_TRUE(diff->changed().empty());
+
+  spec.set_acknowledged("#schedule2");
+  spec.set_resync_requested(true);
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                  new swm::util::ScheduleCommand(create_context("#schedule3"), algs, info, spec)));
+  auto resp3 = out_queue.pop();
+  ASSERT_TRUE(dynamic_cast<swm::util::TimetableResponse *>(resp3.get()) != nullptr);
+  ASSERT_NO_THROW(processor.close());
+}
+
+TEST_F(ctrl, processor_inline_chains) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(2);
+  swm::util::Processor processor;
+  processor.set_inline_threshold(1);
+  ASSERT_EQ(processor.get_inline_threshold(), 1);
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+  ASSERT_GE(processor.metrics()->pool_threads(), 1);
+  ASSERT_EQ(processor.metrics()->pool_busy_threads(), 0);
+
+  in_queue.push(create_schedule_request("#inline", { "swm-fcfs" },
+                                        SchedulingInfoPresets::one_node_one_job("1")));
+  auto resp = out_queue.pop();
+  ASSERT_EQ(resp->context()->id(), "#inline");
+  ASSERT_TRUE(resp->succeeded());
+  ASSERT_EQ(processor.metrics()->inline_chains(), 1);
+  ASSERT_NO_THROW(processor.close());
+}
+
+TEST_F(ctrl, processor_inline_chains_interrupted) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(4);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(4);
+  swm::util::Processor processor;
+  processor.set_inline_threshold(1);
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  // Small chains that never finish by themselves don't hold the interruptions
+  const auto start = std::chrono::steady_clock::now();
+  in_queue.push(create_schedule_request("#inline1", { "swm-dummy" },
+                                        SchedulingInfoPresets::one_node_one_job("hold_on")));
+  in_queue.push(create_schedule_request("#inline2", { "swm-dummy" },
+                                        SchedulingInfoPresets::one_node_one_job("hold_on")));
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                                        create_interrupt_request("#interrupt1", "#inline1")));
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                                        create_interrupt_request("#interrupt2", "#inline2")));
+  for (size_t i = 0; i < 4; ++i) {
+    auto resp = out_queue.pop();
+    if (resp->context()->id() == "#interrupt1" || resp->context()->id() == "#interrupt2") {
+      ASSERT_TRUE(resp->succeeded());
+    }
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  ASSERT_EQ(processor.metrics()->inline_chains(), 2);
+  ASSERT_NO_THROW(processor.close());
+}
+
+TEST_F(ctrl, processor_pinned_cpus) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(2);
+  swm::util::Processor processor;
+  ASSERT_EQ(processor.get_placement(), swm::util::Processor::NUMA_NODES);
+  processor.set_placement(swm::util::Processor::PINNED_CPUS);
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+  ASSERT_GE(processor.metrics()->pool_threads(), 2);
+
+  in_queue.push(create_schedule_request("#pinned1", { "swm-fcfs" },
+                                        SchedulingInfoPresets::one_node_one_job("1")));
+  in_queue.push(create_schedule_request("#pinned2", { "swm-fcfs" },
+                                        SchedulingInfoPresets::one_node_one_job("1")));
+  ASSERT_TRUE(out_queue.pop()->succeeded());
+  ASSERT_TRUE(out_queue.pop()->succeeded());
+  ASSERT_NO_THROW(processor.close());
+}
+
+TEST_F(ctrl, processor_portfolio) {
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > in_queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > out_queue(1);
+  swm::util::Processor processor;
+  ASSERT_NO_THROW(processor.init(factory(), scanner(), &in_queue, &out_queue, 10.0));
+
+  swm::util::ScheduleCommand::ChainSpec spec;
+  spec.set_portfolio(true);
+  spec.set_objective(swm::TimetableObjective::TOTAL_START_TIME);
+  spec.set_budget(0.1);
+  std::vector<swm::util::ScheduleCommand::AlgorithmSpec> algs = { { "swm-dummy" }, { "swm-fcfs" } };
+  in_queue.push(std::shared_ptr<swm::util::CommandInterface>(
+                  new swm::util::ScheduleCommand(create_context("#portfolio"), algs,
+                                                 SchedulingInfoPresets::one_node_one_job("hold_on"),
+                                                 swm::util::ScheduleCommand::ResponseSpec(), spec)));
+  auto resp = out_queue.pop();
+  ASSERT_EQ(resp->context()->id(), "#portfolio");
+  ASSERT_TRUE(resp->succeeded());
+  ASSERT_NO_THROW(processor.close());
+}
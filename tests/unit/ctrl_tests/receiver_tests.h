@@ -7,10 +7,11 @@
 #include "test_defs.h"
 #include "ctrl.h"
 #include "ctrl/receiver.h"
+#include "auxl/term_compression.h"
 
 
 TEST_F(ctrl, receiver_wrong_init) {
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(1);
   std::unique_ptr<swm::util::Receiver> receiver;
   receiver.reset(new swm::util::Receiver());
   ASSERT_ANY_THROW(receiver->init(&queue, nullptr));
@@ -20,7 +21,7 @@ TEST_F(ctrl, receiver_wrong_init) {
 
 TEST_F(ctrl, receiver_second_init) {
   std::istringstream istr1, istr2;
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(3);
   swm::util::Receiver receiver;
   ASSERT_NO_THROW(receiver.init(&queue, &istr1));
   while (!receiver.finished() && queue.element_count() < queue.size()) {
@@ -32,12 +33,13 @@ TEST_F(ctrl, receiver_second_init) {
 TEST_F(ctrl, receiver_no_init) {
   swm::util::Receiver receiver;
   ASSERT_ANY_THROW(receiver.finished());
+  ASSERT_ANY_THROW(receiver.wait());
 }
 
 TEST_F(ctrl, receiver_wrong_config) {
   std::istringstream istr;
   istr.str("No one expects the Spanish inquisition!");
-  swm::util::MyQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
   swm::util::Receiver receiver;
   ASSERT_NO_THROW(receiver.init(&queue, &istr));
 
@@ -181,3 +183,267 @@ TEST_F(ctrl, receiver_parse_rh) {
   ASSERT_EQ(rh5.id(), "3");
   ASSERT_EQ(rh5.children().size(), 0);
 }
+
+TEST_F(ctrl, receiver_parse_options) {
+  ei_x_buff options;
+  ASSERT_EQ(ei_x_new_with_version(&options), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&options, 4), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&options, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&options, "diff"), 0);
+  ASSERT_EQ(ei_x_encode_atom(&options, "true"), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&options, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&options, "client"), 0);
+  ASSERT_EQ(ei_x_encode_string(&options, "client-1"), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&options, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&options, "ack"), 0);
+  ASSERT_EQ(ei_x_encode_string(&options, "request-7"), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&options, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&options, "unknown_option"), 0);
+  ASSERT_EQ(ei_x_encode_long(&options, 42), 0);
+  ASSERT_EQ(ei_x_encode_empty_list(&options), 0);
+
+  std::stringstream stream;
+  write_empty_schedule_command("#plain", nullptr, &stream);
+  write_empty_schedule_command("#options", &options, &stream);
+  ei_x_free(&options);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_TRUE(receiver.finished());
+  ASSERT_EQ(queue.element_count(), 2);
+
+  auto plain = queue.pop();
+  ASSERT_EQ(plain->type(), swm::util::SWM_COMMAND_SCHEDULE);
+  ASSERT_FALSE(static_cast<swm::util::ScheduleCommand *>(plain.get())->response_spec().diff_requested());
+
+  auto cmd = queue.pop();
+  ASSERT_EQ(cmd->type(), swm::util::SWM_COMMAND_SCHEDULE);
+  const auto &spec = static_cast<swm::util::ScheduleCommand *>(cmd.get())->response_spec();
+  ASSERT_TRUE(spec.diff_requested());
+  ASSERT_FALSE(spec.resync_requested());
+  ASSERT_EQ(spec.client(), "client-1");
+  ASSERT_EQ(spec.chain(), "");
+  ASSERT_EQ(spec.acknowledged(), "request-7");
+}
+
+TEST_F(ctrl, receiver_parse_compressed) {
+  // Repetitive list of schedulers is compressible, other slices are sent as is
+  const size_t count = 200;
+  ei_x_buff schedulers;
+  ASSERT_EQ(ei_x_new_with_version(&schedulers), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&schedulers, count), 0);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(ei_x_encode_string(&schedulers, "swm-fcfs"), 0);
+  }
+  ASSERT_EQ(ei_x_encode_empty_list(&schedulers), 0);
+
+  std::unique_ptr<char[]> compressed;
+  size_t compressed_size = 0;
+  ASSERT_TRUE(swm::util::compress_term(schedulers.buff, (size_t)schedulers.index, 1,
+                                       &compressed, &compressed_size));
+  ei_x_free(&schedulers);
+  ei_x_buff packed;
+  ASSERT_EQ(ei_x_new(&packed), 0);
+  ASSERT_EQ(ei_x_append_buf(&packed, compressed.get(), (int)compressed_size), 0);
+
+  std::stringstream stream;
+  write_empty_schedule_command("#compressed", nullptr, &stream, &packed);
+  ei_x_free(&packed);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(1);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_EQ(queue.element_count(), 1);
+  auto cmd = queue.pop();
+  ASSERT_EQ(cmd->type(), swm::util::SWM_COMMAND_SCHEDULE);
+  const auto &algs = static_cast<swm::util::ScheduleCommand *>(cmd.get())->schedulers();
+  ASSERT_EQ(algs.size(), count);
+  ASSERT_EQ(algs[count - 1].family(), "swm-fcfs");
+}
+
+TEST_F(ctrl, receiver_parse_identifiers) {
+  ei_x_buff schedulers;
+  ASSERT_EQ(ei_x_new_with_version(&schedulers), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&schedulers, 2), 0);
+  ASSERT_EQ(ei_x_encode_string(&schedulers, "swm-fcfs"), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&schedulers, 3), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&schedulers, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&schedulers, "family"), 0);
+  ASSERT_EQ(ei_x_encode_string(&schedulers, "swm-dummy"), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&schedulers, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&schedulers, "version"), 0);
+  ASSERT_EQ(ei_x_encode_string(&schedulers, "1.0"), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&schedulers, 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&schedulers, "cu"), 0);
+  ASSERT_EQ(ei_x_encode_atom(&schedulers, "cpu"), 0);
+  ASSERT_EQ(ei_x_encode_empty_list(&schedulers), 0);
+  ASSERT_EQ(ei_x_encode_empty_list(&schedulers), 0);
+
+  std::stringstream stream;
+  write_empty_schedule_command("#schedule1", nullptr, &stream, &schedulers);
+  write_empty_schedule_command("#schedule2", nullptr, &stream);
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#interrupt", { "#schedule1" }, &stream);
+  write_chain_command(swm::util::SWM_COMMAND_METRICS, "#metrics", { "#schedule2" }, &stream);
+  write_chain_command(swm::util::SWM_COMMAND_EXCHANGE, "#exchange", { "#schedule1", "#schedule2" }, &stream);
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#no_chain", { }, &stream);
+  ei_x_free(&schedulers);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(6);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_EQ(queue.element_count(), 6);
+
+  auto sched1 = queue.pop();
+  ASSERT_EQ(sched1->context()->id(), "#schedule1");
+  const auto &algs = static_cast<swm::util::ScheduleCommand *>(sched1.get())->schedulers();
+  ASSERT_EQ(algs.size(), 2);
+  ASSERT_EQ(algs[0].family(), "swm-fcfs");
+  ASSERT_FALSE(algs[0].version_specified());
+  ASSERT_FALSE(algs[0].compute_unit_specified());
+  std::string version;
+  swm::ComputeUnitInterface::Type cu = swm::ComputeUnitInterface::Gpu;
+  ASSERT_EQ(algs[1].family(), "swm-dummy");
+  ASSERT_TRUE(algs[1].version_specified(&version));
+  ASSERT_EQ(version, "1.0");
+  ASSERT_TRUE(algs[1].compute_unit_specified(&cu));
+  ASSERT_EQ(cu, swm::ComputeUnitInterface::Cpu);
+
+  // Empty list of schedulers means the default one
+  auto sched2 = queue.pop();
+  ASSERT_EQ(sched2->context()->id(), "#schedule2");
+  ASSERT_EQ(static_cast<swm::util::ScheduleCommand *>(sched2.get())->schedulers().size(), 1);
+  ASSERT_EQ(static_cast<swm::util::ScheduleCommand *>(sched2.get())->schedulers()[0].family(), "swm-fcfs");
+
+  auto interrupt = queue.pop();
+  ASSERT_EQ(interrupt->type(), swm::util::SWM_COMMAND_INTERRUPT);
+  ASSERT_EQ(interrupt->context()->id(), "#interrupt");
+  ASSERT_EQ(static_cast<swm::util::InterruptCommand *>(interrupt.get())->chain(), "#schedule1");
+
+  auto metrics = queue.pop();
+  ASSERT_EQ(metrics->type(), swm::util::SWM_COMMAND_METRICS);
+  ASSERT_EQ(static_cast<swm::util::MetricsCommand *>(metrics.get())->chain(), "#schedule2");
+
+  auto exchange = queue.pop();
+  ASSERT_EQ(exchange->type(), swm::util::SWM_COMMAND_EXCHANGE);
+  ASSERT_EQ(static_cast<swm::util::ExchangeCommand *>(exchange.get())->source_chain(), "#schedule1");
+  ASSERT_EQ(static_cast<swm::util::ExchangeCommand *>(exchange.get())->target_chain(), "#schedule2");
+
+  // Command without the chain identifier can't be performed
+  auto corrupted = queue.pop();
+  ASSERT_EQ(corrupted->type(), swm::util::SWM_COMMAND_CORRUPTED);
+  ASSERT_EQ(corrupted->context()->id(), "#no_chain");
+}
+
+TEST_F(ctrl, receiver_parse_malformed_candidates) {
+  // Candidate that is not a job's tuple and the list with the wrong tail
+  std::vector<ei_x_buff> not_tuple(1), improper(1);
+  ASSERT_EQ(ei_x_new_with_version(&not_tuple[0]), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&not_tuple[0], 1), 0);
+  ASSERT_EQ(ei_x_encode_atom(&not_tuple[0], "job"), 0);
+  ASSERT_EQ(ei_x_encode_empty_list(&not_tuple[0]), 0);
+  ASSERT_EQ(ei_x_new_with_version(&improper[0]), 0);
+  ASSERT_EQ(ei_x_encode_list_header(&improper[0], 1), 0);
+  ASSERT_EQ(ei_x_encode_tuple_header(&improper[0], 2), 0);
+  ASSERT_EQ(ei_x_encode_atom(&improper[0], "job"), 0);
+  ASSERT_EQ(ei_x_encode_string(&improper[0], "1"), 0);
+  ASSERT_EQ(ei_x_encode_atom(&improper[0], "tail"), 0);
+
+  std::stringstream stream;
+  write_raw_command(swm::util::SWM_COMMAND_ESTIMATE, "#not_tuple", not_tuple, &stream);
+  write_raw_command(swm::util::SWM_COMMAND_ESTIMATE, "#improper", improper, &stream);
+  ei_x_free(&not_tuple[0]);
+  ei_x_free(&improper[0]);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_EQ(queue.element_count(), 2);
+  for (const char *uid : { "#not_tuple", "#improper" }) {
+    auto cmd = queue.pop();
+    ASSERT_EQ(cmd->context()->id(), uid);
+    ASSERT_EQ(cmd->type(), swm::util::SWM_COMMAND_CORRUPTED);
+  }
+}
+
+TEST_F(ctrl, receiver_uid_too_long) {
+  // Declared length of the request identifier is not allocated, the stream is taken as corrupted
+  std::stringstream stream;
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#before", { "#schedule" }, &stream);
+  stream.put((char)swm::util::SWM_COMMAND_INTERRUPT);
+  stream.write("\xff\xff\xff\xff", 4);
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#after", { "#schedule" }, &stream);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(2);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_TRUE(receiver.finished());
+  ASSERT_EQ(queue.element_count(), 1);
+  ASSERT_EQ(queue.pop()->context()->id(), "#before");
+}
+
+TEST_F(ctrl, receiver_control_lane) {
+  std::stringstream stream;
+  write_chain_command(swm::util::SWM_COMMAND_METRICS, "#metrics", { "#running" }, &stream);
+  write_empty_schedule_command("#schedule", nullptr, &stream);
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#interrupt", { "#schedule" }, &stream);
+
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(3);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > control_queue(3);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream, &control_queue));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_TRUE(receiver.finished());
+  ASSERT_EQ(queue.element_count(), 1);
+  ASSERT_EQ(control_queue.element_count(), 2);
+
+  // Control commands know how many schedules were sent before them
+  auto schedule = queue.pop();
+  ASSERT_EQ(schedule->context()->id(), "#schedule");
+  ASSERT_EQ(schedule->type(), swm::util::SWM_COMMAND_SCHEDULE);
+  auto metrics = control_queue.pop();
+  ASSERT_EQ(metrics->context()->id(), "#metrics");
+  ASSERT_EQ(metrics->context()->schedules_before(), 0);
+  auto interrupt = control_queue.pop();
+  ASSERT_EQ(interrupt->context()->id(), "#interrupt");
+  ASSERT_EQ(interrupt->context()->schedules_before(), 1);
+}
+
+TEST_F(ctrl, receiver_control_lane_parser_behind) {
+  std::stringstream stream;
+  for (size_t i = 0; i < 5; ++i) {
+    write_empty_schedule_command("#schedule" + std::to_string(i), nullptr, &stream);
+  }
+  write_chain_command(swm::util::SWM_COMMAND_INTERRUPT, "#interrupt", { "#schedule0" }, &stream);
+
+  // Nobody takes schedules: the queue, the parser and the frames waiting for it hold three of them,
+  // so the reader waits before the control command
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > queue(1);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > control_queue(1);
+  swm::util::Receiver receiver;
+  ASSERT_NO_THROW(receiver.init(&queue, &stream, &control_queue));
+  std::shared_ptr<swm::util::CommandInterface> interrupt;
+  ASSERT_FALSE(control_queue.pop_for(&interrupt, std::chrono::milliseconds(100)));
+  ASSERT_FALSE(receiver.finished());
+
+  // Taken schedules let the reader go on, the control command doesn't wait for the rest of them
+  std::shared_ptr<swm::util::CommandInterface> schedule;
+  for (size_t i = 0; i < 2; ++i) {
+    while (!queue.pop(&schedule)) { }
+    ASSERT_EQ(schedule->context()->id(), "#schedule" + std::to_string(i));
+  }
+  ASSERT_TRUE(control_queue.pop_for(&interrupt, std::chrono::seconds(5)));
+  ASSERT_EQ(interrupt->context()->id(), "#interrupt");
+  ASSERT_EQ(interrupt->context()->schedules_before(), 5);
+  for (size_t i = 2; i < 5; ++i) {
+    while (!queue.pop(&schedule)) { }
+    ASSERT_EQ(schedule->context()->id(), "#schedule" + std::to_string(i));
+  }
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_EQ(receiver.commands(), 6);
+}
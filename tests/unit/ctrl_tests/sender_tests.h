@@ -13,35 +13,35 @@
 
 TEST_F(ctrl, sender_start_stop) {
   std::unique_ptr<swm::util::Sender> ptr(new swm::util::Sender());
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_NO_THROW(ptr->init(&queue, &std::cout));
   ptr.reset();
 }
 
 TEST_F(ctrl, sender_nullptrs) {
   swm::util::Sender sender;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_ANY_THROW(sender.init(&queue, nullptr));
   ASSERT_ANY_THROW(sender.init(nullptr, &std::cout));
 }
 
 TEST_F(ctrl, sender_second_init) {
   swm::util::Sender sender;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_NO_THROW(sender.init(&queue, &std::cout));
   ASSERT_ANY_THROW(sender.init(&queue, &std::cout));
 }
 
 TEST_F(ctrl, sender_no_init) {
   swm::util::Sender sender;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_ANY_THROW(sender.close());
 }
 
 TEST_F(ctrl, sender_nullptr_as_response) {
   swm::util::Sender sender;
   std::stringstream oss;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   queue.push(std::shared_ptr<swm::util::ResponseInterface>());
   queue.push(std::shared_ptr<swm::util::ResponseInterface>());
   ASSERT_NO_THROW(sender.init(&queue, &oss));
@@ -53,7 +53,7 @@ TEST_F(ctrl, sender_nullptr_as_response) {
 TEST_F(ctrl, sender_failed_response) {
   swm::util::Sender sender;
   std::stringstream oss;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_NO_THROW(sender.init(&queue, &oss));
   
   std::shared_ptr<swm::util::CommandContext> ctx(new swm::util::CommandContext("0"));
@@ -68,7 +68,7 @@ TEST_F(ctrl, sender_failed_response) {
 TEST_F(ctrl, sender_timetable_response) {
   swm::util::Sender sender;
   std::stringstream oss;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_NO_THROW(sender.init(&queue, &oss));
 
   swm::SwmTimetable table1, table2;
@@ -97,7 +97,7 @@ TEST_F(ctrl, sender_timetable_response) {
 TEST_F(ctrl, sender_multiple_responses) {
   swm::util::Sender sender;
   std::stringstream oss;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   ASSERT_NO_THROW(sender.init(&queue, &oss));
 
   std::shared_ptr<swm::util::CommandContext> ctx1(new swm::util::CommandContext("1"));
@@ -122,7 +122,7 @@ TEST_F(ctrl, sender_multiple_start_stop) {
   const int n = 10;
   swm::util::Sender sender;
   std::stringstream oss;
-  swm::util::MyQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
   for (int i = 0; i < n; ++i) {
     ASSERT_NO_THROW(sender.init(&queue, &oss));
     std::shared_ptr<swm::util::CommandContext> ctx(new swm::util::CommandContext("0"));
@@ -133,3 +133,65 @@ TEST_F(ctrl, sender_multiple_start_stop) {
   }
   ASSERT_GE(oss.str().size(), 5 * n);
 }
+
+TEST_F(ctrl, sender_too_large_for_ring) {
+  std::vector<swm::SwmTimetable> tables(100);
+  std::vector<const swm::SwmTimetable *> table_ptrs;
+  for (size_t i = 0; i < tables.size(); ++i) {
+    tables[i].set_job_id(std::to_string(i));
+    table_ptrs.push_back(&tables[i]);
+  }
+  std::shared_ptr<swm::TimetableInfoInterface> tt(new TimetableInfoForTests(table_ptrs));
+  std::shared_ptr<swm::util::MetricsSnapshot> m(new swm::util::MetricsSnapshot());
+
+  // Client learns that the result is lost instead of waiting for it
+  swm::util::ShmRing ring;
+  ASSERT_TRUE(ring.create(1024));
+  {
+    swm::util::Sender sender;
+    swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+    ASSERT_NO_THROW(sender.init_ring(&queue, &ring));
+    std::shared_ptr<swm::util::CommandContext> ctx(new swm::util::CommandContext("#huge"));
+    queue.push(std::shared_ptr<swm::util::ResponseInterface>(new swm::util::TimetableResponse(ctx, tt, m)));
+    ASSERT_NO_THROW(sender.close());
+  }
+  swm::util::ShmRing::Frame frame;
+  ASSERT_TRUE(ring.acquire(&frame, 0.0));
+  ASSERT_LE(frame.size, ring.max_frame_size());
+  const std::string received(frame.data, frame.size);
+  EXPECT_NE(received.find("#huge"), std::string::npos);
+  EXPECT_EQ(received.find("99"), std::string::npos);
+}
+
+TEST_F(ctrl, sender_compressed_response) {
+  const size_t jobs = 500;
+  std::vector<swm::SwmTimetable> tables(jobs);
+  std::vector<const swm::SwmTimetable *> table_ptrs;
+  for (size_t i = 0; i < jobs; ++i) {
+    tables[i].set_job_id(std::to_string(i));
+    tables[i].set_job_nodes(std::vector<std::string>(4, "00000000-0000-0000-0000-000000000042"));
+    tables[i].set_start_time(i);
+    table_ptrs.push_back(&tables[i]);
+  }
+  std::shared_ptr<swm::TimetableInfoInterface> tt(new TimetableInfoForTests(table_ptrs));
+  std::shared_ptr<swm::util::MetricsSnapshot> m(new swm::util::MetricsSnapshot());
+
+  std::stringstream plain, packed;
+  std::shared_ptr<swm::util::ServiceMetrics> metrics(new swm::util::ServiceMetrics());
+  for (auto oss : { &plain, &packed }) {
+    swm::util::Sender sender;
+    swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(2);
+    if (oss == &packed) {
+      sender.set_compression_threshold(1024);
+    }
+    ASSERT_NO_THROW(sender.init(&queue, oss, metrics));
+    std::shared_ptr<swm::util::CommandContext> ctx(new swm::util::CommandContext("1"));
+    queue.push(std::shared_ptr<swm::util::ResponseInterface>(new swm::util::TimetableResponse(ctx, tt, m)));
+    ASSERT_NO_THROW(sender.close());
+  }
+
+  ASSERT_LT(packed.str().size() * 4, plain.str().size());
+  ASSERT_EQ(metrics->compressed_responses(), 1);
+  ASSERT_GT(metrics->compression_ratio(), 4.0);
+  ASSERT_GE(metrics->compression_time(), 0.0);
+}
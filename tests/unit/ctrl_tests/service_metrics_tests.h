@@ -0,0 +1,74 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "ctrl.h"
+#include "ctrl/sender.h"
+#include "chn/metrics_snapshot.h"
+
+TEST_F(ctrl, service_metrics_latencies) {
+  swm::util::ServiceMetrics metrics;
+  for (int ms = 1; ms <= 100; ++ms) {
+    metrics.record_latency(swm::util::ServiceMetrics::DECODE, std::chrono::milliseconds(ms));
+  }
+
+  // Percentiles are seen by snapshots only when published
+  const auto &object = metrics.object();
+  std::vector<std::pair<uint32_t, std::string> > indices = object.double_value_indices();
+  auto find = [&indices](const std::string &name) -> uint32_t {
+    for (const auto &index : indices) {
+      if (index.second == name) {
+        return index.first;
+      }
+    }
+    return 0;
+  };
+  const uint32_t p50 = find("decode latency p50, seconds");
+  const uint32_t p999 = find("decode latency p999, seconds");
+  ASSERT_NE(p50, 0);
+  ASSERT_NE(p999, 0);
+  ASSERT_EQ(object.clone()->double_value(p50), 0.0);
+
+  metrics.publish_latencies();
+  auto snapshot = object.clone();
+  ASSERT_NEAR(snapshot->double_value(p50), 0.050, 0.050 / 32);
+  ASSERT_NEAR(snapshot->double_value(p999), 0.100, 0.100 / 32);
+  ASSERT_EQ(snapshot->double_value(find("send latency p99, seconds")), 0.0);
+
+  metrics.latency(swm::util::ServiceMetrics::DECODE)->reset();
+  metrics.publish_latencies();
+  ASSERT_EQ(object.clone()->double_value(p50), 0.0);
+}
+
+TEST_F(ctrl, service_metrics_pipeline_stages) {
+  std::shared_ptr<swm::util::ServiceMetrics> metrics(new swm::util::ServiceMetrics());
+
+  // Reading and decoding of every command are recorded
+  std::stringstream input;
+  write_chain_command(swm::util::SWM_COMMAND_METRICS, "#metrics", { "#running" }, &input);
+  write_empty_schedule_command("#schedule", nullptr, &input);
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::CommandInterface> > commands(2);
+  swm::util::Receiver receiver;
+  receiver.set_metrics(metrics);
+  ASSERT_NO_THROW(receiver.init(&commands, &input));
+  ASSERT_NO_THROW(receiver.wait());
+  ASSERT_EQ(metrics->latency(swm::util::ServiceMetrics::RECEIVE)->count(), 2);
+  ASSERT_EQ(metrics->latency(swm::util::ServiceMetrics::DECODE)->count(), 2);
+
+  // Metrics response is encoded and sent only if replies are on, the original protocol has no answer
+  std::shared_ptr<swm::util::MetricsSnapshot> snapshot(new swm::util::MetricsSnapshot());
+  std::stringstream output;
+  swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > responses(2);
+  swm::util::Sender sender;
+  ASSERT_NO_THROW(sender.init(&responses, &output, metrics));
+  const auto context = commands.pop()->context();
+  responses.push(std::shared_ptr<swm::util::ResponseInterface>(
+    new swm::util::MetricsResponse(context, snapshot)));
+  responses.push(std::shared_ptr<swm::util::ResponseInterface>(
+    new swm::util::MetricsResponse(context, snapshot, true)));
+  ASSERT_NO_THROW(sender.close());
+  ASSERT_NE(output.str().find("scheduler_result"), std::string::npos);
+  ASSERT_EQ(output.str().find("scheduler_result"), output.str().rfind("scheduler_result"));
+  ASSERT_EQ(metrics->latency(swm::util::ServiceMetrics::ENCODE)->count(), 2);
+  ASSERT_EQ(metrics->latency(swm::util::ServiceMetrics::SEND)->count(), 1);
+}
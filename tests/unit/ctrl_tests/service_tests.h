@@ -0,0 +1,303 @@
+#pragma once
+
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ctrl.h"
+#include "ctrl/service.h"
+#include "ctrl/shm_client.h"
+#include "auxl/unix_socket.h"
+
+#if !defined(WIN32)
+
+TEST_F(ctrl, service_socket_clients) {
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".sock";
+  swm::Service service(factory(), scanner());
+  service.set_socket_path(path);
+  service.set_timeout(1.0);
+  bool served = false;
+  std::thread server([&service, &served]() -> void { served = service.main_loop(); });
+
+  // Server is listening asynchronously
+  std::vector<int> clients;
+  for (size_t i = 0; i < 2; ++i) {
+    int fd = -1;
+    for (size_t attempt = 0; attempt < 100 && fd == -1; ++attempt) {
+      fd = swm::util::UnixSocketListener::connect(path);
+      if (fd == -1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+    }
+    ASSERT_NE(fd, -1);
+    clients.push_back(fd);
+  }
+
+  // Both clients send requests at once, each gets the response to its own one
+  const std::vector<SwmUID> uids = { "#first-client", "#second-client" };
+  for (size_t i = 0; i < clients.size(); ++i) {
+    swm::util::SocketStreamBuf buffer(clients[i]);
+    std::ostream output(&buffer);
+    write_empty_schedule_command(uids[i], nullptr, &output);
+    ASSERT_TRUE(output.good());
+  }
+  for (size_t i = 0; i < clients.size(); ++i) {
+    swm::util::SocketStreamBuf buffer(clients[i]);
+    std::istream input(&buffer);
+    std::string received;
+    char ch;
+    while (received.find(uids[i]) == std::string::npos && input.get(ch)) {
+      received.push_back(ch);
+    }
+    EXPECT_NE(received.find(uids[i]), std::string::npos);
+    EXPECT_EQ(received.find(uids[1 - i]), std::string::npos);
+    swm::util::UnixSocketListener::close(clients[i]);
+  }
+
+  service.stop();
+  server.join();
+  EXPECT_TRUE(served);
+  EXPECT_FALSE(std::ifstream(path).good());
+}
+
+TEST_F(ctrl, service_socket_slow_client) {
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".sock";
+  swm::Service service(factory(), scanner());
+  service.set_socket_path(path);
+  service.set_timeout(1.0);
+  service.set_client_queue_size(1);
+  service.set_client_stall_timeout(1.0);
+  bool served = false;
+  std::thread server([&service, &served]() -> void { served = service.main_loop(); });
+
+  std::vector<int> clients;
+  for (size_t i = 0; i < 3; ++i) {
+    int fd = -1;
+    for (size_t attempt = 0; attempt < 100 && fd == -1; ++attempt) {
+      fd = swm::util::UnixSocketListener::connect(path);
+      if (fd == -1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+    }
+    ASSERT_NE(fd, -1);
+    clients.push_back(fd);
+  }
+  auto count = [](int fd, size_t expected) -> size_t {
+    swm::util::SocketStreamBuf buffer(fd);
+    std::istream input(&buffer);
+    std::string received;
+    size_t found = 0;
+    char ch;
+    while (found < expected && input.get(ch)) {
+      received.push_back(ch);
+      if (received.size() >= 3 && received.compare(received.size() - 3, 3, "#r-") == 0) {
+        ++found;
+      }
+    }
+    return found;
+  };
+
+  // Two clients don't read their responses for a while, more of them than the sockets can hold
+  const size_t requests = 600;
+  std::stringstream commands;
+  for (size_t i = 0; i < requests; ++i) {
+    write_empty_schedule_command("#r-" + std::to_string(i), nullptr, &commands);
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    swm::util::SocketStreamBuf buffer(clients[i]);
+    std::ostream output(&buffer);
+    output << commands.str() << std::flush;
+    ASSERT_TRUE(output.good());
+  }
+
+  // Others are still served
+  {
+    swm::util::SocketStreamBuf buffer(clients[2]);
+    std::ostream output(&buffer);
+    write_empty_schedule_command("#r-other", nullptr, &output);
+    ASSERT_TRUE(output.good());
+  }
+  EXPECT_EQ(count(clients[2], 1), 1);
+
+  // The first one comes back before the stall timeout and gets everything, the second one is disconnected
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(count(clients[0], requests), requests);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  EXPECT_LT(count(clients[1], requests), requests);
+  for (int fd : clients) {
+    swm::util::UnixSocketListener::close(fd);
+  }
+
+  service.stop();
+  server.join();
+  EXPECT_TRUE(served);
+}
+
+TEST_F(ctrl, service_socket_in_use) {
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".sock";
+
+  // Path of a file that is not a socket is never removed
+  std::ofstream(path) << "data";
+  swm::util::UnixSocketListener file_listener;
+  std::stringstream errors;
+  ASSERT_FALSE(file_listener.listen(path, &errors));
+  ASSERT_FALSE(errors.str().empty());
+  ASSERT_TRUE(std::ifstream(path).good());
+  std::remove(path.c_str());
+
+  // Socket that is listened to is not taken over, the stale one is replaced
+  {
+    swm::util::UnixSocketListener active;
+    ASSERT_TRUE(active.listen(path));
+    int fd = swm::util::UnixSocketListener::connect(path);
+    ASSERT_NE(fd, -1);
+    swm::util::UnixSocketListener::close(fd);
+    swm::util::UnixSocketListener busy;
+    ASSERT_FALSE(busy.listen(path));
+  }
+  {
+    // Socket file left by a crashed process: bound, but nobody listens
+    int raw = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(bind(raw, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    ::close(raw);
+    swm::util::UnixSocketListener stale;
+    ASSERT_TRUE(stale.listen(path));
+  }
+
+  // Stop wakes the server up at once, it doesn't wait for clients
+  swm::Service service(factory(), scanner());
+  service.set_socket_path(path);
+  bool served = false;
+  std::thread server([&service, &served]() -> void { served = service.main_loop(); });
+  int fd = -1;
+  for (size_t attempt = 0; attempt < 100 && fd == -1; ++attempt) {
+    fd = swm::util::UnixSocketListener::connect(path);
+    if (fd == -1) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+  ASSERT_NE(fd, -1);
+  swm::util::UnixSocketListener::close(fd);
+  const auto begin = std::chrono::steady_clock::now();
+  service.stop();
+  server.join();
+  EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+  EXPECT_TRUE(served);
+}
+
+TEST_F(ctrl, service_shm_rings) {
+  swm::util::ShmClient client;
+  std::stringstream errors;
+  ASSERT_TRUE(client.create(1 << 20, &errors)) << errors.str();
+  swm::Service service(factory(), scanner());
+  service.set_rings(client.commands(), client.responses());
+  service.set_timeout(1.0);
+  std::thread server([&service]() -> void { service.main_loop(); });
+
+  // Broken frame is skipped, the next one is decoded in place
+  char *garbage = client.commands()->reserve(3, 1.0);
+  ASSERT_NE(garbage, nullptr);
+  memcpy(garbage, "\x7f\x00\x00", 3);
+  client.commands()->commit();
+
+  std::vector<ei_x_buff> slices(swm::util::MandatoryDataTypeCount);
+  for (auto &slice : slices) {
+    ASSERT_EQ(ei_x_new_with_version(&slice), 0);
+    ASSERT_EQ(ei_x_encode_empty_list(&slice), 0);
+  }
+  const bool sent = client.send(swm::util::SWM_COMMAND_SCHEDULE, "#ring", slices, 1.0);
+  for (auto &slice : slices) {
+    ei_x_free(&slice);
+  }
+  ASSERT_TRUE(sent);
+
+  std::string received;
+  const bool got = client.receive([&received](const char *data, size_t size) -> void {
+    received.assign(data, size);
+  }, 10.0);
+  client.close();
+  server.join();
+  ASSERT_TRUE(got);
+  EXPECT_NE(received.find("#ring"), std::string::npos);
+  EXPECT_TRUE(client.commands()->finished());
+}
+
+TEST_F(ctrl, service_shm_handshake) {
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".shm";
+  swm::Service service(factory(), scanner());
+  service.set_shm(path, 1 << 16);
+  service.set_timeout(1.0);
+  bool served = false;
+  std::thread server([&service, &served]() -> void { served = service.main_loop(); });
+
+  // Handshake socket is removed once the rings are passed
+  swm::util::ShmClient client;
+  bool connected = false;
+  for (size_t attempt = 0; attempt < 100 && !connected; ++attempt) {
+    connected = client.connect(path);
+    if (!connected) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+  ASSERT_TRUE(connected);
+  EXPECT_EQ(client.commands()->capacity(), 1 << 16);
+
+  std::vector<ei_x_buff> slices(swm::util::MandatoryDataTypeCount);
+  for (auto &slice : slices) {
+    ASSERT_EQ(ei_x_new_with_version(&slice), 0);
+    ASSERT_EQ(ei_x_encode_empty_list(&slice), 0);
+  }
+  const bool sent = client.send(swm::util::SWM_COMMAND_SCHEDULE, "#shared", slices, 1.0);
+  for (auto &slice : slices) {
+    ei_x_free(&slice);
+  }
+  ASSERT_TRUE(sent);
+
+  std::string received;
+  const bool got = client.receive([&received](const char *data, size_t size) -> void {
+    received.assign(data, size);
+  }, 10.0);
+  EXPECT_FALSE(std::ifstream(path).good());
+
+  // Service finishes on stop() while the client keeps the ring of commands open
+  service.stop();
+  server.join();
+  ASSERT_TRUE(got);
+  EXPECT_TRUE(served);
+  EXPECT_NE(received.find("#shared"), std::string::npos);
+  EXPECT_TRUE(client.responses()->closed());
+}
+
+TEST_F(ctrl, service_tracing) {
+  std::stringstream input;
+  std::stringstream output;
+  write_empty_schedule_command("#traced", nullptr, &input);
+  const std::string path = find_temp_dir() + "/swm-sched-tests-" + std::to_string(getpid()) + ".json";
+
+  swm::Service service(factory(), scanner());
+  service.set_input(&input);
+  service.set_output(&output);
+  service.set_tracing(path);
+  ASSERT_FALSE(service.dump_trace());
+  ASSERT_TRUE(service.main_loop());
+  ASSERT_FALSE(service.dump_trace());
+
+  // Every stage of the request is on the timeline
+  std::ifstream file(path);
+  std::stringstream trace;
+  trace << file.rdbuf();
+  for (const char *name : { "receiver.read", "receiver.parse", "processor.request", "chain.run", "sender.send" }) {
+    EXPECT_NE(trace.str().find(std::string("\"") + name + "\""), std::string::npos) << name;
+  }
+  std::remove(path.c_str());
+
+  service.set_tracing(find_temp_dir() + "/not-existing-directory/trace.json");
+  ASSERT_FALSE(service.main_loop());
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "ctrl.h"
+#include "ctrl/timetable_cache.h"
+
+TEST_F(ctrl, timetable_cache_lru) {
+  swm::util::TimetableCache cache(2, 60.0);
+  swm::util::TimetableCache::Result r1, r2, r3, found;
+  r1.timetable.reset(new TimetableInfoForTests(std::vector<const swm::SwmTimetable *>()));
+  r2.timetable.reset(new TimetableInfoForTests(std::vector<const swm::SwmTimetable *>()));
+  r3.timetable.reset(new TimetableInfoForTests(std::vector<const swm::SwmTimetable *>()));
+
+  ASSERT_FALSE(cache.find("1", &found));
+  cache.insert("1", r1);
+  cache.insert("2", r2);
+  ASSERT_TRUE(cache.find("1", &found));
+  ASSERT_EQ(found.timetable.get(), r1.timetable.get());
+
+  // "2" is the least recently used one now
+  cache.insert("3", r3);
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_FALSE(cache.find("2", &found));
+  ASSERT_TRUE(cache.find("1", &found));
+  ASSERT_TRUE(cache.find("3", &found));
+  ASSERT_EQ(found.timetable.get(), r3.timetable.get());
+
+  // Newer result of the same key replaces the older one
+  cache.insert("3", r2);
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_TRUE(cache.find("3", &found));
+  ASSERT_EQ(found.timetable.get(), r2.timetable.get());
+}
+
+TEST_F(ctrl, timetable_cache_ttl) {
+  swm::util::TimetableCache cache(4, 0.05);
+  swm::util::TimetableCache::Result r, found;
+  r.timetable.reset(new TimetableInfoForTests(std::vector<const swm::SwmTimetable *>()));
+  cache.insert("1", r);
+  ASSERT_TRUE(cache.find("1", &found));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_FALSE(cache.find("1", &found));
+  ASSERT_EQ(cache.size(), 0);
+
+  ASSERT_THROW(swm::util::TimetableCache(0, 1.0), std::runtime_error);
+  ASSERT_THROW(swm::util::TimetableCache(1, 0.0), std::runtime_error);
+}
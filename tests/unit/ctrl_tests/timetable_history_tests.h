@@ -0,0 +1,159 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "test_defs.h"
+#include "ctrl.h"
+#include "ctrl/constants.h"
+#include "ctrl/responses.h"
+#include "ctrl/sender.h"
+#include "ctrl/timetable_history.h"
+#include "chn/metrics_snapshot.h"
+
+static swm::SwmTimetable make_timetable(const std::string &job, uint64_t start,
+                                        const std::vector<std::string> &nodes) {
+  swm::SwmTimetable table;
+  table.set_job_id(job);
+  table.set_start_time(start);
+  table.set_job_nodes(nodes);
+  return table;
+}
+
+TEST_F(ctrl, timetable_history_acknowledgement) {
+  typedef swm::util::TimetableHistory::Snapshot Snapshot;
+  swm::util::TimetableHistory history(2);
+  std::shared_ptr<Snapshot> s1(new Snapshot()), s2(new Snapshot()), s3(new Snapshot());
+
+  ASSERT_EQ(history.push("client", "main", "", "#1", s1).get(), nullptr);
+  ASSERT_EQ(history.push("client", "main", "#1", "#2", s2).get(), s1.get());
+  ASSERT_EQ(history.push("client", "other", "#1", "#1", s1).get(), nullptr);
+  ASSERT_EQ(history.stream_count(), 2);
+
+  // Client is allowed to acknowledge any result which was not superseded by acknowledged one
+  ASSERT_EQ(history.push("client", "main", "#2", "#3", s3).get(), s2.get());
+  ASSERT_EQ(history.push("client", "main", "#1", "#4", s3).get(), nullptr);
+}
+
+TEST_F(ctrl, timetable_history_eviction) {
+  typedef swm::util::TimetableHistory::Snapshot Snapshot;
+  ASSERT_ANY_THROW(swm::util::TimetableHistory(4, 0));
+  swm::util::TimetableHistory history(4, 2);
+  std::shared_ptr<Snapshot> s1(new Snapshot());
+
+  // The least recently used stream is forgotten, its client has to resync
+  history.push("client-1", "main", "", "#1", s1);
+  history.push("client-2", "main", "", "#1", s1);
+  ASSERT_EQ(history.push("client-1", "main", "#1", "#2", s1).get(), s1.get());
+  history.push("client-3", "main", "", "#1", s1);
+  ASSERT_EQ(history.stream_count(), 2);
+  ASSERT_EQ(history.push("client-2", "main", "#1", "#2", s1).get(), nullptr);
+  ASSERT_EQ(history.push("client-3", "main", "#1", "#2", s1).get(), s1.get());
+}
+
+TEST_F(ctrl, timetable_diff_response) {
+  typedef swm::util::TimetableHistory::Snapshot Snapshot;
+  Snapshot base, current;
+  base["1"] = make_timetable("1", 0, { "node1" });
+  base["2"] = make_timetable("2", 10, { "node2" });
+  base["3"] = make_timetable("3", 20, { "node3" });
+  current["1"] = make_timetable("1", 0, { "node1" });
+  current["2"] = make_timetable("2", 15, { "node2" });
+  current["4"] = make_timetable("4", 30, { "node1", "node3" });
+
+  std::shared_ptr<swm::util::MetricsSnapshot> m(new swm::util::MetricsSnapshot());
+  swm::util::TimetableDiffResponse resp(create_context("#2"), "#1", base, current, m);
+  ASSERT_TRUE(resp.succeeded());
+  ASSERT_EQ(resp.added().size(), 1);
+  ASSERT_EQ(resp.added()[0].get_job_id(), "4");
+  ASSERT_EQ(resp.changed().size(), 1);
+  ASSERT_EQ(resp.changed()[0].get_job_id(), "2");
+  ASSERT_EQ(resp.removed(), std::vector<std::string>({ "3" }));
+}
+
+// Timetables encoded by make_timetables_ei_buffer(): job ids in order
+static void decode_timetable_ids(const char *buf, int *index, std::vector<std::string> *ids) {
+  int count = 0;
+  ASSERT_EQ(ei_decode_list_header(buf, index, &count), 0);
+  for (int i = 0; i < count; ++i) {
+    int arity = 0;
+    char atom[MAXATOMLEN];
+    unsigned long start = 0;
+    char job[256];
+    ASSERT_EQ(ei_decode_tuple_header(buf, index, &arity), 0);
+    ASSERT_EQ(arity, 4);
+    ASSERT_EQ(ei_decode_atom(buf, index, atom), 0);
+    ASSERT_EQ(std::string(atom), "timetable");
+    ASSERT_EQ(ei_decode_ulong(buf, index, &start), 0);
+    ASSERT_EQ(ei_decode_string(buf, index, job), 0);
+    ASSERT_EQ(ei_skip_term(buf, index), 0);
+    ids->push_back(job);
+  }
+  if (count != 0) {
+    ASSERT_EQ(ei_decode_list_header(buf, index, &count), 0);
+    ASSERT_EQ(count, 0);
+  }
+}
+
+TEST_F(ctrl, timetable_diff_response_round_trip) {
+  typedef swm::util::TimetableHistory::Snapshot Snapshot;
+  Snapshot base, current;
+  base["1"] = make_timetable("1", 0, { "node1" });
+  base["2"] = make_timetable("2", 10, { "node2" });
+  current["1"] = make_timetable("1", 5, { "node1" });
+  current["2"] = make_timetable("2", 10, { });            // not placed anymore
+  current["3"] = make_timetable("3", 30, { });            // never placed
+  current["4"] = make_timetable("4", 30, { "node1", "node3" });
+
+  // Response goes through the sender, as it does on the wire
+  std::shared_ptr<swm::util::MetricsSnapshot> m(new swm::util::MetricsSnapshot());
+  std::stringstream out;
+  {
+    swm::util::Sender sender;
+    swm::util::BlockingQueue<std::shared_ptr<swm::util::ResponseInterface> > queue(1);
+    ASSERT_NO_THROW(sender.init(&queue, &out));
+    queue.push(std::shared_ptr<swm::util::ResponseInterface>(
+      new swm::util::TimetableDiffResponse(create_context("#2"), "#1", base, current, m)));
+    ASSERT_NO_THROW(sender.close());
+  }
+  const std::string data = out.str();
+  const size_t size = data.size();
+  ASSERT_GT(size, 0);
+
+  const char *buf = data.data();
+  int index = 0;
+  int version = 0;
+  int arity = 0;
+  char atom[MAXATOMLEN];
+  ASSERT_EQ(ei_decode_version(buf, &index, &version), 0);
+  ASSERT_EQ(ei_decode_tuple_header(buf, &index, &arity), 0);
+  ASSERT_EQ(arity, (int)swm::util::SwmSchedulerResultDiffTupleSize);
+  ASSERT_EQ(ei_decode_atom(buf, &index, atom), 0);
+  ASSERT_EQ(std::string(atom), "scheduler_result_diff");
+
+  std::vector<std::string> added, changed;
+  decode_timetable_ids(buf, &index, &added);
+  ASSERT_EQ(added, std::vector<std::string>({ "4" }));
+
+  int removed = 0;
+  char job[256];
+  ASSERT_EQ(ei_decode_list_header(buf, &index, &removed), 0);
+  ASSERT_EQ(removed, 1);
+  ASSERT_EQ(ei_decode_string(buf, &index, job), 0);
+  ASSERT_EQ(std::string(job), "2");
+  ASSERT_EQ(ei_decode_list_header(buf, &index, &removed), 0);
+  ASSERT_EQ(removed, 0);
+
+  decode_timetable_ids(buf, &index, &changed);
+  ASSERT_EQ(changed, std::vector<std::string>({ "1" }));
+  ASSERT_EQ(ei_skip_term(buf, &index), 0);                // metrics
+
+  char request_id[256];
+  ASSERT_EQ(ei_decode_string(buf, &index, request_id), 0);
+  ASSERT_EQ(std::string(request_id), "#1");
+  ASSERT_EQ(ei_decode_string(buf, &index, request_id), 0);
+  ASSERT_EQ(std::string(request_id), "#2");
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(ei_skip_term(buf, &index), 0);              // status and times
+  }
+  ASSERT_EQ((size_t)index, size);
+}
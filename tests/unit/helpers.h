@@ -39,4 +39,9 @@ class EmptyPluginEvents : public swm::PluginEventsInterface {
   virtual bool forced_to_interrupt() const override { return false; }
   virtual void commit_intermediate_timetable(
     const std::shared_ptr<swm::TimetableInfoInterface> &) override { }
+  virtual const swm::CancellationToken &cancellation_token() const override { return token_; }
+  virtual clock::time_point deadline() const override { return clock::time_point::max(); }
+
+ private:
+  swm::CancellationToken token_;
 };
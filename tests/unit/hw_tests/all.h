@@ -1,4 +1,4 @@
-
 #pragma once
 
+#include "cpu_topology_tests.h"
 #include "scanner_tests.h"
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#if !defined(WIN32)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "test_defs.h"
+#include "hw/cpu_topology.h"
+#include "hw/scanner.h"
+
+#if !defined(WIN32)
+
+// Creates file with all missing directories
+static void write_sysfs_file(const std::string &root, const std::string &path, const std::string &content) {
+  for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+    mkdir((root + "/" + path.substr(0, pos)).c_str(), 0755);
+  }
+  std::ofstream fstr(root + "/" + path);
+  fstr << content << std::endl;
+}
+
+// Two nodes: the first one has two cores with two threads each, the second - one core with two threads.
+// Returns the root of the fake file system, sysfs is in "<root>/sys/devices/system"
+static std::string create_fake_sysfs() {
+  const std::string root = find_temp_dir() + "/swm-sched-fake-root-" + std::to_string(getpid());
+  mkdir(root.c_str(), 0755);
+  write_sysfs_file(root, "sys/devices/system/cpu/online", "0-5");
+  write_sysfs_file(root, "sys/devices/system/node/online", "0-1");
+  write_sysfs_file(root, "sys/devices/system/node/node0/cpulist", "0-1,3-4");
+  write_sysfs_file(root, "sys/devices/system/node/node1/cpulist", "2,5");
+
+  std::string cpuinfo;
+  for (size_t i = 0; i < 6; ++i) {
+    cpuinfo += "processor\t: " + std::to_string(i) + "\n" +
+               "model name\t: Intel(R) Fake CPU\n" +
+               "cpu MHz\t\t: " + std::to_string(2000 + i) + ".500\n\n";
+  }
+  write_sysfs_file(root, "proc/cpuinfo", cpuinfo);
+  write_sysfs_file(root, "proc/self/cgroup", "0::/");
+
+  const int cores[] = { 0, 1, 0, 0, 1, 0 };
+  const int packages[] = { 0, 0, 1, 0, 0, 1 };
+  const char *siblings[] = { "0,3", "1,4", "2,5", "0,3", "1,4", "2,5" };
+  const char *l3[] = { "0-1,3-4", "0-1,3-4", "2,5", "0-1,3-4", "0-1,3-4", "2,5" };
+  for (size_t i = 0; i < 6; ++i) {
+    const std::string dir = "sys/devices/system/cpu/cpu" + std::to_string(i) + "/";
+    write_sysfs_file(root, dir + "topology/core_id", std::to_string(cores[i]));
+    write_sysfs_file(root, dir + "topology/physical_package_id", std::to_string(packages[i]));
+    write_sysfs_file(root, dir + "topology/thread_siblings_list", siblings[i]);
+    write_sysfs_file(root, dir + "cache/index0/level", "1");
+    write_sysfs_file(root, dir + "cache/index0/type", "Data");
+    write_sysfs_file(root, dir + "cache/index0/size", "32K");
+    write_sysfs_file(root, dir + "cache/index0/shared_cpu_list", siblings[i]);
+    write_sysfs_file(root, dir + "cache/index1/level", "3");
+    write_sysfs_file(root, dir + "cache/index1/type", "Unified");
+    write_sysfs_file(root, dir + "cache/index1/size", "16M");
+    write_sysfs_file(root, dir + "cache/index1/shared_cpu_list", l3[i]);
+  }
+  return root;
+}
+
+TEST(hw, cpu_topology_parse_cpu_list) {
+  std::vector<size_t> cpus;
+  ASSERT_TRUE(swm::CpuTopology::parse_cpu_list("0-3,8,10-11", &cpus));
+  ASSERT_EQ(cpus, std::vector<size_t>({ 0, 1, 2, 3, 8, 10, 11 }));
+  ASSERT_TRUE(swm::CpuTopology::parse_cpu_list("", &cpus));
+  ASSERT_TRUE(cpus.empty());
+  ASSERT_FALSE(swm::CpuTopology::parse_cpu_list("3-1", &cpus));
+  ASSERT_FALSE(swm::CpuTopology::parse_cpu_list("1,x", &cpus));
+  ASSERT_ANY_THROW(swm::CpuTopology::parse_cpu_list("1", nullptr));
+}
+
+TEST(hw, cpu_topology_fake_sysfs) {
+  const std::string root = create_fake_sysfs();
+  swm::CpuTopology topology;
+  std::stringstream errors;
+  ASSERT_FALSE(topology.read(root + "/missing", &errors));
+  ASSERT_TRUE(topology.empty());
+  ASSERT_TRUE(topology.read(root + "/sys/devices/system", &errors)) << errors.str();
+
+  ASSERT_EQ(topology.cpus().size(), 6);
+  ASSERT_EQ(topology.physical_cores(), 3);
+  ASSERT_EQ(topology.nodes(), std::vector<int>({ 0, 1 }));
+  ASSERT_EQ(topology.cpus()[4].siblings, std::vector<size_t>({ 1, 4 }));
+  ASSERT_EQ(topology.cpus()[5].node, 1);
+
+  // The first threads of cores go first
+  ASSERT_EQ(topology.node_cpus(0), std::vector<size_t>({ 0, 1, 3, 4 }));
+  ASSERT_EQ(topology.node_cpus(1), std::vector<size_t>({ 2, 5 }));
+
+  // Three L1 caches (one per core) and two L3 caches (one per node)
+  ASSERT_EQ(topology.caches().size(), 5);
+  size_t l3_size = 0;
+  for (const auto &cache : topology.caches()) {
+    if (cache.level == 3) {
+      l3_size += cache.size_kb;
+    }
+  }
+  ASSERT_EQ(l3_size, 2 * 16 * 1024);
+}
+
+TEST(hw, scanner_numa_nodes) {
+  swm::Scanner sc(create_fake_sysfs());
+  ASSERT_TRUE(sc.scan());
+  ASSERT_EQ(sc.cpu()->name(), "Intel(R) Fake CPU");
+  ASSERT_EQ(sc.cpu()->cores(), 6);
+  ASSERT_DOUBLE_EQ(sc.cpu()->frequency_mhz(), 2005.5);
+  ASSERT_EQ(sc.numa_nodes().size(), 2);
+  ASSERT_EQ(sc.numa_nodes()[1]->device_number(), 1);
+  ASSERT_EQ(sc.numa_nodes()[1]->cores(), 2);
+  ASSERT_EQ(sc.numa_nodes()[1]->cpus(), std::vector<size_t>({ 2, 5 }));
+  ASSERT_EQ(sc.numa_nodes()[0]->device_type(), swm::ComputeUnitInterface::Cpu);
+}
+
+TEST(hw, cpu_limits_cgroup_v2) {
+  const std::string root = create_fake_sysfs();
+  write_sysfs_file(root, "proc/self/cgroup", "0::/sched");
+  write_sysfs_file(root, "sys/fs/cgroup/cpu.max", "max 100000");
+  write_sysfs_file(root, "sys/fs/cgroup/sched/cpu.max", "150000 100000");
+  write_sysfs_file(root, "sys/fs/cgroup/sched/cpuset.cpus.effective", "1-2,4");
+
+  swm::CpuLimits limits;
+  std::stringstream errors;
+  ASSERT_TRUE(limits.read(root, &errors)) << errors.str();
+  ASSERT_DOUBLE_EQ(limits.quota(), 1.5);
+  ASSERT_EQ(limits.cpuset(), std::vector<size_t>({ 1, 2, 4 }));
+  ASSERT_EQ(limits.usable_cpus({ 0, 1, 2, 3, 4, 5 }), 2);
+  ASSERT_EQ(limits.filter({ 0, 1, 3, 4 }), std::vector<size_t>({ 1, 4 }));
+
+  // Pools are sized by the quota, nodes keep their usable CPUs only
+  swm::Scanner sc(root);
+  ASSERT_TRUE(sc.scan());
+  ASSERT_EQ(sc.cpu()->cores(), 2);
+  ASSERT_EQ(sc.cpu()->cpus(), std::vector<size_t>({ 1, 2, 4 }));
+  ASSERT_EQ(sc.numa_nodes().size(), 2);
+  ASSERT_EQ(sc.numa_nodes()[0]->cpus(), std::vector<size_t>({ 1, 4 }));
+  ASSERT_EQ(sc.numa_nodes()[1]->cores(), 1);
+
+}
+
+TEST(hw, cpu_limits_cgroup_v1) {
+  const std::string root = create_fake_sysfs();
+  write_sysfs_file(root, "proc/self/cgroup", "4:cpu,cpuacct:/host/path\n3:cpuset:/\n2:memory:/");
+  write_sysfs_file(root, "sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "300000");
+  write_sysfs_file(root, "sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us", "100000");
+  write_sysfs_file(root, "sys/fs/cgroup/cpuset/cpuset.cpus", "0-3");
+
+  swm::CpuLimits limits;
+  std::stringstream errors;
+  ASSERT_TRUE(limits.read(root, &errors)) << errors.str();
+  ASSERT_DOUBLE_EQ(limits.quota(), 3.0);
+  ASSERT_EQ(limits.cpuset(), std::vector<size_t>({ 0, 1, 2, 3 }));
+  ASSERT_FALSE(limits.read(root + "/missing", &errors));
+
+}
+
+#endif
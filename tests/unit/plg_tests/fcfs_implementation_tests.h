@@ -100,3 +100,35 @@ TEST_F(plg, fcfs_priorities) {
   ASSERT_EQ(tts[1].get_start_time(), 0); ASSERT_EQ(tts[1].get_job_nodes().size(), 1);
   ASSERT_EQ(tts[2].get_start_time(), 3); ASSERT_EQ(tts[2].get_job_nodes().size(), 1);
 }
+
+TEST_F(plg, fcfs_interrupted) {
+  // The deadline is over from the start, it's noticed at the first job
+  class ExpiredEvents : public EmptyPluginEvents {
+   public:
+    virtual clock::time_point deadline() const override { return clock::now() - std::chrono::seconds(1); }
+  } events;
+
+  SchedulingInfoConfigurator config;
+  auto cluster = config.create_cluster("1", "up");
+  auto part = cluster->create_partition("1", "up");
+  part->create_node("1", "up", "idle");
+  for (size_t i = 0; i < 10; ++i) {
+    auto job = config.create_job(std::to_string(i), "1", 1);
+    job->create_request("node", 1);
+  }
+  std::shared_ptr<swm::SchedulingInfoInterface> info;
+  config.construct(&info);
+
+  // Interrupted schedule fails, nothing was placed before the check
+  swm::FcfsImplementation fcfs;
+  std::vector<swm::SwmTimetable> tts;
+  std::stringstream errors;
+  ASSERT_TRUE(fcfs.init(info.get()));
+  ASSERT_FALSE(fcfs.schedule(info->jobs(), &events, &tts, true, &errors));
+  ASSERT_TRUE(tts.empty());
+  ASSERT_FALSE(errors.str().empty());
+
+  EmptyPluginEvents running;
+  ASSERT_TRUE(fcfs.schedule(info->jobs(), &running, &tts, true));
+  ASSERT_EQ(tts.size(), 10);
+}